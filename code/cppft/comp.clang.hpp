@@ -232,6 +232,10 @@
 /// generate to fall back on from Case clauses. The typedef is required in some cases, do not remove.
 #define XTL_UNUSED_TYPEDEF __attribute__((unused))
 #endif
+#if __has_builtin(__builtin_prefetch)
+/// A macro to hint the processor to bring the memory at the given address into cache
+#define XTL_PREFETCH(p) __builtin_prefetch(p)
+#endif
 
 //------------------------------------------------------------------------------
 
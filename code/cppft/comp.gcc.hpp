@@ -217,6 +217,8 @@
 #define XTL_FORCE_INLINE_BEGIN __attribute__ ((always_inline)) static inline 
 /// A macro that is supposed to be put after  the function definition whose body must be inlined
 #define XTL_FORCE_INLINE_END
+/// A macro to hint the processor to bring the memory at the given address into cache
+#define XTL_PREFETCH(p) __builtin_prefetch(p)
 
 /// An attribute used in GCC code to silence warning about potentially unused typedef target_type, which we
 /// generate to fall back on from Case clauses. The typedef is required in some cases, do not remove.
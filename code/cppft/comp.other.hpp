@@ -163,6 +163,32 @@
 #define XTL_SUPPORT_std_is_nothrow_copy_constructible 0
 #endif
 
+//------------------------------------------------------------------------------
+/// Support of std::string_view
+/// \see http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2013/n3762.html
+#if !defined(XTL_SUPPORT_std_string_view)
+    #if __cplusplus >= 201703L || defined(_MSVC_LANG) && _MSVC_LANG >= 201703L
+    #define XTL_SUPPORT_std_string_view 1
+    #else
+    #define XTL_SUPPORT_std_string_view 0
+    #endif
+#endif
+
+//------------------------------------------------------------------------------
+/// Support of std::from_chars for integral types. Floating-point overloads came
+/// later to most libraries and are detected separately with __cpp_lib_to_chars.
+/// \see http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2016/p0067r5.html
+#if !defined(XTL_SUPPORT_std_from_chars)
+    #if XTL_SUPPORT_std_string_view && defined(__has_include)
+        #if __has_include(<charconv>)
+        #define XTL_SUPPORT_std_from_chars 1
+        #endif
+    #endif
+    #if !defined(XTL_SUPPORT_std_from_chars)
+    #define XTL_SUPPORT_std_from_chars 0
+    #endif
+#endif
+
 //------------------------------------------------------------------------------
 
 #if !defined(XTL_MSC_ONLY)
@@ -250,6 +276,11 @@
     #define XTL_FORCE_INLINE_END
 #endif
 
+#if !defined(XTL_PREFETCH)
+    /// A macro to hint the processor to bring the memory at the given address into cache
+    #define XTL_PREFETCH(p) ((void)0)
+#endif
+
 #if !defined(XTL_UNUSED_TYPEDEF)
     /// An attribute used in GCC code to silence warning about potentially unused typedef target_type, which we
     /// generate to fall back on from Case clauses. The typedef is required in some cases, do not remove.
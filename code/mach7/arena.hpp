@@ -0,0 +1,345 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines dispatch_arena: the allocator of memory for dispatch
+/// tables of all the match statements (vtbl maps, their cache descriptors,
+/// entries and sealed tables). When enabled with #XTL_DISPATCH_ARENA, the
+/// tables are carved out of large chunks instead of being scattered across
+/// the heap. Either way the allocator keeps track of the memory used by the
+/// dispatch tables, \see dispatch_table_memory().
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+// --------------------[ Arena Layout ]--------------------
+// - Blocks are deallocated with the same size they were allocated with, which
+//   every dispatch table knows, so no block is preceded by a header.
+// - With #XTL_DISPATCH_ARENA off (default) blocks come straight from the heap
+//   and the allocator only keeps the counters, which are atomic.
+// - With #XTL_DISPATCH_ARENA on, chunks of #XTL_DISPATCH_ARENA_CHUNK_SIZE
+//   bytes are obtained from the heap and handed out by bumping a pointer.
+//   Dispatch tables are thus laid out in the order they were allocated in,
+//   which for most programs is the order in which their match statements were
+//   first executed. Tables allocated by warm-up (\see mch::warm_up_all) and
+//   sealing (\see mch::freeze_all) end up adjacent to each other as well.
+// - Sizes are then rounded up to one of 4 classes per power of 2, wasting at
+//   most 25%. Freed blocks are kept in per-class free lists and reused by
+//   subsequent allocations of the same class. Memory is never returned to the
+//   heap: dispatch tables live as long as the program anyway and free blocks
+//   of tables that grew get reused by other tables that grow.
+// - Blocks larger than half a chunk get a chunk of their own.
+// - Allocation and deallocation only happen on slow paths of dispatch (when a
+//   table grows), so the arena is protected by a simple spin lock.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include "config.hpp"    // Various compiler/platform dependent macros
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Summary of memory used by dispatch tables
+struct dispatch_memory
+{
+    size_t in_use;      ///< Bytes in blocks currently allocated to dispatch tables
+    size_t reserved;    ///< Bytes obtained from the heap for dispatch tables
+    size_t allocations; ///< Number of blocks currently allocated
+};
+
+//------------------------------------------------------------------------------
+
+/// Allocator of memory for dispatch tables
+struct dispatch_arena
+{
+#if XTL_DISPATCH_ARENA
+
+    /// Allocates a block of memory of at least n bytes aligned for any type
+    static void* allocate(size_t n)
+    {
+        const size_t c = size_class(n);
+        lock_guard guard;
+        state& s = get_state();
+        void*  p = take(s, c);
+        s.in_use += class_size(c);
+        s.allocations++;
+        return p;
+    }
+
+    /// Deallocates a block of n bytes previously allocated with #allocate(n)
+    static void deallocate(void* p, size_t n) noexcept
+    {
+        if (!p)
+            return;
+
+        const size_t c = size_class(n);
+        lock_guard guard;
+        state& s = get_state();
+        s.in_use -= class_size(c);
+        s.allocations--;
+        give(s, p, c);
+    }
+
+    /// Returns a summary of memory used by dispatch tables
+    static dispatch_memory memory() noexcept
+    {
+        lock_guard guard;
+        const state& s = get_state();
+        dispatch_memory result = { s.in_use, s.reserved, s.allocations };
+        return result;
+    }
+
+#else
+
+    /// Allocates a block of memory of at least n bytes aligned for any type
+    static void* allocate(size_t n)
+    {
+        void* p = ::operator new(n);
+        counters& s = get_counters();
+        s.in_use.fetch_add(n, std::memory_order_relaxed);
+        s.allocations.fetch_add(1, std::memory_order_relaxed);
+        return p;
+    }
+
+    /// Deallocates a block of n bytes previously allocated with #allocate(n)
+    static void deallocate(void* p, size_t n) noexcept
+    {
+        if (!p)
+            return;
+
+        counters& s = get_counters();
+        s.in_use.fetch_sub(n, std::memory_order_relaxed);
+        s.allocations.fetch_sub(1, std::memory_order_relaxed);
+        ::operator delete(p);
+    }
+
+    /// Returns a summary of memory used by dispatch tables
+    static dispatch_memory memory() noexcept
+    {
+        const counters& s = get_counters();
+        const size_t  n = s.in_use.load(std::memory_order_relaxed);
+        dispatch_memory result = { n, n, s.allocations.load(std::memory_order_relaxed) };
+        return result;
+    }
+
+#endif
+
+    /// Allocates and default-constructs an array of n objects of type T
+    template <typename T>
+    static T* new_array(size_t n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+        size_t* p = static_cast<size_t*>(allocate(array_size<T>(n)));
+        *p = n;
+        T* a = reinterpret_cast<T*>(reinterpret_cast<char*>(p) + sizeof(std::max_align_t));
+
+        for (size_t i = 0; i < n; ++i)
+            ::new(static_cast<void*>(a+i)) T();
+
+        return a;
+    }
+
+    /// Destroys and deallocates an array previously allocated with #new_array
+    template <typename T>
+    static void delete_array(T* a) noexcept
+    {
+        if (!a)
+            return;
+
+        size_t* p = reinterpret_cast<size_t*>(reinterpret_cast<char*>(a) - sizeof(std::max_align_t));
+        const size_t n = *p;
+
+        for (size_t i = n; i > 0; --i)
+            a[i-1].~T();
+
+        deallocate(p, array_size<T>(n));
+    }
+
+    /// Destroys an object of type T occupying a block of n bytes previously
+    /// allocated with #allocate(n). This is how dispatch tables of variable
+    /// size are deleted, since a delete expression does not know their size.
+    template <typename T>
+    static void destroy(T* p, size_t n) noexcept
+    {
+        if (!p)
+            return;
+
+        p->~T();
+        deallocate(p, n);
+    }
+
+private:
+
+    /// Bytes needed by #new_array for n objects of type T, including the count
+    template <typename T>
+    static size_t array_size(size_t n) noexcept { return sizeof(std::max_align_t) + n*sizeof(T); }
+
+#if XTL_DISPATCH_ARENA
+
+    /// Unit of allocation that keeps all the blocks aligned for any type
+    static const size_t unit = sizeof(std::max_align_t);
+
+    /// Number of size classes per power of 2
+    static const size_t classes_per_power = 4;
+
+    /// Total number of size classes
+    static const size_t number_of_classes = classes_per_power * sizeof(size_t) * 8;
+
+    /// State of the arena. It is trivially destructible, so that dispatch tables
+    /// of statics destroyed at program exit can still be deallocated.
+    struct state
+    {
+        void*  free_list[number_of_classes]; ///< Heads of lists of free blocks of each class
+        char*  bump;                         ///< Next free byte of the current chunk
+        char*  bump_end;                     ///< End of the current chunk
+        size_t in_use;
+        size_t reserved;
+        size_t allocations;
+    };
+
+    static state& get_state() noexcept
+    {
+        static state s; // Zero-initialized as a POD with static storage duration
+        return s;
+    }
+
+    /// Spin lock protecting the state: allocations happen only on slow paths
+    static std::atomic_flag& busy() noexcept { static std::atomic_flag flag = ATOMIC_FLAG_INIT; return flag; }
+
+    struct lock_guard
+    {
+        lock_guard()  noexcept { while (busy().test_and_set(std::memory_order_acquire)) ; }
+       ~lock_guard()  noexcept { busy().clear(std::memory_order_release); }
+    };
+
+    /// Size classes are multiples of the unit up to 4 units, and then 4 evenly
+    /// spaced sizes in each interval (2^e,2^(e+1)] of units
+    static size_t size_class(size_t n) noexcept
+    {
+        size_t units = (n + unit - 1) / unit;
+
+        if (units <= classes_per_power)
+            return units;
+
+        size_t e = 0; // floor(log2(units-1))
+        while ((units-1) >> (e+1)) ++e;
+
+        const size_t step = size_t(1) << (e - 2); // e >= 2 here since units > 4
+        return classes_per_power*(e-1) + (units - 1 - (size_t(1) << e)) / step + 1;
+    }
+
+    /// Size in bytes of blocks of the given class
+    static size_t class_size(size_t c) noexcept
+    {
+        if (c <= classes_per_power)
+            return c*unit;
+
+        const size_t e    = (c-1) / classes_per_power + 1;
+        const size_t step = size_t(1) << (e - 2);
+        return ((size_t(1) << e) + ((c-1) % classes_per_power + 1)*step)*unit;
+    }
+
+    /// Takes a free block of the given class or carves a new one
+    static void* take(state& s, size_t c)
+    {
+        if (void* p = s.free_list[c])
+        {
+            s.free_list[c] = *static_cast<void**>(p);
+            return p;
+        }
+
+        const size_t n = class_size(c);
+
+        if (n <= XTL_DISPATCH_ARENA_CHUNK_SIZE/2)
+        {
+            if (size_t(s.bump_end - s.bump) < n)
+            {
+                // The rest of the current chunk is abandoned
+                s.bump     = static_cast<char*>(::operator new(XTL_DISPATCH_ARENA_CHUNK_SIZE));
+                s.bump_end = s.bump + XTL_DISPATCH_ARENA_CHUNK_SIZE;
+                s.reserved+= XTL_DISPATCH_ARENA_CHUNK_SIZE;
+            }
+
+            void* p = s.bump;
+            s.bump += n;
+            return p;
+        }
+
+        s.reserved += n;
+        return ::operator new(n);
+    }
+
+    /// Puts the block into the free list of its class
+    static void give(state& s, void* p, size_t c) noexcept
+    {
+        *static_cast<void**>(p) = s.free_list[c];
+        s.free_list[c] = p;
+    }
+
+#else
+
+    /// Counters of memory taken straight from the heap
+    struct counters
+    {
+        std::atomic<size_t> in_use;
+        std::atomic<size_t> allocations;
+    };
+
+    static counters& get_counters() noexcept
+    {
+        static counters s; // Zero-initialized with static storage duration and trivially destructible
+        return s;
+    }
+
+#endif
+};
+
+//------------------------------------------------------------------------------
+
+/// Returns a summary of memory used by dispatch tables of all match statements
+inline dispatch_memory dispatch_table_memory() noexcept { return dispatch_arena::memory(); }
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
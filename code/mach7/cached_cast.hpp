@@ -0,0 +1,156 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file defines function cached_cast<T>(U), which behaves as the cast the
+/// library uses to check dynamic types of subjects (see #XTL_SUBTYPE_CAST), 
+/// but remembers the outcome of the cast for each vtbl-pointer it has seen. 
+/// Nested constructor patterns use it with #XTL_CACHE_NESTED_CASTS enabled,
+/// so that every level of a tree pattern gets the constant-time amortized 
+/// type test that only the outermost Match used to get from its vtbl map.
+///
+/// Unlike memoized_cast, it does not depend on any vtbl map, so it can be used
+/// with every Match statement, and it keeps a separate small direct-mapped 
+/// table of offsets per thread for each pair of source and target types, 
+/// which needs no synchronization. A cast whose vtbl-pointer collides with
+/// another one in the table is just made again.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include "config.hpp"       // Various compiler/platform dependent macros
+#include "ptrtools.hpp"     // Helper functions to work with pointers
+#if XTL_USE_DISPLAY_CAST
+#include "display_cast.hpp" // Constant-time casts in registered hierarchies
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Per-thread direct-mapped table of offsets of the target type T from the 
+/// source type U for the dynamic types of the objects cast so far, indexed by
+/// their vtbl-pointers.
+template <typename T, typename U>
+struct cached_test
+{
+    /// Log of the number of remembered dynamic types per thread
+    static const std::size_t log_size = XTL_CACHED_CAST_LOG_SIZE;
+
+    /// Offset marking the dynamic types that cannot be cast to T
+    static const std::ptrdiff_t no_cast = std::numeric_limits<std::ptrdiff_t>::min();
+
+    /// Only downcasts and cross-casts from polymorphic types need a test. With
+    /// displays, the casts within registered hierarchies are constant already.
+    static const bool needs_cache = std::is_polymorphic<U>::value
+                                && !std::is_base_of<T,U>::value
+                            #if XTL_USE_DISPLAY_CAST
+                                && !is_display_castable<U,T>::value
+                            #endif
+                                ;
+
+    /// Outcome of the cast of objects sharing a vtbl-pointer
+    struct entry
+    {
+        std::intptr_t  vtbl;   ///< vtbl-pointer of the objects. 0 in unused entries.
+        std::ptrdiff_t offset; ///< Offset of T in them or #no_cast
+    };
+
+    static inline const T* cast(const U* u) noexcept
+    {
+        return cast(u, std::integral_constant<bool, needs_cache>());
+    }
+
+private:
+
+    static inline const T* cast(const U* u, std::false_type) noexcept
+    {
+        return XTL_SUBTYPE_CAST<const T*>(u);
+    }
+
+    static inline const T* cast(const U* u, std::true_type) noexcept
+    {
+        // NOTE: The table is zero-initialized POD, which lets compilers access
+        //       it without any initialization guards.
+        static thread_local entry table[std::size_t(1) << log_size];
+
+        const std::intptr_t vtbl = vtbl_of(u);
+        entry& e = table[(std::size_t(vtbl) >> XTL_IRRELEVANT_VTBL_BITS) & ((std::size_t(1) << log_size) - 1)];
+
+        if (XTL_UNLIKELY(e.vtbl != vtbl))
+        {
+            const T* t = XTL_SUBTYPE_CAST<const T*>(u);
+            e.vtbl   = vtbl;
+            e.offset = t ? reinterpret_cast<const char*>(t) - reinterpret_cast<const char*>(u) : no_cast;
+            return t;
+        }
+
+        return e.offset == no_cast ? nullptr : adjust_ptr<T>(u, e.offset);
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Casts a polymorphic pointer u to the pointer type T as #XTL_SUBTYPE_CAST
+/// would, reusing the outcome of the cast of an earlier object with the same
+/// vtbl-pointer.
+template <typename T, typename U>
+inline T cached_cast(U* u) noexcept
+{
+    typedef typename std::remove_pointer<T>::type target_type;
+
+    if (XTL_UNLIKELY(!u))
+        return nullptr;
+
+    return const_cast<T>(
+               cached_test<
+                   typename std::remove_cv<target_type>::type,
+                   typename std::remove_cv<U>::type
+               >::cast(u)
+           );
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
@@ -49,12 +49,23 @@
 /// - Use of multi-threading           \see #XTL_MULTI_THREADING
 /// - Default syntax                   \see #XTL_DEFAULT_SYNTAX
 /// - Use of vtbl frequencies          \see #XTL_USE_VTBL_FREQUENCY
-/// - Use of memoized_cast             \see #XTL_USE_MEMOIZED_CAST
+/// - Use of memoized_cast             \see #XTL_USE_MEMOIZED_CAST, #XTL_MEMOIZED_CAST_TARGETS
+/// - Use of display_cast              \see #XTL_USE_DISPLAY_CAST
+/// - Sharing of nested type tests     \see #XTL_SHARE_NESTED_TESTS
+/// - Caching of nested type tests     \see #XTL_CACHE_NESTED_CASTS, #XTL_CACHED_CAST_LOG_SIZE
 /// - Whether extractors might throw   \see #XTL_EXTRACTORS_MIGHT_THROW
 /// - Use of static local variables    \see #XTL_PRELOAD_LOCAL_STATIC_VARIABLES
 /// - Use number of case clauses init  \see #XTL_CLAUSES_NUM_ESTIMATES_TYPES_NUM
 /// - Certain under-the-hood types     \see #vtbl_count_t
 /// - Certain under-the-hood constants \see #XTL_MIN_LOG_SIZE, #XTL_MAX_LOG_INC, #XTL_MAX_STACK_LOG_SIZE, #XTL_IRRELEVANT_VTBL_BITS
+/// - Per-thread cache of vtbl maps    \see #XTL_THREAD_CACHE_LOG_SIZE
+/// - Warm-up of vtbl maps             \see #XTL_WARM_UP_MAX_ARITY
+/// - Sealing of frozen vtbl maps      \see #XTL_SEAL_MAX_LOG_INC
+/// - Layout of vtbl maps              \see #XTL_INLINE_VTBL_ENTRIES, #XTL_CACHE_LINE_SIZE
+/// - Use of SIMD and BMI2 in probes   \see #XTL_USE_SIMD
+/// - Prefetching in #MatchEach       \see #XTL_PREFETCH_DISTANCE
+/// - Allocation of dispatch tables   \see #XTL_DISPATCH_ARENA, #XTL_DISPATCH_ARENA_CHUNK_SIZE
+/// - Dense tables of kinds          \see #XTL_MAX_DENSE_KINDS
 /// Most of the combinations of from this set are built with: make timing
 ///
 /// Options with semantic or convenience impact
@@ -67,6 +78,7 @@
 /// Options for logging and debugging
 /// - Compile-time messages            \see #XTL_MESSAGE_ENABLED
 /// - Trace of performance             \see #XTL_DUMP_PERFORMANCE
+/// - Hardware counters of matches    \see #XTL_USE_PERF_COUNTERS
 /// - Trace of memory leaks with lines \see #XTL_LEAKED_NEW_LOCATIONS
 /// - Trace of conditions likeliness   \see #XTL_TRACE_LIKELINESS 
 ///
@@ -81,11 +93,32 @@
 #if !defined(XTL_DUMP_PERFORMANCE)
     /// Flag enabling showing results of performance tracing.
     /// The flag is disabled by default because it incures performance overhead
-    /// during normal program execution.
+    /// during normal program execution. When enabled, statistics of all live
+    /// vtbl maps can also be exported at any time as JSON or CSV.
+    /// \see dispatch_statistics, write_dispatch_statistics_json
     #define XTL_DUMP_PERFORMANCE 0
 #endif
 #define XTL_DUMP_PERFORMANCE_ONLY(...)   XTL_IF(XTL_NOT(XTL_DUMP_PERFORMANCE), XTL_EMPTY(), XTL_EXPAND(__VA_ARGS__))
 
+#if !defined(XTL_USE_PERF_COUNTERS)
+    /// When this macro is 1, every match statement counts CPU cycles, branch
+    /// misses and L1D misses spent in it with hardware performance counters of
+    /// the executing thread (Linux perf_event_open only), so that the cost of a
+    /// slow statement can be attributed to mispredicted branches of its switch,
+    /// cache misses in its vtbl map or the casts of its first executions. The
+    /// counts of all statements can be reported with mch::write_perf_report.
+    /// When the counters are unavailable the statements just count executions.
+    /// \note Each execution of a match statement then makes two system calls,
+    ///       so this is only meant for diagnostic runs (\see perfcounters.hpp).
+    #define XTL_USE_PERF_COUNTERS 0
+#endif
+#define XTL_PERF_COUNTERS_ONLY(...)      XTL_IF(XTL_NOT(XTL_USE_PERF_COUNTERS), XTL_EMPTY(), XTL_EXPAND(__VA_ARGS__))
+
+/// Counts the events of the enclosing match statement till the end of its scope
+/// \note Expands to nothing unless #XTL_USE_PERF_COUNTERS is on, in which case
+///       match statements include perfcounters.hpp that defines the counters.
+#define XTL_PERF_SITE() XTL_PERF_COUNTERS_ONLY(static mch::perf_site __perf_site(__FILE__,__LINE__,XTL_FUNCTION); mch::perf_scope __perf_scope(__perf_site);)
+
 //------------------------------------------------------------------------------
 
 #if !defined(XTL_TRACE_LIKELINESS)
@@ -98,6 +131,8 @@
 
 #if XTL_TRACE_LIKELINESS
     #include "debug.hpp"
+    #undef  XTL_LIKELY
+    #undef  XTL_UNLIKELY
     #define XTL_LIKELY(c)   (mch::trace_likeliness< true,__LINE__,decltype(XTL_FUNCTION)>(c,#c,__FILE__))
     #define XTL_UNLIKELY(c) (mch::trace_likeliness<false,__LINE__,decltype(XTL_FUNCTION)>(c,#c,__FILE__))
 #endif
@@ -110,12 +145,15 @@
 #endif
 
 #if !defined(XTL_USE_VTBL_FREQUENCY)
-    /// When this macro is defined, vtblmaps will count frequency of requests using a
-    /// given vtbl pointer and will take it into account during rearranging of the map.
+    /// When this macro is 1, vtbl maps count requests of each tuple of vtbl
+    /// pointers and keep the most requested ones in their primary cache entries
+    /// when tuples collide. Match statements then also take part in the dispatch
+    /// profile: their statistics can be saved with mch::save_dispatch_profile
+    /// and loaded by the next run with mch::load_dispatch_profile to pre-size
+    /// their vtbl maps and seed the counts (\see profile.hpp).
     /// \note This introduces a slight performance overhead to the most frequent path,
-    ///       but supposedly will pay when no zero conflict is possible.
-    /// \deprecated This macro will be deprecated as tracing frequency was not improving
-    ///       performance enough to justify the overhead it introduces.
+    ///       so it is meant for profiling runs and runs replaying their profiles.
+    /// \note Only the single-threaded vtbl_map records and replays profiles.
     #define XTL_USE_VTBL_FREQUENCY 0
 #endif
 #define XTL_USE_VTBL_FREQUENCY_ONLY(...) XTL_IF(XTL_NOT(XTL_USE_VTBL_FREQUENCY), XTL_EMPTY(), XTL_EXPAND(__VA_ARGS__))
@@ -230,6 +268,7 @@
     /// Whether pattern-matching constructs can be used in multi-threading context
     #define XTL_MULTI_THREADING 0
 #endif
+#define XTL_MULTI_THREADING_ONLY(...)   XTL_IF(XTL_NOT(XTL_MULTI_THREADING), XTL_EMPTY(), XTL_EXPAND(__VA_ARGS__))
 
 //------------------------------------------------------------------------------
 
@@ -275,6 +314,70 @@
     #define XTL_USE_MEMOIZED_CAST 0
 #endif
 
+#if !defined(XTL_MEMOIZED_CAST_TARGETS)
+    /// Number of target types of memoized_cast from a given source type whose
+    /// offsets are kept inline in the entry of a dynamic type. Offsets of more 
+    /// targets are kept in segments of this size allocated on demand.
+    #define XTL_MEMOIZED_CAST_TARGETS 8
+#endif
+
+#if !defined(XTL_USE_DISPLAY_CAST)
+    /// Whether library code should use display_cast, which is constant-time in
+    /// hierarchies registered with #XTL_DISPLAY_ROOT and #XTL_DISPLAY_DERIVED,
+    /// to check dynamic types of subjects. memoized_cast then also uses it for
+    /// such hierarchies instead of memoizing offsets.
+    #define XTL_USE_DISPLAY_CAST 0
+#endif
+
+/// Cast used by the library to check dynamic types of polymorphic subjects
+#define XTL_SUBTYPE_CAST XTL_IF(XTL_USE_DISPLAY_CAST, display_cast, dynamic_cast)
+
+#if !defined(XTL_CACHE_NESTED_CASTS)
+    /// Whether nested constructor patterns should remember the outcomes of the
+    /// type tests of sub-terms by their vtbl-pointers, as Match statements do
+    /// for their subjects, instead of casting every sub-term from scratch.
+    /// \note Every pair of source and target types of such casts then gets its
+    ///       own table of outcomes per thread (\see XTL_CACHED_CAST_LOG_SIZE).
+    /// \note Do not turn it on together with #XTL_SHARE_NESTED_TESTS: a cached
+    ///       cast is cheaper than a lookup of a shared test, so sharing only
+    ///       adds its own costs. In the nested benchmark of mach7-bench, sharing
+    ///       brought the rules from 79 to 72 us without the cache, but from 36 
+    ///       to 47 us with it.
+    /// \see mch::cached_cast
+    #define XTL_CACHE_NESTED_CASTS 0
+#endif
+
+#if !defined(XTL_CACHED_CAST_LOG_SIZE)
+    /// Log of the number of dynamic types whose outcomes of a cast between a 
+    /// given pair of types are remembered per thread by mch::cached_cast
+    #define XTL_CACHED_CAST_LOG_SIZE 4
+#endif
+
+/// Cast used by nested constructor patterns to check dynamic types of sub-terms
+#define XTL_NESTED_SUBTYPE_CAST XTL_IF(XTL_CACHE_NESTED_CASTS, cached_cast, XTL_SUBTYPE_CAST)
+
+#if !defined(XTL_SHARE_NESTED_TESTS)
+    /// Whether nested constructor patterns of all the clauses of a match 
+    /// statement should share the type tests of the same sub-terms of the
+    /// subject, so that each of them is tested at most once per statement.
+    /// \note Every match statement then pays for opening and closing its scope
+    ///       of shared tests, which is only worth it when its clauses repeat
+    ///       nested constructor patterns, e.g. in rewriting rules.
+    /// \note Do not turn it on together with #XTL_CACHE_NESTED_CASTS, whose
+    ///       cached casts are cheaper than lookups of shared tests.
+    /// \see mch::shared_cast
+    #define XTL_SHARE_NESTED_TESTS 0
+#endif
+#define XTL_SHARE_NESTED_TESTS_ONLY(...) XTL_IF(XTL_NOT(XTL_SHARE_NESTED_TESTS), XTL_EMPTY(), XTL_EXPAND(__VA_ARGS__))
+
+/// Opens the scope of type tests shared by the clauses of a match statement
+/// \note Expands to nothing unless #XTL_SHARE_NESTED_TESTS is on, in which case
+///       match statements include shared_tests.hpp that defines the scope.
+#define XTL_SHARED_TESTS_SCOPE() XTL_SHARE_NESTED_TESTS_ONLY(mch::shared_tests_scope __shared_tests_scope;)
+
+/// Cast used by nested constructor patterns, which may share the outcomes of their type tests
+#define XTL_NESTED_CAST XTL_IF(XTL_SHARE_NESTED_TESTS, shared_cast, XTL_NESTED_SUBTYPE_CAST)
+
 //------------------------------------------------------------------------------
 
 #if !defined(XTL_MIN_LOG_SIZE)
@@ -300,6 +403,83 @@
     #define XTL_LOCAL_CACHE_LOG_SIZE 7
 #endif
 
+#if !defined(XTL_THREAD_CACHE_LOG_SIZE)
+    /// Log of the size of the per-thread direct-mapped cache that multi-threaded
+    /// versions of vtbl maps put in front of their shared data. Repeated hits 
+    /// served from it do not touch any memory shared with other threads, which
+    /// helps when many cores hammer the same Match statement. 0 disables it.
+    /// \note Only used when #XTL_MULTI_THREADING is enabled.
+    #define XTL_THREAD_CACHE_LOG_SIZE 0
+#endif
+
+#if !defined(XTL_WARM_UP_MAX_ARITY)
+    /// Largest number of polymorphic subjects of a match statement, whose vtbl
+    /// map mch::warm_up_all seeds by default. A map of arity N is seeded with
+    /// all the N-tuples of the given vtbl-pointers, which grows quickly with N
+    /// and mostly consists of tuples never dispatched on when the vtbl-pointers
+    /// come from several hierarchies. Maps of higher arity are left to fill in
+    /// on their own or from a dispatch profile (\see #XTL_USE_VTBL_FREQUENCY).
+    #define XTL_WARM_UP_MAX_ARITY 1
+#endif
+
+#if !defined(XTL_SEAL_MAX_LOG_INC)
+    /// Log of the maximum allowed increase of the table of a sealed vtbl map
+    /// from the minimum size able to hold all its vtbl-pointer tuples. Larger
+    /// values make it more likely to find a collision-free hash function at
+    /// the cost of memory. Maps for which none was found are not sealed.
+    #define XTL_SEAL_MAX_LOG_INC 4
+#endif
+
+#if !defined(XTL_INLINE_VTBL_ENTRIES)
+    /// Whether the single-threaded vtbl_map should keep its entries inline in
+    /// its hash table (1) instead of referencing them through pointers (0).
+    /// \note Ignored when #XTL_MULTI_THREADING is enabled.
+    #define XTL_INLINE_VTBL_ENTRIES 0
+#endif
+
+#if !defined(XTL_CACHE_LINE_SIZE)
+    /// Size of the cache line of the target architecture. Used to align data
+    /// structures accessed on the hot path.
+    #define XTL_CACHE_LINE_SIZE 64
+#endif
+
+#if !defined(XTL_USE_SIMD)
+    /// Whether to use SIMD (SSE2/AVX2) comparisons of vtbl-pointer tuples and
+    /// BMI2 bit deposit for interleaving them when the target supports those
+    /// (e.g. -mavx2 -mbmi2). Results are identical to the scalar fallback.
+    /// \note Disabled by default: although the comparisons alone are faster
+    ///       (see vtbl_keys in mach7-bench), lookups in vtbl maps of 2 and 3
+    ///       subjects got slower with them, as the early exit of the scalar
+    ///       loop is predicted well. Only maps of 4 subjects gained.
+    #define XTL_USE_SIMD 0
+#endif
+
+#if !defined(XTL_PREFETCH_DISTANCE)
+    /// Number of subjects ahead of the current one that #MatchEach asks the
+    /// processor to prefetch while iterating over a range of subjects.
+    #define XTL_PREFETCH_DISTANCE 8
+#endif
+
+#if !defined(XTL_DISPATCH_ARENA)
+    /// Whether dispatch tables of all match statements should be allocated
+    /// from a common arena (1) instead of individually from the heap (0).
+    /// \see dispatch_arena
+    #define XTL_DISPATCH_ARENA 0
+#endif
+
+#if !defined(XTL_DISPATCH_ARENA_CHUNK_SIZE)
+    /// Size in bytes of chunks the arena of dispatch tables is made of
+    #define XTL_DISPATCH_ARENA_CHUNK_SIZE 65536
+#endif
+
+#if !defined(XTL_MAX_DENSE_KINDS)
+    /// Maximum number of remapped kinds of a closed class hierarchy that are
+    /// kept in dense tables indexed by kind (e.g. the subsumption bit-matrix
+    /// used by #MatchF). Hierarchies with larger (e.g. randomized) kinds fall 
+    /// back to walking the tag precedence lists of those kinds.
+    #define XTL_MAX_DENSE_KINDS 1024
+#endif
+
 #if !defined(XTL_MAX_STACK_LOG_SIZE)
     /// Log of the maximum stack size the library can use to do some histogram 
     /// computations. Making this value smaller will still work, however the 
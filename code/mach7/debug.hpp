@@ -45,7 +45,7 @@
 #pragma once
 
 #include <algorithm> // for std::min/std::max
-#include <ostream>
+#include <iostream>
 #include <iomanip>
 
 namespace mch ///< Mach7 library namespace
@@ -0,0 +1,226 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines function display_cast<T>(U) that behaves as dynamic_cast,
+/// but takes constant time for casts within registered hierarchies. It uses 
+/// the display of the dynamic type of the object: the list of all its base 
+/// classes indexed by their depth in the hierarchy, as described by Norman 
+/// H. Cohen in "Type-extension type tests can be performed in constant time". 
+/// A class is then derived from T if and only if the entry of its display at
+/// the depth of T is T.
+///
+/// Hierarchies are registered by putting #XTL_DISPLAY_ROOT into the root class
+/// and #XTL_DISPLAY_DERIVED into every class derived from it:
+/// \code
+/// struct Shape          { XTL_DISPLAY_ROOT(Shape)            virtual ~Shape() {} };
+/// struct Circle : Shape { XTL_DISPLAY_DERIVED(Circle,Shape) double radius; };
+/// \endcode
+/// Only single non-virtual inheritance among the registered classes is 
+/// supported, though they may have other non-virtual bases. Casts involving
+/// classes that are not registered fall back to dynamic_cast.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include "config.hpp"
+#include "metatools.hpp"     // Utility meta-functions
+#include <cstddef>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Display of a class in a registered hierarchy
+struct type_display
+{
+    size_t                     depth; ///< Number of classes from the root of the hierarchy down to this one
+    const type_display* const* path;  ///< Displays of those classes, with path[depth-1] being this one
+};
+
+//------------------------------------------------------------------------------
+
+/// Whether class T was registered with #XTL_DISPLAY_ROOT or #XTL_DISPLAY_DERIVED.
+/// Classes derived from registered ones without registering themselves are not.
+template <typename T, typename = void> struct is_displayed : std::false_type {};
+template <typename T> struct is_displayed<T, typename std::enable_if<std::is_same<typename T::xtl_display_self, T>::value>::type> : std::true_type {};
+
+/// Depth of a registered class T in its hierarchy, the root being at depth 1
+template <typename T> struct display_depth       { enum { value = display_depth<typename T::xtl_display_base>::value + 1 }; };
+template <>           struct display_depth<void> { enum { value = 0 }; };
+
+/// Base class of registered class T at depth I+1
+template <typename T, size_t I, bool = size_t(display_depth<T>::value) == I+1>
+struct display_ancestor                                    { typedef T type; };
+template <typename T, size_t I>
+struct display_ancestor<T,I,false> : display_ancestor<typename T::xtl_display_base,I> {};
+
+template <typename T> struct display_of;
+
+/// Path part of the display of registered class T. Its elements are addresses
+/// of other displays, so it is initialized statically and does not depend on 
+/// the order of initialization of translation units.
+template <typename T, typename I = typename make_index_list<display_depth<T>::value>::type>
+struct display_path;
+
+template <typename T, size_t... I>
+struct display_path<T,index_list<I...>>
+{
+    static const type_display* const value[sizeof...(I)];
+};
+
+template <typename T, size_t... I>
+const type_display* const display_path<T,index_list<I...>>::value[sizeof...(I)] = { &display_of<typename display_ancestor<T,I>::type>::value... };
+
+/// Display of registered class T
+template <typename T>
+struct display_of
+{
+    enum { depth = display_depth<T>::value };
+    static const type_display value;
+};
+
+template <typename T>
+const type_display display_of<T>::value = { display_of<T>::depth, display_path<T>::value };
+
+//------------------------------------------------------------------------------
+
+/// Whether the cast of a pointer to S into a pointer to T can be performed with 
+/// displays: both have to be registered and T has to be derived from S.
+template <typename S, typename T>
+struct is_display_castable
+{
+    typedef typename std::remove_cv<S>::type source_type;
+    typedef typename std::remove_cv<T>::type target_type;
+    static const bool value = is_displayed<source_type>::value 
+                           && is_displayed<target_type>::value 
+                           && std::is_base_of<source_type,target_type>::value;
+};
+
+/// Checks in constant time whether the dynamic type of s is T or derived from it
+template <typename T, typename S>
+inline bool is_display_subtype(const S& s) noexcept
+{
+    const type_display& d = s.xtl_display();
+    return d.depth >= size_t(display_of<T>::depth) && d.path[display_of<T>::depth-1] == &display_of<T>::value;
+}
+
+//------------------------------------------------------------------------------
+
+/// This general case is not defined on purpose as expected types are only 
+/// pointer and reference types (\see memoized_cast_helper).
+template <typename T>
+struct display_cast_helper;
+
+/// Partial specialization handling pointers as target type.
+template <typename T>
+struct display_cast_helper<T*>
+{
+    template <typename S>
+    static inline T* go(S* p)
+    {
+        return go(p, std::integral_constant<bool, is_display_castable<S,T>::value>());
+    }
+
+private:
+
+    /// Both types are in the same registered hierarchy
+    template <typename S>
+    static inline T* go(S* p, std::true_type) noexcept
+    {
+        return p && is_display_subtype<typename std::remove_cv<T>::type>(*p) ? static_cast<T*>(p) : nullptr;
+    }
+
+    /// Anything else is up to dynamic_cast
+    template <typename S>
+    static inline T* go(S* p, std::false_type)
+    {
+        return dynamic_cast<T*>(p);
+    }
+};
+
+/// Partial specialization handling references as target type.
+template <typename T>
+struct display_cast_helper<T&>
+{
+    template <typename S>
+    static inline T& go(S& s)
+    {
+        if (T* t = display_cast_helper<T*>::go(&s))
+            return *t;
+        else
+            throw std::bad_cast();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
+
+/// Registers class T as the root of a hierarchy supporting display_cast. Has to
+/// be used in the public part of the class definition.
+#define XTL_DISPLAY_ROOT(T)                                                    \
+    typedef T    xtl_display_self;                                             \
+    typedef void xtl_display_base;                                             \
+    virtual const mch::type_display& xtl_display() const noexcept { return mch::display_of<T>::value; }
+
+/// Registers class D derived from registered class B. Has to be used in the 
+/// public part of the class definition.
+#define XTL_DISPLAY_DERIVED(D,B)                                               \
+    typedef D    xtl_display_self;                                             \
+    typedef B    xtl_display_base;                                             \
+    const mch::type_display& xtl_display() const noexcept override { return mch::display_of<D>::value; }
+
+//------------------------------------------------------------------------------
+
+/// Actual implementation of display_cast that simply forwards the call to a 
+/// static member of #display_cast_helper in order to distinguish pointer and 
+/// reference types in the target type.
+template <typename T, typename S>
+inline T display_cast(S&& s)
+{
+    return mch::display_cast_helper<T>::go(std::forward<S>(s));
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,291 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines epoch-based reclamation of memory retired by the
+/// multi-threaded versions of vtbl maps. It lets old cache descriptors be
+/// deallocated once no thread can possibly be looking at them anymore.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+// --------------------[ Reclamation Protocol ]--------------------
+// - Every thread that ever loads a descriptor owns an epoch_record, attached
+//   lazily on its first use of any map and detached when the thread exits.
+// - A thread announces the global epoch it has seen when it enters a vtbl
+//   map's get, before it loads any descriptor, and announces that it is idle
+//   when it leaves the get, on the hit path as well as on the slow one.
+//   Threads outside of vtbl maps, e.g. parked threads or threads that have
+//   not missed for a long time, thus never hold reclamation back.
+// - An object unlinked from a shared location is retired with the current
+//   global epoch E, which gets advanced to E+1 at the same time. The object is
+//   deallocated once no attached thread announces an epoch of E or below: such
+//   a thread is either idle or has entered after the object had become
+//   unreachable, so it cannot hold a pointer to it.
+// - Reclamation is attempted on retirement, when a thread leaves the slow path
+//   of get and when a thread detaches. Only one thread at a time reclaims; the
+//   others simply skip it, so no thread ever blocks.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+#include "config.hpp"    // Various compiler/platform dependent macros
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Type of the global epoch counter. Advanced once per retired object.
+typedef unsigned long long epoch_t;
+
+/// Epoch announced by a thread that is not inside of any vtbl map, including
+/// threads that have detached. It never blocks reclamation.
+const epoch_t epoch_idle = ~epoch_t(0);
+
+//------------------------------------------------------------------------------
+
+/// Participation record of a thread in the epoch-based reclamation. Records
+/// are never deallocated, they are reused by new threads instead.
+struct epoch_record
+{
+    std::atomic<epoch_t> seen;   ///< The latest epoch announced by the owner thread
+    std::atomic<bool>    in_use; ///< Whether the record is owned by some thread
+    epoch_record*        next;   ///< Next record in the list. Immutable once the record is published.
+};
+
+//------------------------------------------------------------------------------
+
+/// An object waiting for all the threads to move past the epoch it was retired in.
+struct retired_object
+{
+    void*           object;         ///< Object to be deallocated
+    void          (*deleter)(void*);///< Function that knows how to deallocate the object
+    epoch_t         epoch;          ///< Epoch in which the object became unreachable
+    retired_object* next;           ///< Next retired object in the list
+};
+
+//------------------------------------------------------------------------------
+
+/// The reclamation domain shared by all vtbl maps in the program. The class is
+/// a template only to let its static members be defined in a header.
+template <typename D = void>
+struct epoch_domain
+{
+    /// Announces the global epoch on behalf of the calling thread, attaching
+    /// it to the domain first if needed. Has to be called before loading any
+    /// pointer to an object that might get retired. Calls do not nest.
+    static inline void enter() noexcept
+    {
+        epoch_record* r = current;
+
+        if (XTL_UNLIKELY(!r))
+            r = attach();
+
+        // NOTE: The fence pairs with the one in reclaim: either the reclaiming
+        //       thread sees the epoch announced here or this thread sees the
+        //       objects retired before the reclaim unlinked already.
+        r->seen.store(global_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /// Announces that the calling thread holds no pointers to retired objects
+    /// anymore. This is all the hit path of a vtbl map has to do on return.
+    static inline void exit() noexcept
+    {
+        current->seen.store(epoch_idle, std::memory_order_release);
+    }
+
+    /// Same as #exit, but also reclaims what can be reclaimed. Meant for the
+    /// slow paths, which are where objects get retired in the first place.
+    static inline void quiescent() noexcept
+    {
+        exit();
+
+        if (pending.load(std::memory_order_relaxed))
+            reclaim();
+    }
+
+    /// Retires an object that has just been unlinked from all shared locations.
+    /// The object will be deleted once no thread can be using it anymore.
+    template <typename X>
+    static void retire(X* p) { retire(p, &destroy<X>); }
+
+    /// Retires an object that has to be deallocated with the given deleter,
+    /// e.g. a dispatch table of variable size (\see dispatch_arena::destroy).
+    static void retire(void* p, void (*deleter)(void*))
+    {
+        retired_object* r = new retired_object;
+        r->object  = p;
+        r->deleter = deleter;
+        r->epoch   = global_epoch.fetch_add(1); // NOTE: seq_cst orders this with attach and reclaim
+        r->next    = retired.load(std::memory_order_relaxed);
+
+        while (!retired.compare_exchange_weak(r->next, r))
+            ;
+
+        pending.fetch_add(1);
+        reclaim();
+    }
+
+    /// Deallocates all retired objects that no attached thread can be using.
+    static void reclaim() noexcept
+    {
+        if (reclaiming.exchange(true, std::memory_order_acquire))
+            return; // Someone else is reclaiming at the moment
+
+        // NOTE: The list has to be taken before the fence: only the objects
+        //       unlinked before it are guaranteed to be unreachable for any
+        //       thread whose announced epoch the scan below does not see.
+        retired_object* list = retired.exchange(nullptr);
+        epoch_t         min  = epoch_idle;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the fence in enter
+
+        for (epoch_record* r = records.load(); r; r = r->next)
+        {
+            const epoch_t e = r->seen.load();
+
+            if (e < min)
+                min = e;
+        }
+
+        while (list)
+        {
+            retired_object* const next = list->next;
+
+            if (list->epoch < min)
+            {
+                list->deleter(list->object);
+                delete list;
+                pending.fetch_sub(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                list->next = retired.load(std::memory_order_relaxed);
+
+                while (!retired.compare_exchange_weak(list->next, list))
+                    ;
+            }
+
+            list = next;
+        }
+
+        reclaiming.store(false, std::memory_order_release);
+    }
+
+    /// Number of retired objects that have not been deallocated yet
+    static size_t pending_count() noexcept { return pending.load(std::memory_order_relaxed); }
+
+private:
+
+    /// Detaches the thread from the domain when the thread exits
+    struct thread_guard
+    {
+       ~thread_guard() { detach(); }
+    };
+
+    template <typename X>
+    static void destroy(void* p) { delete static_cast<X*>(p); }
+
+    /// Slow path of #enter: acquires a record for the calling thread
+    static epoch_record* attach()
+    {
+        static thread_local thread_guard guard; // Detaches on thread exit
+        XTL_UNUSED(guard);
+
+        epoch_record* r = records.load();
+
+        // Try to reuse a record of a thread that has exited
+        for (; r; r = r->next)
+        {
+            bool expected = false;
+
+            if (!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(expected, true))
+                break;
+        }
+
+        if (!r)
+        {
+            r = new epoch_record;
+            r->seen.store(epoch_idle);
+            r->in_use.store(true);
+            r->next = records.load();
+
+            while (!records.compare_exchange_weak(r->next, r))
+                ;
+        }
+
+        current = r;
+        return r;
+    }
+
+    /// Releases the record of the calling thread for reuse by other threads
+    static void detach() noexcept
+    {
+        if (epoch_record* const r = current)
+        {
+            current = nullptr;
+            r->seen.store(epoch_idle, std::memory_order_release);
+            r->in_use.store(false, std::memory_order_release);
+
+            if (pending.load(std::memory_order_relaxed))
+                reclaim();
+        }
+    }
+
+    static std::atomic<epoch_t>         global_epoch; ///< Epoch retired objects get stamped with
+    static std::atomic<epoch_record*>   records;      ///< All the records ever allocated
+    static std::atomic<retired_object*> retired;      ///< Objects waiting to be deallocated
+    static std::atomic<size_t>          pending;      ///< Number of objects in #retired, including those temporarily taken out
+    static std::atomic<bool>            reclaiming;   ///< Whether some thread is currently reclaiming
+    static thread_local epoch_record*   current;      ///< Record of the calling thread or nullptr when it is not attached
+};
+
+template <typename D> std::atomic<epoch_t>         epoch_domain<D>::global_epoch(1);
+template <typename D> std::atomic<epoch_record*>   epoch_domain<D>::records(nullptr);
+template <typename D> std::atomic<retired_object*> epoch_domain<D>::retired(nullptr);
+template <typename D> std::atomic<size_t>          epoch_domain<D>::pending(0);
+template <typename D> std::atomic<bool>            epoch_domain<D>::reclaiming(false);
+template <typename D> thread_local epoch_record*   epoch_domain<D>::current = nullptr;
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
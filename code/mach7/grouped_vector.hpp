@@ -0,0 +1,274 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines class grouped_vector<B>: a container of polymorphic
+/// objects derived from B that keeps objects of each dynamic type in their own
+/// contiguous arena. #MatchEach over such a container dispatches once per
+/// arena and then walks each arena sequentially, without any per-object
+/// look ups in the dispatch table.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "config.hpp"    // Various compiler/platform dependent macros
+#include "ptrtools.hpp"  // Helper functions to work with pointers
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// A container of objects of classes derived from B, grouped by their dynamic
+/// types. Objects of the same dynamic type are stored contiguously in the
+/// order of their insertion, while arenas appear in the order in which their
+/// first object was inserted.
+/// \note Just like with std::vector, inserting an object may relocate other
+///       objects of the same dynamic type, invalidating references to them.
+template <typename B>
+class grouped_vector
+{
+    static_assert(std::is_polymorphic<B>::value, "Objects in grouped_vector should be polymorphic");
+
+    /// Type-erased arena holding objects of a single dynamic type
+    struct arena
+    {
+        virtual ~arena() {}
+        virtual size_t size() const noexcept = 0;
+        virtual B*     first()      noexcept = 0;
+        virtual void   clear()      noexcept = 0;
+        size_t         stride; ///< Distance in bytes between consecutive objects
+    };
+
+    /// Arena holding objects of the dynamic type T
+    template <typename T>
+    struct arena_of : arena
+    {
+        arena_of() { this->stride = sizeof(T); }
+        size_t size() const noexcept { return objects.size(); }
+        B*     first()      noexcept { return objects.empty() ? nullptr : static_cast<B*>(objects.data()); }
+        void   clear()      noexcept { objects.clear(); }
+        std::vector<T> objects;
+    };
+
+public:
+
+    /// A view of objects of the same dynamic type, which are all of type Q
+    /// (B or const B) on the outside. The view is invalidated by insertions.
+    template <typename Q>
+    class group
+    {
+    public:
+
+        /// Iterator walking objects of an arena with its stride
+        class iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Q                         value_type;
+            typedef std::ptrdiff_t            difference_type;
+            typedef Q*                        pointer;
+            typedef Q&                        reference;
+
+            iterator(char* p, size_t s) : ptr(p), stride(s) {}
+
+            Q&        operator*()  const noexcept { return *reinterpret_cast<Q*>(ptr); }
+            Q*        operator->() const noexcept { return  reinterpret_cast<Q*>(ptr); }
+            iterator& operator++()       noexcept { ptr += stride; return *this; }
+            iterator  operator++(int)    noexcept { iterator tmp(*this); ptr += stride; return tmp; }
+            bool operator==(const iterator& other) const noexcept { return ptr == other.ptr; }
+            bool operator!=(const iterator& other) const noexcept { return ptr != other.ptr; }
+
+        private:
+            char*  ptr;
+            size_t stride;
+        };
+
+        group(arena& a) :
+            vtbl(a.size() ? vtbl_of(a.first()) : 0),
+            first(reinterpret_cast<char*>(a.first())),
+            count(a.size()),
+            stride(a.stride)
+        {}
+
+        iterator begin() const noexcept { return iterator(first, stride); }
+        iterator end()   const noexcept { return iterator(first + count*stride, stride); }
+        size_t   size()  const noexcept { return count; }
+
+        /// Objects of an arena are walked sequentially, which the processor
+        /// prefetches on its own.
+        void prefetch(iterator) const noexcept {}
+
+        intptr_t vtbl; ///< vtbl-pointer shared by all the objects of the group
+
+    private:
+
+        char*  first;
+        size_t count;
+        size_t stride;
+    };
+
+    typedef group<B>       group_type;
+    typedef group<const B> const_group_type;
+
+    grouped_vector() : total(0) {}
+    grouped_vector(grouped_vector&&) = default;
+    grouped_vector& operator=(grouped_vector&&) = default;
+    grouped_vector(const grouped_vector&) = delete;
+    grouped_vector& operator=(const grouped_vector&) = delete;
+
+    /// Constructs an object of the dynamic type T in the arena of T
+    template <typename T, typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        static_assert(std::is_base_of<B,T>::value, "Objects in grouped_vector should be derived from its base class");
+        std::vector<T>& objects = arena_for<T>().objects;
+        objects.emplace_back(std::forward<Args>(args)...);
+        ++total;
+        return objects.back();
+    }
+
+    /// Copies or moves the object into the arena of its static type T, which
+    /// has to be its dynamic type as well, since objects are stored by value.
+    template <typename T>
+    T& push_back(T&& t)
+    {
+        typedef typename std::remove_cv<typename std::remove_reference<T>::type>::type object_type;
+        XTL_ASSERT(xtl_failure("Object is sliced by grouped_vector: its static type is not its dynamic type", typeid(t) == typeid(object_type)));
+        return emplace_back<object_type>(std::forward<T>(t));
+    }
+
+    /// Total number of objects in all the arenas
+    size_t size()  const noexcept { return total; }
+    bool   empty() const noexcept { return total == 0; }
+
+    /// Number of distinct dynamic types of the objects stored
+    size_t types() const noexcept
+    {
+        size_t result = 0;
+
+        for (size_t i = 0; i < arenas.size(); ++i)
+            result += arenas[i]->size() != 0;
+
+        return result;
+    }
+
+    /// Destroys all the objects, keeping the memory of the arenas
+    void clear() noexcept
+    {
+        for (size_t i = 0; i < arenas.size(); ++i)
+            arenas[i]->clear();
+
+        total = 0;
+    }
+
+    /// Returns views of all non-empty arenas, suitable for #MatchEach
+    std::vector<group_type> groups()
+    {
+        std::vector<group_type> result;
+        result.reserve(arenas.size());
+
+        for (size_t i = 0; i < arenas.size(); ++i)
+            if (arenas[i]->size())
+                result.push_back(group_type(*arenas[i]));
+
+        return result;
+    }
+
+    /// Returns views of all non-empty arenas, suitable for #MatchEach
+    std::vector<const_group_type> groups() const
+    {
+        std::vector<const_group_type> result;
+        result.reserve(arenas.size());
+
+        for (size_t i = 0; i < arenas.size(); ++i)
+            if (arenas[i]->size())
+                result.push_back(const_group_type(*arenas[i]));
+
+        return result;
+    }
+
+private:
+
+    template <typename T>
+    arena_of<T>& arena_for()
+    {
+        arena*& a = index[std::type_index(typeid(T))];
+
+        if (XTL_UNLIKELY(!a))
+        {
+            arenas.push_back(std::unique_ptr<arena>(new arena_of<T>));
+            a = arenas.back().get();
+        }
+
+        return static_cast<arena_of<T>&>(*a);
+    }
+
+    std::vector<std::unique_ptr<arena>>          arenas; ///< Arenas in the order of their creation
+    std::unordered_map<std::type_index, arena*>  index;  ///< Arena of each dynamic type
+    size_t                                       total;  ///< Total number of objects
+};
+
+//------------------------------------------------------------------------------
+
+/// Overload of #group_by_vtbl for grouped_vector, which is already grouped
+template <typename B>
+inline std::vector<typename grouped_vector<B>::group_type> group_by_vtbl(grouped_vector<B>& v)
+{
+    return v.groups();
+}
+
+/// Overload of #group_by_vtbl for grouped_vector, which is already grouped
+template <typename B>
+inline std::vector<typename grouped_vector<B>::const_group_type> group_by_vtbl(const grouped_vector<B>& v)
+{
+    return v.groups();
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
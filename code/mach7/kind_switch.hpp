@@ -0,0 +1,293 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines function kind_switch, a variadic-template alternative to
+/// #MatchK for closed hierarchies whose classes carry their kind in a member 
+/// specified with #KS. Like #MatchK, a clause applies only to subjects of 
+/// exactly its kind, but the clauses are known at compile time as a whole, so
+/// instead of a switch whose density depends on the values of the kinds, each
+/// call of kind_switch jumps through a flat table of handlers covering the
+/// range of the kinds of its clauses:
+/// \code
+/// double area = mch::kind_switch(shape,
+///     mch::kind_case<Circle>([](const Circle& c) { return pi*c.radius*c.radius; }),
+///     mch::kind_case<Square>([](const Square& s) { return s.side*s.side; }),
+///     mch::kind_otherwise   ([](const Shape&)    { return 0.0; })
+/// );
+/// \endcode
+/// Clauses that can never be reached - on classes not derived from the subject
+/// type, on kinds already handled by an earlier clause or following the default
+/// clause - are rejected at compile time.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include "config.hpp"
+#include "has_member.hpp"        // Meta-functions to check use of certain #bindings facilities
+#include "ptrtools.hpp"          // Helper functions to work with pointers
+#include "patterns/bindings.hpp" // Kind selectors and kind values of classes
+#include <climits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Clause of #kind_switch applying handler F to subjects of the kind of class C
+template <typename C, typename F>
+struct kind_clause
+{
+    F handler;
+};
+
+/// Default clause of #kind_switch applying handler F to subjects of any other kind
+template <typename F>
+struct kind_default
+{
+    F handler;
+};
+
+/// Creates a clause of #kind_switch handling subjects of the kind of class C
+template <typename C, typename F>
+inline kind_clause<C,F> kind_case(F f) { kind_clause<C,F> c = { std::move(f) }; return c; }
+
+/// Creates the default clause of #kind_switch, which has to be the last one
+template <typename F>
+inline kind_default<F> kind_otherwise(F f) { kind_default<F> c = { std::move(f) }; return c; }
+
+//------------------------------------------------------------------------------
+
+/// Kind handled by a clause of #kind_switch
+template <typename Clause> struct clause_kind;
+template <typename C, typename F> struct clause_kind<kind_clause<C,F>> { static const bool is_default = false; static const long long value = bindings<C>::kind_value; };
+template <typename F>             struct clause_kind<kind_default<F>>  { static const bool is_default = true;  static const long long value = 0; };
+
+/// Type of the result of the handler of a clause on subjects of type S
+template <typename S, typename Clause> struct clause_result;
+template <typename S, typename C, typename F> struct clause_result<S,kind_clause<C,F>> { typedef decltype(std::declval<F&>()(std::declval<const C&>())) type; };
+template <typename S, typename F>             struct clause_result<S,kind_default<F>>  { typedef decltype(std::declval<F&>()(std::declval<const S&>())) type; };
+
+/// Range of kinds handled by the given clauses and the number of clauses of each sort
+template <typename... Clauses> struct clause_kinds;
+
+template <>
+struct clause_kinds<>
+{
+    static const long long smallest = LLONG_MAX;
+    static const long long largest  = LLONG_MIN;
+    static const size_t    defaults = 0;
+    static const size_t    kinds    = 0;
+};
+
+template <typename Clause, typename... Clauses>
+struct clause_kinds<Clause,Clauses...>
+{
+    typedef clause_kind<Clause>         head;
+    typedef clause_kinds<Clauses...>    tail;
+    static const long long smallest = head::is_default || tail::smallest < head::value ? tail::smallest : head::value;
+    static const long long largest  = head::is_default || tail::largest  > head::value ? tail::largest  : head::value;
+    static const size_t    defaults = tail::defaults + (head::is_default ? 1 : 0);
+    static const size_t    kinds    = tail::kinds    + (head::is_default ? 0 : 1);
+};
+
+/// Number of clauses handling kind K
+template <long long K, typename... Clauses> struct clauses_on_kind { static const size_t value = 0; };
+template <long long K, typename Clause, typename... Clauses>
+struct clauses_on_kind<K,Clause,Clauses...>
+{
+    static const size_t value = clauses_on_kind<K,Clauses...>::value + (!clause_kind<Clause>::is_default && clause_kind<Clause>::value == K ? 1 : 0);
+};
+
+/// Index of the first clause handling kind K or I plus the number of clauses
+template <long long K, size_t I, typename... Clauses> struct exact_clause { static const size_t value = I; };
+template <long long K, size_t I, typename Clause, typename... Clauses>
+struct exact_clause<K,I,Clause,Clauses...>
+{
+    static const size_t value = !clause_kind<Clause>::is_default && clause_kind<Clause>::value == K ? I : exact_clause<K,I+1,Clauses...>::value;
+};
+
+/// Index of the default clause or I plus the number of clauses
+template <size_t I, typename... Clauses> struct default_clause { static const size_t value = I; };
+template <size_t I, typename Clause, typename... Clauses>
+struct default_clause<I,Clause,Clauses...>
+{
+    static const size_t value = clause_kind<Clause>::is_default ? I : default_clause<I+1,Clauses...>::value;
+};
+
+/// Index of the clause handling subjects of kind K: the clause on that kind,
+/// otherwise the default clause, otherwise the number of clauses.
+template <long long K, typename... Clauses>
+struct clause_for_kind
+{
+    static const size_t exact = exact_clause<K,0,Clauses...>::value;
+    static const size_t value = exact < sizeof...(Clauses) ? exact : default_clause<0,Clauses...>::value;
+};
+
+//------------------------------------------------------------------------------
+
+/// Compile-time checks of clause number I out of N of #kind_switch on subjects
+/// of type S, followed by the given clauses.
+template <typename S, size_t I, size_t N, typename Clause, typename... Later>
+struct kind_clause_check;
+
+template <typename S, size_t I, size_t N, typename C, typename F, typename... Later>
+struct kind_clause_check<S,I,N,kind_clause<C,F>,Later...>
+{
+    static_assert(std::is_base_of<S,C>::value, "The class of a kind_case is not derived from the subject type, so the clause can never be reached");
+    static_assert(clauses_on_kind<bindings<C>::kind_value,Later...>::value == 0, "Several kind_case clauses handle the same kind, so all but the first one can never be reached");
+    static const bool value = true;
+};
+
+template <typename S, size_t I, size_t N, typename F, typename... Later>
+struct kind_clause_check<S,I,N,kind_default<F>,Later...>
+{
+    static_assert(I+1 == N, "kind_otherwise has to be the last clause, the clauses following it can never be reached");
+    static const bool value = true;
+};
+
+/// Compile-time checks of all the clauses of #kind_switch on subjects of type S
+template <typename S, size_t N, typename... Clauses> struct kind_clauses_check { static const bool value = true; };
+template <typename S, size_t N, typename Clause, typename... Clauses>
+struct kind_clauses_check<S,N,Clause,Clauses...>
+{
+    static const bool value = kind_clause_check<S,N-1-sizeof...(Clauses),N,Clause,Clauses...>::value 
+                           && kind_clauses_check<S,N,Clauses...>::value;
+};
+
+//------------------------------------------------------------------------------
+
+/// Dispatcher of #kind_switch on subjects of type S with the given clauses
+template <typename S, typename R, typename... Clauses>
+struct kind_switch_table
+{
+    typedef std::tuple<Clauses...>          clauses_type;
+    typedef clause_kinds<Clauses...>        kinds;
+    typedef R (*entry_type)(const S&, clauses_type&);
+
+    static const long long smallest = kinds::smallest;
+    static const size_t    size     = size_t(kinds::largest - kinds::smallest + 1);
+
+    static_assert(has_member_kind_selector<bindings<S>>::value, "Before using kind_switch, you have to specify kind selector on the subject type using KS macro");
+    static_assert(kinds::kinds > 0, "kind_switch needs at least one kind_case clause");
+    static_assert(kind_clauses_check<S,sizeof...(Clauses),Clauses...>::value, "Unreachable clauses in kind_switch");
+    static_assert(size <= XTL_MAX_DENSE_KINDS, "The range of kinds handled by kind_switch is too wide for a flat table, see XTL_MAX_DENSE_KINDS");
+
+    /// Calls the handler of clause J
+    template <size_t J, bool = (J < sizeof...(Clauses))>
+    struct entry
+    {
+        template <typename C, typename F>
+        static R apply(const S& s, kind_clause<C,F>& c) { return c.handler(*stat_cast<C>(&s)); }
+
+        template <typename F>
+        static R apply(const S& s, kind_default<F>& c)  { return c.handler(s); }
+
+        static R call(const S& s, clauses_type& clauses) { return apply(s, std::get<J>(clauses)); }
+    };
+
+    /// No clause handles the kind and there is no default clause
+    template <size_t J>
+    struct entry<J,false>
+    {
+        static R call(const S&, clauses_type&) { return R(); }
+    };
+
+    /// Entry of the table for kind smallest+I
+    template <size_t I>
+    struct entry_at : entry<clause_for_kind<smallest + (long long)(I),Clauses...>::value> {};
+
+    /// Entry for the kinds outside of the table
+    typedef entry<default_clause<0,Clauses...>::value> outside;
+
+    static R dispatch(const S& s, clauses_type& clauses);
+};
+
+/// Flat table of entries of a given #kind_switch_table, indexed by kind minus
+/// the smallest kind. Consists of addresses of functions only, so it is 
+/// initialized statically.
+template <typename Table, typename I = typename make_index_list<Table::size>::type>
+struct kind_jump_table;
+
+template <typename Table, size_t... I>
+struct kind_jump_table<Table,index_list<I...>>
+{
+    static const typename Table::entry_type value[sizeof...(I)];
+};
+
+template <typename Table, size_t... I>
+const typename Table::entry_type kind_jump_table<Table,index_list<I...>>::value[sizeof...(I)] = { &Table::template entry_at<I>::call... };
+
+template <typename S, typename R, typename... Clauses>
+inline R kind_switch_table<S,R,Clauses...>::dispatch(const S& s, clauses_type& clauses)
+{
+    // Kinds below the smallest one wrap around to large values
+    const size_t k = size_t(static_cast<long long>(kind_selector(&s)) - smallest);
+    return XTL_LIKELY(k < size)
+        ? kind_jump_table<kind_switch_table>::value[k](s, clauses)
+        : outside::call(s, clauses);
+}
+
+//------------------------------------------------------------------------------
+
+/// Dispatches subject s to the handler of the clause for its kind in constant
+/// time. Returns the result of that handler, or a value-initialized result 
+/// when no clause handles the kind and there is no default clause.
+template <typename S, typename Clause, typename... Clauses>
+inline typename clause_result<S,Clause>::type kind_switch(const S& s, Clause clause, Clauses... clauses)
+{
+    typedef kind_switch_table<S,typename clause_result<S,Clause>::type,Clause,Clauses...> table_type;
+    typename table_type::clauses_type all(std::move(clause), std::move(clauses)...);
+    return table_type::dispatch(s, all);
+}
+
+/// Version of #kind_switch taking subject by pointer
+template <typename S, typename Clause, typename... Clauses>
+inline typename clause_result<S,Clause>::type kind_switch(const S* s, Clause clause, Clauses... clauses)
+{
+    return kind_switch(*s, std::move(clause), std::move(clauses)...);
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
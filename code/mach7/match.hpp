@@ -109,6 +109,12 @@
 //------------------------------------------------------------------------------
 
 #include "unisyn.hpp"
+#if XTL_USE_PERF_COUNTERS
+#include "perfcounters.hpp" // Hardware counters of match statements
+#endif
+#if XTL_SHARE_NESTED_TESTS
+#include "shared_tests.hpp" // Type tests of sub-terms shared by the clauses of a match statement
+#endif
 
 #if defined(_MSC_VER) && !defined(_CPPRTTI)
     /// Disabling RTTI in MSVC is known to enable compiler optimizations that
@@ -121,6 +127,10 @@
 #if XTL_USE_MEMOIZED_CAST
   #include "memoized_cast.hpp"
   #define dynamic_cast memoized_cast
+#elif XTL_USE_DISPLAY_CAST
+  #include "display_cast.hpp"
+  #define dynamic_cast  display_cast
+  #define memoized_cast display_cast
 #else
   #define memoized_cast dynamic_cast
 #endif
@@ -292,7 +302,9 @@ template <class T> inline void ignore_unused_warning(T const&) {}
         enum { target_layout = mch::default_layout, is_inside_case_clause = 0 }; \
         XTL_ASSERT(xtl_failure("Trying to match against a nullptr",subject_ptr));\
         auto const matched = subject_ptr;                                      \
-        XTL_UNUSED(matched);
+        XTL_UNUSED(matched);                                                   \
+        XTL_PERF_SITE()                                                        \
+        XTL_SHARED_TESTS_SCOPE()
 
 #define XTL_SUBCLAUSE_FIRST           XTL_NON_FALL_THROUGH_ONLY(XTL_STATIC_IF(false)) XTL_NON_USE_BRACES_ONLY({)
 #define XTL_SUBCLAUSE_OPEN(T,...)                                     XTL_STATIC_IF(XTL_IF(XTL_IS_EMPTY(__VA_ARGS__), true,   XTL_LIKELY(mch::C<target_type,target_layout>(__VA_ARGS__).match_structure(matched) != nullptr))) {
@@ -386,7 +398,7 @@ template<>                        struct target_disambiguator<int>    { typedef
         XTL_PRELOADABLE_LOCAL_STATIC(mch::vtblmap<mch::type_switch_info>,__vtbl2lines_map,match_uid_type,XTL_DUMP_PERFORMANCE_ONLY(__FILE__,__LINE__,XTL_FUNCTION,)XTL_GET_TYPES_NUM_ESTIMATE);\
         register const void* __casted_ptr = 0;                                 \
         mch::type_switch_info& __switch_info = __vtbl2lines_map.get(subject_ptr); \
-        switch (__switch_info.target)                                          \
+        switch (mch::load_target(__switch_info.target))                        \
         {                                                                      \
             XTL_REDUNDANCY_ONLY(try)                                           \
             {                                                                  \
@@ -405,13 +417,13 @@ template<>                        struct target_disambiguator<int>    { typedef
             __casted_ptr = dynamic_cast<const target_type*>(subject_ptr);      \
             if (XTL_UNLIKELY(__casted_ptr != nullptr))                         \
             {                                                                  \
-                if (XTL_LIKELY((__switch_info.target == 0)))                   \
+                if (XTL_LIKELY((mch::load_target(__switch_info.target) == 0))) \
                 {                                                              \
-                    __switch_info.target = target_label;                       \
-                    __switch_info.offset = intptr_t(__casted_ptr)-intptr_t(subject_ptr); \
+                    mch::store_offset(__switch_info.offset, intptr_t(__casted_ptr)-intptr_t(subject_ptr)); \
+                    mch::store_target(__switch_info.target, target_label);     \
                 }                                                              \
             XTL_NON_REDUNDANCY_ONLY(case target_label:)                        \
-                auto matched = mch::adjust_ptr<target_type>(subject_ptr,__switch_info.offset);\
+                auto matched = mch::adjust_ptr<target_type>(subject_ptr,mch::load_offset(__switch_info.offset)); \
                 XTL_CLAUSE_DECL_ONLY(C(*matched));                             \
                 XTL_UNUSED(matched);                                           \
                 XTL_SUBCLAUSE_OPEN(__VA_ARGS__)
@@ -426,13 +438,13 @@ template<>                        struct target_disambiguator<int>    { typedef
             __casted_ptr = dynamic_cast<const target_type*>(subject_ptr);      \
             if (XTL_UNLIKELY(__casted_ptr))                                    \
             {                                                                  \
-                if (XTL_LIKELY(__switch_info.target == 0))                     \
+                if (XTL_LIKELY(mch::load_target(__switch_info.target) == 0))   \
                 {                                                              \
-                    __switch_info.target = target_label;                       \
-                    __switch_info.offset = intptr_t(__casted_ptr)-intptr_t(subject_ptr); \
+                    mch::store_offset(__switch_info.offset, intptr_t(__casted_ptr)-intptr_t(subject_ptr)); \
+                    mch::store_target(__switch_info.target, target_label);     \
                 }                                                              \
             XTL_NON_REDUNDANCY_ONLY(case target_label:)                        \
-                auto matched = mch::adjust_ptr<target_type>(subject_ptr,__switch_info.offset);\
+                auto matched = mch::adjust_ptr<target_type>(subject_ptr,mch::load_offset(__switch_info.offset)); \
                 XTL_UNUSED(matched);                                           \
                 XTL_SUBCLAUSE_PATTERN(__VA_ARGS__)
 
@@ -447,7 +459,7 @@ template<>                        struct target_disambiguator<int>    { typedef
         XTL_SUBCLAUSE_LAST }}                                                  \
         enum { target_label = XTL_COUNTER-__base_counter };                    \
         XTL_SET_TYPES_NUM_ESTIMATE(target_label-1);                            \
-        if (XTL_UNLIKELY((__casted_ptr == 0 && __switch_info.target == 0))) { __switch_info.target = target_label; } \
+        if (XTL_UNLIKELY((__casted_ptr == 0 && mch::load_target(__switch_info.target) == 0))) { mch::store_target(__switch_info.target, target_label); } \
         case target_label: ; }                                                 \
         XTL_WARNING_POP                                                        \
         }
@@ -592,8 +604,8 @@ template<>                        struct target_disambiguator<int>    { typedef
 /// a distinct integral value in one of their members.
 /// Non-forwarding: Sequential:  33% faster; Random: 34% faster
 ///     Forwarding: Sequential: 251% faster; Random: 33% faster
-/// FIX: The use of vector and resize in it assumes at the moment small tags in 
-///      region 0..k. Tag randomization will overuse memory!
+/// \note Precedence lists of kinds come from #kind_table shared by all MatchF
+///       statements on the hierarchy, which also handles randomized tags.
 #define MatchF(s) {                                                            \
         XTL_MATCH_PREAMBULA(s)                                                 \
         static_assert(has_member_kind_selector<mch::bindings<source_type>>::value, "Before using MatchF, you have to specify kind selector on the subject type using KS macro");\
@@ -604,14 +616,7 @@ template<>                        struct target_disambiguator<int>    { typedef
         switch (size_t(__kind_selector)) {                                     \
         default:                                                               \
             if (XTL_LIKELY(!__kinds))                                          \
-            {                                                                  \
-                XTL_PRELOADABLE_LOCAL_STATIC(std::vector<const mch::lbl_type*>,__kinds_cache,match_uid_type,XTL_EMPTY());\
-                if (XTL_UNLIKELY(size_t(__kind_selector) >= __kinds_cache.size()))\
-                    __kinds_cache.resize(__kind_selector+1);                   \
-                __kinds = __kinds_cache[__kind_selector];                      \
-                if (!__kinds)                                                  \
-                    __kinds = __kinds_cache[__kind_selector] = mch::get_kinds<source_type>(__kind_selector);\
-            }                                                                  \
+                __kinds = mch::get_kinds<source_type>(__kind_selector);        \
             XTL_ASSERT(xtl_failure("Base classes for this kind were not specified",__kinds));\
             XTL_ASSERT(xtl_failure("Invalid list of kinds",*__kinds==__kind_selector));      \
             __kind_selector = __kinds ? *++__kinds : mch::lbl_type(0);         \
@@ -60,7 +60,11 @@
 
 #include "vtblmap.hpp"
 #include "metatools.hpp"     // Utility meta-functions
-#include <vector>
+#if XTL_USE_DISPLAY_CAST
+#include "display_cast.hpp"  // Constant-time casts in registered hierarchies
+#endif
+#include <atomic>
+#include <type_traits>
 
 namespace mch ///< Mach7 library namespace
 {
@@ -76,17 +80,52 @@ struct specific_to
     template <typename T>
     static inline size_t type_index_of()
     {
-        static const size_t ti = ++type_counter; // will be executed once upon first entry
+        static const size_t ti = type_counter++; // will be executed once upon first entry
         return ti;
     }
 
 private:
 
-    static size_t type_counter; ///< Actual counter of instantiated types
+    static std::atomic<size_t> type_counter; ///< Actual counter of instantiated types
 
 };
 
-template <typename U> size_t specific_to<U>::type_counter = 0;
+template <typename U> std::atomic<size_t> specific_to<U>::type_counter(0);
+
+//------------------------------------------------------------------------------
+
+/// A list of types
+template <typename... Ts> struct type_list {};
+
+/// Position of type T in a given #type_list or the length of the list when
+/// T is not in it.
+template <typename T, typename L> struct type_index_in;
+template <typename T>                             struct type_index_in<T,type_list<>>         { enum { value = 0 }; };
+template <typename T, typename... Ts>             struct type_index_in<T,type_list<T,Ts...>>  { enum { value = 0 }; };
+template <typename T, typename U, typename... Ts> struct type_index_in<T,type_list<U,Ts...>>  { enum { value = 1 + type_index_in<T,type_list<Ts...>>::value }; };
+
+/// Number of types in a given #type_list
+template <typename L> struct type_list_size;
+template <typename... Ts> struct type_list_size<type_list<Ts...>> { enum { value = sizeof...(Ts) }; };
+
+//------------------------------------------------------------------------------
+
+/// The set of target types of memoized_cast from a given source type S. By 
+/// default it is empty and target types get their indices on first use in the
+/// order of use (\see specific_to). When the set is declared up front with 
+/// #XTL_CAST_TARGETS, the casts to its types use indices known at compile time
+/// and the offsets of all of them are laid out contiguously per dynamic type.
+/// Casts to the types not in the set still work as if it wasn't declared.
+template <typename S> struct cast_targets { typedef type_list<> type; };
+
+/// Whether target type T of memoized_cast from S was declared with #XTL_CAST_TARGETS
+template <typename S, typename T>
+struct is_declared_cast_target
+{
+    typedef typename cast_targets<S>::type targets;
+    static const size_t index = type_index_in<T,targets>::value;
+    static const bool   value = index < size_t(type_list_size<targets>::value);
+};
 
 //------------------------------------------------------------------------------
 
@@ -106,20 +145,97 @@ static const std::ptrdiff_t unknown_offset = 0x0FF1C1A0; // A dedicated constant
 
 //------------------------------------------------------------------------------
 
+/// Offsets of target types from a given dynamic type indexed by the type index
+/// of the target type. The first #XTL_MEMOIZED_CAST_TARGETS offsets are kept 
+/// inline, while the rest go into segments of the same size that are allocated
+/// on demand and linked from here. Offsets never move once allocated, so a 
+/// reference to one stays valid while other threads grow the table, and a read
+/// of any of the first offsets is a single load.
+class offset_table
+{
+public:
+
+    enum { segment_size = XTL_MEMOIZED_CAST_TARGETS };
+
+    offset_table() noexcept : more(nullptr)
+    {
+        for (size_t i = 0; i < segment_size; ++i)
+            offset[i].store(unknown_offset, std::memory_order_relaxed);
+    }
+
+   ~offset_table() { delete more.load(std::memory_order_relaxed); }
+
+    /// Returns the offset of the target type with a given type index
+    std::atomic<std::ptrdiff_t>& operator[](size_t ti)
+    {
+        offset_table* t = this;
+
+        for (; XTL_UNLIKELY(ti >= segment_size); ti -= segment_size)
+            t = t->next();
+
+        return t->offset[ti];
+    }
+
+private:
+
+    offset_table(const offset_table&);            ///< No copy constructor
+    offset_table& operator=(const offset_table&); ///< No assignment operator
+
+    /// Returns the next segment, allocating it when it doesn't exist yet
+    offset_table* next()
+    {
+        offset_table* t = more.load(std::memory_order_acquire);
+
+        if (XTL_UNLIKELY(!t))
+        {
+            offset_table* n = new offset_table;
+
+            if (more.compare_exchange_strong(t, n, std::memory_order_acq_rel, std::memory_order_acquire))
+                t = n;
+            else
+                delete n; // Another thread has linked its segment first
+        }
+
+        return t;
+    }
+
+    std::atomic<std::ptrdiff_t> offset[segment_size]; ///< Offsets of the target types in this segment
+    std::atomic<offset_table*>  more;                 ///< Next segment or nullptr
+};
+
+//------------------------------------------------------------------------------
+
+/// Offsets of all the target types in a given #type_list from a given dynamic
+/// type. Unlike #offset_table, the size is known up front, so the offsets form
+/// a single contiguous block.
+template <typename L>
+struct declared_offsets
+{
+    declared_offsets() noexcept
+    {
+        for (size_t i = 0; i < type_list_size<L>::value; ++i)
+            offset[i].store(unknown_offset, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::ptrdiff_t> offset[type_list_size<L>::value]; ///< Offsets of the target types in the order of L
+};
+
+//------------------------------------------------------------------------------
+
 /// Allocates one vtblmap per target type.
 /// Elements of vtblmap are offsets of target type from p.
 /// \note Typically we will have more target types than source types as source 
 ///       types represent static type of an object while target types - its 
 ///       dynamic type.
 template <typename T>
-inline std::ptrdiff_t& per_target_offset_of(const void* p)
+inline std::atomic<std::ptrdiff_t>& per_target_offset_of(const void* p)
 {
     /// The only purpose of this class is to have #unknown_offset be default
     /// value of otherwise a std::ptrdiff_t variable. 
     struct dyn_cast_info
     {
         dyn_cast_info() : offset(unknown_offset) {}
-        std::ptrdiff_t offset;
+        std::atomic<std::ptrdiff_t> offset;
     };
 
     XTL_PRELOADABLE_LOCAL_STATIC(vtblmap<dyn_cast_info>,offset_map,T);
@@ -134,18 +250,35 @@ inline std::ptrdiff_t& per_target_offset_of(const void* p)
 ///       types represent static type of an object while target types - its 
 ///       dynamic type.
 template <typename S>
-inline std::ptrdiff_t& per_source_offset_of(const void* p, size_t ti)
+inline std::atomic<std::ptrdiff_t>& per_source_offset_of(const void* p, size_t ti)
 {
-    // FIX: vector here might create problems later when we implement 
-    //      multi-threaded solution because of reference invalidation
-    typedef std::vector<std::ptrdiff_t> dyn_cast_info;
-    XTL_PRELOADABLE_LOCAL_STATIC(vtblmap<dyn_cast_info>,offset_map,S);
-    dyn_cast_info& sdci = offset_map.get(p);
+    XTL_PRELOADABLE_LOCAL_STATIC(vtblmap<offset_table>,offset_map,S);
+    return offset_map.get(p)[ti];
+}
+
+/// Allocates one vtblmap per source type with declared #cast_targets.
+/// Elements of vtblmap are blocks of offsets of all the declared target types.
+template <typename S, size_t I>
+inline std::atomic<std::ptrdiff_t>& declared_offset_of(const void* p)
+{
+    typedef declared_offsets<typename cast_targets<S>::type> dyn_cast_info;
+    XTL_PRELOADABLE_LOCAL_STATIC(vtblmap<dyn_cast_info>,offset_map,cast_targets<S>);
+    return offset_map.get(p).offset[I];
+}
 
-    if (XTL_UNLIKELY(ti >= sdci.size()))
-        sdci.resize(ti+1,unknown_offset);
+/// Target type T is among declared #cast_targets of S: its index is constant
+template <typename S, typename T>
+inline std::atomic<std::ptrdiff_t>& offset_memo_of(const void* p, std::true_type)
+{
+    return declared_offset_of<S,is_declared_cast_target<S,T>::index>(p);
+}
 
-    return sdci[ti];
+/// Target type T gets its index on first use
+template <typename S, typename T>
+inline std::atomic<std::ptrdiff_t>& offset_memo_of(const void* p, std::false_type)
+{
+    size_t ti = specific_to<S>::template type_index_of<T>();
+    return per_source_offset_of<S>(p,ti);
 }
 
 //------------------------------------------------------------------------------
@@ -161,20 +294,25 @@ inline T memoized_cast_non_null(const S* p)
 #if 1
     // Per source version is much more efficient in the amount of used memory
     // and size of generated executable.
-    size_t ti = specific_to<source_type>::template type_index_of<target_type>();
-    std::ptrdiff_t& offset = per_source_offset_of<source_type>(p,ti);
+    std::atomic<std::ptrdiff_t>& memo = offset_memo_of<source_type,target_type>(
+        p,
+        std::integral_constant<bool, is_declared_cast_target<source_type,target_type>::value>()
+    );
 #else
     // Per target version is simpler and straightforward, but very inefficient
     // in the size of generated code.
-    std::ptrdiff_t& offset = per_target_offset_of<target_type>(p);
+    std::atomic<std::ptrdiff_t>& memo = per_target_offset_of<target_type>(p);
 #endif
+    // Threads racing on an unknown offset compute and store the same value,
+    // so there is nothing to order and relaxed accesses suffice.
+    const std::ptrdiff_t offset = memo.load(std::memory_order_relaxed);
 
     if (XTL_UNLIKELY(offset == unknown_offset))
     {
         T t = dynamic_cast<T>(p);
-        offset = t 
-                 ? reinterpret_cast<const char*>(t)-reinterpret_cast<const char*>(p) 
-                 : no_cast_exists;
+        memo.store(t 
+                   ? reinterpret_cast<const char*>(t)-reinterpret_cast<const char*>(p) 
+                   : no_cast_exists, std::memory_order_relaxed);
         return t;
     }
     else
@@ -222,6 +360,12 @@ struct memoized_cast_helper<T*>
     template <typename S>
     static inline T* go(S* p)
     {
+    #if XTL_USE_DISPLAY_CAST
+        // There is nothing to memoize about a constant-time cast
+        if (is_display_castable<S,T>::value)
+            return display_cast_helper<T*>::go(p);
+    #endif
+
         if (XTL_LIKELY(p))
             return memoized_cast_non_null<T*>(p);
         else
@@ -247,6 +391,15 @@ struct memoized_cast_helper<T&>
 
 //------------------------------------------------------------------------------
 
+/// Declares the complete set of target types of memoized_cast from the source
+/// type S. Has to be used at global scope before the first cast from S, e.g.:
+/// \code
+/// XTL_CAST_TARGETS(Shape, Circle, Square, Triangle)
+/// \endcode
+#define XTL_CAST_TARGETS(S,...) namespace mch { template <> struct cast_targets<S> { typedef type_list<__VA_ARGS__> type; }; }
+
+//------------------------------------------------------------------------------
+
 /// Actual implementation of memoized_cast that simply forwards the call to a 
 /// static member of #memoized_cast_helper in order to distinguish pointer and 
 /// reference types in the target type.
@@ -45,7 +45,9 @@
 #pragma once
 
 #include "config.hpp"
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <type_traits>
 
@@ -109,6 +111,15 @@ template <class U, size_t L, template<class X, size_t Y> class Q> struct get_par
 
 //------------------------------------------------------------------------------
 
+/// A list of indices to be expanded in a pack
+template <size_t... I> struct index_list {};
+
+/// Meta-function producing #index_list of 0,1,...,N-1
+template <size_t N, size_t... I> struct make_index_list         : make_index_list<N-1,N-1,I...> {};
+template <size_t... I>           struct make_index_list<0,I...> { typedef index_list<I...> type; };
+
+//------------------------------------------------------------------------------
+
 /// A class representing a set of locations of type T, indexed by a usually local
 /// type UID that uniquely identifies the deferred constant. 
 /// The class is used to implicitly introduce global variables in block
@@ -166,6 +177,117 @@ T preallocated<T,UID>::value;
 
 //------------------------------------------------------------------------------
 
+/// Registry of the objects, usually allocated through preallocated<> above, that
+/// can be prepared ahead of time: seeded with the dynamic types they are going to
+/// see and then frozen, so that the first requests served by the program do not
+/// pay for growing and rearranging them.
+///
+/// Objects register themselves in their constructors and unregister in their
+/// destructors. For objects allocated through preallocated<> this happens before
+/// main(), so all of them are known by the time main() can call warm_up_all().
+/// Objects that are plain local static variables (see #XTL_PRELOADABLE_LOCAL_STATIC)
+/// are only known after their declaration has been executed once.
+struct warm_up_registry
+{
+    /// Registration record of an object, normally a member of that object
+    struct record
+    {
+        void*   object;                                               ///< Registered object
+        size_t  arity;                                                ///< Number of vtbl-pointers in the keys of the object
+        void  (*warm_up)(void* object, const intptr_t* vtbls, size_t n); ///< Seeds the object with the given vtbl-pointers
+        bool  (*freeze)(void* object);                                ///< Makes the object stop rearranging itself. Returns whether it was sealed.
+        record* next;                                                 ///< Next registered record
+    };
+
+    /// Adds the record to the registry
+    static void add(record& r) noexcept
+    {
+        lock_guard guard;
+        r.next = head();
+        head() = &r;
+    }
+
+    /// Removes the record from the registry
+    static void remove(record& r) noexcept
+    {
+        lock_guard guard;
+
+        for (record** p = &head(); *p; p = &(*p)->next)
+            if (*p == &r)
+            {
+                *p = r.next;
+                break;
+            }
+    }
+
+    /// Seeds every registered object of at most the given arity with the given vtbl-pointers
+    /// \returns The number of objects seeded
+    static size_t warm_up_all(const intptr_t* vtbls, size_t n, size_t max_arity)
+    {
+        lock_guard guard;
+        size_t count = 0;
+
+        for (record* r = head(); r; r = r->next)
+            if (r->arity <= max_arity)
+            {
+                r->warm_up(r->object, vtbls, n);
+                ++count;
+            }
+
+        return count;
+    }
+
+    /// Freezes every registered object
+    /// \returns The number of objects that were also sealed
+    static size_t freeze_all()
+    {
+        lock_guard guard;
+        size_t count = 0;
+
+        for (record* r = head(); r; r = r->next)
+            count += r->freeze(r->object);
+
+        return count;
+    }
+
+private:
+
+    /// The list of registered records. Constant-initialized, so it can be used
+    /// by constructors of other objects with static storage duration.
+    static record*& head() noexcept { static record* first = nullptr; return first; }
+
+    /// Spin lock protecting the list: registration is rare and never contended
+    /// in practice, but local static variables may be constructed concurrently.
+    static std::atomic_flag& busy() noexcept { static std::atomic_flag flag = ATOMIC_FLAG_INIT; return flag; }
+
+    struct lock_guard
+    {
+        lock_guard()  noexcept { while (busy().test_and_set(std::memory_order_acquire)) ; }
+       ~lock_guard()  noexcept { busy().clear(std::memory_order_release); }
+    };
+};
+
+/// Seeds the registered vtbl maps with the given vtbl-pointers. A map
+/// dispatching on N polymorphic subjects is seeded with all the N-tuples of them,
+/// so only maps of arity up to max_arity are seeded: the rest would mostly be 
+/// filled with tuples of unrelated classes (\see #XTL_WARM_UP_MAX_ARITY).
+/// \note The values associated with seeded vtbl-pointers are still computed on
+///       the first use, but the maps will already have their final size and
+///       hashing parameters by then.
+inline size_t warm_up_all(const intptr_t* vtbls, size_t n, size_t max_arity = XTL_WARM_UP_MAX_ARITY) { return warm_up_registry::warm_up_all(vtbls, n, max_arity); }
+
+/// Same as above for an array of vtbl-pointers
+template <size_t K>
+inline size_t warm_up_all(const intptr_t (&vtbls)[K], size_t max_arity = XTL_WARM_UP_MAX_ARITY) { return warm_up_all(vtbls, K, max_arity); }
+
+/// Stops all the registered vtbl maps from rearranging themselves on collisions
+/// and seals them with a collision-free hash over the tuples they contain.
+/// Maps will still grow when they run out of space for new vtbl-pointers.
+/// \returns The number of maps that were sealed
+inline size_t freeze_all() { return warm_up_registry::freeze_all(); }
+
+//------------------------------------------------------------------------------
+
 ///@{
 /// Helper function to help disambiguate a unary version of a given function when
 /// overloads with different arity are available.
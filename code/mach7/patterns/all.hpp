@@ -57,3 +57,4 @@
 #include "primitive.hpp"      // Value, Variable and Wildcard patterns
 #include "quantifiers.hpp"    // Quantifiers
 #include "regex.hpp"          // Regular expression pattern
+#include "regex_dfa.hpp"      // DFA engine of regular expression patterns
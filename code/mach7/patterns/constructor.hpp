@@ -46,6 +46,15 @@
 
 #include "bindings.hpp"
 #include "primitive.hpp" // FIX: Ideally this should be common.hpp, but GCC seem to disagree: http://gcc.gnu.org/bugzilla/show_bug.cgi?id=55460
+#if XTL_USE_DISPLAY_CAST
+#include "../display_cast.hpp" // Constant-time casts in registered hierarchies
+#endif
+#if XTL_CACHE_NESTED_CASTS
+#include "../cached_cast.hpp"  // Type tests of sub-terms remembered by their vtbl-pointers
+#endif
+#if XTL_SHARE_NESTED_TESTS
+#include "../shared_tests.hpp" // Type tests of sub-terms shared by the clauses of a match statement
+#endif
 #include <cstddef>
 
 namespace mch ///< Mach7 library namespace
@@ -72,8 +81,8 @@ struct constr0
     ///  - the arguments passed by reference from those passed by pointers
     ///  - whether the target type matches the subject type (to avoid dynamic_cast)
     ///  - const from non-const arguments to propagate constness further.
-    template <typename U> const T* operator()(const U* u) const noexcept { return dynamic_cast<const T*>(u); }
-    template <typename U>       T* operator()(      U* u) const noexcept { return dynamic_cast<      T*>(u); }
+    template <typename U> const T* operator()(const U* u) const noexcept { return XTL_NESTED_CAST<const T*>(u); }
+    template <typename U>       T* operator()(      U* u) const noexcept { return XTL_NESTED_CAST<      T*>(u); }
     template <typename U> const T* operator()(const U& u) const noexcept { return operator()(&u); }
     template <typename U>       T* operator()(      U& u) const noexcept { return operator()(&u); }
                           const T* operator()(const T* t) const noexcept { return t; }
@@ -135,8 +144,8 @@ struct constr1
     ///  - the arguments passed by reference from those passed by pointers
     ///  - whether the target type matches the subject type (to avoid dynamic_cast)
     ///  - const from non-const arguments to propagate constness further.
-    template <typename U> const T* operator()(const U* u) const { return operator()(dynamic_cast<const T*>(u)); }
-    template <typename U>       T* operator()(      U* u) const { return operator()(dynamic_cast<      T*>(u)); }
+    template <typename U> const T* operator()(const U* u) const { return operator()(XTL_NESTED_CAST<const T*>(u)); }
+    template <typename U>       T* operator()(      U* u) const { return operator()(XTL_NESTED_CAST<      T*>(u)); }
     template <typename U> const T* operator()(const U& u) const { return operator()(&u); }
     template <typename U>       T* operator()(      U& u) const { return operator()(&u); }
                           const T* operator()(const T* t) const { return t ? match_structure(t) : 0; }
@@ -206,8 +215,8 @@ struct constr1<T,layout,P1,typename std::enable_if<std::is_same<T,typename under
     ///  - the arguments passed by reference from those passed by pointers
     ///  - whether the target type matches the subject type (to avoid dynamic_cast)
     ///  - const from non-const arguments to propagate constness further.
-    template <typename U> const T* operator()(const U* u) const { return operator()(dynamic_cast<const T*>(u)); }
-    template <typename U>       T* operator()(      U* u) const { return operator()(dynamic_cast<      T*>(u)); }
+    template <typename U> const T* operator()(const U* u) const { return operator()(XTL_NESTED_CAST<const T*>(u)); }
+    template <typename U>       T* operator()(      U* u) const { return operator()(XTL_NESTED_CAST<      T*>(u)); }
     template <typename U> const T* operator()(const U& u) const { return operator()(&u); }
     template <typename U>       T* operator()(      U& u) const { return operator()(&u); }
                           const T* operator()(const T* t) const { return t ? match_structure(t) : 0; }
@@ -274,8 +283,8 @@ struct constr2
     ///  - the arguments passed by reference from those passed by pointers
     ///  - whether the target type matches the subject type (to avoid dynamic_cast)
     ///  - const from non-const arguments to propagate constness further.
-    template <typename U> const T* operator()(const U* u) const { return operator()(dynamic_cast<const T*>(u)); }
-    template <typename U>       T* operator()(      U* u) const { return operator()(dynamic_cast<      T*>(u)); }
+    template <typename U> const T* operator()(const U* u) const { return operator()(XTL_NESTED_CAST<const T*>(u)); }
+    template <typename U>       T* operator()(      U* u) const { return operator()(XTL_NESTED_CAST<      T*>(u)); }
     template <typename U> const T* operator()(const U& u) const { return operator()(&u); }
     template <typename U>       T* operator()(      U& u) const { return operator()(&u); }
                           const T* operator()(const T* t) const { return t ? match_structure(t) : 0; }
@@ -350,8 +359,8 @@ struct constr3
     ///  - the arguments passed by reference from those passed by pointers
     ///  - whether the target type matches the subject type (to avoid dynamic_cast)
     ///  - const from non-const arguments to propagate constness further.
-    template <typename U> const T* operator()(const U* u) const { return operator()(dynamic_cast<const T*>(u)); }
-    template <typename U>       T* operator()(      U* u) const { return operator()(dynamic_cast<      T*>(u)); }
+    template <typename U> const T* operator()(const U* u) const { return operator()(XTL_NESTED_CAST<const T*>(u)); }
+    template <typename U>       T* operator()(      U* u) const { return operator()(XTL_NESTED_CAST<      T*>(u)); }
     template <typename U> const T* operator()(const U& u) const { return operator()(&u); }
     template <typename U>       T* operator()(      U& u) const { return operator()(&u); }
                           const T* operator()(const T* t) const { return t ? match_structure(t) : 0; }
@@ -438,8 +447,8 @@ struct constr4
     ///  - the arguments passed by reference from those passed by pointers
     ///  - whether the target type matches the subject type (to avoid dynamic_cast)
     ///  - const from non-const arguments to propagate constness further.
-    template <typename U> const T* operator()(const U* u) const { return operator()(dynamic_cast<const T*>(u)); }
-    template <typename U>       T* operator()(      U* u) const { return operator()(dynamic_cast<      T*>(u)); }
+    template <typename U> const T* operator()(const U* u) const { return operator()(XTL_NESTED_CAST<const T*>(u)); }
+    template <typename U>       T* operator()(      U* u) const { return operator()(XTL_NESTED_CAST<      T*>(u)); }
     template <typename U> const T* operator()(const U& u) const { return operator()(&u); }
     template <typename U>       T* operator()(      U& u) const { return operator()(&u); }
                           const T* operator()(const T* t) const { return t ? match_structure(t) : 0; }
@@ -45,33 +45,323 @@
 #pragma once
 
 #include "common.hpp"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <regex>
+#include <sstream>
 #include <string>
 
+#if XTL_SUPPORT(std_string_view)
+#include <string_view>
+#endif
+
+#if XTL_SUPPORT(std_from_chars)
+#include <charconv>
+#endif
+
 namespace mch ///< Mach7 library namespace
 {
 
 //------------------------------------------------------------------------------
 
+/// Character range [first,second) of a capture group of a regular expression.
+/// Groups that did not participate in the match have both pointers null.
+typedef std::pair<const char*, const char*> regex_capture;
+
+//------------------------------------------------------------------------------
+
+/// Engine policy of regex patterns: how regular expressions of type R are 
+/// compiled and matched. Specializations for other types of compiled regular
+/// expressions (\see dfa_regex) plug other engines into #rex. They define:
+/// - type regex_type equal to R;
+/// - static R compile(const char* re), used for expressions compiled once;
+/// - static bool match(const R& re, const char* first, const char* last, regex_capture* captures, size_t n),
+///   which checks whether the entire range [first,last) matches #re and, if 
+///   so, fills in #captures with the first #n capture groups.
+template <typename R> struct regex_engine {};
+
+/// The default engine based on std::regex with the ECMAScript grammar
+template <>
+struct regex_engine<std::regex>
+{
+    typedef std::regex regex_type;
+
+    static std::regex compile(const char* re) { return std::regex(re, std::regex::ECMAScript | std::regex::optimize); }
+
+    static bool match(const std::regex& re, const char* first, const char* last, regex_capture* captures, size_t n)
+    {
+        std::cmatch m;
+
+        if (!std::regex_match(first, last, m, re))
+            return false;
+
+        XTL_ASSERT(m.size() > n); // There should be enough capture groups for each of the pattern arguments
+
+        for (size_t i = 0; i < n; ++i) // m[0] is the entire expression
+            captures[i] = m[i+1].matched ? regex_capture(m[i+1].first, m[i+1].second) : regex_capture();
+
+        return true;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Compiled regular expression of type R of the call site #N of #XTL_REGEX. The
+/// expression is compiled from #re on the first call only, which is why it has
+/// to be a string literal: the text of the call site never changes then. The
+/// function is static to give each translation unit its own instances, since 
+/// values of #XTL_COUNTER are only unique within one translation unit.
+/// \note For the same reason an inline function or a template that uses 
+///       #XTL_REGEX and is defined in a header included by several translation
+///       units refers to a different function in each of them, which violates
+///       the one-definition rule. Compile such expressions once into a variable
+///       defined in a single translation unit and pass it to #rex instead.
+template <unsigned int N, typename R, size_t M>
+static const R& static_regex(const char (&re)[M])
+{
+    // Initialization of function-local statics is thread-safe since C++11
+    static const R result(regex_engine<R>::compile(re));
+    return result;
+}
+
+/// Compiles regular expression #re once per call site and yields a reference to
+/// the compiled std::regex. Pass it to #rex instead of the string to avoid
+/// compiling the expression every time the pattern is constructed, which for
+/// patterns inside a Match statement is every time the clause is tried:
+/// \code
+///     With(rex(XTL_REGEX("([0-9]+)-([0-9]+)-([0-9]+)"), area_code)) ...
+/// \endcode
+/// \note #re has to be a string literal, since a call site compiles only the
+///       first expression it sees. Anything else does not compile.
+/// \note When the compiler does not support __COUNTER__, call sites are
+///       distinguished by line, so use at most one #XTL_REGEX per line.
+#define XTL_REGEX(re) mch::static_regex<XTL_COUNTER, std::regex>("" re)
+
+//------------------------------------------------------------------------------
+
+/// Regular expression of a regex pattern. The expression is either compiled by
+/// the pattern itself, or compiled elsewhere (\see XTL_REGEX) and only 
+/// referenced, in which case copying the pattern does not copy it.
+template <typename R = std::regex>
+class regex_holder
+{
+public:
+
+    regex_holder(const char* re)                 : m_own(re),            m_re(&m_own) {}
+    regex_holder(const R& re)           noexcept : m_own(),              m_re(&re)    {}
+    regex_holder(      R&& re)                   : m_own(std::move(re)), m_re(&m_own) {}
+    regex_holder(const regex_holder&  src)       : m_own(src.owns() ? src.m_own : R()), m_re(src.owns() ? &m_own : src.m_re) {} ///< Copy constructor
+    regex_holder(      regex_holder&& src)       : m_own(std::move(src.m_own)), m_re(src.m_re == &src.m_own ? &m_own : src.m_re)  {} ///< Move constructor
+
+    regex_holder& operator=(const regex_holder&) XTL_DELETED; ///< Assignment is not allowed for this class
+
+    /// Whether the expression was compiled by this object
+    bool owns() const noexcept { return m_re == &m_own; }
+
+    /// The compiled regular expression
+    const R& regex() const noexcept { return *m_re; }
+
+    /// Checks whether the entire character range [first,last) matches the 
+    /// expression and fills in the first #n #captures if so.
+    bool match(const char* first, const char* last, regex_capture* captures, size_t n) const { return regex_engine<R>::match(*m_re, first, last, captures, n); }
+
+private:
+
+    R        m_own; ///< Expression compiled by this object, if any
+    const R* m_re;  ///< Expression used for matching
+};
+
+//------------------------------------------------------------------------------
+
+/// Type accepted by regex patterns for a subject of type S. Subjects of type
+/// std::string_view and C strings are matched in place, everything else as 
+/// std::string.
+template <typename S> struct regex_subject                   { typedef std::string      type; };
+#if XTL_SUPPORT(std_string_view)
+template <>           struct regex_subject<std::string_view> { typedef std::string_view type; };
+template <>           struct regex_subject<const char*>      { typedef std::string_view type; };
+template <>           struct regex_subject<      char*>      { typedef std::string_view type; };
+template <size_t N>   struct regex_subject<      char[N]>    { typedef std::string_view type; };
+#endif
+
+//------------------------------------------------------------------------------
+
+/// Kind of conversion used for captures converted into type T
+enum capture_conversion_kind
+{
+    capture_via_stream,   ///< Formatted input with operator>>
+    capture_via_integral, ///< Allocation-free conversion of integral numbers
+    capture_via_floating  ///< Allocation-free conversion of floating-point numbers
+};
+
+/// Type function returning the #capture_conversion_kind for type T. Character 
+/// types and bool are read with the formatted input, which treats them specially.
+template <typename T>
+struct capture_conversion : std::integral_constant<capture_conversion_kind,
+        std::is_floating_point<T>::value
+            ? capture_via_floating
+            : std::is_integral<T>::value
+           && !std::is_same<T,bool>::value
+           && !std::is_same<T,char>::value
+           && !std::is_same<T,signed char>::value
+           && !std::is_same<T,unsigned char>::value
+           && !std::is_same<T,wchar_t>::value
+           && !std::is_same<T,char16_t>::value
+           && !std::is_same<T,char32_t>::value
+                ? capture_via_integral
+                : capture_via_stream
+    >
+{};
+
+/// Parses a number from the character range [first,last) with the C library
+/// function #parse after copying the range into a null-terminated buffer on the
+/// stack. Fails for ranges that do not fit into the buffer.
+template <typename T, typename R>
+inline bool parse_capture(const char* first, const char* last, T& v, R (*parse)(const char*, char**))
+{
+    char buffer[64];
+    const size_t n = size_t(last - first);
+
+    if (n >= sizeof(buffer))
+        return false;
+
+    std::memcpy(buffer, first, n);
+    buffer[n] = 0;
+
+    char* end;
+    errno = 0;
+    const R r = parse(buffer, &end);
+
+    if (end == buffer || errno == ERANGE || r < R(std::numeric_limits<T>::lowest()) || r > R(std::numeric_limits<T>::max()))
+        return false;
+
+    v = T(r);
+    return true;
+}
+
+inline long long          parse_signed  (const char* s, char** end) { return std::strtoll (s, end, 10); }
+inline unsigned long long parse_unsigned(const char* s, char** end) { return std::strtoull(s, end, 10); }
+inline long double        parse_floating(const char* s, char** end) { return std::strtold (s, end);     }
+
+/// Converts capture [first,last) into an integral number without allocation
+template <typename T>
+inline bool convert_capture(const char* first, const char* last, T& v, std::integral_constant<capture_conversion_kind,capture_via_integral>)
+{
+    if (first != last && *first == '+')
+        ++first;
+    else
+    if (first != last && *first == '-' && !std::is_signed<T>::value)
+        return false;
+#if XTL_SUPPORT(std_from_chars)
+    const std::from_chars_result r = std::from_chars(first, last, v);
+    return r.ec == std::errc();
+#else
+    return std::is_signed<T>::value ? parse_capture(first, last, v, &parse_signed) 
+                                    : parse_capture(first, last, v, &parse_unsigned);
+#endif
+}
+
+/// Converts capture [first,last) into a floating-point number without allocation
+template <typename T>
+inline bool convert_capture(const char* first, const char* last, T& v, std::integral_constant<capture_conversion_kind,capture_via_floating>)
+{
+    if (first != last && *first == '+')
+        ++first;
+#if XTL_SUPPORT(std_from_chars) && defined(__cpp_lib_to_chars)
+    const std::from_chars_result r = std::from_chars(first, last, v);
+    return r.ec == std::errc();
+#else
+    return parse_capture(first, last, v, &parse_floating);
+#endif
+}
+
+/// Converts capture [first,last) into a value of type T with its operator>>
+template <typename T>
+inline bool convert_capture(const char* first, const char* last, T& v, std::integral_constant<capture_conversion_kind,capture_via_stream>)
+{
+    std::stringstream ss(std::string(first, last));
+    return bool(ss >> v);
+}
+
+/// Converts capture [first,last) of a regular expression into a value of type
+/// T. Numbers are converted without memory allocation, while values of other
+/// types are read with their operator>>. Similarly to the formatted input, 
+/// conversion of a number stops at the first character that cannot be a part
+/// of it, but unlike it, leading whitespace is not skipped.
+template <typename T>
+inline bool convert_capture(const char* first, const char* last, T& v)
+{
+    return convert_capture(first, last, v, capture_conversion<T>());
+}
+
+/// Captures are converted into std::string the same way operator>> reads it:
+/// leading whitespace is skipped, the string ends at the next whitespace and
+/// the conversion fails when there is nothing else in the capture.
+inline bool convert_capture(const char* first, const char* last, std::string& v)
+{
+    while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+        ++first;
+
+    const char* end = first;
+
+    while (end != last && !std::isspace(static_cast<unsigned char>(*end)))
+        ++end;
+
+    if (first == end)
+        return false;
+
+    v.assign(first, end);
+    return true;
+}
+
+#if XTL_SUPPORT(std_string_view)
+/// Captures are converted into std::string_view without copying: the view 
+/// refers to the characters of the subject.
+inline bool convert_capture(const char* first, const char* last, std::string_view& v)
+{
+    v = std::string_view(first, size_t(last - first));
+    return true;
+}
+#endif
+
+/// Applies pattern #p to capture #c of a regular expression
+template <typename P>
+inline bool match_capture(const P& p, const regex_capture& c)
+{
+    typename P::template accepted_type_for<std::string>::type v;
+    return convert_capture(c.first, c.second, v) && p(v);
+}
+
+//------------------------------------------------------------------------------
+
 /// RegEx pattern of 0 arguments
-struct regex0 : std::regex
+template <typename R = std::regex>
+struct regex0 : regex_holder<R>
 {
     /// Type function returning a type that will be accepted by the pattern for
     /// a given subject type S. We use type function instead of an associated 
     /// type, because there is no a single accepted type for a #wildcard pattern
     /// for example. Requirement of #Pattern concept.
-    template <typename S> struct accepted_type_for { typedef std::string type; };
+    template <typename S> struct accepted_type_for : regex_subject<S> {};
 
-    regex0(const char* re) : std::regex(re) {}
-    bool operator()(const std::string& s) const noexcept { return operator()(s.c_str()); }
-    bool operator()(const char*        s) const noexcept { std::cmatch m; return regex_match(s,m,*this); }
+    regex0(regex_holder<R>&& re) : regex_holder<R>(std::move(re)) {}
+
+    bool operator()(const std::string&      s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+    bool operator()(const char*             s) const noexcept { return operator()(s, s + std::strlen(s)); }
+#if XTL_SUPPORT(std_string_view)
+    bool operator()(const std::string_view& s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+#endif
+    bool operator()(const char* first, const char* last) const noexcept { return this->match(first, last, nullptr, 0); }
 };
 
 //------------------------------------------------------------------------------
 
 /// RegEx pattern of 1 arguments
-template <typename P1>
-struct regex1 : std::regex
+template <typename P1, typename R = std::regex>
+struct regex1 : regex_holder<R>
 {
     static_assert(is_pattern<P1>::value,    "Argument P1 of a regex-pattern must be a pattern");
 
@@ -79,30 +369,26 @@ struct regex1 : std::regex
     /// a given subject type S. We use type function instead of an associated 
     /// type, because there is no a single accepted type for a #wildcard pattern
     /// for example. Requirement of #Pattern concept.
-    template <typename S> struct accepted_type_for { typedef std::string type; };
+    template <typename S> struct accepted_type_for : regex_subject<S> {};
 
-    regex1(const char* re, const P1&  p1) noexcept_when(std::is_nothrow_copy_constructible<P1>::value) : std::regex(re), m_p1(          p1 ) {}
-    regex1(const char* re,       P1&& p1) noexcept_when(std::is_nothrow_move_constructible<P1>::value) : std::regex(re), m_p1(std::move(p1)) {}
+    regex1(regex_holder<R>&& re, const P1&  p1) noexcept_when(std::is_nothrow_copy_constructible<P1>::value) : regex_holder<R>(std::move(re)), m_p1(          p1 ) {}
+    regex1(regex_holder<R>&& re,       P1&& p1) noexcept_when(std::is_nothrow_move_constructible<P1>::value) : regex_holder<R>(std::move(re)), m_p1(std::move(p1)) {}
 
-    regex1(const regex1&  src)            noexcept_when(std::is_nothrow_copy_constructible<P1>::value) : std::regex(src), m_p1(          src.m_p1 ) {} ///< Copy constructor    
-    regex1(      regex1&& src)            noexcept_when(std::is_nothrow_move_constructible<P1>::value) : std::regex(src), m_p1(std::move(src.m_p1)) {} ///< Move constructor
+    regex1(const regex1&  src)               noexcept_when(std::is_nothrow_copy_constructible<P1>::value) : regex_holder<R>(src), m_p1(          src.m_p1 ) {} ///< Copy constructor    
+    regex1(      regex1&& src)               noexcept_when(std::is_nothrow_move_constructible<P1>::value) : regex_holder<R>(std::move(src)), m_p1(std::move(src.m_p1)) {} ///< Move constructor
 
     regex1& operator=(const regex1&) XTL_DELETED; ///< Assignment is not allowed for this class
 
-    bool operator()(const std::string& s) const noexcept { return operator()(s.c_str()); }
-    bool operator()(const char*        s) const noexcept
+    bool operator()(const std::string&      s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+    bool operator()(const char*             s) const noexcept { return operator()(s, s + std::strlen(s)); }
+#if XTL_SUPPORT(std_string_view)
+    bool operator()(const std::string_view& s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+#endif
+    bool operator()(const char* first, const char* last) const noexcept
     {
-        std::cmatch m; 
-
-        if (regex_match(s,m,*this))
-        {
-            XTL_ASSERT(m.size() > 1);   // There should be enough capture groups for each of the pattern arguments
-            typename P1::template accepted_type_for<std::string>::type m1;
-            std::stringstream ss(m[1]); // m[0] is the entire expression
-            return (ss >> m1) && m_p1(m1);
-        }
-
-        return false;
+        regex_capture c[1];
+        return this->match(first, last, c, 1)
+            && match_capture(m_p1, c[0]);
     }
     P1 m_p1;
 };
@@ -110,8 +396,8 @@ struct regex1 : std::regex
 //------------------------------------------------------------------------------
 
 /// RegEx pattern of 2 arguments
-template <typename P1, typename P2>
-struct regex2 : std::regex
+template <typename P1, typename P2, typename R = std::regex>
+struct regex2 : regex_holder<R>
 {
     static_assert(is_pattern<P1>::value,    "Argument P1 of a regex-pattern must be a pattern");
     static_assert(is_pattern<P2>::value,    "Argument P2 of a regex-pattern must be a pattern");
@@ -120,38 +406,29 @@ struct regex2 : std::regex
     /// a given subject type S. We use type function instead of an associated 
     /// type, because there is no a single accepted type for a #wildcard pattern
     /// for example. Requirement of #Pattern concept.
-    template <typename S> struct accepted_type_for { typedef std::string type; };
+    template <typename S> struct accepted_type_for : regex_subject<S> {};
 
-    regex2(const char* re, const P1&  p1, const P2&  p2) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value) : std::regex(re), m_p1(          p1 ), m_p2(          p2 ) {}
-    regex2(const char* re,       P1&& p1, const P2&  p2) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value) : std::regex(re), m_p1(std::move(p1)), m_p2(          p2 ) {}
-    regex2(const char* re, const P1&  p1,       P2&& p2) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value) : std::regex(re), m_p1(          p1 ), m_p2(std::move(p2)) {}
-    regex2(const char* re,       P1&& p1,       P2&& p2) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value) : std::regex(re), m_p1(std::move(p1)), m_p2(std::move(p2)) {}
+    regex2(regex_holder<R>&& re, const P1&  p1, const P2&  p2) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value) : regex_holder<R>(std::move(re)), m_p1(          p1 ), m_p2(          p2 ) {}
+    regex2(regex_holder<R>&& re,       P1&& p1, const P2&  p2) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value) : regex_holder<R>(std::move(re)), m_p1(std::move(p1)), m_p2(          p2 ) {}
+    regex2(regex_holder<R>&& re, const P1&  p1,       P2&& p2) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value) : regex_holder<R>(std::move(re)), m_p1(          p1 ), m_p2(std::move(p2)) {}
+    regex2(regex_holder<R>&& re,       P1&& p1,       P2&& p2) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value) : regex_holder<R>(std::move(re)), m_p1(std::move(p1)), m_p2(std::move(p2)) {}
 
-    regex2(const regex2&  src)                           noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value) : std::regex(src), m_p1(          src.m_p1 ), m_p2(          src.m_p2 ) {} ///< Copy constructor    
-    regex2(      regex2&& src)                           noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value) : std::regex(src), m_p1(std::move(src.m_p1)), m_p2(std::move(src.m_p2)) {} ///< Move constructor
+    regex2(const regex2&  src)                              noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value) : regex_holder<R>(src), m_p1(          src.m_p1 ), m_p2(          src.m_p2 ) {} ///< Copy constructor    
+    regex2(      regex2&& src)                              noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value) : regex_holder<R>(std::move(src)), m_p1(std::move(src.m_p1)), m_p2(std::move(src.m_p2)) {} ///< Move constructor
 
     regex2& operator=(const regex2&) XTL_DELETED; ///< Assignment is not allowed for this class
 
-    bool operator()(const std::string& s) const noexcept { return operator()(s.c_str()); }
-    bool operator()(const char*        s) const noexcept
+    bool operator()(const std::string&      s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+    bool operator()(const char*             s) const noexcept { return operator()(s, s + std::strlen(s)); }
+#if XTL_SUPPORT(std_string_view)
+    bool operator()(const std::string_view& s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+#endif
+    bool operator()(const char* first, const char* last) const noexcept
     {
-        std::cmatch m; 
-
-        if (regex_match(s,m,*this))
-        {
-            XTL_ASSERT(m.size() > 2);   // There should be enough capture groups for each of the pattern arguments
-            typename P1::template accepted_type_for<std::string>::type m1;
-            std::stringstream ss1(m[1]); // m[0] is the entire expression
-
-            if ((ss1 >> m1) && m_p1(m1))
-            {
-                typename P2::template accepted_type_for<std::string>::type m2;
-                std::stringstream ss2(m[2]); // FIX: Was unable to reuse ss1 for some rason
-                return (ss2 >> m2) && m_p2(m2);
-            }
-        }
-
-        return false;
+        regex_capture c[2];
+        return this->match(first, last, c, 2)
+            && match_capture(m_p1, c[0])
+            && match_capture(m_p2, c[1]);
     }
     P1 m_p1;
     P2 m_p2;
@@ -160,8 +437,8 @@ struct regex2 : std::regex
 //------------------------------------------------------------------------------
 
 /// RegEx pattern of 3 arguments
-template <typename P1, typename P2, typename P3>
-struct regex3 : std::regex
+template <typename P1, typename P2, typename P3, typename R = std::regex>
+struct regex3 : regex_holder<R>
 {
     static_assert(is_pattern<P1>::value,    "Argument P1 of a regex-pattern must be a pattern");
     static_assert(is_pattern<P2>::value,    "Argument P2 of a regex-pattern must be a pattern");
@@ -171,48 +448,34 @@ struct regex3 : std::regex
     /// a given subject type S. We use type function instead of an associated 
     /// type, because there is no a single accepted type for a #wildcard pattern
     /// for example. Requirement of #Pattern concept.
-    template <typename S> struct accepted_type_for { typedef std::string type; };
+    template <typename S> struct accepted_type_for : regex_subject<S> {};
 
-    regex3(const char* re, const P1&  p1, const P2&  p2, const P3&  p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : std::regex(re), m_p1(          p1 ), m_p2(          p2 ), m_p3(          p3 ) {}
-    regex3(const char* re,       P1&& p1, const P2&  p2, const P3&  p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : std::regex(re), m_p1(std::move(p1)), m_p2(          p2 ), m_p3(          p3 ) {}
-    regex3(const char* re, const P1&  p1,       P2&& p2, const P3&  p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : std::regex(re), m_p1(          p1 ), m_p2(std::move(p2)), m_p3(          p3 ) {}
-    regex3(const char* re,       P1&& p1,       P2&& p2, const P3&  p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : std::regex(re), m_p1(std::move(p1)), m_p2(std::move(p2)), m_p3(          p3 ) {}
-    regex3(const char* re, const P1&  p1, const P2&  p2,       P3&& p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : std::regex(re), m_p1(          p1 ), m_p2(          p2 ), m_p3(std::move(p3)) {}
-    regex3(const char* re,       P1&& p1, const P2&  p2,       P3&& p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : std::regex(re), m_p1(std::move(p1)), m_p2(          p2 ), m_p3(std::move(p3)) {}
-    regex3(const char* re, const P1&  p1,       P2&& p2,       P3&& p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : std::regex(re), m_p1(          p1 ), m_p2(std::move(p2)), m_p3(std::move(p3)) {}
-    regex3(const char* re,       P1&& p1,       P2&& p2,       P3&& p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : std::regex(re), m_p1(std::move(p1)), m_p2(std::move(p2)), m_p3(std::move(p3)) {}
+    regex3(regex_holder<R>&& re, const P1&  p1, const P2&  p2, const P3&  p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(          p1 ), m_p2(          p2 ), m_p3(          p3 ) {}
+    regex3(regex_holder<R>&& re,       P1&& p1, const P2&  p2, const P3&  p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(std::move(p1)), m_p2(          p2 ), m_p3(          p3 ) {}
+    regex3(regex_holder<R>&& re, const P1&  p1,       P2&& p2, const P3&  p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(          p1 ), m_p2(std::move(p2)), m_p3(          p3 ) {}
+    regex3(regex_holder<R>&& re,       P1&& p1,       P2&& p2, const P3&  p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(std::move(p1)), m_p2(std::move(p2)), m_p3(          p3 ) {}
+    regex3(regex_holder<R>&& re, const P1&  p1, const P2&  p2,       P3&& p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(          p1 ), m_p2(          p2 ), m_p3(std::move(p3)) {}
+    regex3(regex_holder<R>&& re,       P1&& p1, const P2&  p2,       P3&& p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(std::move(p1)), m_p2(          p2 ), m_p3(std::move(p3)) {}
+    regex3(regex_holder<R>&& re, const P1&  p1,       P2&& p2,       P3&& p3) noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(          p1 ), m_p2(std::move(p2)), m_p3(std::move(p3)) {}
+    regex3(regex_holder<R>&& re,       P1&& p1,       P2&& p2,       P3&& p3) noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : regex_holder<R>(std::move(re)), m_p1(std::move(p1)), m_p2(std::move(p2)), m_p3(std::move(p3)) {}
 
-    regex3(const regex3&  src)                                          noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : std::regex(src), m_p1(          src.m_p1 ), m_p2(          src.m_p2 ), m_p3(          src.m_p3 ) {} ///< Copy constructor    
-    regex3(      regex3&& src)                                          noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : std::regex(src), m_p1(std::move(src.m_p1)), m_p2(std::move(src.m_p2)), m_p3(std::move(src.m_p3)) {} ///< Move constructor
+    regex3(const regex3&  src)                                          noexcept_when(std::is_nothrow_copy_constructible<P1>::value && std::is_nothrow_copy_constructible<P2>::value && std::is_nothrow_copy_constructible<P3>::value) : regex_holder<R>(src), m_p1(          src.m_p1 ), m_p2(          src.m_p2 ), m_p3(          src.m_p3 ) {} ///< Copy constructor    
+    regex3(      regex3&& src)                                          noexcept_when(std::is_nothrow_move_constructible<P1>::value && std::is_nothrow_move_constructible<P2>::value && std::is_nothrow_move_constructible<P3>::value) : regex_holder<R>(std::move(src)), m_p1(std::move(src.m_p1)), m_p2(std::move(src.m_p2)), m_p3(std::move(src.m_p3)) {} ///< Move constructor
 
     regex3& operator=(const regex3&) XTL_DELETED; ///< Assignment is not allowed for this class
 
-    bool operator()(const std::string& s) const noexcept { return operator()(s.c_str()); }
-    bool operator()(const char*        s) const noexcept
+    bool operator()(const std::string&      s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+    bool operator()(const char*             s) const noexcept { return operator()(s, s + std::strlen(s)); }
+#if XTL_SUPPORT(std_string_view)
+    bool operator()(const std::string_view& s) const noexcept { return operator()(s.data(), s.data() + s.size()); }
+#endif
+    bool operator()(const char* first, const char* last) const noexcept
     {
-        std::cmatch m; 
-
-        if (regex_match(s,m,*this))
-        {
-            XTL_ASSERT(m.size() > 3);   // There should be enough capture groups for each of the pattern arguments
-            typename P1::template accepted_type_for<std::string>::type m1;
-            std::stringstream ss1(m[1]); // m[0] is the entire expression
-
-            if ((ss1 >> m1) && m_p1(m1))
-            {
-                typename P2::template accepted_type_for<std::string>::type m2;
-                std::stringstream ss2(m[2]); // FIX: Was unable to reuse ss1 for some rason
-
-                if ((ss2 >> m2) && m_p2(m2))
-                {
-                    typename P3::template accepted_type_for<std::string>::type m3;
-                    std::stringstream ss3(m[3]); // FIX: Was unable to reuse ss1 for some rason
-                    return (ss3 >> m3) && m_p3(m3);
-                }
-            }
-        }
-
-        return false;
+        regex_capture c[3];
+        return this->match(first, last, c, 3)
+            && match_capture(m_p1, c[0])
+            && match_capture(m_p2, c[1])
+            && match_capture(m_p3, c[2]);
     }
     P1 m_p1;
     P2 m_p2;
@@ -222,29 +485,29 @@ struct regex3 : std::regex
 //------------------------------------------------------------------------------
 
 /// A 0-argument version of a regular-expression-pattern constructor.
-inline regex0 rex(const char* re) noexcept { return regex0(re); }
+inline regex0<> rex(const char* re) { return regex0<>(regex_holder<>(re)); }
 
 /// A 1-argument version of a regular-expression-pattern constructor.
 template <typename P1>
-inline auto rex(const char* re, P1&& p1) noexcept -> XTL_RETURN
+inline auto rex(const char* re, P1&& p1) -> XTL_RETURN
 (
     regex1<
         typename underlying<decltype(filter(std::forward<P1>(p1)))>::type
     >(
-        re, 
+        regex_holder<>(re), 
         filter(std::forward<P1>(p1))
      )
 )
 
 /// A 2-argument version of a regular-expression-pattern constructor.
 template <typename P1, typename P2>
-inline auto rex(const char* re, P1&& p1, P2&& p2) noexcept -> XTL_RETURN
+inline auto rex(const char* re, P1&& p1, P2&& p2) -> XTL_RETURN
 (
     regex2<
         typename underlying<decltype(filter(std::forward<P1>(p1)))>::type,
         typename underlying<decltype(filter(std::forward<P2>(p2)))>::type
     >(
-        re, 
+        regex_holder<>(re), 
         filter(std::forward<P1>(p1)),
         filter(std::forward<P2>(p2))
      )
@@ -252,14 +515,14 @@ inline auto rex(const char* re, P1&& p1, P2&& p2) noexcept -> XTL_RETURN
 
 /// A 3-argument version of a regular-expression-pattern constructor.
 template <typename P1, typename P2, typename P3>
-inline auto rex(const char* re, P1&& p1, P2&& p2, P3&& p3) noexcept -> XTL_RETURN
+inline auto rex(const char* re, P1&& p1, P2&& p2, P3&& p3) -> XTL_RETURN
 (
     regex3<
         typename underlying<decltype(filter(std::forward<P1>(p1)))>::type,
         typename underlying<decltype(filter(std::forward<P2>(p2)))>::type,
         typename underlying<decltype(filter(std::forward<P3>(p3)))>::type
     >(
-        re, 
+        regex_holder<>(re), 
         filter(std::forward<P1>(p1)),
         filter(std::forward<P2>(p2)),
         filter(std::forward<P3>(p3))
@@ -268,10 +531,75 @@ inline auto rex(const char* re, P1&& p1, P2&& p2, P3&& p3) noexcept -> XTL_RETUR
 
 //------------------------------------------------------------------------------
 
-template <>                                      struct is_pattern_<regex0>           { static const bool value = true; };
-template <typename P1>                           struct is_pattern_<regex1<P1>>       { static const bool value = true; };
-template <typename P1, typename P2>              struct is_pattern_<regex2<P1,P2>>    { static const bool value = true; };
-template <typename P1, typename P2, typename P3> struct is_pattern_<regex3<P1,P2,P3>> { static const bool value = true; };
+/// Type of the compiled regular expression R of a #regex_engine, which is only
+/// defined for types that have the engine.
+#define XTL_REGEX_TYPE(R) typename regex_engine<typename std::decay<R>::type>::regex_type
+
+/// A 0-argument version of a regular-expression-pattern constructor that takes
+/// an already compiled expression of any #regex_engine. Lvalues are referenced
+/// by the pattern, while rvalues are moved into it.
+template <typename R>
+inline auto rex(R&& re) -> XTL_RETURN
+(
+    regex0<XTL_REGEX_TYPE(R)>(regex_holder<XTL_REGEX_TYPE(R)>(std::forward<R>(re)))
+)
+
+/// A 1-argument version of a regular-expression-pattern constructor that takes
+/// an already compiled expression of any #regex_engine.
+template <typename R, typename P1>
+inline auto rex(R&& re, P1&& p1) -> XTL_RETURN
+(
+    regex1<
+        typename underlying<decltype(filter(std::forward<P1>(p1)))>::type,
+        XTL_REGEX_TYPE(R)
+    >(
+        regex_holder<XTL_REGEX_TYPE(R)>(std::forward<R>(re)), 
+        filter(std::forward<P1>(p1))
+     )
+)
+
+/// A 2-argument version of a regular-expression-pattern constructor that takes
+/// an already compiled expression of any #regex_engine.
+template <typename R, typename P1, typename P2>
+inline auto rex(R&& re, P1&& p1, P2&& p2) -> XTL_RETURN
+(
+    regex2<
+        typename underlying<decltype(filter(std::forward<P1>(p1)))>::type,
+        typename underlying<decltype(filter(std::forward<P2>(p2)))>::type,
+        XTL_REGEX_TYPE(R)
+    >(
+        regex_holder<XTL_REGEX_TYPE(R)>(std::forward<R>(re)), 
+        filter(std::forward<P1>(p1)),
+        filter(std::forward<P2>(p2))
+     )
+)
+
+/// A 3-argument version of a regular-expression-pattern constructor that takes
+/// an already compiled expression of any #regex_engine.
+template <typename R, typename P1, typename P2, typename P3>
+inline auto rex(R&& re, P1&& p1, P2&& p2, P3&& p3) -> XTL_RETURN
+(
+    regex3<
+        typename underlying<decltype(filter(std::forward<P1>(p1)))>::type,
+        typename underlying<decltype(filter(std::forward<P2>(p2)))>::type,
+        typename underlying<decltype(filter(std::forward<P3>(p3)))>::type,
+        XTL_REGEX_TYPE(R)
+    >(
+        regex_holder<XTL_REGEX_TYPE(R)>(std::forward<R>(re)), 
+        filter(std::forward<P1>(p1)),
+        filter(std::forward<P2>(p2)),
+        filter(std::forward<P3>(p3))
+     )
+)
+
+#undef XTL_REGEX_TYPE
+
+//------------------------------------------------------------------------------
+
+template <typename R>                                        struct is_pattern_<regex0<R>>          { static const bool value = true; };
+template <typename P1, typename R>                           struct is_pattern_<regex1<P1,R>>       { static const bool value = true; };
+template <typename P1, typename P2, typename R>              struct is_pattern_<regex2<P1,P2,R>>    { static const bool value = true; };
+template <typename P1, typename P2, typename P3, typename R> struct is_pattern_<regex3<P1,P2,P3,R>> { static const bool value = true; };
 
 //------------------------------------------------------------------------------
 
@@ -0,0 +1,839 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file defines a regular-expression engine for regex patterns that 
+/// matches in linear time without memory allocation on the hot path.
+///
+/// The engine supports the regular subset of the ECMAScript grammar that is
+/// typically used in patterns: literals, character classes, ., \\d, \\w, \\s and
+/// their negations, capturing and non-capturing groups, alternation, greedy
+/// and lazy quantifiers, as well as ^ and $ at the very beginning and end of the
+/// expression. Repetitions of subexpressions that can match the empty string
+/// are not supported. The expression is compiled into a Thompson NFA and, via subset
+/// construction, into a DFA over equivalence classes of characters. The DFA
+/// decides whether the subject matches, after which only successful matches
+/// with captures requested run the NFA simulation (Pike VM) to locate the 
+/// capture groups. The NFA simulation follows the priorities of alternatives
+/// and quantifiers, so the groups are the same as those std::regex reports.
+/// Expressions outside of the subset (back-references, assertions, etc.) are
+/// compiled with std::regex, which remains the fallback.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+/// \see https://swtch.com/~rsc/regexp/regexp2.html
+///
+
+#pragma once
+
+#include "regex.hpp"
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Regular expression compiled into a deterministic finite automaton. 
+/// \note Compiled expressions are immutable and can be used by several threads
+///       at once. Each thread keeps its own scratch space for the NFA simulation.
+class dfa_regex
+{
+public:
+
+    enum
+    {
+        /// Maximum number of instructions in the compiled NFA. Longer 
+        /// expressions are compiled with std::regex.
+        max_program_size = 4096,
+
+        /// Maximum number of states of the DFA. Expressions with more states 
+        /// decide the match with the NFA simulation as well, which is still 
+        /// linear.
+        max_states = 1024
+    };
+
+    dfa_regex() : m_classes(0), m_start(no_state), m_groups(0) { std::fill(m_class_of, m_class_of + 256, static_cast<unsigned char>(0)); }
+
+    /// Compiles regular expression #re in ECMAScript grammar.
+    /// \throws std::regex_error when the expression is not valid
+    explicit dfa_regex(const char* re) : m_classes(0), m_start(no_state), m_groups(0)
+    {
+        std::fill(m_class_of, m_class_of + 256, static_cast<unsigned char>(0));
+
+        try
+        {
+            compile(re);
+        }
+        catch (const unsupported&)
+        {
+            m_program.clear();
+            m_sets.clear();
+            m_fallback = std::make_shared<std::regex>(re, std::regex::ECMAScript | std::regex::optimize);
+        }
+    }
+
+    /// Whether the expression is outside of the supported subset and is thus
+    /// matched by std::regex.
+    bool uses_fallback() const noexcept { return m_fallback != nullptr; }
+
+    /// Number of states of the DFA, 0 when the match is decided by the NFA
+    /// simulation or by std::regex.
+    size_t states() const noexcept { return m_accepting.size(); }
+
+    /// Number of capture groups in the expression
+    size_t groups() const noexcept { return m_groups; }
+
+    /// Checks whether the entire range [first,last) matches the expression and,
+    /// if so, fills in #captures with the first #n capture groups.
+    bool match(const char* first, const char* last, regex_capture* captures, size_t n) const
+    {
+        if (XTL_UNLIKELY(m_fallback != nullptr))
+            return regex_engine<std::regex>::match(*m_fallback, first, last, captures, n);
+
+        if (XTL_LIKELY(m_start != no_state))
+        {
+            int state = m_start;
+
+            for (const char* p = first; p != last; ++p)
+                if ((state = m_transitions[state*m_classes + m_class_of[static_cast<unsigned char>(*p)]]) == no_state)
+                    return false;
+
+            if (!m_accepting[state])
+                return false;
+
+            if (n == 0)
+                return true;
+        }
+
+        return simulate(first, last, captures, n);
+    }
+
+private:
+
+    /// Thrown by the compiler on syntax outside of the supported subset
+    struct unsupported {};
+
+    /// Marks a missing DFA state or transition
+    enum { no_state = -1 };
+
+    /// Instructions of the NFA program
+    enum opcode
+    {
+        op_set,   ///< Consume a character from set x
+        op_split, ///< Continue at x, and with lower priority at y
+        op_jump,  ///< Continue at x
+        op_save,  ///< Record the current position in capture slot x
+        op_match  ///< Accept
+    };
+
+    struct instruction
+    {
+        instruction(opcode o, int a = 0, int b = 0) : op(o), x(a), y(b) {}
+        opcode op;
+        int    x;
+        int    y;
+    };
+
+    typedef std::bitset<256> charset;
+
+    /// Node of the syntax tree of an expression
+    struct node
+    {
+        enum kind_type { set, empty, sequence, alternation, repetition, group };
+        explicit node(kind_type k, int v = 0) : kind(k), value(v), min(0), max(0), greedy(true) {}
+        kind_type           kind;
+        int                 value; ///< Index of the character set or number of the group
+        int                 min;   ///< Minimum number of repetitions
+        int                 max;   ///< Maximum number of repetitions, -1 when unbounded
+        bool                greedy;
+        std::vector<size_t> kids;
+    };
+
+    /// Recursive-descent parser of the supported subset of ECMAScript grammar
+    struct parser
+    {
+        parser(const char* re, std::vector<charset>& sets) : begin(re), p(re), end(re + std::strlen(re)), sets(sets), groups(0) {}
+
+        size_t add(const node& n) { nodes.push_back(n); return nodes.size() - 1; }
+        size_t add(const charset& s) { sets.push_back(s); return add(node(node::set, int(sets.size() - 1))); }
+
+        size_t parse()
+        {
+            size_t n = alternation();
+
+            if (p != end) // Unbalanced parenthesis
+                throw unsupported();
+
+            return n;
+        }
+
+        size_t alternation()
+        {
+            node alt(node::alternation);
+            alt.kids.push_back(sequence());
+
+            while (p != end && *p == '|')
+            {
+                ++p;
+                alt.kids.push_back(sequence());
+            }
+
+            return alt.kids.size() == 1 ? alt.kids[0] : add(alt);
+        }
+
+        size_t sequence()
+        {
+            node seq(node::sequence);
+
+            while (p != end && *p != '|' && *p != ')')
+                seq.kids.push_back(repetition());
+
+            return add(seq);
+        }
+
+        size_t repetition()
+        {
+            size_t n = atom();
+
+            if (p == end)
+                return n;
+
+            node rep(node::repetition);
+
+            switch (*p)
+            {
+            case '*': rep.min = 0; rep.max = -1; ++p; break;
+            case '+': rep.min = 1; rep.max = -1; ++p; break;
+            case '?': rep.min = 0; rep.max =  1; ++p; break;
+            case '{': ++p; bounds(rep.min, rep.max); break;
+            default:  return n;
+            }
+
+            if (p != end && *p == '?')
+            {
+                rep.greedy = false;
+                ++p;
+            }
+
+            if (p != end && (*p == '*' || *p == '+' || *p == '?' || *p == '{')) // Nothing to repeat
+                throw unsupported();
+
+            // ECMAScript rejects optional iterations that match the empty 
+            // string, which affects the capture groups in ways that priorities
+            // of NFA threads cannot express.
+            if (rep.max != rep.min && nullable(n))
+                throw unsupported();
+
+            rep.kids.push_back(n);
+            return add(rep);
+        }
+
+        /// Whether the syntax tree #n can match the empty string
+        bool nullable(size_t n) const
+        {
+            const node& x = nodes[n];
+
+            switch (x.kind)
+            {
+            case node::set:         return false;
+            case node::empty:       return true;
+            case node::group:       return nullable(x.kids[0]);
+            case node::repetition:  return x.min == 0 || nullable(x.kids[0]);
+            case node::alternation:
+                for (size_t i = 0; i < x.kids.size(); ++i)
+                    if (nullable(x.kids[i]))
+                        return true;
+                return false;
+            default:
+                for (size_t i = 0; i < x.kids.size(); ++i)
+                    if (!nullable(x.kids[i]))
+                        return false;
+                return true;
+            }
+        }
+
+        /// Parses {n}, {n,} and {n,m} after the opening brace
+        void bounds(int& min, int& max)
+        {
+            min = max = number();
+
+            if (p != end && *p == ',')
+                max = ++p != end && *p == '}' ? -1 : number();
+
+            if (p == end || *p++ != '}' || (max >= 0 && max < min))
+                throw unsupported();
+        }
+
+        int number()
+        {
+            int n = 0;
+
+            if (p == end || *p < '0' || *p > '9')
+                throw unsupported();
+
+            for (; p != end && *p >= '0' && *p <= '9'; ++p)
+                if ((n = n*10 + (*p - '0')) > 1000) // Leave excessive repetitions to std::regex
+                    throw unsupported();
+
+            return n;
+        }
+
+        size_t atom()
+        {
+            const char c = *p++;
+            charset s;
+
+            switch (c)
+            {
+            case '(':
+                {
+                    int g = 0;
+
+                    if (p != end && *p == '?')
+                    {
+                        if (p + 1 == end || p[1] != ':') // Assertions are not supported
+                            throw unsupported();
+                        p += 2;
+                    }
+                    else
+                        g = int(++groups);
+
+                    size_t n = alternation();
+
+                    if (p == end || *p++ != ')')
+                        throw unsupported();
+
+                    if (g == 0)
+                        return n;
+
+                    node grp(node::group, g);
+                    grp.kids.push_back(n);
+                    return add(grp);
+                }
+            case '[':  return add(bracket());
+            case '\\': return add(escape(false));
+            case '.':  s.set(); s.reset('\n'); s.reset('\r'); return add(s);
+            case '^':  if (p - 1 == begin) return add(node(node::empty)); throw unsupported();
+            case '$':  if (p     == end)   return add(node(node::empty)); throw unsupported();
+            case '*': case '+': case '?': case '{': case '}': case ']':
+                throw unsupported();
+            default:
+                s.set(static_cast<unsigned char>(c));
+                return add(s);
+            }
+        }
+
+        /// Parses an escape sequence after the backslash
+        charset escape(bool in_class)
+        {
+            if (p == end)
+                throw unsupported();
+
+            const char c = *p++;
+            charset s;
+
+            switch (c)
+            {
+            case 'd': case 'D': for (int i = '0'; i <= '9'; ++i) s.set(i); break;
+            case 's': case 'S': s.set(' '); s.set('\t'); s.set('\n'); s.set('\v'); s.set('\f'); s.set('\r'); break;
+            case 'w': case 'W':
+                for (int i = 0; i < 256; ++i)
+                    if ((i >= '0' && i <= '9') || (i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || i == '_')
+                        s.set(i);
+                break;
+            case 't': s.set('\t'); break;
+            case 'n': s.set('\n'); break;
+            case 'r': s.set('\r'); break;
+            case 'f': s.set('\f'); break;
+            case 'v': s.set('\v'); break;
+            case 'b': if (in_class) { s.set('\b'); break; } throw unsupported(); // Word boundary
+            case '0': if (p == end || *p < '0' || *p > '9') { s.set(0); break; } throw unsupported();
+            case 'x':
+                {
+                    int v = 0;
+
+                    for (int i = 0; i < 2; ++i, ++p)
+                    {
+                        const int d = p == end ? -1 : *p >= '0' && *p <= '9' ? *p - '0' : *p >= 'a' && *p <= 'f' ? *p - 'a' + 10 : *p >= 'A' && *p <= 'F' ? *p - 'A' + 10 : -1;
+
+                        if (d < 0)
+                            throw unsupported();
+
+                        v = v*16 + d;
+                    }
+
+                    s.set(v);
+                    break;
+                }
+            default:
+                if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) // Back-references, \B, \c, \u etc.
+                    throw unsupported();
+                s.set(static_cast<unsigned char>(c)); // Identity escape
+            }
+
+            if (c == 'D' || c == 'S' || c == 'W')
+                s.flip();
+
+            return s;
+        }
+
+        /// Returns the only character of set #s or -1 when there is not exactly one
+        static int single(const charset& s)
+        {
+            if (s.count() != 1)
+                return -1;
+
+            int i = 0;
+            while (!s.test(i)) ++i;
+            return i;
+        }
+
+        /// Parses a character class after the opening bracket
+        charset bracket()
+        {
+            const bool negate = p != end && *p == '^';
+            charset s;
+
+            if (negate)
+                ++p;
+
+            for (;;)
+            {
+                if (p == end)
+                    throw unsupported();
+
+                if (*p == ']')
+                {
+                    ++p;
+                    break;
+                }
+
+                if (*p == '[' && p + 1 != end && (p[1] == ':' || p[1] == '=' || p[1] == '.')) // POSIX classes
+                    throw unsupported();
+
+                charset e;
+
+                if (*p == '\\')
+                {
+                    ++p;
+                    e = escape(true);
+                }
+                else
+                    e.set(static_cast<unsigned char>(*p++));
+
+                const int lo = single(e);
+
+                if (lo >= 0 && p + 1 < end && *p == '-' && p[1] != ']')
+                {
+                    ++p;
+                    charset h;
+
+                    if (*p == '\\')
+                    {
+                        ++p;
+                        h = escape(true);
+                    }
+                    else
+                        h.set(static_cast<unsigned char>(*p++));
+
+                    const int hi = single(h);
+
+                    if (hi < lo)
+                        throw unsupported();
+
+                    for (int i = lo; i <= hi; ++i)
+                        s.set(i);
+                }
+                else
+                    s |= e;
+            }
+
+            if (negate)
+                s.flip();
+
+            return s;
+        }
+
+        const char*           begin;
+        const char*           p;
+        const char*           end;
+        std::vector<node>     nodes;
+        std::vector<charset>& sets;
+        size_t                groups;
+    };
+
+    size_t emit(const instruction& i)
+    {
+        if (m_program.size() >= max_program_size)
+            throw unsupported();
+
+        m_program.push_back(i);
+        return m_program.size() - 1;
+    }
+
+    /// Sets the targets of the split at #pc to continue with the body right 
+    /// after it and exit at #out with priorities defined by #greedy
+    void branch(size_t pc, size_t out, bool greedy)
+    {
+        m_program[pc].x = int(greedy ? pc + 1 : out);
+        m_program[pc].y = int(greedy ? out    : pc + 1);
+    }
+
+    /// Generates the NFA program of syntax-tree node #n
+    void generate(const std::vector<node>& nodes, size_t n)
+    {
+        const node& x = nodes[n];
+
+        switch (x.kind)
+        {
+        case node::set:
+            emit(instruction(op_set, x.value));
+            break;
+        case node::empty:
+            break;
+        case node::sequence:
+            for (size_t i = 0; i < x.kids.size(); ++i)
+                generate(nodes, x.kids[i]);
+            break;
+        case node::alternation:
+            {
+                std::vector<size_t> jumps;
+
+                for (size_t i = 0; i + 1 < x.kids.size(); ++i)
+                {
+                    const size_t split = emit(instruction(op_split));
+                    generate(nodes, x.kids[i]);
+                    jumps.push_back(emit(instruction(op_jump)));
+                    branch(split, m_program.size(), true);
+                }
+
+                generate(nodes, x.kids.back());
+
+                for (size_t i = 0; i < jumps.size(); ++i)
+                    m_program[jumps[i]].x = int(m_program.size());
+            }
+            break;
+        case node::group:
+            emit(instruction(op_save, 2*(x.value - 1)));
+            generate(nodes, x.kids[0]);
+            emit(instruction(op_save, 2*(x.value - 1) + 1));
+            break;
+        case node::repetition:
+            {
+                for (int i = 0; i < x.min; ++i)
+                    generate(nodes, x.kids[0]);
+
+                if (x.max < 0)
+                {
+                    const size_t loop = emit(instruction(op_split));
+                    generate(nodes, x.kids[0]);
+                    emit(instruction(op_jump, int(loop)));
+                    branch(loop, m_program.size(), x.greedy);
+                }
+                else
+                {
+                    std::vector<size_t> splits;
+
+                    for (int i = x.min; i < x.max; ++i)
+                    {
+                        splits.push_back(emit(instruction(op_split)));
+                        generate(nodes, x.kids[0]);
+                    }
+
+                    for (size_t i = 0; i < splits.size(); ++i)
+                        branch(splits[i], m_program.size(), x.greedy);
+                }
+            }
+            break;
+        }
+    }
+
+    /// Adds to #states the instructions consuming characters or accepting that
+    /// are reachable from #pc without consuming a character.
+    void closure(std::vector<int>& states, std::vector<char>& seen, int pc) const
+    {
+        if (seen[pc])
+            return;
+
+        seen[pc] = 1;
+        const instruction& i = m_program[pc];
+
+        switch (i.op)
+        {
+        case op_jump:  closure(states, seen, i.x); break;
+        case op_split: closure(states, seen, i.x); closure(states, seen, i.y); break;
+        case op_save:  closure(states, seen, pc + 1); break;
+        default:       states.push_back(pc);
+        }
+    }
+
+    /// Compiles expression #re into NFA and DFA
+    void compile(const char* re)
+    {
+        parser syntax(re, m_sets);
+        const size_t root = syntax.parse();
+        generate(syntax.nodes, root);
+        emit(instruction(op_match));
+        m_groups = syntax.groups;
+
+        // Split characters into classes that no character set distinguishes
+        std::vector<int> remap;
+        m_classes = 1;
+
+        for (size_t s = 0; s < m_sets.size(); ++s)
+        {
+            remap.assign(2*m_classes, no_state);
+            size_t classes = 0;
+
+            for (int c = 0; c < 256; ++c)
+            {
+                int& r = remap[2*m_class_of[c] + m_sets[s].test(c)];
+
+                if (r == no_state)
+                    r = int(classes++);
+
+                m_class_of[c] = static_cast<unsigned char>(r);
+            }
+
+            m_classes = classes;
+        }
+
+        std::vector<int> representative(m_classes, no_state);
+
+        for (int c = 255; c >= 0; --c)
+            representative[m_class_of[c]] = c;
+
+        // Subset construction
+        std::map<std::vector<int>, int> ids;
+        std::vector<std::vector<int>>   states;
+        std::vector<char>               seen(m_program.size());
+        std::vector<int>                next;
+
+        closure(next, seen, 0);
+        std::sort(next.begin(), next.end());
+        ids[next] = 0;
+        states.push_back(next);
+
+        for (size_t s = 0; s < states.size(); ++s)
+        {
+            if (states.size() > max_states)
+            {
+                m_transitions.clear();
+                m_accepting.clear();
+                return;
+            }
+
+            const std::vector<int> current = states[s];
+            m_transitions.resize((s + 1)*m_classes, no_state);
+            m_accepting.push_back(std::find_if(current.begin(), current.end(), [this](int pc) { return m_program[pc].op == op_match; }) != current.end());
+
+            for (size_t k = 0; k < m_classes; ++k)
+            {
+                next.clear();
+                std::fill(seen.begin(), seen.end(), 0);
+
+                for (size_t i = 0; i < current.size(); ++i)
+                    if (m_program[current[i]].op == op_set && m_sets[m_program[current[i]].x].test(representative[k]))
+                        closure(next, seen, current[i] + 1);
+
+                if (next.empty())
+                    continue;
+
+                std::sort(next.begin(), next.end());
+                std::map<std::vector<int>, int>::const_iterator q = ids.find(next);
+
+                if (q == ids.end())
+                {
+                    q = ids.insert(std::make_pair(next, int(states.size()))).first;
+                    states.push_back(next);
+                }
+
+                m_transitions[s*m_classes + k] = q->second;
+            }
+        }
+
+        m_start = 0;
+    }
+
+    /// Per-thread scratch space of the NFA simulation, which only grows
+    struct scratch
+    {
+        scratch() : step(0) {}
+        std::vector<int>         threads[2]; ///< Instructions of the threads of the current and next step in priority order
+        std::vector<const char*> slots[2];   ///< Capture slots of those threads
+        std::vector<const char*> current;    ///< Capture slots of the thread being advanced
+        std::vector<size_t>      added;      ///< Step at which an instruction was last added
+        size_t                   step;
+    };
+
+    /// Adds a thread at #pc with capture slots #caps to the list #l of #s
+    void add_thread(scratch& s, int l, size_t& count, int pc, const char* sp, const char** caps, size_t k) const
+    {
+        if (s.added[pc] == s.step)
+            return;
+
+        s.added[pc] = s.step;
+        const instruction& i = m_program[pc];
+
+        switch (i.op)
+        {
+        case op_jump:
+            add_thread(s, l, count, i.x, sp, caps, k);
+            break;
+        case op_split:
+            add_thread(s, l, count, i.x, sp, caps, k);
+            add_thread(s, l, count, i.y, sp, caps, k);
+            break;
+        case op_save:
+            if (size_t(i.x) < k)
+            {
+                const char* saved = caps[i.x];
+                caps[i.x] = sp;
+                add_thread(s, l, count, pc + 1, sp, caps, k);
+                caps[i.x] = saved;
+            }
+            else
+                add_thread(s, l, count, pc + 1, sp, caps, k);
+            break;
+        default:
+            s.threads[l][count] = pc;
+            std::copy(caps, caps + k, s.slots[l].data() + count*k);
+            ++count;
+        }
+    }
+
+    /// Simulates the NFA on [first,last) to decide the match and locate the 
+    /// first #n capture groups.
+    bool simulate(const char* first, const char* last, regex_capture* captures, size_t n) const
+    {
+        if (m_program.empty())
+            return false;
+
+        XTL_ASSERT(n <= m_groups); // There should be enough capture groups for each of the pattern arguments
+
+        static thread_local scratch s;
+        const size_t size = m_program.size();
+        const size_t k    = 2*std::min(n, m_groups);
+
+        for (int l = 0; l < 2; ++l)
+        {
+            if (s.threads[l].size() < size)   s.threads[l].resize(size);
+            if (s.slots[l].size()   < size*k) s.slots[l].resize(size*k);
+        }
+
+        if (s.current.size() < k)    s.current.resize(k);
+        if (s.added.size()   < size) s.added.resize(size, 0);
+
+        size_t count[2] = {0, 0};
+        int    cur      = 0;
+
+        std::fill(s.current.begin(), s.current.begin() + k, nullptr);
+        ++s.step;
+        add_thread(s, cur, count[cur], 0, first, s.current.data(), k);
+
+        for (const char* sp = first; sp != last && count[cur]; ++sp)
+        {
+            const int nxt = 1 - cur;
+            const unsigned char c = static_cast<unsigned char>(*sp);
+            count[nxt] = 0;
+            ++s.step;
+
+            for (size_t t = 0; t < count[cur]; ++t)
+            {
+                const instruction& i = m_program[s.threads[cur][t]];
+
+                if (i.op == op_set && m_sets[i.x].test(c))
+                {
+                    std::copy(s.slots[cur].data() + t*k, s.slots[cur].data() + (t+1)*k, s.current.data());
+                    add_thread(s, nxt, count[nxt], s.threads[cur][t] + 1, sp + 1, s.current.data(), k);
+                }
+            }
+
+            cur = nxt;
+        }
+
+        for (size_t t = 0; t < count[cur]; ++t)
+            if (m_program[s.threads[cur][t]].op == op_match)
+            {
+                const char* const* slots = s.slots[cur].data() + t*k;
+
+                for (size_t g = 0; g < n; ++g)
+                    captures[g] = 2*g < k && slots[2*g] && slots[2*g+1] ? regex_capture(slots[2*g], slots[2*g+1]) : regex_capture();
+
+                return true;
+            }
+
+        return false;
+    }
+
+    std::vector<instruction>          m_program;        ///< NFA program
+    std::vector<charset>              m_sets;           ///< Character sets of op_set instructions
+    unsigned char                     m_class_of[256];  ///< Equivalence class of each character
+    size_t                            m_classes;        ///< Number of equivalence classes
+    std::vector<int>                  m_transitions;    ///< DFA transitions: m_classes entries per state
+    std::vector<char>                 m_accepting;      ///< Whether a DFA state is accepting
+    int                               m_start;          ///< Start state of the DFA or #no_state when there is no DFA
+    size_t                            m_groups;         ///< Number of capture groups
+    std::shared_ptr<const std::regex> m_fallback;       ///< Expression outside of the supported subset
+};
+
+//------------------------------------------------------------------------------
+
+/// Engine policy that plugs #dfa_regex into #rex
+template <>
+struct regex_engine<dfa_regex>
+{
+    typedef dfa_regex regex_type;
+
+    static dfa_regex compile(const char* re) { return dfa_regex(re); }
+
+    static bool match(const dfa_regex& re, const char* first, const char* last, regex_capture* captures, size_t n)
+    {
+        return re.match(first, last, captures, n);
+    }
+};
+
+/// The same as #XTL_REGEX, but compiles the expression with #dfa_regex
+#define XTL_DFA_REGEX(re) mch::static_regex<XTL_COUNTER, mch::dfa_regex>("" re)
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
@@ -0,0 +1,531 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines instrumentation of match statements with hardware 
+/// performance counters. With #XTL_USE_PERF_COUNTERS enabled, every match 
+/// statement counts CPU cycles, mispredicted branches and L1D read misses of
+/// its executions in the executing thread, keyed by the location of the 
+/// statement, so that the cost of a slow statement can be told apart into
+/// mispredictions of its switch, cache misses in its vtbl map and the casts
+/// made by its first executions. CPU time is counted as well, so that the 
+/// report stays useful where the hardware events are not available, e.g. in 
+/// most virtual machines.
+///
+/// The counts are inclusive: they cover the case clauses executed by the 
+/// statement as well as the statements nested in them.
+///
+/// \note The counters are only implemented with Linux perf_event_open. On other
+///       systems, or when the kernel refuses to open them (\see 
+///       /proc/sys/kernel/perf_event_paranoid), the statements only count 
+///       their executions and the report says why.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "config.hpp"    // Various compiler/platform dependent macros
+#include "stats.hpp"     // JSON output of strings
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Events counted for every match statement
+enum perf_event_kind
+{
+    perf_cycles,         ///< CPU cycles spent in user mode
+    perf_branch_misses,  ///< Mispredicted branches in user mode
+    perf_l1d_misses,     ///< Read misses of L1 data cache in user mode
+    perf_task_clock,     ///< CPU time in nanoseconds, a software event
+    perf_event_kinds     ///< Number of counted events
+};
+
+/// Name of the event in reports
+inline const char* perf_event_name(size_t k) noexcept
+{
+    static const char* const names[perf_event_kinds] = {"cycles", "branch_misses", "l1d_misses", "task_clock_ns"};
+    return names[k];
+}
+
+/// Values of all the counted events, 0 for events that are not counted
+struct perf_values
+{
+    uint64_t value[perf_event_kinds];
+};
+
+//------------------------------------------------------------------------------
+
+/// State of the counters shared by all threads
+struct perf_status
+{
+    /// Bit mask of events that were counted by at least one thread
+    static std::atomic<unsigned>& counted() noexcept { static std::atomic<unsigned> mask(0); return mask; }
+
+    /// The errno of the first failure to open a counter, or 0
+    static std::atomic<int>& error() noexcept { static std::atomic<int> e(0); return e; }
+
+    /// Records the failure, unless there was one already
+    static void failed(int e) noexcept { int none = 0; error().compare_exchange_strong(none, e ? e : EINVAL); }
+};
+
+/// Explains why counters could not be opened, given the errno of the failure
+inline const char* perf_error_description(int e) noexcept
+{
+    switch (e)
+    {
+    case ENOENT:
+    case EOPNOTSUPP: return "the events are not supported by this CPU or virtual machine";
+    case EACCES:
+    case EPERM:      return "access denied, see /proc/sys/kernel/perf_event_paranoid";
+    case ENOSYS:     return "perf_event_open is not supported on this system";
+    default:         return std::strerror(e);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/// Group of counters of the events counted in a thread. The group is opened on
+/// first use in each thread and is read with a single system call.
+class perf_counters
+{
+public:
+
+    /// Counters of the calling thread
+    static perf_counters& of_this_thread() noexcept
+    {
+    #if defined(__linux__)
+        static thread_local perf_counters counters;
+    #else
+        static perf_counters counters;
+    #endif
+        return counters;
+    }
+
+    /// Whether at least one event is counted in this thread
+    bool active() const noexcept { return leader >= 0; }
+
+    /// Reads the current values of the counters
+    void read(perf_values& v) const noexcept
+    {
+        std::memset(&v, 0, sizeof(v));
+
+    #if defined(__linux__)
+        uint64_t buffer[1+perf_event_kinds]; // Number of values followed by the values in order of opening
+
+        if (leader >= 0 && ::read(leader, buffer, sizeof(buffer)) > 0)
+            for (size_t i = 0; i < buffer[0] && i < opened; ++i)
+                v.value[kind[i]] = buffer[1+i];
+    #endif
+    }
+
+    /// Smallest values counted between two back-to-back reads: every sample is
+    /// corrected by them, so that the cost of reading is not attributed to the
+    /// statements.
+    const perf_values& overhead() const noexcept { return bias; }
+
+private:
+
+    perf_counters() noexcept : leader(-1), opened(0)
+    {
+        std::memset(&bias, 0, sizeof(bias));
+
+    #if defined(__linux__)
+        for (size_t k = 0; k < perf_event_kinds; ++k)
+            open(perf_event_kind(k));
+
+        if (leader < 0)
+            return;
+
+        // Calibrate the cost of reading the counters
+        for (size_t k = 0; k < perf_event_kinds; ++k)
+            bias.value[k] = ~uint64_t(0);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            perf_values a, b;
+            read(a);
+            read(b);
+
+            for (size_t k = 0; k < perf_event_kinds; ++k)
+                bias.value[k] = (std::min)(bias.value[k], b.value[k] - a.value[k]);
+        }
+    #else
+        perf_status::failed(ENOSYS);
+    #endif
+    }
+
+   ~perf_counters()
+    {
+    #if defined(__linux__)
+        for (size_t i = opened; i > 0; --i)
+            ::close(fd[i-1]);
+    #endif
+    }
+
+    perf_counters(const perf_counters&);            ///< Not copyable
+    perf_counters& operator=(const perf_counters&); ///< Not assignable
+
+#if defined(__linux__)
+    /// Opens the counter of event k and adds it to the group of the thread
+    void open(perf_event_kind k) noexcept
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP;
+
+        switch (k)
+        {
+        case perf_cycles:        attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES;    break;
+        case perf_branch_misses: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case perf_l1d_misses:    attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_L1D
+                                                                             | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                                                             | PERF_COUNT_HW_CACHE_RESULT_MISS << 16; break;
+        case perf_task_clock:    attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_TASK_CLOCK;    break;
+        default: return;
+        }
+
+        // Count the calling thread on any CPU
+        const int f = int(::syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+
+        if (f < 0)
+        {
+            perf_status::failed(errno);
+            return;
+        }
+
+        if (leader < 0)
+            leader = f;
+
+        fd[opened]     = f;
+        kind[opened++] = k;
+        perf_status::counted().fetch_or(1u << k, std::memory_order_relaxed);
+    }
+#endif
+
+    int        leader;                   ///< Descriptor of the first opened counter, or -1
+    size_t     opened;                   ///< Number of opened counters
+    int        fd[perf_event_kinds];     ///< Descriptors of the opened counters
+    size_t     kind[perf_event_kinds];   ///< Events of the opened counters in order of opening
+    perf_values bias;                    ///< \see overhead
+};
+
+//------------------------------------------------------------------------------
+
+/// Counts of a single match statement. Objects of this class are function-local
+/// statics of the statements and register themselves on construction.
+struct perf_site
+{
+    perf_site(const char* f, size_t l, const char* fn) noexcept;
+
+    const char*           file;                     ///< File of the match statement
+    size_t                line;                     ///< Line of the match statement in the file
+    const char*           func;                     ///< Function containing the match statement
+    std::atomic<uint64_t> executions;               ///< Number of executions of the statement
+    std::atomic<uint64_t> total[perf_event_kinds];  ///< Sum of the counts of all executions
+    perf_site*            next;                     ///< Next registered site
+};
+
+//------------------------------------------------------------------------------
+
+/// Snapshot of the counts of a single match statement
+struct perf_site_counts
+{
+    const char* file;                     ///< File of the match statement
+    size_t      line;                     ///< Line of the match statement in the file
+    const char* func;                     ///< Function containing the match statement
+    uint64_t    executions;               ///< Number of executions of the statement
+    uint64_t    total[perf_event_kinds];  ///< Sum of the counts of all executions
+};
+
+//------------------------------------------------------------------------------
+
+/// Registry of all the match statements that have been executed. Statements 
+/// are never removed from it, since their sites live until the end of program.
+struct perf_registry
+{
+    /// Adds the site to the registry
+    static void add(perf_site& s) noexcept
+    {
+        static report_at_exit reporter; // Constructed by the first statement, destroyed at exit
+        XTL_UNUSED(reporter);
+        lock_guard guard;
+        s.next = head();
+        head() = &s;
+    }
+
+    /// Takes a snapshot of the counts of all the registered statements, the 
+    /// most expensive ones first.
+    static std::vector<perf_site_counts> snapshot()
+    {
+        std::vector<perf_site_counts> result;
+
+        {
+            lock_guard guard;
+
+            for (perf_site* s = head(); s; s = s->next)
+            {
+                perf_site_counts c = {s->file, s->line, s->func, s->executions.load(std::memory_order_relaxed), {}};
+
+                for (size_t k = 0; k < perf_event_kinds; ++k)
+                    c.total[k] = s->total[k].load(std::memory_order_relaxed);
+
+                result.push_back(c);
+            }
+        }
+
+        std::stable_sort(result.begin(), result.end(), more_expensive);
+        return result;
+    }
+
+private:
+
+    /// Orders statements by cycles, by CPU time where cycles were not counted,
+    /// and by executions where neither was.
+    static bool more_expensive(const perf_site_counts& a, const perf_site_counts& b) noexcept
+    {
+        if (a.total[perf_cycles]     != b.total[perf_cycles])     return a.total[perf_cycles]     > b.total[perf_cycles];
+        if (a.total[perf_task_clock] != b.total[perf_task_clock]) return a.total[perf_task_clock] > b.total[perf_task_clock];
+        return a.executions > b.executions;
+    }
+
+    /// Writes the report to the file named by environment variable 
+    /// XTL_PERF_REPORT at exit: as JSON if its name ends with .json, as text 
+    /// otherwise, and to std::clog if the name is -.
+    struct report_at_exit
+    {
+       ~report_at_exit();
+    };
+
+    /// The list of registered sites. Constant-initialized.
+    static perf_site*& head() noexcept { static perf_site* first = nullptr; return first; }
+
+    /// Spin lock protecting the list: it is only taken when a statement is 
+    /// executed for the first time or a snapshot is taken.
+    static std::atomic_flag& busy() noexcept { static std::atomic_flag flag = ATOMIC_FLAG_INIT; return flag; }
+
+    struct lock_guard
+    {
+        lock_guard()  noexcept { while (busy().test_and_set(std::memory_order_acquire)) ; }
+       ~lock_guard()  noexcept { busy().clear(std::memory_order_release); }
+    };
+};
+
+//------------------------------------------------------------------------------
+
+inline perf_site::perf_site(const char* f, size_t l, const char* fn) noexcept
+    : file(f), line(l), func(fn), executions(0), next(nullptr)
+{
+    for (size_t k = 0; k < perf_event_kinds; ++k)
+        total[k].store(0, std::memory_order_relaxed);
+
+    perf_registry::add(*this);
+}
+
+//------------------------------------------------------------------------------
+
+/// Counts the events of a single execution of a match statement from its 
+/// construction till its destruction and adds them to the site of the statement.
+class perf_scope
+{
+public:
+
+    explicit perf_scope(perf_site& s) noexcept : site(s), counters(perf_counters::of_this_thread())
+    {
+        counters.read(start);
+    }
+
+   ~perf_scope() noexcept
+    {
+        perf_values finish;
+        counters.read(finish);
+        site.executions.fetch_add(1, std::memory_order_relaxed);
+
+        if (counters.active())
+            for (size_t k = 0; k < perf_event_kinds; ++k)
+            {
+                const uint64_t delta = finish.value[k] - start.value[k];
+                const uint64_t bias  = counters.overhead().value[k];
+                site.total[k].fetch_add(delta > bias ? delta - bias : 0, std::memory_order_relaxed);
+            }
+    }
+
+private:
+
+    perf_scope(const perf_scope&);            ///< Not copyable
+    perf_scope& operator=(const perf_scope&); ///< Not assignable
+
+    perf_site&           site;     ///< Site of the statement the counts are added to
+    const perf_counters& counters; ///< Counters of the executing thread
+    perf_values          start;    ///< Values of the counters when the statement started
+};
+
+//------------------------------------------------------------------------------
+
+/// Takes a snapshot of the counts of all the executed match statements, the 
+/// most expensive ones first.
+inline std::vector<perf_site_counts> perf_counts() { return perf_registry::snapshot(); }
+
+/// Whether event k was counted by at least one thread
+inline bool perf_event_counted(size_t k) noexcept { return (perf_status::counted().load(std::memory_order_relaxed) >> k) & 1; }
+
+//------------------------------------------------------------------------------
+
+/// Writes the counts of all the executed match statements as a table with the
+/// average counts per execution, the most expensive statements first. Events
+/// that could not be counted are shown as n/a along with the reason.
+inline void write_perf_report(std::ostream& os)
+{
+    static const char* const headers[perf_event_kinds] = {"cycles", "br-misses", "L1D-misses", "cpu-ns"};
+    const std::vector<perf_site_counts> counts = perf_counts();
+
+    if (const int e = perf_status::error().load(std::memory_order_relaxed))
+    {
+        os << "Some performance counters are unavailable: " << perf_error_description(e);
+
+        if (!perf_event_counted(perf_cycles) && !perf_event_counted(perf_task_clock))
+            os << "; only executions are counted";
+
+        os << std::endl;
+    }
+
+    os << std::setw(12) << "executions";
+
+    for (size_t k = 0; k < perf_event_kinds; ++k)
+        os << std::setw(12) << headers[k];
+
+    os << "  match statement (averages per execution)" << std::endl;
+
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        const perf_site_counts& c = counts[i];
+        os << std::setw(12) << c.executions;
+
+        for (size_t k = 0; k < perf_event_kinds; ++k)
+            if (perf_event_counted(k) && c.executions)
+                os << std::setw(12) << std::fixed << std::setprecision(1) << double(c.total[k])/c.executions;
+            else
+                os << std::setw(12) << "n/a";
+
+        os << "  " << c.file << ':' << c.line << ' ' << c.func << std::endl;
+    }
+}
+
+/// Writes the counts of all the executed match statements as a JSON array of
+/// objects with the totals of all executions. Events that could not be counted
+/// are null.
+inline void write_perf_counters_json(std::ostream& os)
+{
+    const std::vector<perf_site_counts> counts = perf_counts();
+
+    os << '[';
+
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        const perf_site_counts& c = counts[i];
+        os << (i ? ",\n " : "\n ") << "{\"file\":";
+        write_json_string(os, c.file);
+        os << ",\"line\":" << c.line << ",\"func\":";
+        write_json_string(os, c.func);
+        os << ",\"executions\":" << c.executions;
+
+        for (size_t k = 0; k < perf_event_kinds; ++k)
+        {
+            os << ",\"" << perf_event_name(k) << "\":";
+
+            if (perf_event_counted(k))
+                os << c.total[k];
+            else
+                os << "null";
+        }
+
+        os << '}';
+    }
+
+    os << (counts.empty() ? "]" : "\n]") << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+inline perf_registry::report_at_exit::~report_at_exit()
+{
+    const char* name = std::getenv("XTL_PERF_REPORT");
+
+    if (!name || !*name)
+        return;
+
+    const size_t n    = std::strlen(name);
+    const bool   json = n >= 5 && std::strcmp(name + n - 5, ".json") == 0;
+
+    if (std::strcmp(name, "-") == 0)
+        write_perf_report(std::clog);
+    else
+    {
+        std::ofstream file(name);
+
+        if (json)
+            write_perf_counters_json(file);
+        else
+            write_perf_report(file);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
@@ -0,0 +1,247 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines a collision-free multiplicative hash and a table indexed
+/// by it, which vtbl maps build over the vtbl-pointer tuples they contain once
+/// they were asked to stop changing (see vtbl_map::freeze). Lookups in such a
+/// table take a single probe and no branches other than the one verifying
+/// the tuple in the probed entry.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ptrtools.hpp"  // Helper functions to work with pointers
+#include "arena.hpp"     // Allocation of dispatch tables
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// The number of multipliers tried for each table size when looking for a
+/// collision-free hash function
+const size_t perfect_hash_attempts = 64;
+
+//------------------------------------------------------------------------------
+
+/// Combines N vtbl-pointers into a single key of #perfect_hash in the same way
+/// vtbl maps compute their cache index, but without masking the result.
+/// \note Different tuples may end up with the same key, in which case only
+///       one of them will be reachable through the table. The table always
+///       verifies the entire tuple, so this only affects performance.
+template <size_t N>
+inline std::uintptr_t perfect_hash_key(const intptr_t (&vtbl)[N], const size_t (&shifts)[N]) noexcept
+{
+    intptr_t vtbl_shifted[N];
+
+    for (size_t i = 0; i < N; ++i)
+        vtbl_shifted[i] = vtbl[i] >> shifts[i];
+
+    return std::uintptr_t(interleave(vtbl_shifted));
+}
+
+//------------------------------------------------------------------------------
+
+/// Multiplicative hash function h(key) = (key * multiplier) >> shift, which
+/// maps keys into [0, 2^log_size), where log_size = bits in key - shift.
+struct perfect_hash
+{
+    perfect_hash(std::uintptr_t m, size_t log_size) noexcept : multiplier(m), shift(8*sizeof(std::uintptr_t) - log_size) {}
+
+    std::uintptr_t multiplier; ///< Odd multiplier
+    size_t         shift;      ///< Number of low bits of the product to drop
+
+    /// Number of different values the function can take
+    size_t size() const noexcept { return size_t(1) << (8*sizeof(std::uintptr_t) - shift); }
+
+    size_t operator()(std::uintptr_t key) const noexcept { return size_t((key * multiplier) >> shift); }
+
+    /// Looks for a hash function that maps the given sorted unique keys into
+    /// different values, trying table sizes from the smallest able to hold
+    /// all the keys up to 2^max_log_inc times larger than it.
+    /// \returns false when no such function was found
+    static bool find(const std::vector<std::uintptr_t>& keys, size_t max_log_inc, perfect_hash& result)
+    {
+        const size_t lo = std::max(size_t(1), req_bits(keys.size()-1));
+        std::vector<unsigned char> taken;
+
+        for (size_t log_size = lo; log_size <= lo + max_log_inc && log_size < 8*sizeof(std::uintptr_t); ++log_size)
+        {
+            // Start with plain masking of the key, which is what the cache of
+            // the map does, then try Fibonacci hashing and pseudo-random odd
+            // multipliers.
+            std::uintptr_t m = std::uintptr_t(0x9E3779B97F4A7C15ULL);
+
+            for (size_t attempt = 0; attempt < perfect_hash_attempts; ++attempt)
+            {
+                perfect_hash h(attempt ? m | 1 : std::uintptr_t(1) << (8*sizeof(std::uintptr_t) - log_size), log_size);
+                taken.assign(h.size(), 0);
+
+                size_t i = 0;
+
+                for (; i < keys.size(); ++i)
+                {
+                    unsigned char& t = taken[h(keys[i])];
+
+                    if (t)
+                        break; // Collision
+
+                    t = 1;
+                }
+
+                if (i == keys.size())
+                {
+                    result = h;
+                    return true;
+                }
+
+                if (attempt)
+                    m = m * std::uintptr_t(6364136223846793005ULL) + std::uintptr_t(1442695040888963407ULL);
+            }
+        }
+
+        return false;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Table of pointers to entries of type E indexed by a collision-free hash of
+/// the N vtbl-pointers in them. Slots that no entry was hashed into point to
+/// an entry, which no tuple of valid vtbl-pointers can match.
+/// \note The table only references entries, which remain owned by the map.
+template <size_t N, typename E>
+struct sealed_table
+{
+    /// Builds a table over the given entries with their keys computed with
+    /// the given shifts.
+    /// \returns nullptr when no collision-free hash function was found
+    static sealed_table* build(std::vector<std::pair<std::uintptr_t,E*>>& entries, const size_t (&shifts)[N], size_t max_log_inc)
+    {
+        if (entries.empty())
+            return nullptr;
+
+        // Entries with the same key can only be reached through one of them
+        std::sort(entries.begin(), entries.end(), [](const std::pair<std::uintptr_t,E*>& a, const std::pair<std::uintptr_t,E*>& b) { return a.first < b.first; });
+        entries.erase(std::unique(entries.begin(), entries.end(), [](const std::pair<std::uintptr_t,E*>& a, const std::pair<std::uintptr_t,E*>& b) { return a.first == b.first; }), entries.end());
+
+        std::vector<std::uintptr_t> keys;
+        keys.reserve(entries.size());
+
+        for (size_t i = 0; i < entries.size(); ++i)
+            keys.push_back(entries[i].first);
+
+        perfect_hash h(1, 1);
+
+        if (!perfect_hash::find(keys, max_log_inc, h))
+            return nullptr;
+
+        sealed_table* t = new(h.size()) sealed_table(h,shifts);
+
+        for (size_t i = 0; i < entries.size(); ++i)
+            t->slot[h(entries[i].first)] = entries[i].second;
+
+        return t;
+    }
+
+    /// Single probe of the table. The caller has to verify the tuple in the result.
+    E* find(const intptr_t (&vtbl)[N]) const noexcept { return slot[hash(perfect_hash_key(vtbl,shift))]; }
+
+    /// Shifts of vtbl-pointers used to compute their keys
+    size_t shift[N];
+
+    /// Hash function mapping keys of all the entries into different slots
+    const perfect_hash hash;
+
+    /// Entry referenced from all the unused slots. Never matches any tuple.
+    E vacant;
+
+    /// Variable-sized array of pointers to the entries
+    E* slot[XTL_VARIABLE_SIZE_ARRAY];
+
+    #if defined(DBG_NEW)
+        #undef new
+    #endif
+
+    void* operator new(size_t, size_t size)
+    {
+        return dispatch_arena::allocate(bytes(size));
+    }
+
+    #if defined(DBG_NEW)
+        #define new DBG_NEW
+    #endif
+
+    /// We need to declare this placement delete operator since we overload new.
+    void operator delete(void* p, size_t size) { dispatch_arena::deallocate(p, bytes(size)); }
+
+    /// A delete expression does not know the size of the object. Use #destroy instead.
+    void operator delete(void*) XTL_DELETED;
+
+    /// Number of bytes taken by an object with the given number of slots
+    static size_t bytes(size_t n) { return sizeof(sealed_table) + (n-XTL_VARIABLE_SIZE_ARRAY)*sizeof(E*); }
+
+    /// Destroys and deallocates an object allocated with the above operator new
+    static void destroy(void* p) noexcept
+    {
+        if (sealed_table* d = static_cast<sealed_table*>(p))
+            dispatch_arena::destroy(d, bytes(d->hash.size()));
+    }
+
+private:
+
+    sealed_table(const perfect_hash& h, const size_t (&shifts)[N]) : hash(h), vacant()
+    {
+        std::copy(&shifts[0], &shifts[N], &shift[0]);
+        std::fill(&slot[0], &slot[h.size()], &vacant);
+    }
+
+    sealed_table(const sealed_table&);            ///< No copy constructor
+    sealed_table& operator=(const sealed_table&); ///< No assignment operator
+};
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
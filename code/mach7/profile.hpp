@@ -0,0 +1,361 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines the dispatch profile: the record of which tuples of 
+/// dynamic types each match statement has seen, how often and which case
+/// clause they were dispatched to. With #XTL_USE_VTBL_FREQUENCY enabled, a
+/// profile saved by one run of the program with #save_dispatch_profile can
+/// be loaded by the next one with #load_dispatch_profile. Dispatch tables of
+/// the profiled match statements are then pre-sized for all the tuples they
+/// are going to see, while the hottest tuples are kept in their primary slots.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+// --------------------[ Profile Format ]--------------------
+// The profile is a text file with one record per line and tab-separated
+// fields. Dynamic types are identified by the names of their std::type_info,
+// which unlike vtbl-pointers do not change between runs of the same program.
+//
+//     site    <file>:<line>
+//     tuple   <hits>  <case label>  <type name 1>  ...  <type name N>
+//     clause  <case label>  <hits>
+//
+// A site line starts the records of a match statement. Tuple lines give the
+// histogram of dynamic types and clause lines the histogram of case clauses
+// that were taken. The latter is derived from the former and is only there
+// for the reader. Lines starting with # are comments.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "config.hpp"    // Various compiler/platform dependent macros
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Dispatch profile of a program: statistics of every profiled match statement
+struct dispatch_profile
+{
+    /// Statistics of a single tuple of dynamic types seen by a match statement
+    struct entry
+    {
+        size_t      hits;  ///< Number of times the tuple was seen
+        size_t      label; ///< Case label of the clause the tuple was dispatched to
+        std::string types; ///< Names of the dynamic types separated by tabs
+    };
+
+    /// Statistics of a single match statement
+    struct site
+    {
+        /// Records a tuple of dynamic types seen by the match statement
+        void add(size_t hits, size_t label, const std::string& types)
+        {
+            std::unordered_map<std::string,size_t>::iterator p = index.find(types);
+
+            if (p == index.end())
+            {
+                index[types] = entries.size();
+                entry e = { hits, label, types };
+                entries.push_back(e);
+            }
+            else
+                entries[p->second].hits += hits;
+        }
+
+        /// Number of times a given tuple of dynamic types was seen or 0 if never
+        size_t expected_hits(const std::string& types) const
+        {
+            std::unordered_map<std::string,size_t>::const_iterator p = index.find(types);
+            return p == index.end() ? 0 : entries[p->second].hits;
+        }
+
+        /// Histogram of case clauses taken by the match statement
+        std::map<size_t,size_t> clauses() const
+        {
+            std::map<size_t,size_t> result;
+
+            for (size_t i = 0; i < entries.size(); ++i)
+                result[entries[i].label] += entries[i].hits;
+
+            return result;
+        }
+
+        std::vector<entry>                     entries; ///< Tuples in the order they were added
+        std::unordered_map<std::string,size_t> index;   ///< Positions of tuples in entries
+    };
+
+    /// Writes the profile in the format described at the top of this file
+    void write(std::ostream& os) const
+    {
+        os << "# Mach7 dispatch profile" << std::endl;
+
+        for (std::map<std::string,site>::const_iterator p = sites.begin(); p != sites.end(); ++p)
+        {
+            os << "site\t" << p->first << std::endl;
+
+            for (size_t i = 0; i < p->second.entries.size(); ++i)
+            {
+                const entry& e = p->second.entries[i];
+                os << "tuple\t" << e.hits << '\t' << e.label << '\t' << e.types << std::endl;
+            }
+
+            std::map<size_t,size_t> clauses = p->second.clauses();
+
+            for (std::map<size_t,size_t>::const_iterator q = clauses.begin(); q != clauses.end(); ++q)
+                os << "clause\t" << q->first << '\t' << q->second << std::endl;
+        }
+    }
+
+    /// Reads the profile written by #write, merging it into this one
+    /// \returns false when the input was malformed
+    bool read(std::istream& is)
+    {
+        std::string line;
+        site* current = nullptr;
+
+        while (std::getline(is, line))
+        {
+            if (!line.empty() && line[line.size()-1] == '\r')
+                line.erase(line.size()-1);
+
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::string::size_type tab = line.find('\t');
+
+            if (tab == std::string::npos)
+                return false;
+
+            const std::string kind = line.substr(0, tab);
+
+            if (kind == "site")
+                current = &sites[line.substr(tab+1)];
+            else
+            if (kind == "tuple")
+            {
+                std::istringstream fields(line.substr(tab+1));
+                size_t hits, label;
+
+                if (!current || !(fields >> hits >> label) || fields.get() != '\t')
+                    return false;
+
+                std::string types;
+                std::getline(fields, types);
+                current->add(hits, label, types);
+            }
+            else
+            if (kind != "clause")
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Statistics of match statements indexed by their location: file:line
+    std::map<std::string,site> sites;
+};
+
+//------------------------------------------------------------------------------
+
+/// Registry of the dispatch tables of profiled match statements. Tables join
+/// it the first time their match statement is executed and leave it when 
+/// they are destroyed. A profile loaded with #load_dispatch_profile is kept
+/// here as well, so that tables joining later can replay it too.
+struct profile_registry
+{
+    /// Registration record of a dispatch table, normally a member of it
+    struct record
+    {
+        std::string site;                                                  ///< Location of the match statement: file:line
+        void*       object;                                                ///< Registered dispatch table
+        void      (*collect)(const void* object, dispatch_profile::site& s); ///< Adds statistics of the table to s
+        void      (*replay)(void* object, const dispatch_profile::site& s);  ///< Prepares the table for the statistics in s
+        record*     next;                                                  ///< Next registered record
+    };
+
+    /// Adds the record to the registry and replays the loaded profile on it
+    static void add(record& r)
+    {
+        lock_guard guard;
+        r.next = head();
+        head() = &r;
+
+        std::map<std::string,dispatch_profile::site>::const_iterator p = loaded().sites.find(r.site);
+
+        if (p != loaded().sites.end())
+            r.replay(r.object, p->second);
+    }
+
+    /// Removes the record from the registry
+    static void remove(record& r) noexcept
+    {
+        lock_guard guard;
+
+        for (record** p = &head(); *p; p = &(*p)->next)
+            if (*p == &r)
+            {
+                *p = r.next;
+                break;
+            }
+    }
+
+    /// Collects statistics of all the registered dispatch tables
+    static dispatch_profile collect()
+    {
+        lock_guard guard;
+        dispatch_profile result;
+
+        for (record* r = head(); r; r = r->next)
+            r->collect(r->object, result.sites[r->site]);
+
+        return result;
+    }
+
+    /// Keeps the given profile for the tables that will join the registry
+    /// later and replays it on the ones that are already registered.
+    /// \returns The number of tables the profile was replayed on
+    static size_t replay(const dispatch_profile& profile)
+    {
+        lock_guard guard;
+        size_t count = 0;
+
+        // Sites are only ever added to, so tables may keep references to them
+        for (std::map<std::string,dispatch_profile::site>::const_iterator p = profile.sites.begin(); p != profile.sites.end(); ++p)
+            loaded().sites[p->first] = p->second;
+
+        for (record* r = head(); r; r = r->next)
+        {
+            std::map<std::string,dispatch_profile::site>::const_iterator p = loaded().sites.find(r->site);
+
+            if (p != loaded().sites.end())
+            {
+                r->replay(r->object, p->second);
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+private:
+
+    /// The list of registered records. Constant-initialized.
+    static record*& head() noexcept { static record* first = nullptr; return first; }
+
+    /// The profile loaded so far
+    static dispatch_profile& loaded() { static dispatch_profile profile; return profile; }
+
+    /// Spin lock protecting the registry: tables join it on slow paths only
+    static std::atomic_flag& busy() noexcept { static std::atomic_flag flag = ATOMIC_FLAG_INIT; return flag; }
+
+    struct lock_guard
+    {
+        lock_guard()  noexcept { while (busy().test_and_set(std::memory_order_acquire)) ; }
+       ~lock_guard()  noexcept { busy().clear(std::memory_order_release); }
+    };
+};
+
+//------------------------------------------------------------------------------
+
+/// Label recorded in the profile for the value associated with a tuple of
+/// dynamic types. Overloaded for values that represent case clauses.
+template <typename T>
+inline size_t profile_label(const T&) noexcept { return 0; }
+
+/// Associates a dispatch table with the location of its match statement, so
+/// that it takes part in recording and replaying of the dispatch profile.
+/// This generic version is used for the tables that do not support profiling.
+template <typename M>
+inline bool profile_site(M&, const char*, size_t) { return false; }
+
+//------------------------------------------------------------------------------
+
+/// Writes statistics of all the profiled match statements to the stream
+inline void save_dispatch_profile(std::ostream& os) { profile_registry::collect().write(os); }
+
+/// Writes statistics of all the profiled match statements to the file
+/// \returns false when the file could not be written
+inline bool save_dispatch_profile(const char* file_name)
+{
+    std::ofstream os(file_name);
+    save_dispatch_profile(os);
+    return bool(os);
+}
+
+/// Loads the dispatch profile saved by a previous run of the program and 
+/// prepares dispatch tables of the profiled match statements for it.
+/// \returns false when the input was malformed. Nothing is replayed then.
+inline bool load_dispatch_profile(std::istream& is)
+{
+    dispatch_profile profile;
+
+    if (!profile.read(is))
+        return false;
+
+    profile_registry::replay(profile);
+    return true;
+}
+
+/// Same as above for a file
+/// \returns false when the file could not be read or was malformed
+inline bool load_dispatch_profile(const char* file_name)
+{
+    std::ifstream is(file_name);
+    return is && load_dispatch_profile(is);
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
+
+/// Makes the dispatch table of the enclosing match statement take part in the
+/// dispatch profile. Only the first execution of the statement registers it.
+#define XTL_PROFILE_SITE(m) XTL_USE_VTBL_FREQUENCY_ONLY(static const bool __profiled = mch::profile_site(m,__FILE__,__LINE__); XTL_UNUSED(__profiled);)
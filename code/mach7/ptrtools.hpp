@@ -51,6 +51,10 @@
 #include <typeinfo>
 #include <type_traits>
 
+#if XTL_USE_SIMD && defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 #if defined(_MSC_VER)
     #include <excpt.h>
 #endif
@@ -520,6 +524,13 @@ inline T interleave(const T (&vtbl)[N]) noexcept
 // 4x4 - 48% faster V= 65 M= 44   - 59% faster V= 60 M= 37 * -866% slower V= 52 M=508   -107% slower V= 55 M=114  
 
 inline intptr_t interleave(const intptr_t (&vtbl)[1]) noexcept { return vtbl[0]; }
+#if XTL_USE_SIMD && defined(__BMI2__)
+// PDEP deposits the low bits of each argument into every N-th bit of the
+// result, producing exactly the same bits as the table-based versions above.
+inline intptr_t interleave(const intptr_t (&vtbl)[2]) noexcept { return _pdep_u32(uint32_t(vtbl[0]),0x55555555) | _pdep_u32(uint32_t(vtbl[1]),0xAAAAAAAA); }
+inline intptr_t interleave(const intptr_t (&vtbl)[3]) noexcept { return _pdep_u32(uint32_t(vtbl[0]),0x09249249) | _pdep_u32(uint32_t(vtbl[1]),0x12492492) | _pdep_u32(uint32_t(vtbl[2]),0x24924924); }
+inline intptr_t interleave(const intptr_t (&vtbl)[4]) noexcept { return _pdep_u32(uint32_t(vtbl[0]),0x11111111) | _pdep_u32(uint32_t(vtbl[1]),0x22222222) | _pdep_u32(uint32_t(vtbl[2]),0x44444444) | _pdep_u32(uint32_t(vtbl[3]),0x88888888); }
+#else
 inline intptr_t interleave(const intptr_t (&vtbl)[2]) noexcept { return interleave8x2(vtbl[0],vtbl[1]); }
 inline intptr_t interleave(const intptr_t (&vtbl)[3]) noexcept { return interleave(vtbl[0],vtbl[1],vtbl[2]); }
 #if defined(__GNUC__)
@@ -530,6 +541,7 @@ inline intptr_t interleave(const intptr_t (&vtbl)[4]) noexcept { return interlea
 inline intptr_t interleave(const intptr_t (&vtbl)[4]) noexcept { return interleave(vtbl[0],vtbl[1],vtbl[2],vtbl[3]); }
 //inline intptr_t interleave(const intptr_t (&vtbl)[4]) noexcept { return interleave(interleave(vtbl[0],vtbl[1]),interleave(vtbl[2],vtbl[3])); }
 #endif
+#endif // XTL_USE_SIMD && __BMI2__
 
 //------------------------------------------------------------------------------
 
@@ -0,0 +1,195 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file defines shared_cast<T>(U), which behaves as the cast nested 
+/// constructor patterns use to check dynamic types of sub-terms (see 
+/// #XTL_NESTED_SUBTYPE_CAST), but lets all the clauses of a match statement
+/// share the type tests of the same sub-terms of the subject. Clauses often
+/// start with the same nested constructor patterns, e.g.:
+/// \code
+/// Match(e)
+/// {
+///   Case(C<Plus>(C<Value>(0), x)) return eval(x);
+///   Case(C<Plus>(C<Value>(n), C<Value>(m))) return n+m;
+///   ...
+/// }
+/// EndMatch
+/// \endcode
+/// Without sharing, each clause tests the dynamic type of e->e1 again. With
+/// #XTL_SHARE_NESTED_TESTS enabled, nested constructor patterns cast sub-terms
+/// with shared_cast, which remembers the outcome of each cast of a sub-term for
+/// the rest of the match statement, so every sub-term is tested at most once
+/// per target type, no matter how many clauses inspect it.
+///
+/// \note Outcomes are remembered by the address of the sub-term, so they rely
+///       on the subject not changing its shape while the match statement is
+///       being executed, as the choice of the clause it jumps to already does.
+///       Outcomes are forgotten as soon as the statement finishes, and are not
+///       remembered at all for patterns applied outside of match statements.
+/// \note Sharing only pays off with #XTL_CACHE_NESTED_CASTS disabled, since
+///       cached casts are cheaper than lookups of shared tests.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include "config.hpp"    // Various compiler/platform dependent macros
+#if XTL_USE_DISPLAY_CAST
+#include "display_cast.hpp" // Constant-time casts in registered hierarchies
+#endif
+#if XTL_CACHE_NESTED_CASTS
+#include "cached_cast.hpp"  // Type tests of sub-terms remembered by their vtbl-pointers
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Generations of type tests of the calling thread. Each executed match
+/// statement gets its own generation, so that the outcomes remembered by an 
+/// earlier or a nested statement are never taken for its own ones.
+struct shared_tests_generation
+{
+    std::size_t current; ///< Generation of the innermost executing match statement or 0 outside of them
+    std::size_t last;    ///< Last generation given out in the calling thread
+
+    /// Generations of the calling thread
+    static shared_tests_generation& of_this_thread() noexcept
+    {
+        // NOTE: Zero-initialized POD can be accessed without initialization guards
+        static thread_local shared_tests_generation generation;
+        return generation;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Opens a new generation of type tests for the duration of a match statement
+/// and gets back to the generation of the enclosing statement, if any, after it.
+class shared_tests_scope
+{
+public:
+
+    shared_tests_scope() noexcept
+    {
+        shared_tests_generation& g = shared_tests_generation::of_this_thread();
+        m_enclosing = g.current;
+        g.current = ++g.last;
+    }
+
+   ~shared_tests_scope() noexcept
+    {
+        shared_tests_generation& g = shared_tests_generation::of_this_thread();
+        g.current = m_enclosing;
+    }
+
+private:
+
+    shared_tests_scope(const shared_tests_scope&) XTL_DELETED;
+    shared_tests_scope& operator=(const shared_tests_scope&) XTL_DELETED;
+
+    std::size_t m_enclosing; ///< Generation of the enclosing statement or 0
+};
+
+//------------------------------------------------------------------------------
+
+/// Per-thread direct-mapped table of outcomes of casts from U to T remembered
+/// in the current generation. Each pair of types has its own table, so sub-terms
+/// only need to be told apart by their addresses.
+template <typename T, typename U>
+struct shared_test
+{
+    /// Log of the number of remembered outcomes per pair of types
+    static const std::size_t log_size = 2;
+
+    /// Outcome of the cast of a sub-term
+    struct entry
+    {
+        const U*    subject;    ///< Sub-term that was cast
+        const T*    result;     ///< Outcome of the cast
+        std::size_t generation; ///< Generation in which the cast was made. 0 in unused entries.
+    };
+
+    static inline const T* cast(const U* u) noexcept
+    {
+        const std::size_t generation = shared_tests_generation::of_this_thread().current;
+
+        if (!generation || !u)
+            return XTL_NESTED_SUBTYPE_CAST<const T*>(u);
+
+        // NOTE: Objects are rarely smaller than 16 bytes, so the lower bits of
+        //       their addresses carry no information.
+        static thread_local entry table[std::size_t(1) << log_size];
+        entry& e = table[(std::uintptr_t(u) >> 4) & ((std::size_t(1) << log_size) - 1)];
+
+        if (e.subject != u || e.generation != generation)
+        {
+            e.subject    = u;
+            e.result     = XTL_NESTED_SUBTYPE_CAST<const T*>(u);
+            e.generation = generation;
+        }
+
+        return e.result;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Casts a polymorphic pointer u to the pointer type T as #XTL_NESTED_SUBTYPE_CAST
+/// would, reusing the outcome of the same cast of u made earlier in the same 
+/// match statement.
+template <typename T, typename U>
+inline T shared_cast(U* u) noexcept
+{
+    typedef typename std::remove_pointer<T>::type target_type;
+    return const_cast<T>(
+               shared_test<
+                   typename std::remove_cv<target_type>::type,
+                   typename std::remove_cv<U>::type
+               >::cast(u)
+           );
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
@@ -0,0 +1,321 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines the registry of dispatch statistics. With 
+/// #XTL_DUMP_PERFORMANCE enabled, every live vtbl map registers itself in it,
+/// so that a snapshot of the counters of all the match statements can be taken
+/// at any time with #dispatch_statistics and exported in JSON or CSV format,
+/// e.g. periodically by a server that never exits cleanly.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+#include "config.hpp"    // Various compiler/platform dependent macros
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+#if XTL_MULTI_THREADING
+
+/// Counter of events on the hot path of dispatch. Its value is split into
+/// shards, each on its own cache line, and every thread increments the shard
+/// it was assigned to, so that threads dispatching through the same match 
+/// statement do not serialize on a single counter.
+class stats_counter
+{
+public:
+
+    enum { shards = 16 };
+
+    explicit stats_counter(size_t v = 0) noexcept
+    {
+        for (size_t i = 0; i < shards; ++i)
+            shard[i].value.store(i ? 0 : v, std::memory_order_relaxed);
+    }
+
+    stats_counter& operator++() noexcept
+    {
+        shard[thread_shard()].value.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+
+    /// Sum of all the shards. Increments done concurrently may be missed.
+    operator size_t() const noexcept
+    {
+        size_t result = 0;
+
+        for (size_t i = 0; i < shards; ++i)
+            result += shard[i].value.load(std::memory_order_relaxed);
+
+        return result;
+    }
+
+private:
+
+    /// Shard assigned to the calling thread: threads take them in turns
+    static size_t thread_shard() noexcept
+    {
+        static std::atomic<size_t> next(0);
+        static thread_local size_t mine = next.fetch_add(1, std::memory_order_relaxed) % shards;
+        return mine;
+    }
+
+    struct alignas(XTL_CACHE_LINE_SIZE) padded { std::atomic<size_t> value; };
+
+    padded shard[shards];
+};
+
+#else
+
+/// Counter of events on the hot path of dispatch
+class stats_counter
+{
+public:
+    explicit stats_counter(size_t v = 0) noexcept : value(v) {}
+    stats_counter& operator++() noexcept { ++value; return *this; }
+    operator size_t() const noexcept { return value; }
+private:
+    size_t value;
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+
+/// Snapshot of the statistics of a single vtbl map
+struct dispatch_stats
+{
+    const char* file;       ///< File of the match statement or "unspecified"
+    size_t      line;       ///< Line of the match statement in the file
+    const char* func;       ///< Function containing the match statement
+    size_t      arity;      ///< Number of polymorphic subjects of the match statement
+    size_t      hits;       ///< Number of requests found in their primary entry
+    size_t      misses;     ///< Number of requests that were not
+    size_t      collisions; ///< Out of all the misses, how many were actual collisions
+    size_t      updates;    ///< Number of reconfigurations of the map
+    size_t      entries;    ///< Number of vtbl-pointer tuples in the map
+    size_t      cache_size; ///< Number of entries in the cache of the map
+    size_t      memory;     ///< Memory used by the map in bytes
+};
+
+//------------------------------------------------------------------------------
+
+/// Registry of live vtbl maps that keep dispatch statistics. Maps register 
+/// themselves in their constructors and unregister in their destructors.
+struct stats_registry
+{
+    /// Registration record of a map, normally a member of that map
+    struct record
+    {
+        const void* object;                                     ///< Registered map
+        void      (*snapshot)(const void* object, dispatch_stats& s); ///< Fills in statistics of the map
+        record*     next;                                       ///< Next registered record
+    };
+
+    /// Adds the record to the registry
+    static void add(record& r) noexcept
+    {
+        lock_guard guard;
+        r.next = head();
+        head() = &r;
+    }
+
+    /// Removes the record from the registry
+    static void remove(record& r) noexcept
+    {
+        lock_guard guard;
+
+        for (record** p = &head(); *p; p = &(*p)->next)
+            if (*p == &r)
+            {
+                *p = r.next;
+                break;
+            }
+    }
+
+    /// Takes a snapshot of the statistics of all the registered maps
+    static std::vector<dispatch_stats> snapshot()
+    {
+        lock_guard guard;
+        std::vector<dispatch_stats> result;
+
+        for (record* r = head(); r; r = r->next)
+        {
+            dispatch_stats s = {};
+            r->snapshot(r->object, s);
+            result.push_back(s);
+        }
+
+        return result;
+    }
+
+private:
+
+    /// The list of registered records. Constant-initialized.
+    static record*& head() noexcept { static record* first = nullptr; return first; }
+
+    /// Spin lock protecting the list: it is only taken when maps are created,
+    /// destroyed or a snapshot is taken, never on the hot path of dispatch.
+    static std::atomic_flag& busy() noexcept { static std::atomic_flag flag = ATOMIC_FLAG_INIT; return flag; }
+
+    struct lock_guard
+    {
+        lock_guard()  noexcept { while (busy().test_and_set(std::memory_order_acquire)) ; }
+       ~lock_guard()  noexcept { busy().clear(std::memory_order_release); }
+    };
+};
+
+//------------------------------------------------------------------------------
+
+/// Records the location of the match statement of a vtbl map, so that its
+/// statistics can be told apart. This generic version is used for the maps 
+/// that do not keep statistics.
+template <typename M>
+inline bool stats_site(M&, const char*, size_t, const char*) { return false; }
+
+/// Takes a snapshot of the statistics of all live vtbl maps
+inline std::vector<dispatch_stats> dispatch_statistics() { return stats_registry::snapshot(); }
+
+//------------------------------------------------------------------------------
+
+/// Writes a string as a JSON string literal
+inline void write_json_string(std::ostream& os, const char* str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    os << '"';
+
+    for (const char* p = str ? str : ""; *p; ++p)
+    {
+        const unsigned char c = static_cast<unsigned char>(*p);
+
+        if (c == '"' || c == '\\')
+            os << '\\' << char(c);
+        else
+        if (c < 0x20)
+            os << "\\u00" << hex[c >> 4] << hex[c & 15];
+        else
+            os << char(c);
+    }
+
+    os << '"';
+}
+
+/// Writes statistics of all live vtbl maps as a JSON array of objects
+inline void write_dispatch_statistics_json(std::ostream& os)
+{
+    const std::vector<dispatch_stats> stats = dispatch_statistics();
+
+    os << '[';
+
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        const dispatch_stats& s = stats[i];
+        os << (i ? ",\n " : "\n ") << "{\"file\":";
+        write_json_string(os, s.file);
+        os << ",\"line\":" << s.line << ",\"func\":";
+        write_json_string(os, s.func);
+        os << ",\"arity\":"      << s.arity
+           << ",\"hits\":"       << s.hits
+           << ",\"misses\":"     << s.misses
+           << ",\"collisions\":" << s.collisions
+           << ",\"updates\":"    << s.updates
+           << ",\"entries\":"    << s.entries
+           << ",\"cache_size\":" << s.cache_size
+           << ",\"memory\":"     << s.memory
+           << '}';
+    }
+
+    os << (stats.empty() ? "]" : "\n]") << std::endl;
+}
+
+/// Writes a string as a CSV field
+inline void write_csv_field(std::ostream& os, const char* str)
+{
+    os << '"';
+
+    for (const char* p = str ? str : ""; *p; ++p)
+        if (*p == '"')
+            os << "\"\"";
+        else
+            os << *p;
+
+    os << '"';
+}
+
+/// Writes statistics of all live vtbl maps as CSV with a header line
+inline void write_dispatch_statistics_csv(std::ostream& os)
+{
+    const std::vector<dispatch_stats> stats = dispatch_statistics();
+
+    os << "file,line,func,arity,hits,misses,collisions,updates,entries,cache_size,memory" << std::endl;
+
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        const dispatch_stats& s = stats[i];
+        write_csv_field(os, s.file);
+        os << ',' << s.line << ',';
+        write_csv_field(os, s.func);
+        os << ',' << s.arity
+           << ',' << s.hits
+           << ',' << s.misses
+           << ',' << s.collisions
+           << ',' << s.updates
+           << ',' << s.entries
+           << ',' << s.cache_size
+           << ',' << s.memory
+           << std::endl;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
+
+/// Records the location of the enclosing match statement in the statistics of
+/// its vtbl map. Only the first execution of the statement does this.
+#define XTL_STATS_SITE(m) XTL_DUMP_PERFORMANCE_ONLY(static const bool __located = mch::stats_site(m,__FILE__,__LINE__,XTL_FUNCTION); XTL_UNUSED(__located);)
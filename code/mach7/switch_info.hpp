@@ -0,0 +1,96 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file defines the types of the jump target and the offsets that Match
+/// statements remember for each vtbl-pointer, together with the functions 
+/// through which the statements read and write them. With #XTL_MULTI_THREADING
+/// they are atomic: a thread writes the offsets first and then publishes the
+/// target with a release store, so that any thread acquiring a non-zero target
+/// also sees the offsets of the clause it jumps to. Threads racing to fill in 
+/// the same entry write the same values, so the offsets need no ordering among
+/// themselves and are accessed with relaxed operations.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include "config.hpp"    // Various compiler/platform dependent macros
+#include <cstddef>
+#if XTL_MULTI_THREADING
+#include <atomic>
+#endif
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+#if XTL_MULTI_THREADING
+typedef std::atomic<std::size_t>    switch_target; ///< Case label of the jump target shared by threads
+typedef std::atomic<std::ptrdiff_t> switch_offset; ///< Offset to the target sub-object shared by threads
+#else
+typedef std::size_t                 switch_target; ///< Case label of the jump target
+typedef std::ptrdiff_t              switch_offset; ///< Offset to the target sub-object
+#endif
+
+//------------------------------------------------------------------------------
+
+/// Jump target remembered for a vtbl-pointer or 0 when it has not been learned yet
+inline std::size_t load_target(const std::size_t& target) noexcept { return target; }
+
+/// Publishes the jump target learned for a vtbl-pointer
+inline void store_target(std::size_t& target, std::size_t label) noexcept { target = label; }
+
+/// Offset remembered for a vtbl-pointer
+inline std::ptrdiff_t load_offset(const std::ptrdiff_t& offset) noexcept { return offset; }
+
+/// Remembers the offset for a vtbl-pointer before its jump target is published
+inline void store_offset(std::ptrdiff_t& offset, std::ptrdiff_t value) noexcept { offset = value; }
+
+#if XTL_MULTI_THREADING
+/// \note Synchronizes with #store_target, which makes the offsets visible
+inline std::size_t load_target(const std::atomic<std::size_t>& target) noexcept { return target.load(std::memory_order_acquire); }
+inline void store_target(std::atomic<std::size_t>& target, std::size_t label) noexcept { target.store(label, std::memory_order_release); }
+inline std::ptrdiff_t load_offset(const std::atomic<std::ptrdiff_t>& offset) noexcept { return offset.load(std::memory_order_relaxed); }
+inline void store_offset(std::atomic<std::ptrdiff_t>& offset, std::ptrdiff_t value) noexcept { offset.store(value, std::memory_order_relaxed); }
+#endif
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
@@ -52,6 +52,12 @@
 #include <xtl/xtl.hpp>   // XTL subtyping definitions
 #include "vtblmap4.hpp"
 #include "metatools.hpp"
+#if XTL_USE_PERF_COUNTERS
+#include "perfcounters.hpp" // Hardware counters of match statements
+#endif
+#if XTL_SHARE_NESTED_TESTS
+#include "shared_tests.hpp" // Type tests of sub-terms shared by the clauses of a match statement
+#endif
 
 //------------------------------------------------------------------------------
 
@@ -112,12 +118,12 @@ struct type_switch_info_offset_helper
 {
     static inline void set_offset(SwitchInfo& si, size_t index, ptrdiff_t offset)
     {
-        si.offset[index] = offset;
+        store_offset(si.offset[index], offset);
     }
 
     static inline ptrdiff_t get_offset(SwitchInfo& si, size_t index)
     {
-        return si.offset[index];
+        return load_offset(si.offset[index]);
     }
 };
 
@@ -184,12 +190,14 @@ struct type_switch_info_offset_helper<false, SwitchInfo>
             polymorphic_index00 = -1,                                          \
             __base_counter = XTL_COUNTER                                       \
         };                                                                     \
+        XTL_PERF_SITE()                                                        \
+        XTL_SHARED_TESTS_SCOPE()                                               \
         XTL_REPEAT(N,XTL_MATCH_SUBJECT_POLYMORPHIC_FROM,__VA_ARGS__)           \
         enum { number_of_polymorphic_subjects = XTL_REPEAT_WITH(+,N, XTL_PREFIX, is_polymorphic) }; \
         typedef mch::vtbl_map<number_of_polymorphic_subjects,mch::type_switch_info<number_of_polymorphic_subjects>> vtbl_map_type; \
         XTL_PRELOADABLE_LOCAL_STATIC(vtbl_map_type,__vtbl2case_map,match_uid_type,XTL_DUMP_PERFORMANCE_ONLY(__FILE__,__LINE__,XTL_FUNCTION,)XTL_GET_TYPES_NUM_ESTIMATE);\
         mch::type_switch_info<number_of_polymorphic_subjects>& __switch_info = __vtbl2case_map.xtl_get(XTL_ENUM(N,XTL_PREFIX,subject_ptr)); \
-        switch (number_of_polymorphic_subjects ? __switch_info.target : 0) {   \
+        switch (number_of_polymorphic_subjects ? mch::load_target(__switch_info.target) : 0) { \
         default: {{{
 
 #if defined(_MSC_VER)
@@ -226,10 +234,10 @@ struct type_switch_info_offset_helper<false, SwitchInfo>
             static_assert(number_of_subjects == N, "Number of targets in the case clause must be the same as the number of subjects in the Match statement"); \
             enum { target_label = XTL_COUNTER-__base_counter, is_inside_case_clause = 1 }; \
             XTL_STATIC_IF(number_of_polymorphic_subjects)                      \
-            if (XTL_LIKELY(__switch_info.target == 0))                         \
+            if (XTL_LIKELY(mch::load_target(__switch_info.target) == 0))       \
             {                                                                  \
-                __switch_info.target = target_label;                           \
                 XTL_REPEAT(N, XTL_ASSIGN_OFFSET, XTL_EMPTY())                  \
+                mch::store_target(__switch_info.target, target_label);         \
             }                                                                  \
         case target_label:                                                     \
             XTL_REPEAT(N, XTL_ADJUST_PTR_FROM, __VA_ARGS__)                    \
@@ -251,19 +259,19 @@ struct type_switch_info_offset_helper<false, SwitchInfo>
         }}}                                                                    \
         {{{                                                                    \
             enum { target_label = XTL_COUNTER-__base_counter, is_inside_case_clause = 1 }; \
-            if (XTL_LIKELY(__switch_info.target == 0))                         \
-                __switch_info.target = target_label;                           \
+            if (XTL_LIKELY(mch::load_target(__switch_info.target) == 0))       \
+                mch::store_target(__switch_info.target, target_label);         \
         case target_label:
 
 /// General EndMatch statement
 #define EndMatch                                                               \
         }}}                                                                    \
         XTL_STATIC_IF(number_of_polymorphic_subjects)                          \
-        if (XTL_UNLIKELY((__switch_info.target == 0)))                         \
+        if (XTL_UNLIKELY((mch::load_target(__switch_info.target) == 0)))       \
         {                                                                      \
             enum { target_label = XTL_COUNTER-__base_counter };                \
             XTL_SET_TYPES_NUM_ESTIMATE(target_label-1);                        \
-            __switch_info.target = target_label;                               \
+            mch::store_target(__switch_info.target, target_label);             \
             case target_label: ;                                               \
         }                                                                      \
         }                                                                      \
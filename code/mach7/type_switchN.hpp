@@ -51,6 +51,10 @@
 
 #include "vtblmap4.hpp"
 #include "metatools.hpp"
+#include "vtblgroups.hpp"
+#if XTL_USE_PERF_COUNTERS
+#include "perfcounters.hpp" // Hardware counters of match statements
+#endif
 
 namespace mch ///< Mach7 library namespace
 {
@@ -121,12 +125,15 @@ enum { default_layout = size_t(~0) };
         struct match_uid_type {};                                              \
         enum { is_inside_case_clause = 0, number_of_subjects = N };            \
         enum { __base_counter = XTL_COUNTER };                                 \
+        XTL_PERF_SITE()                                                        \
         XTL_REPEAT(N,XTL_MATCH_SUBJECT_POLYMORPHIC_FROM,__VA_ARGS__)           \
         const intptr_t __vtbl[N] = {XTL_ENUM(N,XTL_GET_VTLB_OF_SUBJECT, XTL_EMPTY())}; \
         typedef mch::vtbl_map<N,mch::type_switch_info<N>> vtbl_map_type;       \
         XTL_PRELOADABLE_LOCAL_STATIC(vtbl_map_type,__vtbl2case_map,match_uid_type,XTL_DUMP_PERFORMANCE_ONLY(__FILE__,__LINE__,XTL_FUNCTION,)XTL_GET_TYPES_NUM_ESTIMATE);\
+        XTL_PROFILE_SITE(__vtbl2case_map)                                      \
+        XTL_STATS_SITE(__vtbl2case_map)                                        \
         mch::type_switch_info<N>& __switch_info = __vtbl2case_map.get(__vtbl); \
-        switch (__switch_info.target) {                                        \
+        switch (mch::load_target(__switch_info.target)) {                      \
         default: {
 
 #if defined(_MSC_VER)
@@ -140,8 +147,8 @@ enum { default_layout = size_t(~0) };
 #endif
 
 #define XTL_DYN_CAST_FROM(i,...) (__casted_ptr##i = dynamic_cast<const XTL_SELECT_ARG(i,__VA_ARGS__)*>(subject_ptr##i)) != 0
-#define XTL_ASSIGN_OFFSET(i,...) __switch_info.offset[i] = intptr_t(__casted_ptr##i)-intptr_t(subject_ptr##i);
-#define XTL_ADJUST_PTR_FROM(i,...) auto& match##i = *mch::adjust_ptr<XTL_SELECT_ARG(i,__VA_ARGS__)>(subject_ptr##i,__switch_info.offset[i]); XTL_UNUSED(match##i)
+#define XTL_ASSIGN_OFFSET(i,...) mch::store_offset(__switch_info.offset[i], intptr_t(__casted_ptr##i)-intptr_t(subject_ptr##i));
+#define XTL_ADJUST_PTR_FROM(i,...) auto& match##i = *mch::adjust_ptr<XTL_SELECT_ARG(i,__VA_ARGS__)>(subject_ptr##i,mch::load_offset(__switch_info.offset[i])); XTL_UNUSED(match##i)
 
 /// Helper macro for #Case
 /// NOTE: It is possible to have if conditions sequenced instead of &&, but that
@@ -152,10 +159,10 @@ enum { default_layout = size_t(~0) };
         {                                                                      \
             static_assert(number_of_subjects == N, "Number of targets in the case clause must be the same as the number of subjects in the Match statement"); \
             enum { target_label = XTL_COUNTER-__base_counter, is_inside_case_clause = 1 }; \
-            if (XTL_LIKELY(__switch_info.target == 0))                         \
+            if (XTL_LIKELY(mch::load_target(__switch_info.target) == 0))       \
             {                                                                  \
-                __switch_info.target = target_label;                           \
                 XTL_REPEAT(N, XTL_ASSIGN_OFFSET, XTL_EMPTY())                  \
+                mch::store_target(__switch_info.target, target_label);         \
             }                                                                  \
         case target_label:                                                     \
             XTL_REPEAT(N, XTL_ADJUST_PTR_FROM, __VA_ARGS__)
@@ -175,18 +182,18 @@ enum { default_layout = size_t(~0) };
         }                                                                      \
         {                                                                      \
             enum { target_label = XTL_COUNTER-__base_counter, is_inside_case_clause = 1 }; \
-            if (XTL_LIKELY(__switch_info.target == 0))                         \
-                __switch_info.target = target_label;                           \
+            if (XTL_LIKELY(mch::load_target(__switch_info.target) == 0))       \
+                mch::store_target(__switch_info.target, target_label);         \
         case target_label:
 
 /// General EndMatch statement
 #define EndMatch                                                               \
         }                                                                      \
-        if (XTL_UNLIKELY((__switch_info.target == 0)))                         \
+        if (XTL_UNLIKELY((mch::load_target(__switch_info.target) == 0)))       \
         {                                                                      \
             enum { target_label = XTL_COUNTER-__base_counter };                \
             XTL_SET_TYPES_NUM_ESTIMATE(target_label-1);                        \
-            __switch_info.target = target_label;                               \
+            mch::store_target(__switch_info.target, target_label);             \
             case target_label: ;                                               \
         }                                                                      \
         }                                                                      \
@@ -194,3 +201,54 @@ enum { default_layout = size_t(~0) };
         }
 
 //------------------------------------------------------------------------------
+
+/// Batched #Match statement over a range of polymorphic subjects. The subjects
+/// are first grouped by their vtbl-pointers, after which the dispatch table is
+/// consulted once per group and the case clauses are run on all the subjects of
+/// a group in a row, turning random dispatch into mostly predictable branches.
+/// The range may contain pointers or references to subjects, which are visited
+/// in the order of first appearance of their dynamic type. Containers keeping
+/// their subjects grouped already (\see grouped_vector) skip the grouping.
+/// Inside the clauses \c continue moves on to the next subject, just like
+/// \c break does.
+/// \note Only a single subject per statement is supported.
+#define MatchEach(s) {                                                         \
+        XTL_WARNING_PUSH                                                       \
+        XTL_WARNING_IGNORE_NAME_HIDING                                         \
+        struct match_uid_type {};                                              \
+        enum { is_inside_case_clause = 0, number_of_subjects = 1 };            \
+        enum { __base_counter = XTL_COUNTER };                                 \
+        XTL_PERF_SITE()                                                        \
+        auto&& __subjects = s;                                                 \
+        typedef mch::vtbl_map<1,mch::type_switch_info<1>> vtbl_map_type;       \
+        XTL_PRELOADABLE_LOCAL_STATIC(vtbl_map_type,__vtbl2case_map,match_uid_type,XTL_DUMP_PERFORMANCE_ONLY(__FILE__,__LINE__,XTL_FUNCTION,)XTL_GET_TYPES_NUM_ESTIMATE);\
+        XTL_PROFILE_SITE(__vtbl2case_map)                                      \
+        XTL_STATS_SITE(__vtbl2case_map)                                        \
+        for (const auto& __group : mch::group_by_vtbl(__subjects))             \
+        {                                                                      \
+            const intptr_t __vtbl[1] = {__group.vtbl};                         \
+            mch::type_switch_info<1>& __switch_info = __vtbl2case_map.get(__vtbl); \
+            for (auto __it = __group.begin(); __it != __group.end(); ++__it)   \
+            {                                                                  \
+                __group.prefetch(__it);                                        \
+                XTL_MATCH_SUBJECT_POLYMORPHIC(0,*__it)                         \
+                switch (mch::load_target(__switch_info.target)) {              \
+                default: {
+
+/// End of the #MatchEach statement
+#define EndMatchEach                                                           \
+        }                                                                      \
+        if (XTL_UNLIKELY((mch::load_target(__switch_info.target) == 0)))       \
+        {                                                                      \
+            enum { target_label = XTL_COUNTER-__base_counter };                \
+            XTL_SET_TYPES_NUM_ESTIMATE(target_label-1);                        \
+            mch::store_target(__switch_info.target, target_label);             \
+            case target_label: ;                                               \
+        }                                                                      \
+        }                                                                      \
+            }                                                                  \
+        }                                                                      \
+        XTL_WARNING_POP                                                        \
+        }
+
+//------------------------------------------------------------------------------
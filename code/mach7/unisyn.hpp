@@ -48,6 +48,12 @@
 #include "has_member.hpp"    // Meta-functions to check use of certain #bindings facilities
 #include "patterns/bindings.hpp"
 #include "vtblmap.hpp"
+#include "epoch.hpp"         // Epoch-based reclamation of replaced snapshots of kinds
+#if XTL_USE_DISPLAY_CAST
+#include "display_cast.hpp"  // Constant-time casts in registered hierarchies
+#endif
+#include <atomic>
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
@@ -116,13 +122,169 @@ template <typename T> inline lbl_type original2remapped(tag_type t) { return lbl
 
 //------------------------------------------------------------------------------
 
-typedef std::unordered_map<lbl_type, const lbl_type*> kind_to_kinds_map;
+/// Precomputed subsumption relation between kinds of a class hierarchy: row D
+/// of the bit-matrix has bit B set when kind B belongs to the tag precedence
+/// list of kind D. This turns the check of whether one kind is the base of 
+/// another from a walk over the precedence list into a single load. Rows are
+/// allocated only for registered kinds and never change once published, so
+/// they can be read without locking while other kinds are being registered.
+/// \note Kinds not smaller than #XTL_MAX_DENSE_KINDS are not kept here.
+class kind_subsumption
+{
+public:
+
+    typedef std::uint64_t word_type;
+
+    enum
+    {
+        bits_per_word = sizeof(word_type)*8,
+        words_per_row = (XTL_MAX_DENSE_KINDS + bits_per_word - 1) / bits_per_word
+    };
+
+    kind_subsumption() noexcept : m_rows() {}
+   ~kind_subsumption()
+    {
+        for (size_t i = 0; i < XTL_MAX_DENSE_KINDS; ++i)
+            delete[] m_rows[i].load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < m_retired.size(); ++i)
+            delete[] m_retired[i];
+    }
+
+    /// Records the tag precedence list of a given kind. Returns false when the
+    /// list cannot be represented densely and thus has to be walked instead.
+    /// \note Concurrent calls have to be serialized by the caller.
+    bool set(lbl_type kind, const lbl_type* kinds)
+    {
+        if (!kinds || size_t(kind) >= XTL_MAX_DENSE_KINDS)
+            return false;
+
+        for (const lbl_type* k = kinds; *k; ++k)
+            if (size_t(*k) >= XTL_MAX_DENSE_KINDS)
+                return false;
+
+        word_type* r = new word_type[words_per_row]();
+
+        for (const lbl_type* k = kinds; *k; ++k)
+            r[*k/bits_per_word] |= word_type(1) << (*k%bits_per_word);
+
+        // Rows replaced by re-registration may still be read, so keep them
+        if (const word_type* old = m_rows[kind].exchange(r, std::memory_order_release))
+            m_retired.push_back(old);
+
+        return true;
+    }
+
+    /// Returns 1 when base_kind is in the tag precedence list of derived_kind,
+    /// 0 when it is not and -1 when the relation is not known densely.
+    int test(lbl_type base_kind, lbl_type derived_kind) const noexcept
+    {
+        if (XTL_LIKELY(size_t(derived_kind) < XTL_MAX_DENSE_KINDS))
+            if (const word_type* r = m_rows[derived_kind].load(std::memory_order_acquire))
+                return size_t(base_kind) < XTL_MAX_DENSE_KINDS
+                     ? int((r[base_kind/bits_per_word] >> (base_kind%bits_per_word)) & 1)
+                     : 0;
+
+        return -1;
+    }
+
+private:
+
+    kind_subsumption(const kind_subsumption&);            ///< Not copyable
+    kind_subsumption& operator=(const kind_subsumption&); ///< Not assignable
+
+    std::atomic<const word_type*>  m_rows[XTL_MAX_DENSE_KINDS]; ///< Rows of the matrix indexed by derived kind
+    std::vector<const word_type*>  m_retired;                   ///< Rows replaced by re-registration of their kind
+};
+
+/// Flat table of tag precedence lists of kinds of a class hierarchy. Kinds below
+/// #XTL_MAX_DENSE_KINDS are kept in an array indexed by remapped kind, which is
+/// shared by all match statements on the hierarchy and read without locking. 
+/// Larger kinds (e.g. randomized tags) go to a sparse map instead, which is
+/// published as an immutable snapshot, so lookups in it do not lock either.
+/// Registration of kinds copies the map and is serialized with a spin lock.
+/// The snapshot it replaces is retired into the epoch-based reclamation (see
+/// epoch.hpp) and deallocated once no lookup can be using it anymore.
+class kind_table
+{
+public:
 
+    kind_table() noexcept : m_dense(), m_sparse(nullptr), m_subsumption() { m_busy.clear(); }
+   ~kind_table() { delete m_sparse.load(std::memory_order_relaxed); }
+
+    /// Gets the tag precedence list of a given kind or 0 if it was not registered
+    const lbl_type* get(lbl_type kind) const noexcept
+    {
+        if (XTL_LIKELY(size_t(kind) < XTL_MAX_DENSE_KINDS))
+            return m_dense[kind].load(std::memory_order_acquire);
+
+        epoch_domain<>::enter(); // The snapshot might be retired by a concurrent registration
+
+        const sparse_map* m = m_sparse.load(std::memory_order_acquire);
+        const lbl_type*   r = 0;
+
+        if (m)
+        {
+            sparse_map::const_iterator p = m->find(kind);
+
+            if (p != m->end())
+                r = p->second;
+        }
+
+        epoch_domain<>::exit(); // Precedence lists are never deallocated, only the snapshot was protected
+        return r;
+    }
+
+    /// Registers the tag precedence list of a given kind
+    const lbl_type* set(lbl_type kind, const lbl_type* kinds)
+    {
+        lock_guard guard(m_busy);
+        m_subsumption.set(kind, kinds);
+
+        if (size_t(kind) < XTL_MAX_DENSE_KINDS)
+            m_dense[kind].store(kinds, std::memory_order_release);
+        else
+        {
+            // Readers might still be using the current snapshot, so we publish
+            // a modified copy of it and let reclamation decide when to delete it.
+            sparse_map* old = m_sparse.load(std::memory_order_relaxed);
+            sparse_map* m   = old ? new sparse_map(*old) : new sparse_map;
+            (*m)[kind] = kinds;
+            m_sparse.store(m, std::memory_order_release);
+
+            if (old)
+                epoch_domain<>::retire(old);
+        }
+
+        return kinds;
+    }
+
+    /// Subsumption relation between kinds registered so far
+    const kind_subsumption& subsumption() const noexcept { return m_subsumption; }
+
+private:
+
+    typedef std::unordered_map<lbl_type, const lbl_type*> sparse_map;
+
+    struct lock_guard
+    {
+        lock_guard(std::atomic_flag& f) noexcept : flag(f) { while (flag.test_and_set(std::memory_order_acquire)) ; }
+       ~lock_guard() noexcept { flag.clear(std::memory_order_release); }
+        std::atomic_flag& flag;
+    };
+
+    std::atomic_flag              m_busy;                        ///< Spin lock serializing registration of kinds
+    std::atomic<const lbl_type*>  m_dense[XTL_MAX_DENSE_KINDS];  ///< Precedence lists of kinds below #XTL_MAX_DENSE_KINDS
+    std::atomic<sparse_map*>      m_sparse;                      ///< Snapshot of precedence lists of the remaining kinds
+    kind_subsumption              m_subsumption;                 ///< Subsumption relation between dense kinds
+};
+
+/// Gets the table of kinds of the class hierarchy rooted at T
 template <typename T>
-inline kind_to_kinds_map& get_kind_to_kinds_map() noexcept 
+inline kind_table& get_kind_table() noexcept
 {
-    static kind_to_kinds_map k2k;
-    return k2k;
+    static kind_table kt;
+    return kt;
 }
 
 /// Gets all the kinds of a class with static type T and dynamic type represented 
@@ -131,13 +293,13 @@ inline kind_to_kinds_map& get_kind_to_kinds_map() noexcept
 template <typename T>
 inline const lbl_type* get_kinds(lbl_type kind) noexcept
 {
-    return get_kind_to_kinds_map<T>()[kind];
+    return get_kind_table<T>().get(kind);
 }
 
 template <typename T>
 inline const lbl_type* set_kinds(lbl_type kind, const lbl_type* kinds) noexcept
 {
-    return get_kind_to_kinds_map<T>()[kind] = kinds;
+    return get_kind_table<T>().set(kind, kinds);
 }
 
 template <typename D, typename B>
@@ -154,6 +316,11 @@ const lbl_type* associate_kinds<D,B>::kinds = set_kinds<B>(remapped<D>::lbl, bin
 template <typename T>
 inline bool is_base_and_derived_kinds(lbl_type base_kind, lbl_type derived_kind) noexcept
 {
+    int known = get_kind_table<T>().subsumption().test(base_kind, derived_kind);
+
+    if (XTL_LIKELY(known >= 0))
+        return known != 0;
+
     const lbl_type* all_kinds = get_kinds<T>(derived_kind);
 
     if (!all_kinds)
@@ -334,26 +501,26 @@ public:
     static inline size_t choose(const source_type* subject_ptr, static_data_type& static_data, local_data_type& local_data) noexcept
     {
         local_data.switch_info_ptr = &static_data.get(subject_ptr);
-        return local_data.switch_info_ptr->target;
+        return load_target(local_data.switch_info_ptr->target);
     }
 
     /// Function that will be called upon first entry to the case through the fall-through behavior
     static inline void on_first_pass(const source_type* subject_ptr, local_data_type& local_data, size_t line) noexcept
     {
-        if (XTL_LIKELY(local_data.switch_info_ptr->target == 0)) 
+        if (XTL_LIKELY(load_target(local_data.switch_info_ptr->target) == 0)) 
         {
-            local_data.switch_info_ptr->target = line; 
-            local_data.switch_info_ptr->offset = intptr_t(local_data.casted_ptr)-intptr_t(subject_ptr);
+            store_offset(local_data.switch_info_ptr->offset, intptr_t(local_data.casted_ptr)-intptr_t(subject_ptr));
+            store_target(local_data.switch_info_ptr->target, line);
         } 
     }
     
     /// Function that will be called when the fall-through behavior reached end of the switch
     static inline void on_end(const source_type*, local_data_type& local_data, size_t line) noexcept
     {
-        XTL_ASSERT(local_data.switch_info_ptr->target == 0);
-        //if (XTL_LIKELY(local_data.switch_info_ptr->target == 0)) 
+        XTL_ASSERT(load_target(local_data.switch_info_ptr->target) == 0);
+        //if (XTL_LIKELY(load_target(local_data.switch_info_ptr->target) == 0)) 
         { 
-            local_data.switch_info_ptr->target = line;
+            store_target(local_data.switch_info_ptr->target, line);
         }
     }
 
@@ -397,7 +564,7 @@ public:
             /// during the fall-through behavior.
             static inline bool main_condition(const source_type* subject_ptr, local_data_type& local_data) noexcept
             {
-                return (local_data.casted_ptr = dynamic_cast<const target_type*>(subject_ptr)) != 0;
+                return (local_data.casted_ptr = XTL_SUBTYPE_CAST<const target_type*>(subject_ptr)) != 0;
             }
 
             /// Performs the necessary conversion of the original subject into the proper
@@ -405,7 +572,7 @@ public:
             /// \note The subject is const-qualified, thus the target is also const-qualified
             static inline const target_type* get_matched(const source_type* subject_ptr, local_data_type& local_data) noexcept
             {
-                return adjust_ptr<target_type>(subject_ptr,local_data.switch_info_ptr->offset);
+                return adjust_ptr<target_type>(subject_ptr,load_offset(local_data.switch_info_ptr->offset));
             }
 
             /// Performs the necessary conversion of the original subject into the proper
@@ -413,7 +580,7 @@ public:
             /// \note The subject is non-const, thus the target is also non-const
             static inline       target_type* get_matched(      source_type* subject_ptr, local_data_type& local_data) noexcept
             {
-                return adjust_ptr<target_type>(subject_ptr,local_data.switch_info_ptr->offset);
+                return adjust_ptr<target_type>(subject_ptr,load_offset(local_data.switch_info_ptr->offset));
             }
         };
     };
@@ -448,7 +615,8 @@ public:
 
     /// Type of data that has to be statically allocated inside the block 
     /// containg extended switch
-    typedef std::vector<const lbl_type*> static_data_type;
+    /// \note Precedence lists of kinds are shared by all match statements, see #kind_table
+    struct static_data_type {};
 
     /// Type of data that has to be automatically allocated inside the block 
     /// containg extended switch
@@ -494,19 +662,12 @@ public:
 
     /// Function that will be called on default clause. It should return true 
     /// when unconditional jump to ReMatch label should be performed.
-    static inline bool on_default(size_t& jump_target, local_data_type& local_data, static_data_type& static_data) noexcept
+    static inline bool on_default(size_t& jump_target, local_data_type& local_data, static_data_type&) noexcept
     {
         if (XTL_LIKELY(!local_data.kinds))
         {
-            /// FIX: The use of vector and resize in it assumes at the moment small tags in 
-            ///      region 0..k. Tag randomization will overuse memory!
-
             //local_data.attempt = 0;
-            if (XTL_UNLIKELY(jump_target >= static_data.size()))
-                static_data.resize(jump_target+1);
-            local_data.kinds = static_data[jump_target];
-            if (!local_data.kinds)
-                local_data.kinds = static_data[jump_target] = get_kinds<source_type>(lbl_type(jump_target));
+            local_data.kinds = get_kinds<source_type>(lbl_type(jump_target));
         }
         XTL_ASSERT(xtl_failure("Base classes for this kind were not specified",local_data.kinds));
         //XTL_ASSERT(xtl_failure("Invalid list of kinds",local_data.kinds[local_data.attempt]==jump_target));
@@ -0,0 +1,132 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines a small per-thread direct-mapped cache that the
+/// multi-threaded versions of vtbl maps put in front of their shared data when
+/// #XTL_THREAD_CACHE_LOG_SIZE is not 0. Repeated hits served from this cache
+/// do not touch any memory shared with other threads.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include "config.hpp"    // Various compiler/platform dependent macros
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Per-thread direct-mapped cache of references to values of vtbl maps of type
+/// vtbl_map<N,T>. All the maps of the same type share one table per thread, so
+/// every cached reference is tagged with the unique id of the map it came from.
+/// \note The cache relies on the maps never moving or deallocating their
+///       values while alive, which both multi-threaded maps guarantee. Ids are
+///       never reused, so a map allocated where another one used to be will
+///       not see the values of its predecessor.
+template <size_t N, typename T>
+struct thread_vtbl_cache
+{
+    /// Log of the number of entries in the table of each thread
+    static const size_t log_size = XTL_THREAD_CACHE_LOG_SIZE;
+
+    /// A cached reference together with the key it was cached for
+    struct entry
+    {
+        size_t   owner;   ///< Id of the map the value belongs to. 0 in unused entries.
+        intptr_t vtbl[N]; ///< vtbl-pointers the value is associated with
+        T*       value;   ///< Value in the map associated with the vtbl-pointers
+    };
+
+    /// Allocates a new id for a map. Ids start from 1 as 0 marks unused entries.
+    static size_t new_owner() noexcept
+    {
+        static std::atomic<size_t> last_owner(0);
+        return ++last_owner;
+    }
+
+    /// Returns the entry the given key maps to in the table of the calling thread
+    static inline entry& entry_for(size_t owner, const intptr_t (&vtbl)[N]) noexcept
+    {
+        // NOTE: The table is zero-initialized POD, which lets compilers access
+        //       it without any initialization guards.
+        static thread_local entry table[size_t(1) << log_size];
+
+        size_t h = owner;
+
+        for (size_t i = 0; i < N; ++i)
+            h = h*31 + size_t(vtbl[i] >> XTL_IRRELEVANT_VTBL_BITS);
+
+        return table[h & ((size_t(1) << log_size) - 1)];
+    }
+
+    /// Returns the cached value for the given key or nullptr if it is not cached
+    static inline T* find(size_t owner, const intptr_t (&vtbl)[N]) noexcept
+    {
+        const entry& e = entry_for(owner, vtbl);
+
+        if (e.owner != owner)
+            return nullptr;
+
+        for (size_t i = 0; i < N; ++i)
+            if (e.vtbl[i] != vtbl[i])
+                return nullptr;
+
+        return e.value;
+    }
+
+    /// Caches the value for the given key, evicting whatever was there before
+    static inline void store(size_t owner, const intptr_t (&vtbl)[N], T& value) noexcept
+    {
+        entry& e = entry_for(owner, vtbl);
+        e.owner = owner;
+
+        for (size_t i = 0; i < N; ++i)
+            e.vtbl[i] = vtbl[i];
+
+        e.value = &value;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
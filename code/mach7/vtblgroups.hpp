@@ -0,0 +1,327 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines class vtbl_groups<P> used by #MatchEach to group a range
+/// of polymorphic subjects by their vtbl-pointers, so that the dispatch table
+/// of a match statement is consulted once per dynamic type instead of once
+/// per subject.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "config.hpp"    // Various compiler/platform dependent macros
+#include "ptrtools.hpp"  // Helper functions to work with pointers
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Pointers to subjects of a range grouped by their vtbl-pointers. Groups
+/// appear in the order in which their first subject appears in the range and
+/// subjects within a group keep their relative order from the range.
+/// \tparam P Type of a pointer to a subject, e.g. const Shape*
+template <typename P>
+class vtbl_groups
+{
+public:
+
+    /// Subjects of the same dynamic type
+    class group
+    {
+    public:
+
+        typedef const P* iterator;
+
+        group(intptr_t v, const P* f, const P* l) : vtbl(v), first(f), last(l) {}
+
+        iterator begin() const noexcept { return first; }
+        iterator end()   const noexcept { return last;  }
+        size_t   size()  const noexcept { return last - first; }
+
+        /// Hints the processor to bring in the subject a few positions ahead
+        /// of the one pointed to by i in this group
+        void prefetch(iterator i) const noexcept
+        {
+            if (last - i > XTL_PREFETCH_DISTANCE)
+                XTL_PREFETCH(i[XTL_PREFETCH_DISTANCE]);
+        }
+
+        intptr_t vtbl; ///< vtbl-pointer shared by all the subjects of the group
+
+    private:
+
+        const P* first;
+        const P* last;
+    };
+
+    typedef typename std::vector<group>::const_iterator iterator;
+
+    /// Groups subjects of the range [first,last), which may contain pointers
+    /// or references to subjects, by their vtbl-pointers.
+    template <typename InputIterator>
+    vtbl_groups(InputIterator first, InputIterator last) : store(acquire())
+    {
+        typedef typename std::iterator_traits<InputIterator>::iterator_category category;
+
+        std::vector<P>&      ptrs = store.ptrs;
+        std::vector<size_t>& ids  = store.ids;
+        std::vector<P>&  subjects = store.subjects;
+        group_ids            table;
+
+        reserve(ptrs, ids, first, last, category());
+
+        for (; first != last; ++first)
+        {
+            prefetch_ahead(first, last, category());
+
+            const P p = mch::addr(*first);
+            ptrs.push_back(p);
+            ids.push_back(table.id_of(vtbl_of(p)));
+        }
+
+        // Counting sort of the subjects by their group ids
+        subjects.resize(ptrs.size());
+        groups.reserve(table.vtbls.size());
+
+        std::vector<size_t> offsets(table.vtbls.size());
+
+        for (size_t g = 0, offset = 0; g < table.vtbls.size(); offset += table.counts[g++])
+        {
+            offsets[g] = offset;
+            groups.push_back(group(table.vtbls[g], subjects.data() + offset, subjects.data() + offset + table.counts[g]));
+        }
+
+        for (size_t i = 0; i < ptrs.size(); ++i)
+            subjects[offsets[ids[i]]++] = ptrs[i];
+    }
+
+    /// Returns the buffers to the pool of the calling thread
+    ~vtbl_groups()
+    {
+        std::vector<buffers>& pool = spare();
+
+        if (pool.size() < max_spare)
+            pool.push_back(std::move(store));
+    }
+
+    vtbl_groups(vtbl_groups&&) = default;
+    vtbl_groups(const vtbl_groups&) = delete;
+    vtbl_groups& operator=(const vtbl_groups&) = delete;
+
+    iterator begin()  const noexcept { return groups.begin(); }
+    iterator end()    const noexcept { return groups.end();   }
+    size_t   size()   const noexcept { return groups.size();  }
+
+private:
+
+    /// Hash table mapping vtbl-pointers to group ids. The table is grown until
+    /// the vtbl-pointers it has seen land in distinct slots, so that a look up
+    /// of a known vtbl-pointer is a single comparison that is always true.
+    /// \note Unlike vtbl_map, the table is short-lived, so instead of learning
+    ///       which bits of vtbl-pointers are relevant, it uses Fibonacci hashing.
+    struct group_ids
+    {
+        struct slot
+        {
+            intptr_t vtbl; ///< vtbl-pointer of a group or 0 if the slot is empty
+            size_t   id;   ///< Id of the group
+        };
+
+        group_ids() : log_size(XTL_MIN_LOG_SIZE), slots(size_t(1) << XTL_MIN_LOG_SIZE) {}
+
+        size_t hash(intptr_t v) const noexcept
+        {
+            return size_t((uint64_t(v) * 0x9E3779B97F4A7C15ULL) >> (64 - log_size));
+        }
+
+        /// Returns id of the group of vtbl-pointer v, creating it if necessary
+        size_t id_of(intptr_t v)
+        {
+            const slot& s = slots[hash(v)];
+
+            if (XTL_LIKELY(s.vtbl == v))
+                return (++counts[s.id], s.id);
+
+            return add(v);
+        }
+
+        /// Slow path of #id_of for new vtbl-pointers and colliding ones
+        size_t add(intptr_t v)
+        {
+            const size_t mask = slots.size() - 1;
+            const size_t home = hash(v);
+            size_t       i    = home;
+
+            for (; slots[i].vtbl != 0; i = (i + 1) & mask)
+                if (slots[i].vtbl == v)
+                    return (++counts[slots[i].id], slots[i].id);
+
+            const size_t id = vtbls.size();
+
+            slots[i].vtbl = v;
+            slots[i].id   = id;
+            vtbls.push_back(v);
+            counts.push_back(1);
+
+            if (i != home || vtbls.size()*2 > slots.size())
+                grow();
+
+            return id;
+        }
+
+        /// Grows the table until the groups land in distinct slots or the table
+        /// becomes too sparse, in which case collisions are resolved by probing.
+        void grow()
+        {
+            const size_t max_log_size = bits_required(vtbls.size()*2) + XTL_SEAL_MAX_LOG_INC;
+
+            for (bool collisions = true; collisions && log_size < max_log_size; )
+            {
+                ++log_size;
+                slots.assign(size_t(1) << log_size, slot());
+                collisions = false;
+
+                const size_t mask = slots.size() - 1;
+
+                for (size_t g = 0; g < vtbls.size(); ++g)
+                {
+                    size_t i = hash(vtbls[g]);
+
+                    for (; slots[i].vtbl != 0; i = (i + 1) & mask)
+                        collisions = true;
+
+                    slots[i].vtbl = vtbls[g];
+                    slots[i].id   = g;
+                }
+            }
+        }
+
+        static size_t bits_required(size_t n) noexcept
+        {
+            size_t k = 0;
+            while ((size_t(1) << k) < n) ++k;
+            return k;
+        }
+
+        size_t                log_size; ///< Log of the number of slots
+        std::vector<slot>     slots;    ///< Slots of the table
+        std::vector<intptr_t> vtbls;    ///< vtbl-pointer of each group
+        std::vector<size_t>   counts;   ///< Number of subjects in each group
+    };
+
+    template <typename InputIterator, typename Category>
+    static void reserve(std::vector<P>&, std::vector<size_t>&, InputIterator, InputIterator, Category) {}
+
+    template <typename RandomAccessIterator>
+    static void reserve(std::vector<P>& ptrs, std::vector<size_t>& ids, RandomAccessIterator first, RandomAccessIterator last, std::random_access_iterator_tag)
+    {
+        ptrs.reserve(last - first);
+        ids.reserve(last - first);
+    }
+
+    template <typename InputIterator, typename Category>
+    static void prefetch_ahead(InputIterator, InputIterator, Category) noexcept {}
+
+    /// Hints the processor to bring in the subject a few positions ahead as
+    /// its vtbl-pointer will be needed shortly
+    template <typename RandomAccessIterator>
+    static void prefetch_ahead(RandomAccessIterator first, RandomAccessIterator last, std::random_access_iterator_tag) noexcept
+    {
+        if (last - first > XTL_PREFETCH_DISTANCE)
+            XTL_PREFETCH(mch::addr(first[XTL_PREFETCH_DISTANCE]));
+    }
+
+    /// Storage of a vtbl_groups object. Buffers of destroyed objects are kept
+    /// per thread for reuse, as otherwise allocating and faulting in fresh
+    /// pages for every batch dominates the cost of grouping.
+    struct buffers
+    {
+        std::vector<P>      subjects; ///< Pointers to subjects ordered by groups
+        std::vector<P>      ptrs;     ///< Pointers to subjects in the order of the range
+        std::vector<size_t> ids;      ///< Group id of each subject in the order of the range
+    };
+
+    /// Maximum number of buffers kept per thread, which is the depth of nesting
+    /// of #MatchEach statements that is served without allocations.
+    static const size_t max_spare = 4;
+
+    static std::vector<buffers>& spare()
+    {
+        static thread_local std::vector<buffers> pool;
+        return pool;
+    }
+
+    static buffers acquire()
+    {
+        std::vector<buffers>& pool = spare();
+
+        if (pool.empty())
+            return buffers();
+
+        buffers result(std::move(pool.back()));
+        pool.pop_back();
+        result.subjects.clear();
+        result.ptrs.clear();
+        result.ids.clear();
+        return result;
+    }
+
+    buffers            store;  ///< Storage of subjects
+    std::vector<group> groups; ///< Groups of subjects in the order of their appearance
+};
+
+//------------------------------------------------------------------------------
+
+/// Groups subjects of a range by their vtbl-pointers for #MatchEach. Containers
+/// that already keep their objects grouped (\see grouped_vector) overload it.
+template <typename Range>
+inline vtbl_groups<decltype(mch::addr(*std::begin(std::declval<Range&>())))> group_by_vtbl(Range& range)
+{
+    return vtbl_groups<decltype(mch::addr(*std::begin(range)))>(std::begin(range), std::end(range));
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
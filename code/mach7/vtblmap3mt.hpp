@@ -82,6 +82,10 @@
 #include <cstring>
 #include "ptrtools.hpp"  // Helper functions to work with pointers
 #include "config.hpp"    // Various compiler/platform dependent macros
+#include "arena.hpp"     // Allocation of dispatch tables
+#include "switch_info.hpp" // Jump targets and offsets remembered by Match statements
+#include "epoch.hpp"     // Epoch-based reclamation of retired descriptors
+#include "vtblcache.hpp" // Per-thread cache in front of the shared data
 
 #if XTL_DUMP_PERFORMANCE
 // For print out purposes only
@@ -136,24 +140,38 @@ class vtblmap
 {
 private:
 
-    /// A helper data structure that is atomically swapped during updates to 
-    /// cache parameters k and l.
-    struct cache_descriptor
+    /// Type of the stored values, which is a pair of vtbl-pointer and T value.
+    struct stored_type
     {
-        /// Type of the stored values, which is a pair of vtbl-pointer and T value.
-        struct stored_type
-        {
-            stored_type(intptr_t v = 0) : vtbl(v), value() {}
+        stored_type(intptr_t v = 0) : vtbl(v), value() {}
+
+        std::atomic<intptr_t> vtbl;  ///< v-table pointer of the value
+        T                     value; ///< value associated with the v-table pointer vtbl
+    };
 
-            std::atomic<intptr_t> vtbl;  ///< v-table pointer of the value
-            T                     value; ///< value associated with the v-table pointer vtbl
+    /// A chunk of entries. Chunks are allocated every time the cache grows and
+    /// are linked into a list that all the subsequent descriptors share.
+    /// Chunks are only deallocated by the destructor of vtblmap, which is what
+    /// keeps references returned by get valid after the descriptor that was
+    /// used to obtain them has been reclaimed.
+    struct entries_chunk
+    {
+        entries_chunk(size_t n, entries_chunk* nxt) : next(nxt), begin(dispatch_arena::new_array<stored_type>(n)), end(begin+n) {}
+       ~entries_chunk() { dispatch_arena::delete_array(begin); }
 
-            /// Helper function to in-place construct stored_type inside uninitialized memory
-            void construct()    { new(this) stored_type(); }
-            /// Helper function to manually destroy stored_type
-            void destroy()      { this->~stored_type(); }
-        };
+        entries_chunk* const next;  ///< Older chunk
+        stored_type*   const begin; ///< First entry of the chunk
+        stored_type*   const end;   ///< One past the last entry of the chunk. \warning This value should never be dereferenced!
 
+    private:
+        entries_chunk(const entries_chunk&);            ///< No copy constructor
+        entries_chunk& operator=(const entries_chunk&); ///< No assignment operator
+    };
+
+    /// A helper data structure that is atomically swapped during updates to 
+    /// cache parameters k and l.
+    struct cache_descriptor
+    {
         /// Cache mask to access entries. Always cache_size-1 since cache_size is a power of 2
         /// \note We currently rely in constructors on this member be first in 
         ///       declaration order so that it is initialized first!
@@ -168,24 +186,10 @@ private:
         ///       changes to size of the cache, but only change to the optimal_shift.
         std::atomic<size_t> optimal_shift;
 
-        /// Total number of vtbl-pointers in the cache
-        std::atomic<size_t> used;
-
-        /// Lock-free programming does not have a reliable way so far to detect 
-        /// when old descriptor can be destroyed - not without garbage collection
-        /// at least. Every successful replacement of descriptor thus keeps a 
-        /// pointer to its predecessor. We need this also to be able to traverse
-        /// stored values to which cache entires are pointing to.
-        cache_descriptor*  predecessor;
-
-        /// This is the pointer to array of the entires that this descriptor own.
-        /// Descriptor manages not only own entries, but also the entries it 
-        /// inherited from its predecessor.
-        stored_type* const own_entries_begin;
-
-        /// This is the pointer to one past the end of the array pointed to by 
-        /// own_entries_begin. \warning This value should never be dereferenced!
-        stored_type* const own_entries_end;
+        /// The newest chunk of entries. The list of chunks it starts contains
+        /// exactly size() entries. Replaced descriptors are retired into the
+        /// epoch-based reclamation, which is why they may not own any entries.
+        entries_chunk* const entries;
 
         /// Variable-sized array with actual pointers to stored_type
         /// \warning: This must be the last member of this class!
@@ -195,13 +199,11 @@ private:
             #undef new
         #endif
 
-        /// We pass log_size as parameter and allocate enough space to have both
-        /// cache and owned entries be allocated together with the object to
-        /// improve cache locality.
-        void* operator new(size_t s, size_t cache_size, size_t elements_size)
+        /// We pass the size of the cache as parameter to allocate the cache 
+        /// together with the object to improve cache locality.
+        void* operator new(size_t, size_t cache_size)
         {
-            // FIX: Ensure proper alignment requirements
-            return ::new char[s + (cache_size-XTL_VARIABLE_SIZE_ARRAY)*sizeof(std::atomic<stored_type*>) + elements_size*sizeof(stored_type)];
+            return dispatch_arena::allocate(bytes(cache_size));
         }
 
         #if defined(DBG_NEW)
@@ -209,10 +211,20 @@ private:
         #endif
 
         /// We need to declare this placement delete operator since we overload new.
-        void operator delete(void* p, size_t, size_t) { ::delete(static_cast<char*>(p)); }
+        void operator delete(void* p, size_t cache_size) { dispatch_arena::deallocate(p, bytes(cache_size)); }
+
+        /// A delete expression does not know the size of the object. Use #destroy instead.
+        void operator delete(void*) XTL_DELETED;
+
+        /// Number of bytes taken by an object with the given number of slots
+        static size_t bytes(size_t n) { return sizeof(cache_descriptor) + (n-XTL_VARIABLE_SIZE_ARRAY)*sizeof(std::atomic<stored_type*>); }
 
-        /// We also provide non-placement delete operator since it doesn't really depend on extra arguments.
-        void operator delete(void* p)                 { ::delete(static_cast<char*>(p)); }
+        /// Destroys and deallocates an object allocated with the above operator new
+        static void destroy(void* p) noexcept
+        {
+            if (cache_descriptor* d = static_cast<cache_descriptor*>(p))
+                dispatch_arena::destroy(d, bytes(d->size()));
+        }
 
         /// Creates new cache_descriptor based on parameters k and l of the hashing function
         cache_descriptor(
@@ -221,69 +233,42 @@ private:
         ) :
             cache_mask( (1<<log_size) - 1 ),
             optimal_shift(shift),
-            used(0),
-            predecessor(nullptr),
-            own_entries_begin(reinterpret_cast<stored_type*>(&cache[0]+(1<<log_size))),
-            own_entries_end(own_entries_begin + (1<<log_size))
+            entries(new entries_chunk(1<<log_size, nullptr))
         {
             // Initialize pointers from cache to newly allocated cache entries
             for (size_t i = 0; i <= cache_mask; ++i)
-            {
-                own_entries_begin[i].construct();  // Initialize uninitialized memory
-                cache[i] = &own_entries_begin[i];  // Make cache point to actual entries
-            }
+                cache[i] = &entries->begin[i];  // Make cache point to actual entries
         }
 
         /// Creates new cache_descriptor based on parameters k and l of the 
         /// hashing function as well as a reference to the cache_descriptor it
         /// is going to replace.
         cache_descriptor(
-            const size_t      log_size, ///< Parameter k of the cache - the log of the size of the cache                
-            const size_t      shift,    ///< Parameter l of the cache - number of irrelevant bits on the right to remove
-            cache_descriptor& old       ///< cache_descriptor we will supposedly replace
+            const size_t            log_size, ///< Parameter k of the cache - the log of the size of the cache                
+            const size_t            shift,    ///< Parameter l of the cache - number of irrelevant bits on the right to remove
+            const cache_descriptor& old       ///< cache_descriptor we will supposedly replace
         ) :
             cache_mask( (1<<log_size) - 1 ),
             optimal_shift(shift),
-            used(old.size()),
-            predecessor(&old),
-            own_entries_begin(reinterpret_cast<stored_type*>(&cache[0]+(1<<log_size))),
-            own_entries_end(own_entries_begin + (cache_mask - old.cache_mask))
+            entries(new entries_chunk(cache_mask - old.cache_mask, old.entries))
         {
             XTL_ASSERT(cache_mask > old.cache_mask);   // Since we are going to inherit all its existing elements
-            XTL_ASSERT(old.used.load() == old.size()); // Since we replace descriptors only when they are full
-
-            // Initialize remaining pointers from cache to newly allocated cache entries
-            for (size_t j = 0, i = old.size(); i <= cache_mask; ++i, ++j)
-            {
-                own_entries_begin[j].construct();  // Initialize uninitialized memory
-                cache[i] = &own_entries_begin[j];  // Make cache point to actual entries
-            }
 
-            // Initialize cache pointers to cache entries from old caches.
+            // Initialize cache pointers to all the entries, including those 
+            // inherited from the old descriptor.
             // NOTE: we have to initialize it to addresses of actual entries
             //       instead of just copying the content of old cache because
             //       the content of cache may still be changing by other threads
             //       making us see some values twice or none times.
-            for (cache_descriptor* dsc = &old; dsc; dsc = dsc->predecessor)
-            {
-                for (size_t j = 0, i = dsc->predecessor ? dsc->predecessor->size() : 0; i <= dsc->cache_mask; ++i, ++j)
-                    cache[i] = &dsc->own_entries_begin[j];  // Make cache point to actual entries
-            }
-        }
+            size_t i = 0;
 
-        /// Deallocates memory used for elements.
-        /// \note Lock-free programming practices do not have reliable way of 
-        ///       knowing when an old atomic descriptor can be destroyed.
-        ~cache_descriptor()
-        {
-            for (stored_type* p = own_entries_begin; p != own_entries_end; ++p)
-                p->destroy();
+            for (entries_chunk* c = entries; c; c = c->next)
+                for (stored_type* p = c->begin; p != c->end; ++p)
+                    cache[i++] = p;  // Make cache point to actual entries
 
-            if (predecessor)
-                delete predecessor;
+            XTL_ASSERT(i == size());
         }
 
-        bool is_full() const { return used > cache_mask; } ///< Checks whether cache is full
         size_t  size() const { return cache_mask+1; }      ///< Number of entries in cache
 
         const stored_type* operator[](intptr_t vtbl) const { return cache[(vtbl>>optimal_shift) & cache_mask]; }
@@ -309,11 +294,16 @@ private:
             return nullptr;
         }
 
+        /// Checks whether vtbl is among the entries and if so, waits until the
+        /// pointer to it reappears in the cache.
+        /// \warning Must not be used to look for vacant entries (vtbl == 0) as
+        ///          the entry found might get occupied while we wait for it.
         inline stored_type* thorough_find(const intptr_t vtbl, std::atomic<stored_type*>*& pce) noexcept
         {
-            // Search own storage first
-            for (cache_descriptor* dsc = this; dsc; dsc = dsc->predecessor)
-                for (stored_type* p = dsc->own_entries_begin; p != dsc->own_entries_end; ++p)
+            XTL_ASSERT(vtbl); // Only occupied entries are guaranteed to reappear in cache
+
+            for (entries_chunk* c = entries; c; c = c->next)
+                for (stored_type* p = c->begin; p != c->end; ++p)
                     if (p->vtbl == vtbl)
                     {
                         // Loop infinitely till we find it in cache
@@ -333,16 +323,14 @@ private:
             //      consideration
             intptr_t diff = 0;
 
-            for (const cache_descriptor* dsc = this; dsc; dsc = dsc->predecessor)
-            {
-                // Compute bits in which existing vtbl, including the newly added one, differ
-                for (const stored_type* p = dsc->own_entries_begin; p != dsc->own_entries_end; ++p)
+            // Compute bits in which existing vtbl, including the newly added one, differ
+            for (const entries_chunk* c = entries; c; c = c->next)
+                for (const stored_type* p = c->begin; p != c->end; ++p)
                     if (intptr_t vtbl = p->vtbl)
                     {
                         diff |= prev ^ vtbl;
                         prev = vtbl;
                     }
-            }
 
             return diff;
         }
@@ -371,7 +359,8 @@ private:
         }
 
         /// Main function that will be used to get a reference to the stored element. 
-        inline stored_type* get(const intptr_t vtbl) noexcept
+        /// \returns nullptr when there are no vacant entries left
+        inline stored_type* get(const intptr_t vtbl, std::atomic<size_t>& used) noexcept
         {
             XTL_ASSERT(vtbl); // Must be a valid vtbl pointer
 
@@ -429,23 +418,24 @@ private:
                 }
                 else // vtbl is not in the cache
                 {
-                    while (!is_full())
+                    // NOTE: We only look for vacant entries in the cache. An 
+                    //       entry temporarily pulled out of it by another 
+                    //       thread is not worth waiting for: the caller will 
+                    //       simply retry through update.
+                    while (used <= cache_mask)
                     {
                         std::atomic<stored_type*>* pce2;
                         stored_type*  st2 = eager_find(0,pce2);
                             
-                        if (st2 || (st2 = thorough_find(0,pce2))) // vtbl is already in the cache
-                        {
-                            XTL_ASSERT(pce2);
-                            XTL_ASSERT(pce2->load()); // NOTE: stronger *pce2 == st2 may not necessarily hold anymore
+                        if (!st2)
+                            break;
 
-                            std::intptr_t null_vtbl = 0;
+                        std::intptr_t null_vtbl = 0;
 
-                            if (st2->vtbl.compare_exchange_strong(null_vtbl, vtbl)) // essentially: ce->vtbl = vtbl;
-                            {
-                                ++used;
-                                return st2;
-                            }
+                        if (st2->vtbl.compare_exchange_strong(null_vtbl, vtbl)) // essentially: ce->vtbl = vtbl;
+                        {
+                            ++used;
+                            return st2;
                         }
                     }
 
@@ -456,7 +446,13 @@ private:
 
             return st1;
         }
-    };
+
+    private:
+
+        cache_descriptor(const cache_descriptor&);            ///< No copy constructor
+        cache_descriptor& operator=(const cache_descriptor&); ///< No assignment operator
+
+    }; // of class cache_descriptor
 
 public:
     
@@ -465,7 +461,8 @@ public:
         #undef new
     #endif
     vtblmap(const char* fl, size_t ln, const char* fn, const vtbl_count_t expected_size = min_expected_size) : 
-        descriptor(new(1<<req_bits(expected_size-1),1<<req_bits(expected_size-1)) cache_descriptor(req_bits(expected_size-1))),
+        descriptor(new(1<<req_bits(expected_size-1)) cache_descriptor(req_bits(expected_size-1))),
+        used(0),
         last_table_size(0),
         collisions_before_update(initial_collisions_before_update),
         file(fl), 
@@ -486,7 +483,9 @@ public:
         #undef new
     #endif
     vtblmap(const vtbl_count_t expected_size = min_expected_size) :
-        descriptor(new(1<<req_bits(expected_size-1),1<<req_bits(expected_size-1)) cache_descriptor(req_bits(expected_size-1))),
+        descriptor(new(1<<req_bits(expected_size-1)) cache_descriptor(req_bits(expected_size-1))),
+        used(0),
+        last_table_size(0),
         collisions_before_update(initial_collisions_before_update)
         XTL_DUMP_PERFORMANCE_ONLY(,file("unspecified"), line(0), func("unspecified"), updates(0), clauses(expected_size), hits(0), misses(0), collisions(0))
     {}
@@ -497,7 +496,19 @@ public:
    ~vtblmap()
     {
         XTL_DUMP_PERFORMANCE_ONLY(std::clog << *this << std::endl);
-        delete descriptor.load(); // FIX: in lock free?
+
+        // Descriptors replaced earlier have been retired and do not own any 
+        // entries, so we only have to deallocate the current one and the chunks.
+        cache_descriptor* dsc = descriptor.load();
+
+        for (entries_chunk* c = dsc->entries; c; )
+        {
+            entries_chunk* next = c->next;
+            delete c;
+            c = next;
+        }
+
+        cache_descriptor::destroy(dsc);
     }
 
     /// This is the main function to get the value of type T associated with
@@ -507,7 +518,40 @@ public:
     ///       may take address or change the value of the cell!
     inline T& get(const void* p) noexcept
     {
-        typedef typename cache_descriptor::stored_type stored_type;
+    #if XTL_THREAD_CACHE_LOG_SIZE
+        const intptr_t key[1] = {*reinterpret_cast<const intptr_t*>(p)};
+
+        if (T* cached = thread_cache::find(owner, key))
+            return *cached; // Repeated hit served without touching anything shared
+
+        T& result = shared_get(p);
+        thread_cache::store(owner, key, result);
+        return result;
+    #else
+        return shared_get(p);
+    #endif
+    }
+
+    /// A function that gets called when the cache is either too inefficient or full.
+    T& update(intptr_t vtbl);
+
+#if XTL_DUMP_PERFORMANCE
+    std::ostream& operator>>(std::ostream& os) const;
+    friend std::ostream& operator<<(std::ostream& os, const vtblmap& m) { return m >> os; }
+#endif
+
+private:
+
+#if XTL_THREAD_CACHE_LOG_SIZE
+    /// Per-thread cache shared by all the maps of this type
+    typedef thread_vtbl_cache<1,T> thread_cache;
+#endif
+
+    /// Looks up the value associated with the vtbl of a given pointer in the 
+    /// data shared by all the threads, updating it when needed.
+    inline T& shared_get(const void* p) noexcept
+    {
+        epoch_domain<>::enter(); // Announce the epoch this thread is in before it loads the descriptor
 
         cache_descriptor* dsc = descriptor; // Load atomic value for this thread since it may change
 
@@ -522,41 +566,50 @@ public:
 
         if (XTL_UNLIKELY(cur_vtbl != vtbl))
         {
-            XTL_DUMP_PERFORMANCE_ONLY(++misses);
-            XTL_DUMP_PERFORMANCE_ONLY(if (cur_vtbl) ++collisions);
-
-            if (dsc->is_full()                            // No entries left for possibly new vtbl in the cache
-                || (cur_vtbl                              // Collision - the entry for vtbl is already occupied
-                && --collisions_before_update <= 0        // We had sufficiently many collisions to justify call
-                && dsc->used != last_table_size))         // There was at least one vtbl added since last update
-                return update(vtbl);                      // try to rearrange cache
-
-            // Find entry with our vtbl and update cache if needed
-            if (stored_type* st = dsc->get(vtbl))
-                return st->value;
-            else
-                return update(vtbl); // call to get will fail only when the cache is full
+            T& result = miss(dsc,vtbl,cur_vtbl);
+            epoch_domain<>::quiescent(); // This thread holds no descriptor pointers past this point
+            return result;
         }
         else
         {
             XTL_DUMP_PERFORMANCE_ONLY(++hits);
+            epoch_domain<>::exit();
             return st->value;
         }
     }
 
-    /// A function that gets called when the cache is either too inefficient or full.
-    T& update(intptr_t vtbl);
+    /// Slow path of #get taken out of line to keep the hit path small
+    T& miss(cache_descriptor* dsc, intptr_t vtbl, intptr_t cur_vtbl) noexcept
+    {
+        XTL_DUMP_PERFORMANCE_ONLY(++misses);
+        XTL_DUMP_PERFORMANCE_ONLY(if (cur_vtbl) ++collisions);
 
-#if XTL_DUMP_PERFORMANCE
-    std::ostream& operator>>(std::ostream& os) const;
-    friend std::ostream& operator<<(std::ostream& os, const vtblmap& m) { return m >> os; }
-#endif
+        if (used > dsc->cache_mask                    // No entries left for possibly new vtbl in the cache
+            || (cur_vtbl                              // Collision - the entry for vtbl is already occupied
+            && --collisions_before_update <= 0        // We had sufficiently many collisions to justify call
+            && used != last_table_size))              // There was at least one vtbl added since last update
+            return update(vtbl);                      // try to rearrange cache
 
-private:
+        // Find entry with our vtbl and update cache if needed
+        if (stored_type* st = dsc->get(vtbl,used))
+            return st->value;
+        else
+            return update(vtbl); // call to get will fail only when the cache is full
+    }
+
+#if XTL_THREAD_CACHE_LOG_SIZE
+    /// Unique id of this map that tags its values in the per-thread cache
+    const size_t owner = thread_cache::new_owner();
+#endif
 
     /// Cached mappings of vtbl to some indecies
     std::atomic<cache_descriptor*> descriptor;
 
+    /// Total number of vtbl-pointers in all the entries. This is not a property
+    /// of a descriptor since entries are shared among descriptors and can be 
+    /// claimed through any of them.
+    std::atomic<size_t> used;
+
     /// Memoized table.size() during last cache rearranging
     std::atomic<size_t> last_table_size;
 
@@ -596,10 +649,11 @@ ReStart:
 
     XTL_ASSERT(dsc); // Allocated in constructor, deallocated in destructor, atomically replaced
 
+    const size_t u  = used;                                           // number of vtbls seen so far
     bit_offset_t k  = bit_offset_t(req_bits(dsc->cache_mask));        // current log_size
     size_t       l  = dsc->optimal_shift;                             // current optimal_shift
     intptr_t   diff = dsc->vtbl_mask(vtbl);                           // bitmask of bits in which vtbl pointers differ
-    bit_offset_t n  = bit_offset_t(req_bits(dsc->used));              // needed  log_size
+    bit_offset_t n  = bit_offset_t(req_bits(u));                      // needed  log_size
     bit_offset_t m  = bit_offset_t(req_bits(diff));                   // highest bit in which vtbls differ
     bit_offset_t z  = bit_offset_t(trailing_zeros(static_cast<unsigned int>(diff))); // amount of lowest bits in which vtbls do not differ
     bit_offset_t l1 = std::min(max_log_size,std::max(k,n));                          // lower bound for log_size iteration
@@ -626,8 +680,8 @@ ReStart:
             XTL_BIT_SET(cache_histogram, (vtbl >> j) & cache_mask);               // Mark the entry for new vtbl
 
             // Iterate over vtbl in old cache and see where they are mapped with log size i and offset j
-            for (cache_descriptor* d = dsc; d; d = d->predecessor)
-                for (cache_descriptor::stored_type* p = d->own_entries_begin; p != d->own_entries_end; ++p)
+            for (entries_chunk* c = dsc->entries; c; c = c->next)
+                for (stored_type* p = c->begin; p != c->end; ++p)
                     if (intptr_t vt = p->vtbl)
                         XTL_BIT_SET(cache_histogram, (vt >> j) & cache_mask); // Mark the entry for each vtbl
 
@@ -645,7 +699,7 @@ ReStart:
                 zo = j;
             }
 
-            if (entries == dsc->used+1)
+            if (entries == u+1)
             {
                 // We found size and offset without conflicts, exit both loops
                 i = l2+1; // to exit both for loops
@@ -663,20 +717,25 @@ ReStart:
         #if defined(DBG_NEW)
             #undef new
         #endif
-        cache_descriptor* new_dsc = new(1<<no,(1<<no)-dsc->cache_mask-1) cache_descriptor(no,zo,*dsc);
+        cache_descriptor* new_dsc = new(1<<no) cache_descriptor(no,zo,*dsc);
         #if defined(DBG_NEW)
             #define new DBG_NEW
         #endif
 
         if (descriptor.compare_exchange_strong(dsc, new_dsc)) // descriptor = new_dsc;
         {
-            // We successfully updated descriptor
-            dsc = descriptor;
+            // We successfully updated descriptor. Other threads might still
+            // be using the old one, so we let reclamation decide when to delete it.
+            epoch_domain<>::retire(dsc, &cache_descriptor::destroy);
+            dsc = new_dsc;
         }
         else
         {
-            // Someone else has replaced descriptor in the mean time
-            delete new_dsc;
+            // Someone else has replaced descriptor in the mean time.
+            // new_dsc has never been seen by other threads, but its newest
+            // chunk is the only one it owns.
+            delete new_dsc->entries;
+            cache_descriptor::destroy(new_dsc);
             // dsc now holds the new value of descriptor
         }
     }
@@ -684,10 +743,10 @@ ReStart:
     if (dsc->optimal_shift != zo)
         dsc->optimal_shift.compare_exchange_strong(l, zo);
 
-    if (typename cache_descriptor::stored_type* res = dsc->get(vtbl))
+    if (stored_type* res = dsc->get(vtbl,used))
     {
         XTL_ASSERT(res && res->vtbl == vtbl); // We have ensured enough space, so no need to check this explicitly
-        last_table_size = dsc->used.load();   // Update memoized value
+        last_table_size = used.load();        // Update memoized value
 #if XTL_DUMP_PERFORMANCE
         std::clog << "After" << std::endl;
         *this >> std::clog;       
@@ -727,7 +786,7 @@ std::ostream& vtblmap<T>::operator>>(std::ostream& os) const
 
     XTL_ASSERT(dsc); // Allocated in constructor, deallocated in destructor, atomically replaced
 
-    size_t vtbl_count = dsc->used;
+    size_t vtbl_count = used;
     size_t log_size   = req_bits(dsc->cache_mask);
     size_t cache_size = (1<<log_size);
 
@@ -910,8 +969,8 @@ std::ostream& vtblmap<T>::operator>>(std::ostream& os) const
 /// required offset with the vtbl-pointer.
 struct type_switch_info
 {
-    std::ptrdiff_t offset; ///< Required this-pointer offset to the source sub-object
-    std::size_t    target; ///< Case label of the jump target of Match statement
+    switch_offset  offset; ///< Required this-pointer offset to the source sub-object
+    switch_target  target; ///< Case label of the jump target of Match statement
 };
 
 //------------------------------------------------------------------------------
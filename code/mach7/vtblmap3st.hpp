@@ -81,6 +81,8 @@
 #include <cstring>
 #include "ptrtools.hpp"  // Helper functions to work with pointers
 #include "config.hpp"    // Various compiler/platform dependent macros
+#include "arena.hpp"     // Allocation of dispatch tables
+#include "switch_info.hpp" // Jump targets and offsets remembered by Match statements
 
 #if XTL_DUMP_PERFORMANCE
 // For print out purposes only
@@ -175,10 +177,9 @@ private:
             #undef new
         #endif
 
-        void* operator new(size_t s, size_t log_size)
+        void* operator new(size_t, size_t log_size)
         {
-            // FIX: Ensure proper alignment requirements
-            return ::new char[s + ((1<<log_size)-XTL_VARIABLE_SIZE_ARRAY)*sizeof(stored_type*)];
+            return dispatch_arena::allocate(bytes(size_t(1)<<log_size));
         }
 
         #if defined(DBG_NEW)
@@ -186,10 +187,20 @@ private:
         #endif
 
         /// We need to declare this placement delete operator since we overload new.
-        void operator delete(void* p, size_t) { ::delete(static_cast<char*>(p)); } // We cast to char* to avoid warning on deleting void*, which is undefined
+        void operator delete(void* p, size_t log_size) { dispatch_arena::deallocate(p, bytes(size_t(1)<<log_size)); }
 
-        /// We also provide non-placement delete operator since it doesn't really depend on extra arguments.
-        void operator delete(void* p)         { ::delete(static_cast<char*>(p)); } // We cast to char* to avoid warning on deleting void*, which is undefined
+        /// A delete expression does not know the size of the object. Use #destroy instead.
+        void operator delete(void*) XTL_DELETED;
+
+        /// Number of bytes taken by an object with the given number of slots
+        static size_t bytes(size_t n) { return sizeof(cache_descriptor) + (n-XTL_VARIABLE_SIZE_ARRAY)*sizeof(stored_type*); }
+
+        /// Destroys and deallocates an object allocated with the above operator new
+        static void destroy(void* p) noexcept
+        {
+            if (cache_descriptor* d = static_cast<cache_descriptor*>(p))
+                dispatch_arena::destroy(d, bytes(d->size()));
+        }
 
         /// Creates new cache_descriptor based on parameters k and l of the hashing function
         cache_descriptor(
@@ -202,7 +213,7 @@ private:
         {
             // Allocate all cache entries in one chunk for better cache performance.
             // Only allocate the difference from need and already present in old ones
-            stored_type* cache_entries = new stored_type[1<<log_size];
+            stored_type* cache_entries = dispatch_arena::new_array<stored_type>(1<<log_size);
 
             // Initialize pointers from cache to newly allocated cache entries
             for (size_t i = 0; i <= cache_mask; ++i)
@@ -236,7 +247,7 @@ private:
             {
                 // Allocate all cache entries in one chunk for better cache performance.
                 // Only allocate the difference from need and already present in old ones
-                stored_type* cache_entries = new stored_type[cache_mask - old.cache_mask];
+                stored_type* cache_entries = dispatch_arena::new_array<stored_type>(cache_mask - old.cache_mask);
 
                 // Initialize remaining pointers from cache to newly allocated cache entries
                 for (size_t j = 0; i <= cache_mask; ++i, ++j)
@@ -257,7 +268,7 @@ private:
                 {
                     size_t j = i+1;
                     for (; j <= cache_mask && intptr_t(cache[j])-intptr_t(cache[j-1]) == sizeof(stored_type); ++j);
-                    delete[] cache[i];
+                    dispatch_arena::delete_array(cache[i]);
                     i = j;
                 }
                 else
@@ -359,7 +370,7 @@ public:
    ~vtblmap()
     {
         XTL_DUMP_PERFORMANCE_ONLY(std::clog << *this << std::endl);
-        delete descriptor;
+        cache_descriptor::destroy(descriptor);
     }
 
     /// This is the main function to get the value of type T associated with
@@ -534,7 +545,7 @@ T& vtblmap<T>::update(intptr_t vtbl)
         #if defined(DBG_NEW)
             #define new DBG_NEW
         #endif
-        delete old;
+        cache_descriptor::destroy(old);
     }
 
 //#if XTL_DUMP_PERFORMANCE
@@ -755,8 +766,8 @@ std::ostream& vtblmap<T>::operator>>(std::ostream& os) const
 /// required offset with the vtbl-pointer.
 struct type_switch_info
 {
-    std::ptrdiff_t offset; ///< Required this-pointer offset to the source sub-object
-    std::size_t    target; ///< Case label of the jump target of Match statement
+    switch_offset  offset; ///< Required this-pointer offset to the source sub-object
+    switch_target  target; ///< Case label of the jump target of Match statement
 };
 
 //------------------------------------------------------------------------------
@@ -81,8 +81,18 @@
 #include <cstring>
 #include <cstdarg>
 #include "ptrtools.hpp"  // Helper functions to work with pointers
+#include "metatools.hpp" // Registry of objects that can be warmed up ahead of time
+#include "perfect_hash.hpp" // Collision-free hashing of frozen maps
+#include "arena.hpp"     // Allocation of dispatch tables
+#include "profile.hpp"   // Profile-guided preparation of dispatch tables
+#include "stats.hpp"     // Registry of dispatch statistics
+#include "switch_info.hpp" // Jump targets and offsets remembered by Match statements
 #include <xtl/xtl.hpp>   // XTL subtyping definitions
 
+#if XTL_USE_SIMD && defined(__SSE2__)
+#include <immintrin.h>   // SSE2/AVX2 comparisons of vtbl-pointer tuples
+#endif
+
 #if XTL_DUMP_PERFORMANCE
 // For print out purposes only
 #include <array>
@@ -168,6 +178,7 @@ inline void vtbl_bin_print(const intptr_t (&vtbl)[N], std::ostream& os)
 template <size_t N>
 inline void vtbl_class_print(const intptr_t (&vtbl)[N], std::ostream& os)
 {
+    XTL_UNUSED(vtbl); // Only used by the commented-out printing of class names
     for (size_t s = 0; s < N; s++)
         os << (s ? " \t| " : "") 
          /*<< vtbl_typeid(vtbl[s]).name()*/;
@@ -228,6 +239,47 @@ inline bool array_equal(const T (&a)[1], const T (&b)[1])
 
 //------------------------------------------------------------------------------
 
+#if XTL_USE_SIMD && defined(__SSE2__) && (defined(__x86_64__) || defined(_M_X64))
+
+// Vectorized comparisons of vtbl-pointer tuples: all N pointers are compared
+// in a single instruction instead of the early-exit loop above.
+
+inline bool array_equal(const intptr_t (&a)[2], const intptr_t (&b)[2])
+{
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(x,y)) == 0xFFFF;
+}
+
+inline bool array_equal(const intptr_t (&a)[3], const intptr_t (&b)[3])
+{
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(x,y)) == 0xFFFF && a[2] == b[2];
+}
+
+#if defined(__AVX2__)
+inline bool array_equal(const intptr_t (&a)[4], const intptr_t (&b)[4])
+{
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi64(x,y)) == -1;
+}
+#else
+inline bool array_equal(const intptr_t (&a)[4], const intptr_t (&b)[4])
+{
+    const __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    const __m128i y0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    const __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+2));
+    const __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b+2));
+    return _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi32(x0,y0),_mm_cmpeq_epi32(x1,y1))) == 0xFFFF;
+}
+#endif
+
+#endif // XTL_USE_SIMD && __SSE2__ && x64
+
+//------------------------------------------------------------------------------
+
 template <typename T, size_t N>
 inline void array_copy(const T (&src)[N], T (&tgt)[N])
 {
@@ -250,11 +302,12 @@ inline void array_fill(const T (&a)[N], const T& v)
 template <size_t N, typename T>
 struct stored_type_for
 {
-    stored_type_for() : XTL_VTBL_HASHING(hash(0),) vtbl(), value() {}
+    stored_type_for() : XTL_VTBL_HASHING(hash(0),) vtbl(), value() XTL_USE_VTBL_FREQUENCY_ONLY(, hits(0)) {}
 
     XTL_VTBL_HASHING(intptr_t hash;)     ///< hash of vtbl[i] for comparing vtbl for large N (> 2)
     intptr_t vtbl[N];  ///< v-table pointers of the value
     T        value;    ///< value associated with the v-table pointers vtbl[]
+    XTL_USE_VTBL_FREQUENCY_ONLY(size_t hits;) ///< Number of requests for vtbl[], including those expected from the dispatch profile
 
     /// Helper function to in-place construct stored_type inside uninitialized memory
     void construct()    { new(this) stored_type_for(); }
@@ -279,10 +332,11 @@ struct stored_type_for
 template <typename T>
 struct stored_type_for<1,T>
 {
-    stored_type_for() : vtbl(), value() {}
+    stored_type_for() : vtbl(), value() XTL_USE_VTBL_FREQUENCY_ONLY(, hits(0)) {}
 
     intptr_t vtbl[1];  ///< v-table pointers of the value
     T        value;    ///< value associated with the v-table pointers vtbl[]
+    XTL_USE_VTBL_FREQUENCY_ONLY(size_t hits;) ///< Number of requests for vtbl[], including those expected from the dispatch profile
 
     /// Helper function to in-place construct stored_type inside uninitialized memory
     void construct()    { new(this) stored_type_for(); }
@@ -302,6 +356,16 @@ struct stored_type_for<1,T>
 
 //------------------------------------------------------------------------------
 
+/// Class for efficient mapping of N vtbl-pointers to a value of type T.
+/// \note The multi-threaded version of the class is defined in vtblmap4mt.hpp
+///       and the version with inline entries in vtblmap4inl.hpp
+template <size_t N, typename T> class vtbl_map;
+
+//------------------------------------------------------------------------------
+
+#if !XTL_MULTI_THREADING && !XTL_INLINE_VTBL_ENTRIES
+/// Single-threaded version of the class for efficient mapping of N vtbl-pointers
+/// to a value of type T.
 template <size_t N, typename T>
 class vtbl_map
 {
@@ -336,10 +400,9 @@ private:
             #undef new
         #endif
 
-        void* operator new(size_t s, size_t log_size)
+        void* operator new(size_t, size_t log_size)
         {
-            // FIX: Ensure proper alignment requirements
-            return ::new char[s + ((1<<log_size)-XTL_VARIABLE_SIZE_ARRAY)*sizeof(stored_type*)];
+            return dispatch_arena::allocate(bytes(size_t(1)<<log_size));
         }
 
         #if defined(DBG_NEW)
@@ -347,10 +410,20 @@ private:
         #endif
 
         /// We need to declare this placement delete operator since we overload new.
-        void operator delete(void* p, size_t) { ::delete[](static_cast<char*>(p)); } // We cast to char* to avoid warning on deleting void*, which is undefined
+        void operator delete(void* p, size_t log_size) { dispatch_arena::deallocate(p, bytes(size_t(1)<<log_size)); }
+
+        /// A delete expression does not know the size of the object. Use #destroy instead.
+        void operator delete(void*) XTL_DELETED;
 
-        /// We also provide non-placement delete operator since it doesn't really depend on extra arguments.
-        void operator delete(void* p)         { ::delete[](static_cast<char*>(p)); } // We cast to char* to avoid warning on deleting void*, which is undefined
+        /// Number of bytes taken by an object with the given number of slots
+        static size_t bytes(size_t n) { return sizeof(cache_descriptor) + (n-XTL_VARIABLE_SIZE_ARRAY)*sizeof(stored_type*); }
+
+        /// Destroys and deallocates an object allocated with the above operator new
+        static void destroy(void* p) noexcept
+        {
+            if (cache_descriptor* d = static_cast<cache_descriptor*>(p))
+                dispatch_arena::destroy(d, bytes(d->size()));
+        }
 
         /// Creates new cache_descriptor based on parameters k and l of the hashing function
         cache_descriptor(
@@ -439,6 +512,9 @@ public:
         last_table_size(0),
         collisions_before_update(initial_collisions_before_update),
         prev_collisions_before_update(initial_collisions_before_update),
+        frozen(false),
+        sealed(nullptr),
+        XTL_USE_VTBL_FREQUENCY_ONLY(expected_hits(nullptr),)
         file(fl), 
         line(ln),
         func(fn),
@@ -446,7 +522,10 @@ public:
         hits(0),
         misses(0),
         collisions(0)
-    {}
+    {
+        register_for_warm_up();
+        register_for_statistics();
+    }
     #if defined(DBG_NEW)
         #define new DBG_NEW
     #endif
@@ -460,9 +539,15 @@ public:
         case_clauses(num_clauses),
         last_table_size(0),
         collisions_before_update(initial_collisions_before_update),
-        prev_collisions_before_update(initial_collisions_before_update)
+        prev_collisions_before_update(initial_collisions_before_update),
+        frozen(false),
+        sealed(nullptr)
+        XTL_USE_VTBL_FREQUENCY_ONLY(, expected_hits(nullptr))
         XTL_DUMP_PERFORMANCE_ONLY(,file("unspecified"), line(0), func("unspecified"), updates(0), hits(0), misses(0), collisions(0))
-    {}
+    {
+        register_for_warm_up();
+        XTL_DUMP_PERFORMANCE_ONLY(register_for_statistics());
+    }
     #if defined(DBG_NEW)
         #define new DBG_NEW
     #endif
@@ -470,7 +555,11 @@ public:
    ~vtbl_map()
     {
         XTL_DUMP_PERFORMANCE_ONLY(std::clog << *this << std::endl);
-        delete descriptor;
+        XTL_DUMP_PERFORMANCE_ONLY(stats_registry::remove(statistics));
+        warm_up_registry::remove(registration);
+        XTL_USE_VTBL_FREQUENCY_ONLY(if (expected_hits) profile_registry::remove(profiling));
+        sealed_table<N,typename cache_descriptor::stored_type>::destroy(sealed);
+        cache_descriptor::destroy(descriptor);
     }
 
     size_t memory_used() const 
@@ -515,24 +604,39 @@ public:
         if (XTL_LIKELY(ce->is_for(vtbl)))
         {
             XTL_DUMP_PERFORMANCE_ONLY(++hits);
+            XTL_USE_VTBL_FREQUENCY_ONLY(++ce->hits);
             return ce->value;
         }
         else
         {
+            if (sealed) // Checked only on collisions, so that maps that are never sealed keep their hit path
+            {
+                typename cache_descriptor::stored_type* const se = sealed->find(vtbl); // The only place it can be
+
+                if (XTL_LIKELY(se->is_for(vtbl)))
+                {
+                    XTL_DUMP_PERFORMANCE_ONLY(++hits);
+                    XTL_USE_VTBL_FREQUENCY_ONLY(++se->hits);
+                    return se->value;
+                }
+            }
+
             XTL_DUMP_PERFORMANCE_ONLY(++misses);
             XTL_DUMP_PERFORMANCE_ONLY(if (ce->occupied()) ++collisions);
 
             if (XTL_UNLIKELY(
                 descriptor->is_full()                     // No entries left for possibly new vtbl in the cache
                 || (ce->occupied()                        // Collision - the entry for vtbl is already occupied
+                && !frozen                                // We were not asked to keep current arrangement
                 && --collisions_before_update <= 0        // We had sufficiently many collisions to justify call
                 && descriptor->used != last_table_size))) // There was at least one vtbl added since last update
                 return update(vtbl);                      // try to rearrange cache
 
             // Try to find entry with our vtbl and swap it with where it is expected to be
-            descriptor->get(vtbl,j); // This will bring correct pointer into ce
-            XTL_ASSERT(ce->is_for(vtbl));
-            return ce->value;
+            typename cache_descriptor::stored_type* e = descriptor->get(vtbl,j); // This will normally bring correct pointer into ce
+            XTL_ASSERT(e && e->is_for(vtbl));
+            XTL_USE_VTBL_FREQUENCY_ONLY(count_miss(*e));
+            return e->value;
         }
     }
 
@@ -613,13 +717,209 @@ public:
     /// A function that gets called when the cache is either too inefficient or full.
     T& update(const intptr_t (&vtbl)[N]);
 
+    /// Seeds the map with all the N-tuples of the given vtbl-pointers, so that
+    /// it reaches its final size and hashing parameters before it is used.
+    /// \note Values associated with the seeded tuples are default-constructed.
+    void warm_up(const intptr_t* vtbls, size_t n)
+    {
+        if (!n)
+            return;
+
+        size_t   idx[N] = {};
+        intptr_t vtbl[N];
+
+        for (;;)
+        {
+            for (size_t i = 0; i < N; ++i)
+                vtbl[i] = vtbls[idx[i]];
+
+            get(vtbl);
+
+            // Advance to the next tuple
+            size_t i = 0;
+
+            while (i < N && ++idx[i] == n)
+                idx[i++] = 0;
+
+            if (i == N)
+                break;
+        }
+    }
+
+    /// Rearranges the map one last time and stops it from rearranging itself
+    /// on collisions afterwards. The map still grows when it runs out of space.
+    /// \returns Whether the map was also sealed (see #seal)
+    bool freeze()
+    {
+        for (size_t i = 0; i <= descriptor->cache_mask; ++i)
+            if (descriptor->cache[i]->occupied())
+            {
+                intptr_t vtbl[N];
+                array_copy(descriptor->cache[i]->vtbl, vtbl);
+                update(vtbl); // The tuple is already in the map, so this only looks for better parameters
+                break;
+            }
+
+        frozen = true;
+        return seal();
+    }
+
+    /// Builds a collision-free hash over the vtbl-pointer tuples currently in
+    /// the map, through which those colliding in the regular cache are found
+    /// with a single extra probe. Tuples added later are still found through
+    /// the regular cache.
+    /// \returns false when no collision-free hash function was found
+    bool seal()
+    {
+        typedef typename cache_descriptor::stored_type stored_type;
+        std::vector<std::pair<std::uintptr_t,stored_type*>> entries;
+
+        for (size_t i = 0; i <= descriptor->cache_mask; ++i)
+            if (descriptor->cache[i]->occupied())
+                entries.push_back(std::make_pair(perfect_hash_key(descriptor->cache[i]->vtbl,descriptor->optimal_shift), descriptor->cache[i]));
+
+        sealed_table<N,stored_type>* t = sealed_table<N,stored_type>::build(entries, descriptor->optimal_shift, XTL_SEAL_MAX_LOG_INC);
+
+        if (!t)
+            return false;
+
+        sealed_table<N,typename cache_descriptor::stored_type>::destroy(sealed);
+        sealed = t;
+        return true;
+    }
+
+#if XTL_USE_VTBL_FREQUENCY
+    /// Makes the map take part in the dispatch profile under the name of the
+    /// location of its match statement (\see profile_registry).
+    bool profile_as(const char* file, size_t line)
+    {
+        std::ostringstream site;
+        site << file << ':' << line;
+        profiling.site    = site.str();
+        profiling.object  = this;
+        profiling.collect = [](const void* m, dispatch_profile::site& s) { static_cast<const vtbl_map*>(m)->collect(s); };
+        profiling.replay  = [](void* m, const dispatch_profile::site& s) { static_cast<vtbl_map*>(m)->replay(s); };
+        expected_hits = &no_expected_hits();
+        profile_registry::add(profiling);
+        return true;
+    }
+
+    /// Adds the statistics of the tuples in the map to the given site
+    void collect(dispatch_profile::site& s) const
+    {
+        for (size_t i = 0; i <= descriptor->cache_mask; ++i)
+            if (descriptor->cache[i]->occupied())
+                s.add(descriptor->cache[i]->hits, profile_label(descriptor->cache[i]->value), type_names(descriptor->cache[i]->vtbl));
+    }
+
+    /// Prepares the map for the tuples recorded in the given site: grows it to
+    /// hold them all and makes hot tuples win the primary slots of the cache.
+    void replay(const dispatch_profile::site& s)
+    {
+        expected_hits = &s;
+
+        for (size_t i = 0; i <= descriptor->cache_mask; ++i)
+            if (descriptor->cache[i]->occupied())
+                descriptor->cache[i]->hits = std::max(descriptor->cache[i]->hits, s.expected_hits(type_names(descriptor->cache[i]->vtbl)));
+
+        // Rebuilding the cache places entries in the order of their hits
+        const bit_offset_t k = bit_offset_t(req_bits(descriptor->cache_mask));                // current log_size
+        const bit_offset_t n = std::max(k, bit_offset_t(req_bits(s.entries.size()))); // needed  log_size
+        cache_descriptor* old = descriptor;
+        #if defined(DBG_NEW)
+            #undef new
+        #endif
+        #if defined(XTL_NO_RVALREF)
+            descriptor = new(n) cache_descriptor(n,old->optimal_shift,*old);
+        #else
+            descriptor = new(n) cache_descriptor(n,old->optimal_shift,std::move(*old));
+        #endif
+        #if defined(DBG_NEW)
+            #define new DBG_NEW
+        #endif
+        cache_descriptor::destroy(old);
+    }
+#endif
+
 #if XTL_DUMP_PERFORMANCE
     std::ostream& operator>>(std::ostream& os) const;
     friend std::ostream& operator<<(std::ostream& os, const vtbl_map& m) { return m >> os; }
+
+    /// Records the location of the match statement this map belongs to
+    bool locate(const char* fl, size_t ln, const char* fn) noexcept
+    {
+        file = fl;
+        line = ln;
+        func = fn;
+        return true;
+    }
+
+    /// Fills in the current statistics of the map. Counters of other threads
+    /// are read without synchronization and thus may lag behind slightly.
+    void snapshot(dispatch_stats& s) const
+    {
+        s.file       = file;
+        s.line       = line;
+        s.func       = func;
+        s.arity      = N;
+        s.hits       = hits;
+        s.misses     = misses;
+        s.collisions = collisions;
+        s.updates    = updates;
+        s.cache_size = descriptor->cache_mask + 1;
+        s.entries    = descriptor->used;
+        s.memory     = memory_used();
+    }
 #endif
 
 private:
 
+#if XTL_USE_VTBL_FREQUENCY
+    /// Names of dynamic types of the given vtbl-pointers separated by tabs
+    static std::string type_names(const intptr_t (&vtbl)[N])
+    {
+        std::string result;
+
+        for (size_t i = 0; i < N; ++i)
+            (result += (i ? "\t" : "")) += vtbl_typeid(vtbl[i]).name();
+
+        return result;
+    }
+
+    /// Profile site of maps that did not replay any profile
+    static const dispatch_profile::site& no_expected_hits() { static const dispatch_profile::site none; return none; }
+
+    /// Counts a request served on a slow path. Entries seen for the first time 
+    /// start with the number of requests expected from the dispatch profile.
+    void count_miss(typename cache_descriptor::stored_type& e)
+    {
+        if (XTL_UNLIKELY(!e.hits) && expected_hits)
+            e.hits = expected_hits->expected_hits(type_names(e.vtbl));
+
+        ++e.hits;
+    }
+#endif
+
+    /// Registers the map in #warm_up_registry
+    void register_for_warm_up() noexcept
+    {
+        registration.object  = this;
+        registration.arity   = N;
+        registration.warm_up = [](void* m, const intptr_t* vtbls, size_t n) { static_cast<vtbl_map*>(m)->warm_up(vtbls,n); };
+        registration.freeze  = [](void* m) { return static_cast<vtbl_map*>(m)->freeze(); };
+        warm_up_registry::add(registration);
+    }
+
+#if XTL_DUMP_PERFORMANCE
+    /// Registers the map in #stats_registry
+    void register_for_statistics() noexcept
+    {
+        statistics.object   = this;
+        statistics.snapshot = [](const void* m, dispatch_stats& s) { static_cast<const vtbl_map*>(m)->snapshot(s); };
+        stats_registry::add(statistics);
+    }
+#endif
+
     /// Cached mappings of vtbl to some indecies
     cache_descriptor* descriptor;
 
@@ -636,17 +936,40 @@ private:
     /// Previous number of colisions that we will still tolerate before next update
     int prev_collisions_before_update;
 
+    /// Whether collisions should no longer trigger rearrangement of the cache
+    bool frozen;
+
+    /// Collision-free table over the tuples the map had when it was sealed.
+    /// nullptr until the map is sealed.
+    sealed_table<N,typename cache_descriptor::stored_type>* sealed;
+
+    /// Registration of this map in #warm_up_registry
+    warm_up_registry::record registration;
+
+#if XTL_USE_VTBL_FREQUENCY
+    /// Registration of this map in #profile_registry
+    profile_registry::record profiling;
+
+    /// Statistics of the site this map replayed or nullptr when the map does 
+    /// not take part in the dispatch profile
+    const dispatch_profile::site* expected_hits;
+#endif
+
 #if XTL_DUMP_PERFORMANCE
-    const char* file;      ///< File in which this vtblmap_of is instantiated
-    size_t      line;      ///< Line in the file where it is instantiated
-    const char* func;      ///< Function in which this vtblmap_of is instantiated
-    size_t      updates;   ///< Amount of reconfigurations performed at run time
-    size_t      hits;      ///< The number of cache hits
-    size_t      misses;    ///< The number of cache misses
-    size_t      collisions;///< Out of all the misses, how many were actual collisions
+    const char*   file;      ///< File in which this vtblmap_of is instantiated
+    size_t        line;      ///< Line in the file where it is instantiated
+    const char*   func;      ///< Function in which this vtblmap_of is instantiated
+    stats_counter updates;   ///< Amount of reconfigurations performed at run time
+    stats_counter hits;      ///< The number of cache hits
+    stats_counter misses;    ///< The number of cache misses
+    stats_counter collisions;///< Out of all the misses, how many were actual collisions
+
+    /// Registration of this map in #stats_registry
+    stats_registry::record statistics;
 #endif
 
 };
+#endif // !XTL_MULTI_THREADING && !XTL_INLINE_VTBL_ENTRIES
 
 //------------------------------------------------------------------------------
 
@@ -664,6 +987,8 @@ template <typename T> T vtbl_map<0,T>::dummy;
 
 //------------------------------------------------------------------------------
 
+#if !XTL_MULTI_THREADING && !XTL_INLINE_VTBL_ENTRIES
+
 template <size_t N, typename T>
 vtbl_map<N,T>::cache_descriptor::cache_descriptor(
     const size_t       log_size, ///< Parameter k of the cache - the log of the size of the cache
@@ -678,7 +1003,7 @@ vtbl_map<N,T>::cache_descriptor::cache_descriptor(
 
     // Allocate all cache entries in one chunk for better cache performance.
     // Only allocate the difference from need and already present in old ones
-    stored_type* cache_entries = new stored_type[1<<log_size];
+    stored_type* cache_entries = dispatch_arena::new_array<stored_type>(1<<log_size);
 
     // Initialize pointers from cache to newly allocated cache entries
     // NOTE: We allocate them in the order of LCG traversal to improve
@@ -713,9 +1038,26 @@ vtbl_map<N,T>::cache_descriptor::cache_descriptor(
     // so zero them out first to see which ones we have alredy initialized
     for (size_t i = 0; i <= cache_mask; ++i) cache[i] = 0;
 
-    // Initialize first cache pointers to occupied cache entries in the old cache
+#if XTL_USE_VTBL_FREQUENCY
+    // Place the most requested entries first so that they win the entries of
+    // the cache they are mapped to, while colliding ones get moved further
+    std::vector<size_t> order;
+
     for (size_t i = 0; i <= old.cache_mask; ++i)
+        order.push_back(i);
+
+    std::stable_sort(order.begin(), order.end(), [&old](size_t a, size_t b) { return old.cache[a]->hits > old.cache[b]->hits; });
+#endif
+
+    // Initialize first cache pointers to occupied cache entries in the old cache
+    for (size_t o = 0; o <= old.cache_mask; ++o)
     {
+#if XTL_USE_VTBL_FREQUENCY
+        const size_t i = order[o];
+#else
+        const size_t i = o;
+#endif
+
         XTL_ASSERT(old.cache[i]); // Since we pre-allocate them
 
         if (old.cache[i]->occupied())
@@ -750,7 +1092,7 @@ vtbl_map<N,T>::cache_descriptor::cache_descriptor(
     {
         // Allocate all cache entries in one chunk for better cache performance.
         // Only allocate the difference from need and already present in old ones
-        stored_type* cache_entries = new stored_type[cache_mask - old.cache_mask];
+        stored_type* cache_entries = dispatch_arena::new_array<stored_type>(cache_mask - old.cache_mask);
 
         // Initialize remaining pointers from cache to newly allocated cache entries
         // NOTE: We allocate them in the order of LCG traversal to improve
@@ -784,7 +1126,7 @@ vtbl_map<N,T>::cache_descriptor::~cache_descriptor()
         {
             size_t j = i+1;
             for (; j <= cache_mask && intptr_t(cache[j])-intptr_t(cache[j-1]) == sizeof(stored_type); ++j);
-            delete[] cache[i];
+            dispatch_arena::delete_array(cache[i]);
             i = j;
         }
         else
@@ -890,6 +1232,7 @@ auto vtbl_map<N,T>::cache_descriptor::get(const intptr_t (&vtbl)[N], size_t j) n
             else
             if (XTL_UNLIKELY(cache[j]->is_for(vtbl XTL_VTBL_HASHING(,vtbl_hash)))) // if so ...
             {
+                XTL_USE_VTBL_FREQUENCY_ONLY(if (cache[j]->hits < ce->hits) return cache[j]); // Keep the more requested entry in the right position
                 std::swap(ce,cache[j]); // swap it with the right position
                 return ce;
             }
@@ -902,6 +1245,7 @@ auto vtbl_map<N,T>::cache_descriptor::get(const intptr_t (&vtbl)[N], size_t j) n
         for (size_t i = j; i <= cache_mask; ++i)
             if (XTL_UNLIKELY(cache[i]->is_for(vtbl XTL_VTBL_HASHING(,vtbl_hash)))) // if so ...
             {
+                XTL_USE_VTBL_FREQUENCY_ONLY(if (cache[i]->hits < ce->hits) return cache[i]); // Keep the more requested entry in the right position
                 std::swap(ce,cache[i]); // swap it with the right position
                 return ce;
             }
@@ -909,6 +1253,7 @@ auto vtbl_map<N,T>::cache_descriptor::get(const intptr_t (&vtbl)[N], size_t j) n
         for (size_t i = 0; i < j; ++i)
             if (XTL_UNLIKELY(cache[i]->is_for(vtbl XTL_VTBL_HASHING(,vtbl_hash)))) // if so ...
             {
+                XTL_USE_VTBL_FREQUENCY_ONLY(if (cache[i]->hits < ce->hits) return cache[i]); // Keep the more requested entry in the right position
                 std::swap(ce,cache[i]); // swap it with the right position
                 return ce;
             }
@@ -1195,7 +1540,7 @@ break_of_both_loops: ;
         #if defined(DBG_NEW)
             #define new DBG_NEW
         #endif
-        delete old;
+        cache_descriptor::destroy(old);
     }
     else
     {
@@ -1212,6 +1557,7 @@ break_of_both_loops: ;
     //       not get into endless recursion update <-> get!
     typename cache_descriptor::stored_type* res = descriptor->get(vtbl);
     XTL_ASSERT(res && res->is_for(vtbl)); // We have ensured enough space, so no need to check this explicitly
+    XTL_USE_VTBL_FREQUENCY_ONLY(count_miss(*res));
     last_table_size = descriptor->used;   // Update memoized value
     return res->value;
 }
@@ -1411,6 +1757,7 @@ std::ostream& vtbl_map<N,T>::operator>>(std::ostream& os) const
     return os << std::endl;
 }
 #endif
+#endif // !XTL_MULTI_THREADING && !XTL_INLINE_VTBL_ENTRIES
 
 //------------------------------------------------------------------------------
 
@@ -1419,21 +1766,52 @@ std::ostream& vtbl_map<N,T>::operator>>(std::ostream& os) const
 template <size_t N>
 struct type_switch_info
 {
-    std::ptrdiff_t offset[N]; ///< Required this-pointer offset to the source sub-object
-    std::size_t    target;    ///< Case label of the jump target of Match statement
+    switch_offset  offset[N]; ///< Required this-pointer offset to the source sub-object
+    switch_target  target;    ///< Case label of the jump target of Match statement
 };
 
 template <>
 struct type_switch_info<0>
 {
-    std::size_t    target;    ///< Case label of the jump target of Match statement
+    switch_target  target;    ///< Case label of the jump target of Match statement
     std::ptrdiff_t offset[XTL_VARIABLE_SIZE_ARRAY]; ///< Dummy array, not used. Ideally should be 0 size
 };
 
+/// Tuples of dynamic types are recorded in the dispatch profile with the case
+/// label they were dispatched to
+template <size_t N>
+inline size_t profile_label(const type_switch_info<N>& info) noexcept { return load_target(info.target); }
+
+#if !XTL_MULTI_THREADING && !XTL_INLINE_VTBL_ENTRIES && XTL_USE_VTBL_FREQUENCY
+/// The single-threaded vtbl_map supports profiling
+template <size_t N, typename T>
+inline bool profile_site(vtbl_map<N,T>& m, const char* file, size_t line) { return m.profile_as(file, line); }
+
+/// Maps of match statements without polymorphic subjects have nothing to profile
+template <typename T>
+inline bool profile_site(vtbl_map<0,T>&, const char*, size_t) { return false; }
+#endif
+
+#if XTL_DUMP_PERFORMANCE
+/// Maps that keep statistics learn the location of their match statement
+template <size_t N, typename T>
+inline bool stats_site(vtbl_map<N,T>& m, const char* file, size_t line, const char* func) { return m.locate(file, line, func); }
+
+/// Maps of match statements without polymorphic subjects keep no statistics
+template <typename T>
+inline bool stats_site(vtbl_map<0,T>&, const char*, size_t, const char*) { return false; }
+#endif
+
 //------------------------------------------------------------------------------
 
 } // of namespace mch
 
+#if XTL_MULTI_THREADING
+#include "vtblmap4mt.hpp" // Multi-threaded version of vtbl_map based on atomics and lock-free programming
+#elif XTL_INLINE_VTBL_ENTRIES
+#include "vtblmap4inl.hpp" // Single-threaded version of vtbl_map with entries inline in the hash table
+#endif
+
 // Generic M and V without vtbl array hashing are:
 // N=1:  100 combinations V=50 M=53  -   5% slower
 // N=2:  100 combinations V=55 M=38  -  43% faster
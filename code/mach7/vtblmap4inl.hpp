@@ -0,0 +1,767 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines the version of class vtbl_map<N,T> that keeps its entries
+/// inline in the hash table instead of referencing them through pointers. The
+/// file is included by vtblmap4.hpp when #XTL_INLINE_VTBL_ENTRIES is enabled
+/// and should not be included directly.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <type_traits>
+
+// --------------------[ Layout of the Table ]--------------------
+// - Each slot of the table packs the vtbl-pointers together with the value
+//   associated with them, so a hit is a single load of one cache line
+//   instead of two dependent loads of the pointer-based version.
+// - Slots are aligned to the smallest power of 2 not smaller than their size,
+//   but no more than #XTL_CACHE_LINE_SIZE, so that a slot never straddles a
+//   cache line unless it is larger than one. The table itself is allocated
+//   with that alignment.
+// - References to values returned by get have to remain valid while a case
+//   clause is being evaluated, which may recursively use the same map. Slots
+//   therefore never move once claimed: collisions are resolved with the LCG
+//   walk from the slot the tuple hashes into, and rearrangement copies the
+//   slots into a new table, while the old one is kept until the map dies.
+//   A value computed through a stale reference only lands in the old table,
+//   so the new one will compute it again on the first use.
+//------------------------------------------------------------------------------
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Alignment of a slot of the given size in vtbl_map with inline entries
+constexpr size_t inline_slot_alignment(size_t size, size_t alignment = 1)
+{
+    return alignment >= size || alignment >= XTL_CACHE_LINE_SIZE ? alignment : inline_slot_alignment(size, 2*alignment);
+}
+
+/// Type of the slots of vtbl_map with inline entries: a tuple of vtbl-pointers
+/// and T value aligned to not straddle a cache line.
+template <size_t N, typename T>
+struct alignas(inline_slot_alignment(sizeof(stored_type_for<N,T>))) inline_stored_type_for : stored_type_for<N,T>
+{
+    /// Copies passed set of vtbl pointers into ours
+    inline_stored_type_for& operator=(const intptr_t (&v)[N]) { stored_type_for<N,T>::operator=(v); return *this; }
+};
+
+//------------------------------------------------------------------------------
+
+/// Single-threaded version of the class for efficient mapping of N vtbl-pointers
+/// to a value of type T, which keeps the values inline in its hash table.
+template <size_t N, typename T>
+class vtbl_map
+{
+private:
+
+    /// Type of the stored values, which is a tuple of vtbl-pointers and T value.
+    typedef inline_stored_type_for<N,T> stored_type;
+
+    /// A helper data structure that is swapped during updates to cache
+    /// parameters k and l. It owns the table of slots.
+    struct cache_descriptor
+    {
+        /// Cache mask to access entries. Always cache_size-1 since cache_size is a power of 2
+        /// \note We currently rely in constructors on this member be first in 
+        ///       declaration order so that it is initialized first!
+        const size_t cache_mask;
+
+        /// Optimal shift computed based on the vtbl pointers already in the map.
+        /// \see The same member of the pointer-based version of cache_descriptor
+        bit_offset_t optimal_shift[N];
+
+        /// Total number of vtbl-pointers in the cache
+        size_t used;
+
+        /// The descriptor this one has replaced. Kept alive as references to
+        /// its values might still be in use.
+        cache_descriptor* const retired;
+
+        /// Variable-sized array of slots
+        /// \warning: This must be the last member of this class!
+        stored_type cache[XTL_VARIABLE_SIZE_ARRAY];
+
+        #if defined(DBG_NEW)
+            #undef new
+        #endif
+
+        void* operator new(size_t, size_t log_size)
+        {
+            // Over-allocate to be able to align the descriptor and remember
+            // the beginning of the allocated block right in front of it.
+            const size_t a = alignment();
+            char* const  p = static_cast<char*>(dispatch_arena::allocate(bytes(size_t(1)<<log_size)));
+            char* const  q = p + sizeof(char*) + (a - (intptr_t(p + sizeof(char*)) & (a-1))) % a;
+            reinterpret_cast<char**>(q)[-1] = p;
+            return q;
+        }
+
+        #if defined(DBG_NEW)
+            #define new DBG_NEW
+        #endif
+
+        /// We need to declare this placement delete operator since we overload new.
+        void operator delete(void* p, size_t log_size) { dispatch_arena::deallocate(static_cast<char**>(p)[-1], bytes(size_t(1)<<log_size)); }
+
+        /// A delete expression does not know the size of the object. Use #destroy instead.
+        void operator delete(void*) XTL_DELETED;
+
+        static size_t alignment() { return alignof(cache_descriptor) < sizeof(char*) ? sizeof(char*) : alignof(cache_descriptor); }
+
+        /// Number of bytes allocated for a descriptor with the given number of slots
+        static size_t bytes(size_t n) { return sizeof(cache_descriptor) + (n-XTL_VARIABLE_SIZE_ARRAY)*sizeof(stored_type) + alignment() + sizeof(char*); }
+
+        /// Destroys and deallocates a descriptor allocated with the above operator new
+        static void destroy(void* p) noexcept
+        {
+            if (cache_descriptor* d = static_cast<cache_descriptor*>(p))
+            {
+                char* const  block = static_cast<char**>(p)[-1];
+                const size_t n     = bytes(d->size());
+                d->~cache_descriptor();
+                dispatch_arena::deallocate(block, n);
+            }
+        }
+
+        /// Creates new cache_descriptor based on parameters k and l of the hashing function
+        cache_descriptor(
+            const size_t       log_size,               ///< Parameter k of the cache - the log of the size of the cache
+            const bit_offset_t shift = irrelevant_bits ///< Parameter l of the cache - number of irrelevant bits on the right to remove
+        ) :
+            cache_mask( (1<<log_size) - 1 ),
+            used(0),
+            retired(nullptr)
+        {
+            std::fill(&optimal_shift[0],&optimal_shift[N],shift);
+
+            for (size_t i = XTL_VARIABLE_SIZE_ARRAY; i <= cache_mask; ++i)
+                cache[i].construct();
+        }
+
+        /// Creates new cache_descriptor based on parameters k and l of the 
+        /// hashing function as well as the cache_descriptor it replaces. The
+        /// slots of the old descriptor are copied and it becomes retired.
+        cache_descriptor(
+            const size_t       log_size,    ///< Parameter k of the cache - the log of the size of the cache
+            const bit_offset_t (&shifts)[N],///< Parameter l of the cache - number of irrelevant bits on the right to remove
+            cache_descriptor*  old          ///< cache_descriptor we will replace
+        ) :
+            cache_mask( (1<<log_size) - 1 ),
+            used(0),
+            retired(old)
+        {
+            XTL_ASSERT(cache_mask >= old->cache_mask); // Since we are going to inherit all its existing elements
+
+            array_copy(shifts,optimal_shift);
+
+            for (size_t i = XTL_VARIABLE_SIZE_ARRAY; i <= cache_mask; ++i)
+                cache[i].construct();
+
+            for (size_t i = 0; i <= old->cache_mask; ++i)
+                if (old->cache[i].occupied())
+                {
+                    stored_type* st = get(old->cache[i].vtbl, cache_index(old->cache[i].vtbl));
+                    XTL_ASSERT(st);
+                    st->value = old->cache[i].value;
+                }
+        }
+
+        /// Deallocates all the retired descriptors as well.
+       ~cache_descriptor()
+        {
+            for (size_t i = XTL_VARIABLE_SIZE_ARRAY; i <= cache_mask; ++i)
+                cache[i].destroy();
+
+            destroy(retired);
+        }
+
+        bool    is_full() const { return used > cache_mask; } ///< Checks whether cache is full
+        size_t     size() const { return cache_mask+1; }      ///< Number of entries in cache
+        size_t lcg_next(size_t j) const { return (lcg_a*j + lcg_c) & cache_mask; }
+
+        size_t memory_used() const 
+        {
+            return sizeof(cache_descriptor)                                  // Descriptor itself
+                + (cache_mask+1-XTL_VARIABLE_SIZE_ARRAY)*sizeof(stored_type) // Slots
+                + (retired ? retired->memory_used() : 0);                    // Descriptors kept alive
+        }
+
+        /// Global function computing cache index for a given vtbl pointers, offsets and cache mask
+        static inline size_t cache_index(const intptr_t vtbl[N], const bit_offset_t shifts[N], size_t cache_mask)
+        {
+            intptr_t vtbl_shifted[N];
+
+            for (size_t i = 0; i < N; ++i)
+                vtbl_shifted[i] = vtbl[i] >> shifts[i];
+
+            return interleave(vtbl_shifted) & cache_mask;
+        }
+
+        /// Computes cache index for current optimal offsets and cache mask.
+        size_t cache_index(const intptr_t vtbl[N]) const { return cache_index(vtbl,optimal_shift,cache_mask); }
+
+        /// Finds the slot of the given vtbl-pointers by walking from the slot
+        /// j they hash into, claiming the first vacant one if they are not there.
+        /// \returns nullptr when the vtbl-pointers are not there and the cache is full
+        stored_type* get(const intptr_t (&vtbl)[N], size_t j) noexcept
+        {
+            for (size_t n = 0; n <= cache_mask; ++n, j = lcg_next(j))
+            {
+                stored_type& st = cache[j];
+
+                if (st.is_for(vtbl))
+                    return &st;
+
+                if (st.vacant())
+                {
+                    st = vtbl;
+                    ++used;
+                    return &st;
+                }
+            }
+
+            return nullptr;
+        }
+
+        /// Computes the number of entries an existing set of vtbl-pointer tuples 
+        /// extended with the new one will occupy in cache of a given #log_size 
+        /// with given #offsets
+        size_t entries_for(const intptr_t (&vtbl)[N], size_t log_size, const bit_offset_t (&offsets)[N]) const;
+
+    private:
+
+        cache_descriptor(const cache_descriptor&);            ///< No copy constructor
+        cache_descriptor& operator=(const cache_descriptor&); ///< No assignment operator
+
+    }; // of class cache_descriptor
+
+    /// Helpers to collect vtbl pointers of polymorphic subjects only
+    template <typename S>
+    static inline void collect(const S* s, intptr_t* vtbl, size_t& i, std::true_type)  noexcept { vtbl[i++] = vtbl_of(s); }
+    template <typename S>
+    static inline void collect(const S*,   intptr_t*,      size_t&,   std::false_type) noexcept {}
+
+private:
+
+    vtbl_map(const vtbl_map&);            ///< No copy constructor
+    vtbl_map& operator=(const vtbl_map&); ///< No assignment operator
+
+public:
+
+#if XTL_DUMP_PERFORMANCE
+    #if defined(DBG_NEW)
+        #undef new
+    #endif
+    vtbl_map(const char* fl, size_t ln, const char* fn, const vtbl_count_t& num_clauses) :
+        descriptor(new(min_log_size) cache_descriptor(min_log_size)),
+        case_clauses(num_clauses),
+        last_table_size(0),
+        collisions_before_update(initial_collisions_before_update),
+        prev_collisions_before_update(initial_collisions_before_update),
+        frozen(false),
+        sealed(nullptr),
+        file(fl),
+        line(ln),
+        func(fn),
+        updates(0),
+        hits(0),
+        misses(0),
+        collisions(0)
+    {
+        register_for_warm_up();
+        register_for_statistics();
+    }
+    #if defined(DBG_NEW)
+        #define new DBG_NEW
+    #endif
+#endif
+
+    #if defined(DBG_NEW)
+        #undef new
+    #endif
+    vtbl_map(const vtbl_count_t& num_clauses) :
+        descriptor(new(min_log_size) cache_descriptor(min_log_size)),
+        case_clauses(num_clauses),
+        last_table_size(0),
+        collisions_before_update(initial_collisions_before_update),
+        prev_collisions_before_update(initial_collisions_before_update),
+        frozen(false),
+        sealed(nullptr)
+        XTL_DUMP_PERFORMANCE_ONLY(,file("unspecified"), line(0), func("unspecified"), updates(0), hits(0), misses(0), collisions(0))
+    {
+        register_for_warm_up();
+        XTL_DUMP_PERFORMANCE_ONLY(register_for_statistics());
+    }
+    #if defined(DBG_NEW)
+        #define new DBG_NEW
+    #endif
+
+   ~vtbl_map()
+    {
+        XTL_DUMP_PERFORMANCE_ONLY(std::clog << *this << std::endl);
+        XTL_DUMP_PERFORMANCE_ONLY(stats_registry::remove(statistics));
+        warm_up_registry::remove(registration);
+        sealed_table<N,stored_type>::destroy(sealed);
+        cache_descriptor::destroy(descriptor);
+    }
+
+    size_t memory_used() const
+    {
+        XTL_ASSERT(descriptor);
+        return sizeof(vtbl_map) + descriptor->memory_used();
+    }
+
+    /// This is the main function to get the value of type T associated with
+    /// the (vtbl0,...,vtblN) of given pointers.
+    ///
+    /// \note The function returns the value "by reference" to indicate that you
+    ///       may take address or change the value of the cell! The reference
+    ///       remains valid for the lifetime of the map.
+    inline T& get(const intptr_t (&vtbl)[N]) noexcept
+    {
+        const size_t j  = descriptor->cache_index(vtbl); // Index of location where it should be
+        stored_type& ce = descriptor->cache[j];           // Location where it should be
+
+        if (XTL_LIKELY(ce.is_for(vtbl)))
+        {
+            XTL_DUMP_PERFORMANCE_ONLY(++hits);
+            return ce.value;
+        }
+        else
+            return miss(ce,j,vtbl);
+    }
+
+    /// Overload taking pointers to subjects of Match statement, where only
+    /// pointers to polymorphic subjects are taken into account.
+    template <typename... S>
+    inline T& get(const S*... s) noexcept
+    {
+        intptr_t vtbl[N];
+        size_t   i = 0;
+        int dummy[] = {0, (collect(s, vtbl, i, std::integral_constant<bool,std::is_polymorphic<S>::value>()),0)...};
+        XTL_UNUSED(dummy);
+        XTL_ASSERT(i == N);
+        return get(vtbl);
+    }
+
+    /// Same as above, but uses XTL subtyping to determine which subjects should be taken into account.
+    template <typename... S>
+    inline T& xtl_get(const S*... s) noexcept
+    {
+        intptr_t vtbl[N];
+        size_t   i = 0;
+        int dummy[] = {0, (collect(s, vtbl, i, std::integral_constant<bool,xtl::is_poly_morphic<S>::value>()),0)...};
+        XTL_UNUSED(dummy);
+        XTL_ASSERT(i == N);
+        return get(vtbl);
+    }
+
+    /// A function that gets called when the cache is either too inefficient or full.
+    T& update(const intptr_t (&vtbl)[N]);
+
+    /// Seeds the map with all the N-tuples of the given vtbl-pointers, so that
+    /// it reaches its final size and hashing parameters before it is used.
+    /// \note Values associated with the seeded tuples are default-constructed.
+    void warm_up(const intptr_t* vtbls, size_t n)
+    {
+        if (!n)
+            return;
+
+        size_t   idx[N] = {};
+        intptr_t vtbl[N];
+
+        for (;;)
+        {
+            for (size_t i = 0; i < N; ++i)
+                vtbl[i] = vtbls[idx[i]];
+
+            get(vtbl);
+
+            // Advance to the next tuple
+            size_t i = 0;
+
+            while (i < N && ++idx[i] == n)
+                idx[i++] = 0;
+
+            if (i == N)
+                break;
+        }
+    }
+
+    /// Rearranges the map one last time and stops it from rearranging itself
+    /// on collisions afterwards. The map still grows when it runs out of space.
+    /// \returns Whether the map was also sealed (see #seal)
+    bool freeze()
+    {
+        for (size_t i = 0; i <= descriptor->cache_mask; ++i)
+            if (descriptor->cache[i].occupied())
+            {
+                intptr_t vtbl[N];
+                array_copy(descriptor->cache[i].vtbl, vtbl);
+                update(vtbl); // The tuple is already in the map, so this only looks for better parameters
+                break;
+            }
+
+        frozen = true;
+        return seal();
+    }
+
+    /// Builds a collision-free hash over the vtbl-pointer tuples currently in
+    /// the map, through which those colliding in the regular cache are found
+    /// with a single extra probe. Tuples added later are still found through
+    /// the regular cache.
+    /// \returns false when no collision-free hash function was found
+    bool seal()
+    {
+        std::vector<std::pair<std::uintptr_t,stored_type*>> entries;
+
+        for (size_t i = 0; i <= descriptor->cache_mask; ++i)
+            if (descriptor->cache[i].occupied())
+                entries.push_back(std::make_pair(perfect_hash_key(descriptor->cache[i].vtbl,descriptor->optimal_shift), &descriptor->cache[i]));
+
+        sealed_table<N,stored_type>* t = sealed_table<N,stored_type>::build(entries, descriptor->optimal_shift, XTL_SEAL_MAX_LOG_INC);
+
+        if (!t)
+            return false;
+
+        sealed_table<N,stored_type>::destroy(sealed);
+        sealed = t;
+        return true;
+    }
+
+#if XTL_DUMP_PERFORMANCE
+    std::ostream& operator>>(std::ostream& os) const;
+    friend std::ostream& operator<<(std::ostream& os, const vtbl_map& m) { return m >> os; }
+
+    /// Records the location of the match statement this map belongs to
+    bool locate(const char* fl, size_t ln, const char* fn) noexcept
+    {
+        file = fl;
+        line = ln;
+        func = fn;
+        return true;
+    }
+
+    /// Fills in the current statistics of the map. Counters of other threads
+    /// are read without synchronization and thus may lag behind slightly.
+    void snapshot(dispatch_stats& s) const
+    {
+        s.file       = file;
+        s.line       = line;
+        s.func       = func;
+        s.arity      = N;
+        s.hits       = hits;
+        s.misses     = misses;
+        s.collisions = collisions;
+        s.updates    = updates;
+        s.cache_size = descriptor->cache_mask + 1;
+        s.entries    = descriptor->used;
+        s.memory     = memory_used();
+    }
+#endif
+
+private:
+
+    /// Registers the map in #warm_up_registry
+    void register_for_warm_up() noexcept
+    {
+        registration.object  = this;
+        registration.arity   = N;
+        registration.warm_up = [](void* m, const intptr_t* vtbls, size_t n) { static_cast<vtbl_map*>(m)->warm_up(vtbls,n); };
+        registration.freeze  = [](void* m) { return static_cast<vtbl_map*>(m)->freeze(); };
+        warm_up_registry::add(registration);
+    }
+
+#if XTL_DUMP_PERFORMANCE
+    /// Registers the map in #stats_registry
+    void register_for_statistics() noexcept
+    {
+        statistics.object   = this;
+        statistics.snapshot = [](const void* m, dispatch_stats& s) { static_cast<const vtbl_map*>(m)->snapshot(s); };
+        stats_registry::add(statistics);
+    }
+#endif
+
+    /// Slow path of #get taken out of line to keep the hit path small
+    T& miss(stored_type& ce, size_t j, const intptr_t (&vtbl)[N]) noexcept
+    {
+        if (sealed) // Checked only on collisions, so that maps that are never sealed keep their hit path
+        {
+            stored_type* const se = sealed->find(vtbl); // The only place it can be
+
+            if (XTL_LIKELY(se->is_for(vtbl)))
+            {
+                XTL_DUMP_PERFORMANCE_ONLY(++hits);
+                return se->value;
+            }
+        }
+
+        XTL_DUMP_PERFORMANCE_ONLY(++misses);
+        XTL_DUMP_PERFORMANCE_ONLY(if (ce.occupied()) ++collisions);
+
+        if (XTL_UNLIKELY(
+            descriptor->is_full()                     // No entries left for possibly new vtbl in the cache
+            || (ce.occupied()                         // Collision - the entry for vtbl is already occupied
+            && !frozen                                // We were not asked to keep current arrangement
+            && --collisions_before_update <= 0        // We had sufficiently many collisions to justify call
+            && descriptor->used != last_table_size))) // There was at least one vtbl added since last update
+            return update(vtbl);                      // try to rearrange cache
+
+        // Walk from where it should be to where it is or to a vacant slot
+        stored_type* st = descriptor->get(vtbl,j);
+        XTL_ASSERT(st); // The cache is not full
+        return st->value;
+    }
+
+    /// Cached mappings of vtbl to some indecies
+    cache_descriptor* descriptor;
+
+    /// A reference to a global variable that will be initialized with the 
+    /// number of case clauses of a given match statement
+    const vtbl_count_t& case_clauses;
+
+    /// Memoized table.size() during last cache rearranging
+    size_t last_table_size;
+
+    /// Number of colisions that we will still tolerate before next update
+    int collisions_before_update;
+
+    /// Previous number of colisions that we will still tolerate before next update
+    int prev_collisions_before_update;
+
+    /// Whether collisions should no longer trigger rearrangement of the cache
+    bool frozen;
+
+    /// Collision-free table over the tuples the map had when it was sealed.
+    /// nullptr until the map is sealed.
+    sealed_table<N,stored_type>* sealed;
+
+    /// Registration of this map in #warm_up_registry
+    warm_up_registry::record registration;
+
+#if XTL_DUMP_PERFORMANCE
+    const char*   file;      ///< File in which this vtblmap_of is instantiated
+    size_t        line;      ///< Line in the file where it is instantiated
+    const char*   func;      ///< Function in which this vtblmap_of is instantiated
+    stats_counter updates;   ///< Amount of reconfigurations performed at run time
+    stats_counter hits;      ///< The number of cache hits
+    stats_counter misses;    ///< The number of cache misses
+    stats_counter collisions;///< Out of all the misses, how many were actual collisions
+
+    /// Registration of this map in #stats_registry
+    stats_registry::record statistics;
+#endif
+
+};
+
+//------------------------------------------------------------------------------
+
+template <size_t N, typename T>
+size_t vtbl_map<N,T>::cache_descriptor::entries_for(const intptr_t (&vtbl)[N], size_t log_size, const bit_offset_t (&offsets)[N]) const
+{
+    // NOTE: See notes on the pointer-based version of this function.
+    const intptr_t new_cache_mask       = (1<<log_size)-1; // Actual cache mask for the hash function
+    const intptr_t max_stack_mask       = (1<<(max_stack_log_size+3))-1; // Mask for the largest number of bits we are allowed to allocate on stack: +3 is *8 for the number of bits in the allowed stack size
+    const size_t   cache_histogram_size = 1 + std::min(new_cache_mask,max_stack_mask)/XTL_BIT_SIZE(intptr_t); // Number of elements in intptr_t array allocated on the stack
+    XTL_VLAZ(cache_histogram, intptr_t, cache_histogram_size, 1 + max_stack_mask/XTL_BIT_SIZE(intptr_t)); // Declares intptr_t cache_histogram[cache_histogram_size] = {0};
+    XTL_BIT_SET(cache_histogram, cache_index(vtbl,offsets,new_cache_mask) & max_stack_mask); // Mark the entry for new vtbl
+
+    // Iterate over vtbl in the cache and see where they are mapped with log size i and offset j
+    for (size_t c = 0; c <= this->cache_mask; ++c)
+        if (cache[c].occupied())
+            XTL_BIT_SET(cache_histogram, cache_index(cache[c].vtbl,offsets,new_cache_mask) & max_stack_mask); // Mark the entry for each vtbl
+
+    size_t entries = 0;
+
+    // Count the number of used entries
+    for (size_t h = 0; h < cache_histogram_size; ++h)
+        entries += bits_set(cache_histogram[h]);
+
+    return entries;
+}
+
+//------------------------------------------------------------------------------
+
+template <size_t N, typename T>
+T& vtbl_map<N,T>::update(const intptr_t (&vtbl)[N])
+{
+    XTL_ASSERT(descriptor); // Allocated in constructor, deallocated in destructor
+    XTL_DUMP_PERFORMANCE_ONLY(++updates); // Record update
+
+    intptr_t prev[N];
+    intptr_t diff[N] = {};
+
+    array_copy(vtbl,prev);
+
+    // Compute bits in which existing vtbl, including the newly added one, differ
+    for (size_t i = 0; i <= descriptor->cache_mask; ++i)
+        if (descriptor->cache[i].occupied())
+            for (size_t s = 0; s < N; s++)
+            {
+                const intptr_t vt = descriptor->cache[i].vtbl[s];
+                diff[s] |= prev[s] ^ vt;
+                prev[s] = vt;
+            }
+
+    bit_offset_t k  = bit_offset_t(req_bits(descriptor->cache_mask));     // current log_size
+    bit_offset_t n  = bit_offset_t(req_bits(descriptor->used));           // needed  log_size
+    bit_offset_t c  = bit_offset_t(req_bits(case_clauses));               // log_size estimate. NOTE: case_clauses will be initialized by now
+    bit_offset_t l1 = std::max(std::max(k,c),n);                          // lower bound for log_size iteration
+    bit_offset_t l2 = std::max(std::max(k,c),bit_offset_t(n+max_log_inc));// upper bound for log_size iteration
+    bit_offset_t no = l1; // current estimate of the best log_size
+    bit_offset_t zo[N];   // current estimate of the best offset
+    bit_offset_t m[N];    // highest bit in which vtbls differ
+    bit_offset_t z[N];    // lowest bits in which vtbls do not differ
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (diff[i])  // We have to check for non-zero as trailing_zeros will return -127 for 0
+        {
+            m[i] = bit_offset_t(req_bits(diff[i])); // highest bit in which vtbls differ
+            z[i] = bit_offset_t(trailing_zeros(static_cast<unsigned int>(diff[i]))); // lowest bits in which vtbls do not differ.
+        }
+        else
+            m[i] = z[i] = descriptor->optimal_shift[i];
+    }
+
+    size_t max_cache_entries = descriptor->entries_for(vtbl, l1, descriptor->optimal_shift);
+    array_copy(descriptor->optimal_shift,zo); // Copy current solution as current optimal
+
+    // Iterate over allowed log sizes
+    for (bit_offset_t i = l1; i <= l2; ++i)
+    {
+        // Try to improve independently each argument position
+        for (size_t s = 0; s < N; ++s)
+        {
+            bit_offset_t bits_in_arg_mask = (i+N-1-s)/N;
+            bit_offset_t mm = m[s] > bits_in_arg_mask && m[s] - bits_in_arg_mask >= z[s] ? m[s] - bits_in_arg_mask : m[s];
+            bit_offset_t cur = zo[s];
+
+            for (bit_offset_t t = z[s]; t <= mm; ++t)
+            {
+                if (t != cur)
+                {
+                    zo[s] = t;
+
+                    size_t entries = descriptor->entries_for(vtbl, i, zo); // Count the number of used entries
+
+                    // Update best estimates
+                    if (entries > max_cache_entries)
+                    {
+                        max_cache_entries = entries;
+                        no  = i;
+                        cur = t;
+
+                        if (entries == descriptor->used+1)
+                        {
+                            // We found size and offset without conflicts, exit both loops
+                            i = l2+1; // to exit both for loops
+                            zo[s] = cur;
+                            goto break_of_both_loops;
+                        }
+                    }
+                }
+            }
+
+            zo[s] = cur;
+        } // of loop over argument positions
+
+break_of_both_loops: ;
+
+    } // of loop over possible log sizes
+
+    if (no < k)
+        no = k; // We never shrink, while we preallocate based on number of case clauses or the minimum
+
+    if (no != k || !array_equal(descriptor->optimal_shift,zo))
+    {
+        // OK, either log size or optimal shifts changed. Reset collisions counter to default one
+        prev_collisions_before_update = collisions_before_update = case_clauses ? case_clauses : N*initial_collisions_before_update;
+
+        #if defined(DBG_NEW)
+            #undef new
+        #endif
+        descriptor = new(no) cache_descriptor(no,zo,descriptor);
+        #if defined(DBG_NEW)
+            #define new DBG_NEW
+        #endif
+    }
+    else
+    {
+        // Update hasn't changed anything, increase the number of colisions before next update
+        prev_collisions_before_update = collisions_before_update = prev_collisions_before_update*2;
+    }
+
+    stored_type* st = descriptor->get(vtbl,descriptor->cache_index(vtbl));
+    XTL_ASSERT(st); // We either grew the cache or it had a vacant slot
+    last_table_size = descriptor->used; // Update memoized value
+    return st->value;
+}
+
+//------------------------------------------------------------------------------
+
+#if XTL_DUMP_PERFORMANCE
+template <size_t N, typename T>
+std::ostream& vtbl_map<N,T>::operator>>(std::ostream& os) const
+{
+    std::ios::fmtflags fmt = os.flags(); // store flags
+
+    os  << " clauses="    << std::setw(4) << case_clauses     // Number of case clauses in the match statement
+        << " total="      << std::setw(5) << descriptor->used // Total number of vtbl pointers seen
+        << " log_size="   << std::setw(2) << req_bits(descriptor->cache_mask) // log2 size required
+        << " updates="    << std::setw(2) << updates          // how many updates have been performed on the cache
+        << " hits="       << std::setw(8) << hits             // how many hits have we had
+        << " misses="     << std::setw(8) << misses           // how many misses have we had
+        << " collisions=" << std::setw(8) << collisions       // how many misses were actual collisions
+        << " memory="     << std::setw(8) << memory_used()    // number of bytes used
+        << " Stmt: "      << file << '[' << line << ']' << ' ' << func
+        << ";\n";
+    os.flags(fmt);
+    return os;
+}
+#endif
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
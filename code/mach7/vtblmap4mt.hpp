@@ -0,0 +1,1087 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file defines the multi-threaded version of class vtbl_map<N,T> used for
+/// fast mapping of N vtbl pointers to type T. The file is included by
+/// vtblmap4.hpp when #XTL_MULTI_THREADING is enabled and should not be included
+/// directly.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+// --------------------[ Concurrency Management ]--------------------
+// - The hit path is wait-free: one acquire load of the descriptor, one acquire
+//   load of the cache entry and the comparison of the vtbl pointers.
+// - Entries (tuples of vtbl pointers together with their values) never move
+//   and never get deallocated while the map is alive. Any reference returned
+//   by get remains valid regardless of what other threads do to the map.
+// - An entry is claimed by CAS-ing its vtbl[0] from 0 to #claimed_vtbl.
+//   The claiming thread then fills in the rest of the vtbl pointers and only
+//   then publishes vtbl[0] with release semantics. Readers thus never see a
+//   partially written tuple.
+// - Cache entries (pointers to entries) are swapped with two CASes. In between
+//   the two CASes an entry might be temporarily absent from the cache, which
+//   is why the slow path falls back to searching the entry chunks directly.
+// - Rearrangement (change of k or l of the hash function) never modifies a
+//   published descriptor: a new descriptor referencing the same entries is
+//   built and installed with CAS. Threads still using the old descriptor keep
+//   working correctly, they just miss more often. The replaced descriptor is
+//   retired into the epoch-based reclamation (see epoch.hpp) and deallocated
+//   once no thread can be looking at it anymore.
+// - Two threads racing to insert the same new tuple may both claim an entry
+//   for it. Both entries carry correct values, so this only wastes a slot.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <type_traits>
+#include "epoch.hpp"     // Epoch-based reclamation of retired descriptors
+#include "perfect_hash.hpp" // Collision-free hashing of frozen maps
+#include "vtblcache.hpp" // Per-thread cache in front of the shared data
+
+namespace mch ///< Mach7 library namespace
+{
+
+//------------------------------------------------------------------------------
+
+/// Value stored in vtbl[0] of an entry that has been claimed by some thread, but
+/// whose vtbl pointers have not yet been published. Never a valid vtbl pointer.
+const intptr_t claimed_vtbl = 1;
+
+//------------------------------------------------------------------------------
+
+/// Type of the stored values in the multi-threaded version of vtbl_map, which
+/// is a tuple of vtbl-pointers and T value.
+/// \note vtbl[0] is the publication word of the entry: it is the first to be
+///       claimed and the last to be written.
+template <size_t N, typename T>
+struct atomic_stored_type_for
+{
+    atomic_stored_type_for() : value() { for (size_t i = 0; i < N; ++i) vtbl[i].store(0, std::memory_order_relaxed); }
+
+    std::atomic<intptr_t> vtbl[N];  ///< v-table pointers of the value
+    T                     value;    ///< value associated with the v-table pointers vtbl[]
+
+    /// Checks whether given entry has been claimed by some thread (it might not be published yet)
+    bool occupied() const  { return vtbl[0].load(std::memory_order_acquire) != 0; }
+    /// Checks whether given entry is vacant
+    bool vacant()   const  { return !occupied(); }
+    /// Checks whether given entry has been published
+    bool published() const { intptr_t v = vtbl[0].load(std::memory_order_acquire); return v != 0 && v != claimed_vtbl; }
+
+    /// Checks whether passed set of vtbl pointers matches ours set
+    bool is_for(const intptr_t (&v)[N]) const
+    {
+        if (vtbl[0].load(std::memory_order_acquire) != v[0])
+            return false;
+
+        // Acquire above guarantees the rest of the tuple to be visible
+        for (size_t i = 1; i < N; ++i)
+            if (vtbl[i].load(std::memory_order_relaxed) != v[i])
+                return false;
+
+        return true;
+    }
+
+    /// Copies the vtbl pointers of a published entry into v
+    /// \returns false when the entry has not been published yet
+    bool load(intptr_t (&v)[N]) const
+    {
+        v[0] = vtbl[0].load(std::memory_order_acquire);
+
+        if (v[0] == 0 || v[0] == claimed_vtbl)
+            return false;
+
+        for (size_t i = 1; i < N; ++i)
+            v[i] = vtbl[i].load(std::memory_order_relaxed);
+
+        return true;
+    }
+
+    /// Tries to claim a vacant entry for the given set of vtbl pointers.
+    /// \returns false if some other thread claimed this entry first
+    bool claim(const intptr_t (&v)[N])
+    {
+        intptr_t expected = 0;
+
+        if (!vtbl[0].compare_exchange_strong(expected, claimed_vtbl, std::memory_order_acq_rel))
+            return false;
+
+        for (size_t i = 1; i < N; ++i)
+            vtbl[i].store(v[i], std::memory_order_relaxed);
+
+        vtbl[0].store(v[0], std::memory_order_release); // Publish
+        return true;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Class for efficient mapping of N vtbl-pointers to a value of type T.
+/// This version of the class is for use in the multi-threaded environment.
+/// The data structure is implemented in a lock-free manner.
+///
+/// Just like the single-threaded version, the map can only grow in size and it
+/// never moves the entries themselves, only the pointers to them. Unlike the
+/// single-threaded version, a published descriptor is never modified other
+/// than through CAS on its cache entries and is kept alive as long as some
+/// thread might still be using it.
+template <size_t N, typename T>
+class vtbl_map
+{
+private:
+
+    /// Type of the stored values, which is a tuple of vtbl-pointers and T value.
+    typedef atomic_stored_type_for<N,T> stored_type;
+
+    /// A chunk of entries. Chunks are allocated every time the cache grows and
+    /// are linked into a list that all the subsequent descriptors share.
+    /// Chunks are only deallocated by the destructor of vtbl_map.
+    struct entries_chunk
+    {
+        entries_chunk(size_t n, entries_chunk* nxt) : next(nxt), begin(dispatch_arena::new_array<stored_type>(n)), end(begin+n) {}
+       ~entries_chunk() { dispatch_arena::delete_array(begin); }
+
+        entries_chunk* const next;  ///< Older chunk
+        stored_type*   const begin; ///< First entry of the chunk
+        stored_type*   const end;   ///< One past the last entry of the chunk. \warning This value should never be dereferenced!
+
+    private:
+        entries_chunk(const entries_chunk&);            ///< No copy constructor
+        entries_chunk& operator=(const entries_chunk&); ///< No assignment operator
+    };
+
+    /// A helper data structure that is atomically swapped during updates to
+    /// cache parameters k and l. Once published, only the pointers in the
+    /// cache array may change.
+    struct cache_descriptor
+    {
+        /// Cache mask to access entries. Always cache_size-1 since cache_size is a power of 2
+        /// \note We currently rely in constructors on this member be first in
+        ///       declaration order so that it is initialized first!
+        const size_t cache_mask;
+
+        /// Optimal shift computed based on the vtbl pointers already in the map.
+        /// \note Unlike the single-threaded version, the value never changes
+        ///       after the descriptor is published.
+        bit_offset_t optimal_shift[N];
+
+        /// The newest chunk of entries. The list of chunks it starts contains
+        /// exactly size() entries.
+        entries_chunk* const entries;
+
+        /// Variable-sized array with actual pointers to stored_type
+        /// \warning: This must be the last member of this class!
+        std::atomic<stored_type*> cache[XTL_VARIABLE_SIZE_ARRAY];
+
+        #if defined(DBG_NEW)
+            #undef new
+        #endif
+
+        void* operator new(size_t, size_t log_size)
+        {
+            return dispatch_arena::allocate(bytes(size_t(1)<<log_size));
+        }
+
+        #if defined(DBG_NEW)
+            #define new DBG_NEW
+        #endif
+
+        /// We need to declare this placement delete operator since we overload new.
+        void operator delete(void* p, size_t log_size) { dispatch_arena::deallocate(p, bytes(size_t(1)<<log_size)); }
+
+        /// A delete expression does not know the size of the object. Use #destroy instead.
+        void operator delete(void*) XTL_DELETED;
+
+        /// Number of bytes taken by an object with the given number of slots
+        static size_t bytes(size_t n) { return sizeof(cache_descriptor) + (n-XTL_VARIABLE_SIZE_ARRAY)*sizeof(std::atomic<stored_type*>); }
+
+        /// Destroys and deallocates an object allocated with the above operator new
+        static void destroy(void* p) noexcept
+        {
+            if (cache_descriptor* d = static_cast<cache_descriptor*>(p))
+                dispatch_arena::destroy(d, bytes(d->size()));
+        }
+
+        /// Creates new cache_descriptor based on parameters k and l of the hashing function
+        cache_descriptor(
+            const size_t       log_size,               ///< Parameter k of the cache - the log of the size of the cache
+            const bit_offset_t shift = irrelevant_bits ///< Parameter l of the cache - number of irrelevant bits on the right to remove
+        ) :
+            cache_mask( (1<<log_size) - 1 ),
+            entries(new entries_chunk(1<<log_size, nullptr))
+        {
+            std::fill(&optimal_shift[0],&optimal_shift[N],shift);
+
+            for (size_t i = 0; i <= cache_mask; ++i)
+                cache[i].store(&entries->begin[i], std::memory_order_relaxed);
+        }
+
+        /// Creates new cache_descriptor based on parameters k and l of the
+        /// hashing function as well as a reference to the cache_descriptor it
+        /// is going to replace. The old descriptor remains fully functional.
+        cache_descriptor(
+            const size_t            log_size, ///< Parameter k of the cache - the log of the size of the cache
+            const bit_offset_t    (&shifts)[N],///< Parameter l of the cache - number of irrelevant bits on the right to remove
+            const cache_descriptor& old       ///< cache_descriptor we will supposedly replace
+        ) :
+            cache_mask( (1<<log_size) - 1 ),
+            entries(cache_mask > old.cache_mask ? new entries_chunk(cache_mask - old.cache_mask, old.entries) : old.entries)
+        {
+            XTL_ASSERT(cache_mask >= old.cache_mask); // Since we are going to inherit all its existing elements
+
+            array_copy(shifts,optimal_shift);
+
+            for (size_t i = 0; i <= cache_mask; ++i)
+                cache[i].store(nullptr, std::memory_order_relaxed);
+
+            // NOTE: We have to initialize the cache with addresses of actual
+            //       entries instead of copying the content of the old cache
+            //       because the old cache may still be changed by other threads
+            //       making us see some entries twice or none times. Entries
+            //       that become occupied while we do this will be brought into
+            //       their place lazily by get.
+            // NOTE: Each entry must be looked at exactly once as its state may
+            //       change while we are doing this. Published entries are put
+            //       in their place if possible, the rest fill the cache from
+            //       its end.
+            intptr_t v[N];
+            size_t   k = cache_mask;
+
+            for (entries_chunk* c = entries; c; c = c->next)
+                for (stored_type* p = c->begin; p != c->end; ++p)
+                {
+                    size_t j;
+
+                    if (p->load(v))
+                        for (j = cache_index(v); cache[j].load(std::memory_order_relaxed); j = lcg_next(j));
+                    else
+                        for (j = k; cache[j].load(std::memory_order_relaxed); j = --k) XTL_ASSERT(k);
+
+                    cache[j].store(p, std::memory_order_relaxed);
+                }
+        }
+
+        size_t     size() const { return cache_mask+1; }      ///< Number of entries in cache
+        size_t lcg_next(size_t j) const { return (lcg_a*j + lcg_c) & cache_mask; }
+
+        size_t memory_used() const
+        {
+            return sizeof(cache_descriptor)                                                // Descriptor itself
+                + (cache_mask+1-XTL_VARIABLE_SIZE_ARRAY)*sizeof(std::atomic<stored_type*>) // Pointers in cache
+                + (cache_mask+1)*sizeof(stored_type);                                      // Actual cached values pointers in cache point to
+        }
+
+        /// Global function computing cache index for a given vtbl pointers, offsets and cache mask
+        static inline size_t cache_index(const intptr_t vtbl[N], const bit_offset_t shifts[N], size_t cache_mask)
+        {
+            intptr_t vtbl_shifted[N];
+
+            for (size_t i = 0; i < N; ++i)
+                vtbl_shifted[i] = vtbl[i] >> shifts[i];
+
+            return interleave(vtbl_shifted) & cache_mask;
+        }
+
+        /// Computes cache index for current optimal offsets and cache mask.
+        size_t cache_index(const intptr_t vtbl[N]) const { return cache_index(vtbl,optimal_shift,cache_mask); }
+
+        /// Eagerly check if vtbl is elsewhere in the cache.
+        /// \note This might fail while vtbl is in the cache because
+        ///       some thread pulled the link out temporarily
+        inline stored_type* eager_find(const intptr_t (&vtbl)[N], std::atomic<stored_type*>*& pce) noexcept
+        {
+            for (size_t i = 0; i <= cache_mask; ++i)
+            {
+                std::atomic<stored_type*>& ce = cache[i];
+                stored_type* const st = ce.load(std::memory_order_acquire);
+
+                if (st->is_for(vtbl)) // if so ...
+                {
+                    pce = &ce;
+                    return st;
+                }
+            }
+
+            return nullptr;
+        }
+
+        /// Checks whether vtbl is among the entries and if so, waits until the
+        /// pointer to it reappears in the cache.
+        inline stored_type* thorough_find(const intptr_t (&vtbl)[N], std::atomic<stored_type*>*& pce) noexcept
+        {
+            for (entries_chunk* c = entries; c; c = c->next)
+                for (stored_type* p = c->begin; p != c->end; ++p)
+                    if (p->is_for(vtbl))
+                    {
+                        // Loop infinitely till we find it in cache
+                        for (;;)
+                            if (stored_type* q = eager_find(vtbl, pce))
+                                return q;
+                    }
+
+            return nullptr;
+        }
+
+        /// Finds vacant entry and returns the cache entry pointing to it
+        inline stored_type* find_vacant(std::atomic<stored_type*>*& pce) noexcept
+        {
+            for (size_t i = 0; i <= cache_mask; ++i)
+            {
+                std::atomic<stored_type*>& ce = cache[i];
+                stored_type* const st = ce.load(std::memory_order_acquire);
+
+                if (st->vacant())
+                {
+                    pce = &ce;
+                    return st;
+                }
+            }
+
+            return nullptr;
+        }
+
+        /// Looks up cache entry pointing to #what and replaces it atomically with value of #with
+        /// \warning The function assumes #what is present in cache
+        inline void replace(stored_type* const what, stored_type* const with) noexcept
+        {
+            while (true)
+            {
+                for (size_t i = 0; i <= cache_mask; ++i)
+                {
+                    std::atomic<stored_type*>& ce = cache[i];
+
+                    if (ce.load(std::memory_order_acquire) == what)
+                    {
+                        stored_type* expected = what;
+
+                        if (ce.compare_exchange_strong(expected, with)) // ce = with;
+                            return; // Replaced successfully
+                        else
+                            break;  // Someone updated ce, restart search
+                    }
+                }
+            }
+        }
+
+        /// Atomically swaps pointers in cache entries ce1 and *pce2 that were
+        /// seen pointing to st1 and st2 respectively.
+        /// \returns false if someone else has updated ce1 in the mean time
+        inline bool swap(std::atomic<stored_type*>& ce1, stored_type* st1, std::atomic<stored_type*>* pce2, stored_type* st2) noexcept
+        {
+            if (&ce1 == pce2)
+                return true;
+
+            if (!ce1.compare_exchange_strong(st1, st2)) // ce1 = st2;
+                return false;
+
+            // Now both ce1 and ce2 point to *st2
+            stored_type* expected2 = st2;
+
+            if (!pce2->compare_exchange_strong(expected2, st1))
+            {
+                // This means another thread managed to update ce2.
+                // Find any cache entry pointing to *st2 and update it atomically to point to *st1
+                replace(st2,st1);
+            }
+
+            return true;
+        }
+
+        /// Main function that will be used to get a reference to the stored
+        /// element on the slow path. Inserts vtbl when it is not yet present.
+        /// \returns nullptr when there are no vacant entries left
+        stored_type* get(const intptr_t (&vtbl)[N], std::atomic<size_t>& used) noexcept
+        {
+            std::atomic<stored_type*>& ce1 = cache[cache_index(vtbl)]; // Location where it should be
+
+            for (;;)
+            {
+                stored_type* const st1 = ce1.load(std::memory_order_acquire); // atomically get value in that location since it may change
+
+                XTL_ASSERT(st1);   // Since we pre-allocate all entries
+
+                if (st1->is_for(vtbl))
+                    return st1;
+
+                std::atomic<stored_type*>* pce2;
+                stored_type* st2 = eager_find(vtbl,pce2);
+
+                if (st2 || (st2 = thorough_find(vtbl,pce2))) // vtbl is already in the cache
+                {
+                    if (swap(ce1,st1,pce2,st2))
+                        return st2;
+                    else
+                        continue; // Another thread managed to update ce1
+                }
+
+                // vtbl is not in the cache
+                st2 = find_vacant(pce2);
+
+                if (!st2)
+                    return nullptr; // There are no empty slots
+
+                if (st2->claim(vtbl))
+                {
+                    used.fetch_add(1, std::memory_order_relaxed);
+                    swap(ce1,st1,pce2,st2); // Bring it to its place if we can
+                    return st2;
+                }
+
+                // Another thread claimed the entry first, possibly for the same vtbl: restart
+            }
+        }
+
+        /// Computes the number of entries an existing set of vtbl-pointer tuples
+        /// extended with the new one will occupy in cache of a given #log_size
+        /// with given #offsets
+        size_t entries_for(const intptr_t (&vtbl)[N], size_t log_size, const bit_offset_t (&offsets)[N]) const;
+
+    private:
+
+        cache_descriptor(const cache_descriptor&);            ///< No copy constructor
+        cache_descriptor& operator=(const cache_descriptor&); ///< No assignment operator
+
+    }; // of class cache_descriptor
+
+    /// Helpers to collect vtbl pointers of polymorphic subjects only
+    template <typename S>
+    static inline void collect(const S* s, intptr_t* vtbl, size_t& i, std::true_type)  noexcept { vtbl[i++] = vtbl_of(s); }
+    template <typename S>
+    static inline void collect(const S*,   intptr_t*,      size_t&,   std::false_type) noexcept {}
+
+private:
+
+    vtbl_map(const vtbl_map&);            ///< No copy constructor
+    vtbl_map& operator=(const vtbl_map&); ///< No assignment operator
+
+public:
+
+#if XTL_DUMP_PERFORMANCE
+    #if defined(DBG_NEW)
+        #undef new
+    #endif
+    vtbl_map(const char* fl, size_t ln, const char* fn, const vtbl_count_t& num_clauses) :
+        descriptor(new(min_log_size) cache_descriptor(min_log_size)),
+        used(0),
+        case_clauses(num_clauses),
+        last_table_size(0),
+        collisions_before_update(initial_collisions_before_update),
+        prev_collisions_before_update(initial_collisions_before_update),
+        frozen(false),
+        sealed(nullptr),
+        file(fl),
+        line(ln),
+        func(fn),
+        updates(0),
+        hits(0),
+        misses(0),
+        collisions(0)
+    {
+        register_for_warm_up();
+        register_for_statistics();
+    }
+    #if defined(DBG_NEW)
+        #define new DBG_NEW
+    #endif
+#endif
+
+    #if defined(DBG_NEW)
+        #undef new
+    #endif
+    vtbl_map(const vtbl_count_t& num_clauses) :
+        descriptor(new(min_log_size) cache_descriptor(min_log_size)),
+        used(0),
+        case_clauses(num_clauses),
+        last_table_size(0),
+        collisions_before_update(initial_collisions_before_update),
+        prev_collisions_before_update(initial_collisions_before_update),
+        frozen(false),
+        sealed(nullptr)
+        XTL_DUMP_PERFORMANCE_ONLY(,file("unspecified"), line(0), func("unspecified"), updates(0), hits(0), misses(0), collisions(0))
+    {
+        register_for_warm_up();
+        XTL_DUMP_PERFORMANCE_ONLY(register_for_statistics());
+    }
+    #if defined(DBG_NEW)
+        #define new DBG_NEW
+    #endif
+
+   ~vtbl_map()
+    {
+        XTL_DUMP_PERFORMANCE_ONLY(std::clog << *this << std::endl);
+        XTL_DUMP_PERFORMANCE_ONLY(stats_registry::remove(statistics));
+        warm_up_registry::remove(registration);
+        sealed_table<N,stored_type>::destroy(sealed.load());
+
+        cache_descriptor* dsc = descriptor.load();
+
+        for (entries_chunk* c = dsc->entries; c; )
+        {
+            entries_chunk* next = c->next;
+            delete c;
+            c = next;
+        }
+
+        cache_descriptor::destroy(dsc);
+    }
+
+    size_t memory_used() const
+    {
+        return sizeof(vtbl_map) + descriptor.load()->memory_used();
+    }
+
+    /// This is the main function to get the value of type T associated with
+    /// the (vtbl0,...,vtblN) of given pointers.
+    ///
+    /// \note The function returns the value "by reference" to indicate that you
+    ///       may take address or change the value of the cell! The reference
+    ///       remains valid for the lifetime of the map.
+    inline T& get(const intptr_t (&vtbl)[N]) noexcept
+    {
+    #if XTL_THREAD_CACHE_LOG_SIZE
+        if (T* cached = thread_cache::find(owner, vtbl))
+            return *cached; // Repeated hit served without touching anything shared
+
+        T& result = shared_get(vtbl);
+        thread_cache::store(owner, vtbl, result);
+        return result;
+    #else
+        return shared_get(vtbl);
+    #endif
+    }
+
+    /// Overload taking pointers to subjects of Match statement, where only
+    /// pointers to polymorphic subjects are taken into account.
+    template <typename... S>
+    inline T& get(const S*... s) noexcept
+    {
+        intptr_t vtbl[N];
+        size_t   i = 0;
+        int dummy[] = {0, (collect(s, vtbl, i, std::integral_constant<bool,std::is_polymorphic<S>::value>()),0)...};
+        XTL_UNUSED(dummy);
+        XTL_ASSERT(i == N);
+        return get(vtbl);
+    }
+
+    /// Same as above, but uses XTL subtyping to determine which subjects should be taken into account.
+    template <typename... S>
+    inline T& xtl_get(const S*... s) noexcept
+    {
+        intptr_t vtbl[N];
+        size_t   i = 0;
+        int dummy[] = {0, (collect(s, vtbl, i, std::integral_constant<bool,xtl::is_poly_morphic<S>::value>()),0)...};
+        XTL_UNUSED(dummy);
+        XTL_ASSERT(i == N);
+        return get(vtbl);
+    }
+
+    /// A function that gets called when the cache is either too inefficient or full.
+    T& update(const intptr_t (&vtbl)[N]);
+
+    /// Seeds the map with all the N-tuples of the given vtbl-pointers, so that
+    /// it reaches its final size and hashing parameters before it is used.
+    /// \note Values associated with the seeded tuples are default-constructed.
+    void warm_up(const intptr_t* vtbls, size_t n)
+    {
+        if (!n)
+            return;
+
+        size_t   idx[N] = {};
+        intptr_t vtbl[N];
+
+        for (;;)
+        {
+            for (size_t i = 0; i < N; ++i)
+                vtbl[i] = vtbls[idx[i]];
+
+            get(vtbl);
+
+            // Advance to the next tuple
+            size_t i = 0;
+
+            while (i < N && ++idx[i] == n)
+                idx[i++] = 0;
+
+            if (i == N)
+                break;
+        }
+    }
+
+    /// Rearranges the map one last time and stops it from rearranging itself
+    /// on collisions afterwards. The map still grows when it runs out of space.
+    /// \returns Whether the map was also sealed (see #seal)
+    bool freeze()
+    {
+        intptr_t vtbl[N];
+
+        epoch_domain<>::enter(); // The descriptor might be retired by a concurrent update
+
+        const bool found = first_tuple(descriptor.load(std::memory_order_acquire), vtbl);
+
+        epoch_domain<>::quiescent(); // Only the copied vtbl-pointers are used past this point
+
+        if (found)
+            update(vtbl); // The tuple is already in the map, so this only looks for better parameters
+
+        frozen.store(true, std::memory_order_relaxed);
+        return seal();
+    }
+
+    /// Builds a collision-free hash over the vtbl-pointer tuples currently in
+    /// the map, through which those colliding in the regular cache are found
+    /// with a single extra probe. Tuples added later are still found through
+    /// the regular cache.
+    /// \returns false when no collision-free hash function was found
+    bool seal()
+    {
+        epoch_domain<>::enter();
+
+        const cache_descriptor* dsc = descriptor.load(std::memory_order_acquire);
+        std::vector<std::pair<std::uintptr_t,stored_type*>> entries;
+        bit_offset_t shifts[N];
+        intptr_t     vtbl[N];
+
+        array_copy(dsc->optimal_shift, shifts);
+
+        for (entries_chunk* c = dsc->entries; c; c = c->next)
+            for (stored_type* p = c->begin; p != c->end; ++p)
+                if (p->load(vtbl))
+                    entries.push_back(std::make_pair(perfect_hash_key(vtbl,shifts), p));
+
+        epoch_domain<>::quiescent(); // Entries are owned by the map, so only the descriptor was protected
+
+        sealed_table<N,stored_type>* t = sealed_table<N,stored_type>::build(entries, shifts, XTL_SEAL_MAX_LOG_INC);
+
+        if (!t)
+            return false;
+
+        if (sealed_table<N,stored_type>* old = sealed.exchange(t, std::memory_order_acq_rel))
+            epoch_domain<>::retire(old, &sealed_table<N,stored_type>::destroy); // Other threads might still be probing it
+
+        return true;
+    }
+
+#if XTL_DUMP_PERFORMANCE
+    std::ostream& operator>>(std::ostream& os) const;
+    friend std::ostream& operator<<(std::ostream& os, const vtbl_map& m) { return m >> os; }
+
+    /// Records the location of the match statement this map belongs to
+    bool locate(const char* fl, size_t ln, const char* fn) noexcept
+    {
+        file = fl;
+        line = ln;
+        func = fn;
+        return true;
+    }
+
+    /// Fills in the current statistics of the map. Counters of other threads
+    /// are read without synchronization and thus may lag behind slightly.
+    void snapshot(dispatch_stats& s) const
+    {
+        s.file       = file;
+        s.line       = line;
+        s.func       = func;
+        s.arity      = N;
+        s.hits       = hits;
+        s.misses     = misses;
+        s.collisions = collisions;
+        s.updates    = updates;
+        epoch_domain<>::enter(); // The descriptor might be replaced meanwhile
+        s.cache_size = descriptor.load(std::memory_order_acquire)->cache_mask + 1;
+        epoch_domain<>::quiescent();
+        s.entries    = used.load(std::memory_order_relaxed);
+        s.memory     = memory_used();
+    }
+#endif
+
+private:
+
+#if XTL_THREAD_CACHE_LOG_SIZE
+    /// Per-thread cache shared by all the maps of this type
+    typedef thread_vtbl_cache<N,T> thread_cache;
+#endif
+
+    /// Registers the map in #warm_up_registry
+    void register_for_warm_up() noexcept
+    {
+        registration.object  = this;
+        registration.arity   = N;
+        registration.warm_up = [](void* m, const intptr_t* vtbls, size_t n) { static_cast<vtbl_map*>(m)->warm_up(vtbls,n); };
+        registration.freeze  = [](void* m) { return static_cast<vtbl_map*>(m)->freeze(); };
+        warm_up_registry::add(registration);
+    }
+
+#if XTL_DUMP_PERFORMANCE
+    /// Registers the map in #stats_registry
+    void register_for_statistics() noexcept
+    {
+        statistics.object   = this;
+        statistics.snapshot = [](const void* m, dispatch_stats& s) { static_cast<const vtbl_map*>(m)->snapshot(s); };
+        stats_registry::add(statistics);
+    }
+#endif
+
+    /// Copies into \a vtbl the vtbl-pointers of the first tuple in the map.
+    /// \returns false when the map has no entries yet
+    static bool first_tuple(const cache_descriptor* dsc, intptr_t (&vtbl)[N]) noexcept
+    {
+        for (const entries_chunk* c = dsc->entries; c; c = c->next)
+            for (const stored_type* p = c->begin; p != c->end; ++p)
+                if (p->load(vtbl))
+                    return true;
+
+        return false;
+    }
+
+    /// Looks up the value associated with the vtbl-pointers in the data 
+    /// shared by all the threads, updating it when needed.
+    inline T& shared_get(const intptr_t (&vtbl)[N]) noexcept
+    {
+        epoch_domain<>::enter(); // Announce the epoch this thread is in before it loads the descriptor
+
+        cache_descriptor* const dsc = descriptor.load(std::memory_order_acquire); // Load atomic value for this thread since it may change
+        stored_type*      const st  = dsc->cache[dsc->cache_index(vtbl)].load(std::memory_order_acquire);
+
+        XTL_ASSERT(st);   // Since we pre-allocate all entries
+
+        if (XTL_LIKELY(st->is_for(vtbl)))
+        {
+            XTL_DUMP_PERFORMANCE_ONLY(++hits);
+            epoch_domain<>::exit();
+            return st->value;
+        }
+        else
+        {
+            if (const sealed_table<N,stored_type>* const s = sealed.load(std::memory_order_acquire)) // Checked only on collisions, so that maps that are never sealed keep their hit path
+            {
+                stored_type* const se = s->find(vtbl); // The only place it can be
+
+                if (XTL_LIKELY(se->is_for(vtbl)))
+                {
+                    XTL_DUMP_PERFORMANCE_ONLY(++hits);
+                    epoch_domain<>::exit();
+                    return se->value;
+                }
+            }
+
+            T& result = miss(dsc,st,vtbl);
+            epoch_domain<>::quiescent(); // This thread holds no descriptor pointers past this point
+            return result;
+        }
+    }
+
+    /// Slow path of #get taken out of line to keep the hit path small
+    T& miss(cache_descriptor* dsc, stored_type* st, const intptr_t (&vtbl)[N]) noexcept
+    {
+        XTL_DUMP_PERFORMANCE_ONLY(++misses);
+        XTL_DUMP_PERFORMANCE_ONLY(if (st->occupied()) ++collisions);
+
+        const size_t u = used.load(std::memory_order_relaxed);
+
+        if (XTL_UNLIKELY(
+            u > dsc->cache_mask                       // No entries left for possibly new vtbl in the cache
+            || (st->occupied()                        // Collision - the entry for vtbl is already occupied
+            && !frozen.load(std::memory_order_relaxed)// We were not asked to keep current arrangement
+            && --collisions_before_update <= 0        // We had sufficiently many collisions to justify call
+            && u != last_table_size)))                // There was at least one vtbl added since last update
+            return update(vtbl);                      // try to rearrange cache
+
+        // Find entry with our vtbl and update cache if needed
+        if (stored_type* res = dsc->get(vtbl,used))
+            return res->value;
+        else
+            return update(vtbl); // call to get will fail only when the cache is full
+    }
+
+#if XTL_THREAD_CACHE_LOG_SIZE
+    /// Unique id of this map that tags its values in the per-thread cache
+    const size_t owner = thread_cache::new_owner();
+#endif
+
+    /// Cached mappings of vtbl to some indecies
+    std::atomic<cache_descriptor*> descriptor;
+
+    /// Total number of vtbl-pointer tuples in all the entries. Unlike the
+    /// single-threaded version this is not a property of a descriptor since
+    /// entries are shared among descriptors and can be claimed through any.
+    std::atomic<size_t> used;
+
+    /// A reference to a global variable that will be initialized with the
+    /// number of case clauses of a given match statement
+    const vtbl_count_t& case_clauses;
+
+    /// Memoized table.size() during last cache rearranging
+    std::atomic<size_t> last_table_size;
+
+    /// Number of colisions that we will still tolerate before next update
+    std::atomic<int> collisions_before_update;
+
+    /// Previous number of colisions that we will still tolerate before next update
+    std::atomic<int> prev_collisions_before_update;
+
+    /// Whether collisions should no longer trigger rearrangement of the cache
+    std::atomic<bool> frozen;
+
+    /// Collision-free table over the tuples the map had when it was sealed.
+    /// nullptr until the map is sealed.
+    std::atomic<sealed_table<N,stored_type>*> sealed;
+
+    /// Registration of this map in #warm_up_registry
+    warm_up_registry::record registration;
+
+#if XTL_DUMP_PERFORMANCE
+    const char*   file;      ///< File in which this vtblmap_of is instantiated
+    size_t        line;      ///< Line in the file where it is instantiated
+    const char*   func;      ///< Function in which this vtblmap_of is instantiated
+    stats_counter updates;   ///< Amount of reconfigurations performed at run time
+    stats_counter hits;      ///< The number of cache hits
+    stats_counter misses;    ///< The number of cache misses
+    stats_counter collisions;///< Out of all the misses, how many were actual collisions
+
+    /// Registration of this map in #stats_registry
+    stats_registry::record statistics;
+#endif
+
+};
+
+//------------------------------------------------------------------------------
+
+template <size_t N, typename T>
+size_t vtbl_map<N,T>::cache_descriptor::entries_for(const intptr_t (&vtbl)[N], size_t log_size, const bit_offset_t (&offsets)[N]) const
+{
+    // NOTE: See notes on the single-threaded version of this function.
+    const intptr_t new_cache_mask       = (1<<log_size)-1; // Actual cache mask for the hash function
+    const intptr_t max_stack_mask       = (1<<(max_stack_log_size+3))-1; // Mask for the largest number of bits we are allowed to allocate on stack: +3 is *8 for the number of bits in the allowed stack size
+    const size_t   cache_histogram_size = 1 + std::min(new_cache_mask,max_stack_mask)/XTL_BIT_SIZE(intptr_t); // Number of elements in intptr_t array allocated on the stack
+    XTL_VLAZ(cache_histogram, intptr_t, cache_histogram_size, 1 + max_stack_mask/XTL_BIT_SIZE(intptr_t)); // Declares intptr_t cache_histogram[cache_histogram_size] = {0};
+    XTL_BIT_SET(cache_histogram, cache_index(vtbl,offsets,new_cache_mask) & max_stack_mask); // Mark the entry for new vtbl
+
+    intptr_t v[N];
+
+    // Iterate over all the entries and see where they are mapped with log size i and offset j
+    for (const entries_chunk* c = entries; c; c = c->next)
+        for (const stored_type* p = c->begin; p != c->end; ++p)
+            if (p->load(v))
+                XTL_BIT_SET(cache_histogram, cache_index(v,offsets,new_cache_mask) & max_stack_mask); // Mark the entry for each vtbl
+
+    size_t entries = 0;
+
+    // Count the number of used entries
+    for (size_t h = 0; h < cache_histogram_size; ++h)
+        entries += bits_set(cache_histogram[h]);
+
+    return entries;
+}
+
+//------------------------------------------------------------------------------
+
+template <size_t N, typename T>
+T& vtbl_map<N,T>::update(const intptr_t (&vtbl)[N])
+{
+    XTL_DUMP_PERFORMANCE_ONLY(++updates); // Record update
+
+ReStart:
+
+    cache_descriptor* dsc = descriptor.load(std::memory_order_acquire); // Load atomic value for this thread since it may change
+
+    XTL_ASSERT(dsc); // Allocated in constructor, deallocated in destructor, atomically replaced
+
+    intptr_t prev[N];
+    intptr_t diff[N] = {};
+    intptr_t v[N];
+
+    array_copy(vtbl,prev);
+
+    // Compute bits in which existing vtbl, including the newly added one, differ
+    for (entries_chunk* c = dsc->entries; c; c = c->next)
+        for (stored_type* p = c->begin; p != c->end; ++p)
+            if (p->load(v))
+                for (size_t s = 0; s < N; s++)
+                {
+                    diff[s] |= prev[s] ^ v[s];
+                    prev[s] = v[s];
+                }
+
+    const size_t u  = used.load(std::memory_order_relaxed);
+    bit_offset_t k  = bit_offset_t(req_bits(dsc->cache_mask));           // current log_size
+    bit_offset_t n  = bit_offset_t(req_bits(u));                          // needed  log_size
+    bit_offset_t c  = bit_offset_t(req_bits(case_clauses));               // log_size estimate. NOTE: case_clauses will be initialized by now
+    bit_offset_t l1 = std::max(std::max(k,c),n);                          // lower bound for log_size iteration
+    bit_offset_t l2 = std::max(std::max(k,c),bit_offset_t(n+max_log_inc));// upper bound for log_size iteration
+    bit_offset_t no = l1; // current estimate of the best log_size
+    bit_offset_t zo[N];   // current estimate of the best offset
+    bit_offset_t m[N];    // highest bit in which vtbls differ
+    bit_offset_t z[N];    // lowest bits in which vtbls do not differ
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (diff[i])  // We have to check for non-zero as trailing_zeros will return -127 for 0
+        {
+            m[i] = bit_offset_t(req_bits(diff[i])); // highest bit in which vtbls differ
+            z[i] = bit_offset_t(trailing_zeros(static_cast<unsigned int>(diff[i]))); // lowest bits in which vtbls do not differ.
+        }
+        else
+            m[i] = z[i] = dsc->optimal_shift[i];
+    }
+
+    size_t max_cache_entries = dsc->entries_for(vtbl, l1, dsc->optimal_shift);
+    array_copy(dsc->optimal_shift,zo); // Copy current solution as current optimal
+
+    // Iterate over allowed log sizes
+    for (bit_offset_t i = l1; i <= l2; ++i)
+    {
+        // Try to improve independently each argument position
+        for (size_t s = 0; s < N; ++s)
+        {
+            bit_offset_t bits_in_arg_mask = (i+N-1-s)/N;
+            bit_offset_t mm = m[s] > bits_in_arg_mask && m[s] - bits_in_arg_mask >= z[s] ? m[s] - bits_in_arg_mask : m[s];
+            bit_offset_t cur = zo[s];
+
+            for (bit_offset_t t = z[s]; t <= mm; ++t)
+            {
+                if (t != cur)
+                {
+                    zo[s] = t;
+
+                    size_t entries = dsc->entries_for(vtbl, i, zo); // Count the number of used entries
+
+                    // Update best estimates
+                    if (entries > max_cache_entries)
+                    {
+                        max_cache_entries = entries;
+                        no  = i;
+                        cur = t;
+
+                        if (entries == u+1)
+                        {
+                            // We found size and offset without conflicts, exit both loops
+                            i = l2+1; // to exit both for loops
+                            zo[s] = cur;
+                            goto break_of_both_loops;
+                        }
+                    }
+                }
+            }
+
+            zo[s] = cur;
+        } // of loop over argument positions
+
+break_of_both_loops: ;
+
+    } // of loop over possible log sizes
+
+    if (no < k)
+        no = k; // We never shrink, while we preallocate based on number of case clauses or the minimum
+
+    if (no != k || !array_equal(dsc->optimal_shift,zo))
+    {
+        // OK, either log size or optimal shifts changed. Reset collisions counter to default one
+        prev_collisions_before_update = case_clauses ? case_clauses : N*initial_collisions_before_update;
+        collisions_before_update      = prev_collisions_before_update.load();
+
+        #if defined(DBG_NEW)
+            #undef new
+        #endif
+        cache_descriptor* new_dsc = new(no) cache_descriptor(no,zo,*dsc);
+        #if defined(DBG_NEW)
+            #define new DBG_NEW
+        #endif
+
+        if (descriptor.compare_exchange_strong(dsc, new_dsc)) // descriptor = new_dsc;
+        {
+            // We successfully updated descriptor. Other threads might still
+            // be using the old one, so we let reclamation decide when to delete it.
+            epoch_domain<>::retire(dsc, &cache_descriptor::destroy);
+            dsc = new_dsc;
+        }
+        else
+        {
+            // Someone else has replaced descriptor in the mean time.
+            // dsc now holds the new value of descriptor.
+            if (no != k)
+                delete new_dsc->entries; // Only the newly allocated chunk is ours
+            cache_descriptor::destroy(new_dsc);
+        }
+    }
+    else
+    {
+        // Update hasn't changed anything, increase the number of colisions before next update
+        prev_collisions_before_update = prev_collisions_before_update*2;
+        collisions_before_update      = prev_collisions_before_update.load();
+    }
+
+    if (stored_type* res = dsc->get(vtbl,used))
+    {
+        XTL_ASSERT(res->is_for(vtbl));
+        last_table_size = used.load(std::memory_order_relaxed); // Update memoized value
+        return res->value;
+    }
+    else
+        goto ReStart; // Some other thread took the last vacant entry
+}
+
+//------------------------------------------------------------------------------
+
+#if XTL_DUMP_PERFORMANCE
+template <size_t N, typename T>
+std::ostream& vtbl_map<N,T>::operator>>(std::ostream& os) const
+{
+    std::ios::fmtflags fmt = os.flags(); // store flags
+    const cache_descriptor* dsc = descriptor.load();
+
+    os  << " clauses="    << std::setw(4) << case_clauses // Number of case clauses in the match statement
+        << " total="      << std::setw(5) << used.load()  // Total number of vtbl pointers seen
+        << " log_size="   << std::setw(2) << req_bits(dsc->cache_mask) // log2 size required
+        << " updates="    << std::setw(2) << updates      // how many updates have been performed on the cache
+        << " hits="       << std::setw(8) << hits         // how many hits have we had
+        << " misses="     << std::setw(8) << misses       // how many misses have we had
+        << " collisions=" << std::setw(8) << collisions   // how many misses were actual collisions
+        << " memory="     << std::setw(8) << memory_used()// number of bytes used
+        << " Stmt: "      << file << '[' << line << ']' << ' ' << func
+        << ";\n";
+    os.flags(fmt);
+    return os;
+}
+#endif
+
+//------------------------------------------------------------------------------
+
+} // of namespace mch
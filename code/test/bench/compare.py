@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+#  Mach7: Pattern Matching Library for C++
+#
+#  Copyright 2014 Yuriy Solodkyy.
+#  All rights reserved.
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions are met:
+#
+#      * Redistributions of source code must retain the above copyright
+#        notice, this list of conditions and the following disclaimer.
+#
+#      * Redistributions in binary form must reproduce the above copyright
+#        notice, this list of conditions and the following disclaimer in the
+#        documentation and/or other materials provided with the distribution.
+#
+#      * Neither the names of Mach7 project nor the names of its contributors
+#        may be used to endorse or promote products derived from this software
+#        without specific prior written permission.
+#
+#  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+#  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+#  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+#  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+#  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+#  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+#  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+#  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+#  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+#  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+"""Compares two JSON reports of mach7-bench and flags regressions.
+
+Usage: compare.py [--threshold PCT] [--alpha P] [--metric cpu_time|real_time]
+                  baseline.json contender.json
+
+The reports are produced with --benchmark_out=FILE --benchmark_out_format=json.
+When both reports contain individual repetitions (--benchmark_repetitions=N
+with N >= 3), a change of the median is only reported when the Mann-Whitney U
+test says the two samples are unlikely to come from the same distribution.
+Otherwise the medians (or single runs) are compared against the threshold
+alone. The exit status is 1 when at least one benchmark regressed.
+"""
+
+import argparse
+import json
+import math
+import sys
+
+TIME_UNITS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+
+def load(path, metric):
+    """Returns {benchmark name: list of times in ns} for the given report."""
+    with open(path) as f:
+        report = json.load(f)
+
+    runs = {}
+    aggregates = {}
+
+    for b in report.get('benchmarks', []):
+        name = b.get('run_name', b['name'])
+        scale = TIME_UNITS[b.get('time_unit', 'ns')]
+
+        if b.get('run_type') == 'aggregate':
+            if b.get('aggregate_name') == 'median':
+                aggregates[name] = [b[metric] * scale]
+        else:
+            runs.setdefault(name, []).append(b[metric] * scale)
+
+    # Reports written with --benchmark_report_aggregates_only have medians only
+    for name, times in aggregates.items():
+        runs.setdefault(name, times)
+
+    return runs
+
+
+def median(xs):
+    s = sorted(xs)
+    n = len(s)
+    return s[n // 2] if n % 2 else (s[n // 2 - 1] + s[n // 2]) / 2.0
+
+
+def mann_whitney_p(xs, ys):
+    """Two-sided p-value of Mann-Whitney U test in normal approximation."""
+    values = sorted([(v, 0) for v in xs] + [(v, 1) for v in ys])
+    ranks = [0.0] * len(values)
+    ties = 0.0
+    i = 0
+
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+
+    n1, n2 = len(xs), len(ys)
+    n = n1 + n2
+    r1 = sum(r for r, (_, g) in zip(ranks, values) if g == 0)
+    u = r1 - n1 * (n1 + 1) / 2.0
+    mu = n1 * n2 / 2.0
+    sigma = math.sqrt(n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1))))
+
+    if sigma == 0:
+        return 1.0
+
+    z = (abs(u - mu) - 0.5) / sigma
+    return max(0.0, min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2))))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('baseline')
+    parser.add_argument('contender')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='smallest change of median in percent to report (default: 5)')
+    parser.add_argument('--alpha', type=float, default=0.05,
+                        help='significance level of Mann-Whitney U test (default: 0.05)')
+    parser.add_argument('--metric', choices=('cpu_time', 'real_time'), default='cpu_time')
+    args = parser.parse_args()
+
+    old = load(args.baseline, args.metric)
+    new = load(args.contender, args.metric)
+    width = max([len(n) for n in old] + [len(n) for n in new] + [9])
+    regressions = 0
+
+    print('%-*s %12s %12s %8s %7s  %s' % (width, 'Benchmark', 'Baseline', 'Contender', 'Change', 'p', 'Verdict'))
+
+    for name in sorted(set(old) | set(new)):
+        if name not in old or name not in new:
+            print('%-*s %s' % (width, name, 'only in ' + (args.baseline if name in old else args.contender)))
+            continue
+
+        a, b = median(old[name]), median(new[name])
+        change = (b - a) / a * 100.0 if a else 0.0
+        p = mann_whitney_p(old[name], new[name]) if min(len(old[name]), len(new[name])) >= 3 else None
+        significant = abs(change) >= args.threshold and (p is None or p < args.alpha)
+        verdict = ('REGRESSION' if change > 0 else 'improvement') if significant else ''
+        regressions += verdict == 'REGRESSION'
+
+        print('%-*s %10.1fns %10.1fns %+7.1f%% %7s  %s' % (width, name, a, b, change, '-' if p is None else '%.3f' % p, verdict))
+
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
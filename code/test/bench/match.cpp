@@ -0,0 +1,214 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Compares the flavours of Match statement on the same closed hierarchy. Each
+/// benchmark dispatches on the same sequence of subjects as BM_unary<visit> in
+/// type_switch.cpp, arranged either sequentially or randomly.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/match.hpp>                 // Support for Match statement
+#include <mach7/patterns/constructor.hpp>  // Support for constructor patterns used by MatchS
+#include "shapes.hpp"
+
+//------------------------------------------------------------------------------
+
+namespace bench
+{
+/// The same hierarchy as a discriminated union for MatchU
+struct ShapeADT
+{
+    ShapeADT(size_t kind) : m_kind(kind), m_size(kind*7+1) {}
+
+    size_t m_kind;
+    size_t m_size;
+};
+} // of namespace bench
+
+//------------------------------------------------------------------------------
+
+namespace mch ///< Mach7 library namespace
+{
+template <>         struct bindings<bench::Shape>      { KS(bench::Shape::m_kind); KV(bench::Shape,NUMBER_OF_SHAPES); };
+#define FOR_EACH_MAX NUMBER_OF_SHAPES-1
+#define FOR_EACH_N(N) template <> struct bindings<bench::shape_kind<N>> { KV(bench::Shape,N); BCS(bench::shape_kind<N>,bench::Shape); Members(bench::shape_kind<N>::m_size); };
+#include "../time/loop_over_numbers.hpp"
+#undef  FOR_EACH_N
+#undef  FOR_EACH_MAX
+template <>         struct bindings<bench::ShapeADT>   { KS(bench::ShapeADT::m_kind); };
+template <size_t N> struct bindings<bench::ShapeADT,N> { KV(bench::ShapeADT,N); Members(bench::ShapeADT::m_size); };
+} // of namespace mch
+
+//------------------------------------------------------------------------------
+
+using namespace bench;
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t match_p(const Shape& s)
+{
+    MatchP(s)
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) CaseP(shape_kind<N>) return N;
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    EndMatchP
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t match_k(const Shape& s)
+{
+    MatchK(s)
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) CaseK(shape_kind<N>) return N;
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    EndMatchK
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t match_f(const Shape& s)
+{
+    MatchF(s)
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) CaseF(shape_kind<N>) return N;
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    EndMatchF
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t match_u(const ShapeADT& s)
+{
+    MatchU(s)
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) CaseU(N) return N;
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    EndMatchU
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t match_s(const Shape& s)
+{
+    MatchS(s)
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) CaseS(shape_kind<N>) return N;
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    EndMatchS
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+/// Times dispatch of function f over the objects of the hierarchy. The range
+/// argument selects sequential (0) or random (1) order of the subjects.
+template <size_t (*f)(const Shape&)>
+void BM_dispatch(benchmark::State& state)
+{
+    shapes subjects(state.range(0) != 0);
+
+    for (auto _ : state)
+        for (size_t i = 0; i < subjects.size(); ++i)
+            benchmark::DoNotOptimize(f(*subjects[i]));
+
+    state.SetItemsProcessed(state.iterations()*subjects.size());
+}
+
+//------------------------------------------------------------------------------
+
+void BM_MatchU(benchmark::State& state)
+{
+    std::vector<size_t>   kinds = make_kinds(state.range(0) != 0);
+    std::vector<ShapeADT> subjects(kinds.begin(), kinds.end());
+
+    for (auto _ : state)
+        for (size_t i = 0; i < subjects.size(); ++i)
+            benchmark::DoNotOptimize(match_u(subjects[i]));
+
+    state.SetItemsProcessed(state.iterations()*subjects.size());
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK_TEMPLATE(BM_dispatch, match_p)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_dispatch, match_k)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_dispatch, match_f)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_dispatch, match_s)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK(BM_MatchU)->ArgName("random")->Arg(0)->Arg(1);
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Compares memoized_cast to dynamic_cast on a hierarchy with virtual
+/// inheritance, where the offsets of casts depend on the dynamic type of the
+/// subject. Casts to targets declared up front with XTL_CAST_TARGETS are timed
+/// separately from those discovered on the fly.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/memoized_cast.hpp>         // Support for memoized dynamic_cast
+#include "shapes.hpp"
+
+//------------------------------------------------------------------------------
+
+/// The same diamond is instantiated twice: targets of casts from A<1> are
+/// declared, while those from A<0> are not.
+template <int H> struct A                { virtual ~A() {} size_t m_a; };
+template <int H> struct B : virtual A<H> { size_t m_b; };
+template <int H> struct C : virtual A<H> { size_t m_c; };
+template <int H> struct D : B<H>, C<H>   { size_t m_d; };
+template <int H> struct E : D<H>         { size_t m_e; };
+
+XTL_CAST_TARGETS(A<1>, B<1>, C<1>, D<1>, E<1>)
+
+//------------------------------------------------------------------------------
+
+/// Creates objects of all the classes of the diamond in the given order
+template <int H>
+std::vector<A<H>*> make_diamonds(bool random)
+{
+    std::vector<size_t> kinds = bench::make_kinds(random, 4);
+    std::vector<A<H>*>  objects;
+
+    for (size_t i = 0; i < kinds.size(); ++i)
+        switch (kinds[i])
+        {
+        case 0: objects.push_back(new B<H>); break;
+        case 1: objects.push_back(new C<H>); break;
+        case 2: objects.push_back(new D<H>); break;
+        case 3: objects.push_back(new E<H>); break;
+        }
+
+    return objects;
+}
+
+//------------------------------------------------------------------------------
+
+template <int H>
+void cleanup(std::vector<A<H>*>& objects)
+{
+    for (size_t i = 0; i < objects.size(); ++i)
+        delete objects[i];
+}
+
+//------------------------------------------------------------------------------
+
+/// Times cross-casts and down-casts to C with dynamic_cast
+void BM_dynamic_cast(benchmark::State& state)
+{
+    std::vector<A<0>*> objects = make_diamonds<0>(state.range(0) != 0);
+
+    for (auto _ : state)
+        for (size_t i = 0; i < objects.size(); ++i)
+            benchmark::DoNotOptimize(dynamic_cast<C<0>*>(objects[i]));
+
+    state.SetItemsProcessed(state.iterations()*objects.size());
+    cleanup(objects);
+}
+
+//------------------------------------------------------------------------------
+
+/// Times the same casts with memoized_cast, from source type A<H>
+template <int H>
+void BM_memoized_cast(benchmark::State& state)
+{
+    std::vector<A<H>*> objects = make_diamonds<H>(state.range(0) != 0);
+
+    for (auto _ : state)
+        for (size_t i = 0; i < objects.size(); ++i)
+            benchmark::DoNotOptimize(memoized_cast<C<H>*>(objects[i]));
+
+    state.SetItemsProcessed(state.iterations()*objects.size());
+    cleanup(objects);
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK(BM_dynamic_cast)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_memoized_cast, 0)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_memoized_cast, 1)->ArgName("random")->Arg(0)->Arg(1);
+
+//------------------------------------------------------------------------------
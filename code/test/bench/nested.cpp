@@ -0,0 +1,189 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Measures a Match statement whose clauses are simplification rules of an
+/// expression tree that start with the same nested constructor patterns, so 
+/// that sub-terms of the subject are inspected by many clauses. With 
+/// #XTL_CACHE_NESTED_CASTS the outcome of the type test of each sub-term is
+/// remembered for its vtbl-pointer, while with #XTL_SHARE_NESTED_TESTS the 
+/// test is made once per statement and then shared by all the clauses 
+/// inspecting it. The suite builds it with sharing on, so build it with 
+/// XTL_SHARE_NESTED_TESTS=0 and XTL_CACHE_NESTED_CASTS=1 to measure the cache
+/// instead, as the two should not be combined.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/type_switchN-patterns.hpp> // Support for N-ary Match statement on patterns
+#include <mach7/patterns/bindings.hpp>     // Mach7 support for bindings on arbitrary UDT
+#include <mach7/patterns/constructor.hpp>  // Support for constructor patterns
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+#include "shapes.hpp"
+
+//------------------------------------------------------------------------------
+
+namespace bench
+{
+
+struct Expr          { virtual ~Expr() {} };
+struct Val    : Expr { Val(int v)                : value(v)       {} int   value; };
+struct Neg    : Expr { Neg(const Expr* e)        : e(e)           {} const Expr* e; };
+struct Add    : Expr { Add(const Expr* e1, const Expr* e2) : e1(e1), e2(e2) {} const Expr* e1; const Expr* e2; };
+struct Mul    : Expr { Mul(const Expr* e1, const Expr* e2) : e1(e1), e2(e2) {} const Expr* e1; const Expr* e2; };
+
+} // of namespace bench
+
+namespace mch ///< Mach7 library namespace
+{
+template <> struct bindings<bench::Val> { Members(bench::Val::value); };
+template <> struct bindings<bench::Neg> { Members(bench::Neg::e); };
+template <> struct bindings<bench::Add> { Members(bench::Add::e1, bench::Add::e2); };
+template <> struct bindings<bench::Mul> { Members(bench::Mul::e1, bench::Mul::e2); };
+} // of namespace mch
+
+using namespace bench;
+
+//------------------------------------------------------------------------------
+
+/// Owns the expressions built for a benchmark. Their roots are sums, products
+/// and negations, whose operands are in turn small expressions or values, so
+/// that most of them are inspected by several rules before one applies.
+struct expressions : std::vector<const Expr*>
+{
+    expressions()
+    {
+        std::vector<size_t> kinds = make_kinds(true, 3*8*8);
+
+        for (size_t i = 0; i < kinds.size(); ++i)
+        {
+            const Expr* e1 = make_operand(kinds[i] / 8 % 8);
+            const Expr* e2 = make_operand(kinds[i] % 8);
+
+            switch (kinds[i] / 64)
+            {
+            case 0:  push_back(keep(new Add(e1, e2))); break;
+            case 1:  push_back(keep(new Mul(e1, e2))); break;
+            default: push_back(keep(new Neg(e1)));     break;
+            }
+        }
+    }
+   ~expressions()
+    {
+        for (size_t i = 0; i < m_all.size(); ++i)
+            delete m_all[i];
+    }
+
+    /// Value, negated value, sum or product of values
+    const Expr* make_operand(size_t kind)
+    {
+        switch (kind % 6)
+        {
+        case 0:
+        case 1:
+        case 2:  return keep(new Val(int(kind)));
+        case 3:  return keep(new Neg(keep(new Val(int(kind)))));
+        case 4:  return keep(new Add(keep(new Val(1)), keep(new Val(2))));
+        default: return keep(new Mul(keep(new Val(1)), keep(new Val(2))));
+        }
+    }
+
+    const Expr* keep(const Expr* e) { m_all.push_back(e); return e; }
+
+    std::vector<const Expr*> m_all;
+};
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t rules(const Expr* e)
+{
+    mch::var<const Expr*> x, y;
+    mch::var<int> n, m;
+    mch::wildcard _;
+
+    Match(e)
+    {
+        Case(mch::C<Add>(mch::C<Val>(0), x))            return 1;
+        Case(mch::C<Add>(x, mch::C<Val>(0)))            return 2;
+        Case(mch::C<Add>(mch::C<Val>(n), mch::C<Val>(m))) return 3;
+        Case(mch::C<Add>(mch::C<Neg>(x), mch::C<Neg>(y))) return 4;
+        Case(mch::C<Add>(mch::C<Neg>(x), y))            return 5;
+        Case(mch::C<Add>(x, mch::C<Neg>(y)))            return 6;
+        Case(mch::C<Mul>(mch::C<Val>(1), x))            return 7;
+        Case(mch::C<Mul>(x, mch::C<Val>(1)))            return 8;
+        Case(mch::C<Mul>(mch::C<Val>(0), _))            return 9;
+        Case(mch::C<Mul>(_, mch::C<Val>(0)))            return 10;
+        Case(mch::C<Mul>(mch::C<Neg>(x), mch::C<Neg>(y))) return 11;
+        Case(mch::C<Mul>(mch::C<Neg>(x), y))            return 12;
+        Case(mch::C<Neg>(mch::C<Mul>(x, y)))            return 13;
+        Case(mch::C<Neg>(mch::C<Val>(n)))               return 14;
+        Otherwise()                                     return 0;
+    }
+    EndMatch
+
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+void BM_nested_rules(benchmark::State& state)
+{
+    const expressions es;
+
+    for (auto _ : state)
+    {
+        size_t n = 0;
+
+        for (size_t i = 0; i < es.size(); ++i)
+            n += rules(es[i]);
+
+        benchmark::DoNotOptimize(n);
+    }
+
+    state.SetItemsProcessed(state.iterations()*es.size());
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK(BM_nested_rules);
+
+//------------------------------------------------------------------------------
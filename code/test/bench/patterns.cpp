@@ -0,0 +1,192 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Measures the overhead of the pattern combinators over hand-written
+/// conditions: each benchmark counts the points that a constructor pattern
+/// with the given nested patterns accepts.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/patterns/bindings.hpp>     // Mach7 support for bindings on arbitrary UDT
+#include <mach7/patterns/combinators.hpp>  // Support for pattern combinators &&, || and !
+#include <mach7/patterns/constructor.hpp>  // Support for constructor patterns
+#include <mach7/patterns/equivalence.hpp>  // Equivalence combinator +
+#include <mach7/patterns/guard.hpp>        // Support for guard patterns
+#include <mach7/patterns/n+k.hpp>          // Generalized n+k patterns
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+#include "shapes.hpp"
+
+//------------------------------------------------------------------------------
+
+struct Point
+{
+    int x;
+    int y;
+};
+
+namespace mch ///< Mach7 library namespace
+{
+template <> struct bindings<Point> { Members(Point::x, Point::y); };
+} // of namespace mch
+
+typedef std::vector<Point> points;
+
+//------------------------------------------------------------------------------
+
+points make_points()
+{
+    std::vector<size_t> kinds = bench::make_kinds(true, 16*16);
+    points result(kinds.size());
+
+    for (size_t i = 0; i < kinds.size(); ++i)
+    {
+        result[i].x = int(kinds[i] / 16);
+        result[i].y = int(kinds[i] % 16);
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t hand_written(const points& ps)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < ps.size(); ++i)
+        if (ps[i].x == ps[i].y)
+            ++n;
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t equivalence(const points& ps)
+{
+    mch::var<int> x;
+    size_t n = 0;
+
+    for (size_t i = 0; i < ps.size(); ++i)
+        if (mch::C<Point>(x, +x)(ps[i]))
+            ++n;
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t guard(const points& ps)
+{
+    mch::var<int> x, y;
+    size_t n = 0;
+
+    for (size_t i = 0; i < ps.size(); ++i)
+        if (mch::C<Point>(x, y |= x < y)(ps[i]))
+            ++n;
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t n_plus_k(const points& ps)
+{
+    mch::var<int> x;
+    mch::wildcard _;
+    size_t n = 0;
+
+    for (size_t i = 0; i < ps.size(); ++i)
+        if (mch::C<Point>(2*x+1, _)(ps[i]))
+            ++n;
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t combinators(const points& ps)
+{
+    using mch::val;
+    mch::wildcard _;
+    size_t n = 0;
+
+    for (size_t i = 0; i < ps.size(); ++i)
+        if (mch::C<Point>(val(1) || val(2) || val(3), !val(0) && _)(ps[i]))
+            ++n;
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+template <size_t (*f)(const points&)>
+void BM_pattern(benchmark::State& state)
+{
+    const points ps = make_points();
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(f(ps));
+
+    state.SetItemsProcessed(state.iterations()*ps.size());
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK_TEMPLATE(BM_pattern, hand_written);
+BENCHMARK_TEMPLATE(BM_pattern, equivalence);
+BENCHMARK_TEMPLATE(BM_pattern, guard);
+BENCHMARK_TEMPLATE(BM_pattern, n_plus_k);
+BENCHMARK_TEMPLATE(BM_pattern, combinators);
+
+//------------------------------------------------------------------------------
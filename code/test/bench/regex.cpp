@@ -0,0 +1,149 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Compares the engines of regex patterns on a Match statement classifying the
+/// request lines of a text protocol: std::regex compiled once per call site
+/// versus the DFA engine. Most clauses fail on most subjects, which the DFA 
+/// decides without running the NFA simulation.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/match.hpp>                 // Support for Match statement
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+#include <mach7/patterns/regex_dfa.hpp>    // DFA engine for regular expression patterns
+#include "shapes.hpp"
+
+//------------------------------------------------------------------------------
+
+/// Request lines of a text protocol
+std::vector<std::string> make_requests()
+{
+    static const char* lines[] = 
+    {
+        "GET /index.html HTTP/1.1",
+        "POST /api/v1/items HTTP/1.0",
+        "HEAD /favicon.ico HTTP/1.1",
+        "Host: www.example.com",
+        "Content-Length: 1024",
+        "OPTIONS * HTTP/1.1",
+        "garbage",
+        "DELETE /api/v1/items/42 HTTP/1.1",
+    };
+
+    std::vector<size_t> kinds = bench::make_kinds(true, XTL_ARR_SIZE(lines));
+    std::vector<std::string> result;
+
+    for (size_t i = 0; i < kinds.size(); ++i)
+        result.push_back(lines[kinds[i]]);
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t std_engine(const std::vector<std::string>& requests)
+{
+    mch::var<std::string> method, path;
+    mch::var<int> minor, length;
+    size_t n = 0;
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        Match(requests[i])
+        {
+            With(mch::rex(XTL_REGEX("(GET|HEAD) (/[^ ]*) HTTP/1\\.([01])"), method, path, minor))  n += 1; break;
+            With(mch::rex(XTL_REGEX("(POST|PUT|DELETE) (/[^ ]*) HTTP/1\\.([01])"), method, path, minor)) n += 2; break;
+            With(mch::rex(XTL_REGEX("Content-Length: ([0-9]+)"), length))                           n += length; break;
+            With(mch::rex(XTL_REGEX("([A-Za-z-]+): (.*)"), method, path))                           n += 3; break;
+        }
+        EndMatch
+    }
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t dfa_engine(const std::vector<std::string>& requests)
+{
+    mch::var<std::string> method, path;
+    mch::var<int> minor, length;
+    size_t n = 0;
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        Match(requests[i])
+        {
+            With(mch::rex(XTL_DFA_REGEX("(GET|HEAD) (/[^ ]*) HTTP/1\\.([01])"), method, path, minor))  n += 1; break;
+            With(mch::rex(XTL_DFA_REGEX("(POST|PUT|DELETE) (/[^ ]*) HTTP/1\\.([01])"), method, path, minor)) n += 2; break;
+            With(mch::rex(XTL_DFA_REGEX("Content-Length: ([0-9]+)"), length))                           n += length; break;
+            With(mch::rex(XTL_DFA_REGEX("([A-Za-z-]+): (.*)"), method, path))                           n += 3; break;
+        }
+        EndMatch
+    }
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+template <size_t (*f)(const std::vector<std::string>&)>
+void BM_regex(benchmark::State& state)
+{
+    const std::vector<std::string> requests = make_requests();
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(f(requests));
+
+    state.SetItemsProcessed(state.iterations()*requests.size());
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK_TEMPLATE(BM_regex, std_engine);
+BENCHMARK_TEMPLATE(BM_regex, dfa_engine);
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,165 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Defines the closed hierarchy of shapes shared by the benchmarks of match
+/// statements and type switches: every class carries its kind for MatchK and
+/// MatchF, and accepts a visitor so that the statements can be compared to the
+/// visitor design pattern on the same objects.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+#if !defined(NUMBER_OF_SHAPES)
+/// Number of classes derived from bench::Shape. The default matches the size
+/// of a typical closed hierarchy, e.g. of the nodes of an abstract syntax tree.
+#define NUMBER_OF_SHAPES 20
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace bench
+{
+
+struct ShapeVisitor;
+
+//------------------------------------------------------------------------------
+
+struct Shape
+{
+    Shape(size_t kind) : m_kind(kind), m_size(kind*7+1) {}
+    virtual ~Shape() {}
+    virtual void accept(ShapeVisitor&) const = 0;
+
+    size_t m_kind;
+    size_t m_size;
+};
+
+//------------------------------------------------------------------------------
+
+template <size_t N>
+struct shape_kind : Shape
+{
+    shape_kind() : Shape(N) {}
+    void accept(ShapeVisitor&) const;
+};
+
+//------------------------------------------------------------------------------
+
+struct ShapeVisitor
+{
+    virtual ~ShapeVisitor() {}
+    #define FOR_EACH_MAX NUMBER_OF_SHAPES-1
+    #define FOR_EACH_N(N) virtual void visit(const shape_kind<N>&) {}
+    #include "../time/loop_over_numbers.hpp"
+    #undef  FOR_EACH_N
+    #undef  FOR_EACH_MAX
+};
+
+//------------------------------------------------------------------------------
+
+template <size_t N> void shape_kind<N>::accept(ShapeVisitor& v) const { v.visit(*this); }
+
+//------------------------------------------------------------------------------
+
+inline Shape* make_shape(size_t i)
+{
+    switch (i % NUMBER_OF_SHAPES)
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) case N: return new shape_kind<N>;
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+/// Number of subjects each benchmark iterates over. It is large enough to
+/// defeat the branch predictor on random sequences, yet small enough for all
+/// objects to stay in L1/L2 so that we time the dispatch and not the memory.
+const size_t number_of_subjects = 1024;
+
+/// Returns the kinds of shapes to be created in either sequential or
+/// pseudo-random order. The sequence is the same on every run and machine.
+inline std::vector<size_t> make_kinds(bool random, size_t n = NUMBER_OF_SHAPES)
+{
+    std::vector<size_t> kinds(number_of_subjects);
+    unsigned long long seed = 1;
+
+    for (size_t i = 0; i < kinds.size(); ++i)
+    {
+        seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+        kinds[i] = random ? size_t(seed >> 33) % n : i % n;
+    }
+
+    return kinds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Owns the objects of the hierarchy created for a benchmark
+struct shapes : std::vector<Shape*>
+{
+    shapes(bool random, size_t n = NUMBER_OF_SHAPES)
+    {
+        std::vector<size_t> kinds = make_kinds(random, n);
+
+        for (size_t i = 0; i < kinds.size(); ++i)
+            push_back(make_shape(kinds[i]));
+    }
+   ~shapes()
+    {
+        for (size_t i = 0; i < size(); ++i)
+            delete (*this)[i];
+    }
+};
+
+} // of namespace bench
+
+//------------------------------------------------------------------------------
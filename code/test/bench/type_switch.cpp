@@ -0,0 +1,198 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Compares the open type switch to the visitor design pattern on the same
+/// hierarchy: single dispatch against a visitor and double dispatch against
+/// a visitor that forwards to a visitor specialized for the first argument.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shapes.hpp"
+#include "../time/testrepeat.hpp"
+
+using namespace bench;
+
+//------------------------------------------------------------------------------
+
+/// Number of classes in each position of the binary type switch
+const size_t binary_shapes = 10;
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t type_switch(const Shape& s)
+{
+    Match(s)
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) Case(shape_kind<N>) return N;
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    EndMatch
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t visit(const Shape& s)
+{
+    struct Visitor : ShapeVisitor
+    {
+        #define FOR_EACH_MAX  NUMBER_OF_SHAPES-1
+        #define FOR_EACH_N(N) virtual void visit(const shape_kind<N>&) { result = N; }
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+        size_t result;
+    };
+
+    Visitor v;
+    v.result = 0;
+    s.accept(v);
+    return v.result;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+#define BENCH_CASE_N_M(M,...) Case(shape_kind<__VA_ARGS__>,shape_kind<M>) return (__VA_ARGS__)*100 + M;
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t type_switch(const Shape& s1, const Shape& s2)
+{
+    Match(s1,s2)
+    {
+        #define FOR_EACH_MAX  9
+        #define FOR_EACH_N(N) XTL_TEST_REPEAT(10, BENCH_CASE_N_M, N)
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+    }
+    EndMatch
+    return 0;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+/// Second step of double dispatch with the dynamic type of the first argument known
+template <size_t M>
+struct VisitorFor : ShapeVisitor
+{
+    #define FOR_EACH_MAX  9
+    #define FOR_EACH_N(N) virtual void visit(const shape_kind<N>&) { result = M*100 + N; }
+    #include "../time/loop_over_numbers.hpp"
+    #undef  FOR_EACH_N
+    #undef  FOR_EACH_MAX
+    size_t result;
+};
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t visit(const Shape& s1, const Shape& s2)
+{
+    struct Visitor : ShapeVisitor
+    {
+        Visitor(const Shape& s) : second(s), result(0) {}
+
+        #define FOR_EACH_MAX  9
+        #define FOR_EACH_N(N) virtual void visit(const shape_kind<N>&) { VisitorFor<N> v; v.result = 0; second.accept(v); result = v.result; }
+        #include "../time/loop_over_numbers.hpp"
+        #undef  FOR_EACH_N
+        #undef  FOR_EACH_MAX
+
+        const Shape& second;
+        size_t       result;
+    };
+
+    Visitor v(s2);
+    s1.accept(v);
+    return v.result;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+/// Times single dispatch of function f. The range argument selects sequential
+/// (0) or random (1) order of the subjects.
+template <size_t (*f)(const Shape&)>
+void BM_unary(benchmark::State& state)
+{
+    shapes subjects(state.range(0) != 0);
+
+    for (auto _ : state)
+        for (size_t i = 0; i < subjects.size(); ++i)
+            benchmark::DoNotOptimize(f(*subjects[i]));
+
+    state.SetItemsProcessed(state.iterations()*subjects.size());
+}
+
+//------------------------------------------------------------------------------
+
+/// Times double dispatch of function f on adjacent subjects
+template <size_t (*f)(const Shape&, const Shape&)>
+void BM_binary(benchmark::State& state)
+{
+    shapes subjects(state.range(0) != 0, binary_shapes);
+
+    for (auto _ : state)
+        for (size_t i = 1; i < subjects.size(); ++i)
+            benchmark::DoNotOptimize(f(*subjects[i-1], *subjects[i]));
+
+    state.SetItemsProcessed(state.iterations()*(subjects.size()-1));
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK_TEMPLATE(BM_unary,  type_switch)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_unary,  visit      )->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_binary, type_switch)->ArgName("random")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_binary, visit      )->ArgName("random")->Arg(0)->Arg(1);
+
+//------------------------------------------------------------------------------
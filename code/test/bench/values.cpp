@@ -0,0 +1,199 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Compares a Match statement with many value clauses and a trailing n+k 
+/// clause on an integral subject to the sequential testing of the same patterns
+/// and to a hand-written switch. Clauses of a Match statement are separate 
+/// statements tested one by one, so this measures how far the chain of inlined
+/// comparisons with constants is from the jump table of the switch.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/match.hpp>                 // Support for Match statement
+#include <mach7/patterns/n+k.hpp>          // Generalized n+k patterns
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+#include "shapes.hpp"
+
+//------------------------------------------------------------------------------
+
+/// Subjects mostly accepted by one of the 16 value clauses below
+std::vector<int> make_values()
+{
+    std::vector<size_t> kinds = bench::make_kinds(true, 20);
+    std::vector<int> result;
+
+    for (size_t i = 0; i < kinds.size(); ++i)
+        result.push_back(int(kinds[i])*7);
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t hand_written(const std::vector<int>& values)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        switch (values[i])
+        {
+        case   0: n +=  1; break;
+        case   7: n +=  2; break;
+        case  14: n +=  3; break;
+        case  21: n +=  4; break;
+        case  28: n +=  5; break;
+        case  35: n +=  6; break;
+        case  42: n +=  7; break;
+        case  49: n +=  8; break;
+        case  56: n +=  9; break;
+        case  63: n += 10; break;
+        case  70: n += 11; break;
+        case  77: n += 12; break;
+        case  84: n += 13; break;
+        case  91: n += 14; break;
+        case  98: n += 15; break;
+        case 105: n += 16; break;
+        default:
+            if (values[i] > 105 && values[i] - 105 <= 0xFFFF)
+                n += values[i] - 105;
+        }
+    }
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t sequential(const std::vector<int>& values)
+{
+    mch::var<unsigned short> m;
+    size_t n = 0;
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        const int& v = values[i];
+
+        if      (mch::filter(  0)(v)) n +=  1;
+        else if (mch::filter(  7)(v)) n +=  2;
+        else if (mch::filter( 14)(v)) n +=  3;
+        else if (mch::filter( 21)(v)) n +=  4;
+        else if (mch::filter( 28)(v)) n +=  5;
+        else if (mch::filter( 35)(v)) n +=  6;
+        else if (mch::filter( 42)(v)) n +=  7;
+        else if (mch::filter( 49)(v)) n +=  8;
+        else if (mch::filter( 56)(v)) n +=  9;
+        else if (mch::filter( 63)(v)) n += 10;
+        else if (mch::filter( 70)(v)) n += 11;
+        else if (mch::filter( 77)(v)) n += 12;
+        else if (mch::filter( 84)(v)) n += 13;
+        else if (mch::filter( 91)(v)) n += 14;
+        else if (mch::filter( 98)(v)) n += 15;
+        else if (mch::filter(105)(v)) n += 16;
+        else if (mch::filter(m+105)(v)) n += m;
+    }
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+XTL_DO_NOT_INLINE_BEGIN
+size_t match_statement(const std::vector<int>& values)
+{
+    mch::var<unsigned short> m;
+    size_t n = 0;
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        Match(values[i])
+        {
+            With(mch::val(  0)) n +=  1; break;
+            With(mch::val(  7)) n +=  2; break;
+            With(mch::val( 14)) n +=  3; break;
+            With(mch::val( 21)) n +=  4; break;
+            With(mch::val( 28)) n +=  5; break;
+            With(mch::val( 35)) n +=  6; break;
+            With(mch::val( 42)) n +=  7; break;
+            With(mch::val( 49)) n +=  8; break;
+            With(mch::val( 56)) n +=  9; break;
+            With(mch::val( 63)) n += 10; break;
+            With(mch::val( 70)) n += 11; break;
+            With(mch::val( 77)) n += 12; break;
+            With(mch::val( 84)) n += 13; break;
+            With(mch::val( 91)) n += 14; break;
+            With(mch::val( 98)) n += 15; break;
+            With(mch::val(105)) n += 16; break;
+            With(m+105)         n += m;  break;
+        }
+        EndMatch
+    }
+
+    return n;
+}
+XTL_DO_NOT_INLINE_END
+
+//------------------------------------------------------------------------------
+
+template <size_t (*f)(const std::vector<int>&)>
+void BM_values(benchmark::State& state)
+{
+    const std::vector<int> values = make_values();
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(f(values));
+
+    state.SetItemsProcessed(state.iterations()*values.size());
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK_TEMPLATE(BM_values, hand_written);
+BENCHMARK_TEMPLATE(BM_values, sequential);
+BENCHMARK_TEMPLATE(BM_values, match_statement);
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,166 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Measures the comparison of the vtbl-pointer tuples that keys of vtbl_map<N,T>
+/// consist of, by the early-exit scalar loop and by the SIMD code path enabled
+/// with #XTL_USE_SIMD, on tuples that are equal as on hits and on tuples that 
+/// differ in a random position as on collisions. When built with -mbmi2, it 
+/// also measures interleaving of the tuples with PDEP against the scalar code.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/vtblmap4.hpp>
+#include <array>
+#include <random>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+/// Number of tuples compared or interleaved in each iteration
+const size_t keys = 1024;
+
+/// Pairs of pseudo-random N-tuples of aligned vtbl-pointers, of which the given
+/// percentage are equal and the rest differ in a single random position.
+template <size_t N>
+struct key_pairs
+{
+    typedef intptr_t key_type[N];
+
+    explicit key_pairs(size_t equal_percentage) : a(keys), b(keys)
+    {
+        std::mt19937_64 rng(42);
+
+        for (size_t i = 0; i < keys; ++i)
+        {
+            for (size_t j = 0; j < N; ++j)
+                a[i][j] = b[i][j] = intptr_t(rng() & ~uint64_t(7));
+
+            if (rng() % 100 >= equal_percentage)
+                b[i][rng() % N] ^= intptr_t(8);
+        }
+    }
+
+    std::vector<std::array<intptr_t,N>> a;
+    std::vector<std::array<intptr_t,N>> b;
+
+    static const key_type& key(const std::array<intptr_t,N>& k) { return *reinterpret_cast<const key_type*>(k.data()); }
+};
+
+//------------------------------------------------------------------------------
+
+/// The early-exit loop of the generic array_equal
+template <size_t N>
+void BM_key_equal_scalar(benchmark::State& state)
+{
+    key_pairs<N> pairs(size_t(state.range(0)));
+
+    for (auto _ : state)
+        for (size_t i = 0; i < keys; ++i)
+            benchmark::DoNotOptimize(mch::array_equal<intptr_t,N>(pairs.key(pairs.a[i]), pairs.key(pairs.b[i])));
+
+    state.SetItemsProcessed(state.iterations()*keys);
+}
+
+/// The overload of array_equal used by vtbl maps, which is vectorized with #XTL_USE_SIMD
+template <size_t N>
+void BM_key_equal(benchmark::State& state)
+{
+    key_pairs<N> pairs(size_t(state.range(0)));
+
+    for (auto _ : state)
+        for (size_t i = 0; i < keys; ++i)
+            benchmark::DoNotOptimize(mch::array_equal(pairs.key(pairs.a[i]), pairs.key(pairs.b[i])));
+
+    state.SetItemsProcessed(state.iterations()*keys);
+}
+
+BENCHMARK_TEMPLATE(BM_key_equal_scalar, 2)->ArgName("equal%")->Arg(100)->Arg(50)->Arg(0);
+BENCHMARK_TEMPLATE(BM_key_equal,        2)->ArgName("equal%")->Arg(100)->Arg(50)->Arg(0);
+BENCHMARK_TEMPLATE(BM_key_equal_scalar, 3)->ArgName("equal%")->Arg(100)->Arg(50)->Arg(0);
+BENCHMARK_TEMPLATE(BM_key_equal,        3)->ArgName("equal%")->Arg(100)->Arg(50)->Arg(0);
+BENCHMARK_TEMPLATE(BM_key_equal_scalar, 4)->ArgName("equal%")->Arg(100)->Arg(50)->Arg(0);
+BENCHMARK_TEMPLATE(BM_key_equal,        4)->ArgName("equal%")->Arg(100)->Arg(50)->Arg(0);
+
+//------------------------------------------------------------------------------
+
+#if defined(__BMI2__)
+
+inline intptr_t scalar_interleave(const intptr_t (&v)[2]) { return mch::interleave8x2(v[0],v[1]); }
+inline intptr_t scalar_interleave(const intptr_t (&v)[3]) { return mch::interleave(v[0],v[1],v[2]); }
+inline intptr_t scalar_interleave(const intptr_t (&v)[4]) { return mch::interleave4x4(v[0],v[1],v[2],v[3]); }
+
+/// Interleaving with the scalar functions used without BMI2
+template <size_t N>
+void BM_interleave_scalar(benchmark::State& state)
+{
+    key_pairs<N> pairs(100);
+
+    for (auto _ : state)
+        for (size_t i = 0; i < keys; ++i)
+            benchmark::DoNotOptimize(scalar_interleave(pairs.key(pairs.a[i])));
+
+    state.SetItemsProcessed(state.iterations()*keys);
+}
+
+/// Interleaving used by vtbl maps, which is done with PDEP under #XTL_USE_SIMD
+template <size_t N>
+void BM_interleave(benchmark::State& state)
+{
+    key_pairs<N> pairs(100);
+
+    for (auto _ : state)
+        for (size_t i = 0; i < keys; ++i)
+            benchmark::DoNotOptimize(mch::interleave(pairs.key(pairs.a[i])));
+
+    state.SetItemsProcessed(state.iterations()*keys);
+}
+
+BENCHMARK_TEMPLATE(BM_interleave_scalar, 2);
+BENCHMARK_TEMPLATE(BM_interleave,        2);
+BENCHMARK_TEMPLATE(BM_interleave_scalar, 3);
+BENCHMARK_TEMPLATE(BM_interleave,        3);
+BENCHMARK_TEMPLATE(BM_interleave_scalar, 4);
+BENCHMARK_TEMPLATE(BM_interleave,        4);
+
+#endif
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,103 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library benchmark suite.
+///
+/// Measures the cost of lookups in vtbl_map<N,T> alone, without the rest of
+/// the type switch, for N=1..4 and a growing number of classes. The map has
+/// seen all the tuples before timing starts, so only hits are timed.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <benchmark/benchmark.h>
+#include <mach7/vtblmap4.hpp>
+#include "shapes.hpp"
+
+using namespace bench;
+
+//------------------------------------------------------------------------------
+
+/// Number of tuples looked up in each iteration
+const size_t lookups = 1024;
+
+//------------------------------------------------------------------------------
+
+/// Times lookups of pseudo-randomly chosen N-tuples of vtbl-pointers of the
+/// first state.range(0) classes of the hierarchy.
+template <size_t N>
+void BM_vtbl_map(benchmark::State& state)
+{
+    using namespace mch;
+
+    const size_t k = size_t(state.range(0));
+    static vtbl_count_t clauses; // The map keeps a reference to it
+    clauses = vtbl_count_t(k);
+    vtbl_map<N,type_switch_info<N>> map(clauses);
+    shapes objects(false, k);
+    std::vector<intptr_t> vtbls;
+
+    for (size_t i = 0; i < k; ++i)
+        vtbls.push_back(vtbl_of(objects[i]));
+
+    map.warm_up(vtbls.data(), vtbls.size());
+
+    // Pregenerate random tuples so that random number generation is not timed
+    std::vector<size_t>   kinds = make_kinds(true, k);
+    std::vector<intptr_t> tuples(lookups*N);
+
+    for (size_t i = 0; i < tuples.size(); ++i)
+        tuples[i] = vtbls[kinds[i % kinds.size()]];
+
+    for (auto _ : state)
+        for (size_t i = 0; i < lookups; ++i)
+            benchmark::DoNotOptimize(map.get(*reinterpret_cast<const intptr_t(*)[N]>(&tuples[i*N])).target);
+
+    state.SetItemsProcessed(state.iterations()*lookups);
+    state.counters["memory"] = double(map.memory_used());
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK_TEMPLATE(BM_vtbl_map, 1)->ArgName("classes")->RangeMultiplier(2)->Range(4, NUMBER_OF_SHAPES);
+BENCHMARK_TEMPLATE(BM_vtbl_map, 2)->ArgName("classes")->RangeMultiplier(2)->Range(4, NUMBER_OF_SHAPES);
+BENCHMARK_TEMPLATE(BM_vtbl_map, 3)->ArgName("classes")->RangeMultiplier(2)->Range(4, 16);
+BENCHMARK_TEMPLATE(BM_vtbl_map, 4)->ArgName("classes")->RangeMultiplier(2)->Range(4, 8);
+
+//------------------------------------------------------------------------------
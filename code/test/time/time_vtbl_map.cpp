@@ -0,0 +1,154 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Measures the cost of lookups in vtbl_map<N,T> alone, without the rest of
+/// the type switch. Build it with XTL_INLINE_VTBL_ENTRIES=0 and 1 to compare
+/// the layout with pointers to separately allocated entries to the one with
+/// entries inline in the hash table.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "timing.hpp"
+#include <mach7/vtblmap4.hpp>
+
+//------------------------------------------------------------------------------
+
+struct Shape { virtual ~Shape() {} };
+template <int I> struct ShapeN : Shape {};
+
+template <int... I>
+std::vector<Shape*> make_shapes()
+{
+    Shape* shapes[] = {new ShapeN<I>...};
+    return std::vector<Shape*>(shapes, shapes + sizeof...(I));
+}
+
+//------------------------------------------------------------------------------
+
+const size_t lookups    = 1000000; ///< Number of lookups in each measurement
+const size_t iterations = 21;      ///< Number of measurements, of which median is reported
+
+//------------------------------------------------------------------------------
+
+/// Times lookups of randomly chosen N-tuples of vtbl-pointers of given objects
+/// in a map that has already seen all of them.
+template <size_t N>
+void measure(const std::vector<Shape*>& shapes, size_t k)
+{
+    using namespace mch;
+
+    static vtbl_count_t clauses; // The map keeps a reference to it
+    clauses = vtbl_count_t(k);
+    vtbl_map<N,type_switch_info<N>> map(clauses);
+    std::vector<intptr_t> vtbls;
+
+    for (size_t i = 0; i < k; ++i)
+        vtbls.push_back(vtbl_of(shapes[i]));
+
+    map.warm_up(vtbls.data(), vtbls.size());
+
+    // Pregenerate random tuples so that random number generation is not timed
+    std::vector<intptr_t> tuples(lookups*N);
+    size_t seed = 1;
+
+    for (size_t i = 0; i < tuples.size(); ++i)
+    {
+        seed = seed*1103515245 + 12345;
+        tuples[i] = vtbls[(seed >> 16) % k];
+    }
+
+    std::vector<long long> timings;
+    size_t checksum = 0;
+
+    for (size_t j = 0; j < iterations; ++j)
+    {
+        time_stamp start = get_time_stamp();
+
+        for (size_t i = 0; i < lookups; ++i)
+            checksum += map.get(*reinterpret_cast<const intptr_t(*)[N]>(&tuples[i*N])).target;
+
+        time_stamp finish = get_time_stamp();
+        timings.push_back(finish - start);
+    }
+
+    std::sort(timings.begin(), timings.end());
+
+    std::cout << "N=" << N
+              << " classes=" << std::setw(3) << k
+              << " tuples="  << std::setw(6) << vtbls.size() * (N > 1 ? vtbls.size() : 1) * (N > 2 ? vtbls.size() : 1)
+              << " time="    << std::setw(6) << std::fixed << std::setprecision(2) << dbl::nanoseconds(timings[iterations/2])/lookups << "ns"
+              << " memory="  << std::setw(8) << map.memory_used()
+              << (checksum ? "" : " ") // Keep the lookups from being optimized away
+              << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const std::vector<Shape*> shapes = make_shapes<
+         0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,15,16,17,18,19,
+        20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,
+        40,41,42,43,44,45,46,47,48,49,50,51,52,53,54,55,56,57,58,59,
+        60,61,62,63
+    >();
+
+    std::cout << "Layout: " << (XTL_INLINE_VTBL_ENTRIES ? "inline entries" : "pointers to entries") << std::endl;
+
+    for (size_t k = 4; k <= shapes.size(); k *= 2)
+        measure<1>(shapes, k);
+
+    for (size_t k = 4; k <= shapes.size(); k *= 2)
+        measure<2>(shapes, k);
+
+    for (size_t k = 4; k <= 16; k *= 2)
+        measure<3>(shapes, k);
+
+    for (size_t i = 0; i < shapes.size(); ++i)
+        delete shapes[i];
+}
+
+//------------------------------------------------------------------------------
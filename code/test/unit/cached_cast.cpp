@@ -0,0 +1,178 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Checks that cached_cast agrees with dynamic_cast on downcasts and 
+/// cross-casts through multiple and virtual inheritance, including the casts 
+/// that fail and the dynamic types colliding in its table, as well as that 
+/// nested constructor patterns on sub-objects at non-zero offsets still bind
+/// the right objects.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <mach7/cached_cast.hpp>           // Casts remembering their outcome per vtbl-pointer
+#include <mach7/type_switchN-patterns.hpp> // Support for N-ary Match statement on patterns
+#include <mach7/patterns/bindings.hpp>     // Mach7 support for bindings on arbitrary UDT
+#include <mach7/patterns/constructor.hpp>  // Support for constructor patterns
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+
+#include <iostream>
+#include <typeinfo>
+#include <vector>
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+using mch::cached_cast;
+
+//------------------------------------------------------------------------------
+
+struct A             { virtual ~A() {} int a; };
+struct B : virtual A { int b; };
+struct C : virtual A, B { int c; };
+struct D : virtual A, B { int d; };
+struct E : C, D      { int e; };
+struct F             { virtual ~F() {} int f; };
+struct G : F, B      { int g; };
+
+/// Many more dynamic types than the table of a pair of types remembers
+template <int N> struct L : F, B { int l[N]; };
+
+//------------------------------------------------------------------------------
+
+template <int N>
+void make_leaves(std::vector<A*>& objects)
+{
+    make_leaves<N-1>(objects);
+    objects.push_back(new L<N>);
+}
+
+template <> void make_leaves<0>(std::vector<A*>&) {}
+
+template <typename T>
+int check(const std::vector<A*>& objects)
+{
+    int errors = 0;
+
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+              A* a = objects[i];
+        const A* k = a;
+
+        if (cached_cast<T*>(a) != dynamic_cast<T*>(a))
+            std::cerr << "cached_cast<" << typeid(T).name() << "*>(" << typeid(*a).name() << ") differs from dynamic_cast" << std::endl, ++errors;
+
+        if (cached_cast<const T*>(k) != dynamic_cast<const T*>(k))
+            std::cerr << "cached_cast<const " << typeid(T).name() << "*>(" << typeid(*a).name() << ") differs from dynamic_cast" << std::endl, ++errors;
+    }
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+struct Expr          { virtual ~Expr() {} };
+struct Tag           { virtual ~Tag()  {} int tag; };
+struct Val    : Tag, Expr { Val(int v)         : value(v) {} int value; };
+struct Neg    : Tag, Expr { Neg(const Expr* e) : e(e)     {} const Expr* e; };
+
+namespace mch ///< Mach7 library namespace
+{
+template <> struct bindings<Val> { Members(Val::value); };
+template <> struct bindings<Neg> { Members(Neg::e); };
+} // of namespace mch
+
+/// Value of a negation of a value, looked through the base at non-zero offset
+int negated(const Expr* e)
+{
+    mch::var<int> n;
+
+    Match(e)
+    {
+        Case(mch::C<Neg>(mch::C<Val>(n))) return -n;
+        Case(mch::C<Val>(n))              return  n;
+        Otherwise()                       return  0;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    std::vector<A*> objects;
+    objects.push_back(new A);
+    objects.push_back(new B);
+    objects.push_back(new C);
+    objects.push_back(new D);
+    objects.push_back(new E);
+    objects.push_back(static_cast<B*>(new G));
+    objects.push_back(static_cast<C*>(new E)); // Same dynamic type through another path
+    objects.push_back(static_cast<D*>(new E));
+    make_leaves<40>(objects);
+    objects.push_back(nullptr);
+
+    int errors = 0;
+
+    // Second round hits the entries learned during the first one
+    for (int round = 0; round < 2; ++round)
+    {
+        errors += check<B>(objects);
+        errors += check<C>(objects);
+        errors += check<D>(objects);
+        errors += check<E>(objects);
+        errors += check<F>(objects);
+        errors += check<G>(objects);
+        errors += check<L<7> >(objects);
+    }
+
+    const Val v1(1), v2(2);
+    const Neg n1(&v1), n2(&v2), nn(&n1);
+    const Expr* exprs[] = { &v1, &v2, &n1, &n2, &nn, &n2, &n1, &v2 };
+    const int   values[] = { 1,   2,  -1,  -2,   0,  -2,  -1,   2  };
+
+    for (size_t i = 0; i < XTL_ARR_SIZE(exprs); ++i)
+        if (negated(exprs[i]) != values[i])
+            std::cerr << "negated(" << i << ") == " << negated(exprs[i]) << std::endl, ++errors;
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,192 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises dispatch_arena: the allocator of dispatch tables of all match
+/// statements. Blocks have to be properly aligned, must not overlap, have to
+/// be accounted for and reused, and dispatch tables of type switches have to
+/// be allocated from it. The -arena variant of the test checks the same with
+/// #XTL_DISPATCH_ARENA on.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+/// Classes whose vtbl-pointers are spread over many dispatch tables
+template <int I> struct ShapeN : Shape {};
+
+int do_match(const Shape* s0)
+{
+    Match(s0)
+    {
+    Case(ShapeN<0>) return 0;
+    Case(ShapeN<1>) return 1;
+    Case(ShapeN<2>) return 2;
+    Case(ShapeN<3>) return 3;
+    Otherwise()     return 4;
+    }
+    EndMatch
+
+    return -1;
+}
+
+int do_match(const Shape* s0, const Shape* s1)
+{
+    Match(s0,s1)
+    {
+    Case(ShapeN<0>, ShapeN<0>) return 0;
+    Case(ShapeN<1>, Shape    ) return 1;
+    Case(Shape    , ShapeN<2>) return 2;
+    Otherwise()                return 3;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+/// Allocates and deallocates blocks of random sizes checking their contents
+size_t test_allocator()
+{
+    struct block { unsigned char* p; size_t n; unsigned char fill; };
+
+    const mch::dispatch_memory before = mch::dispatch_table_memory();
+    std::mt19937       rng(42);
+    std::vector<block> blocks;
+    size_t             errors = 0;
+
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        if (blocks.size() < 500 && rng() % 3)
+        {
+            block b = { nullptr, 1 + rng() % (rng() % 4 ? 512 : 3*XTL_DISPATCH_ARENA_CHUNK_SIZE/4), static_cast<unsigned char>(i) };
+            b.p = static_cast<unsigned char*>(mch::dispatch_arena::allocate(b.n));
+
+            if (intptr_t(b.p) % alignof(std::max_align_t))
+                ++errors; // Misaligned
+
+            std::memset(b.p, b.fill, b.n);
+            blocks.push_back(b);
+        }
+        else
+        if (!blocks.empty())
+        {
+            const size_t k = rng() % blocks.size();
+            const block  b = blocks[k];
+
+            for (size_t j = 0; j < b.n; ++j)
+                if (b.p[j] != b.fill)
+                {
+                    ++errors; // Overwritten by another block
+                    break;
+                }
+
+            mch::dispatch_arena::deallocate(b.p, b.n);
+            blocks[k] = blocks.back();
+            blocks.pop_back();
+        }
+    }
+
+    const mch::dispatch_memory during = mch::dispatch_table_memory();
+
+    if (during.allocations != before.allocations + blocks.size() || during.in_use < before.in_use || during.reserved < during.in_use)
+        ++errors;
+
+    for (size_t k = 0; k < blocks.size(); ++k)
+        mch::dispatch_arena::deallocate(blocks[k].p, blocks[k].n);
+
+    const mch::dispatch_memory after = mch::dispatch_table_memory();
+
+    if (after.allocations != before.allocations || after.in_use != before.in_use)
+        ++errors; // Not everything was accounted for
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+/// Checks that dispatch tables of type switches come from the arena
+size_t test_type_switch()
+{
+    const mch::dispatch_memory before = mch::dispatch_table_memory();
+
+    ShapeN<0> s0; ShapeN<1> s1; ShapeN<2> s2; ShapeN<3> s3; ShapeN<4> s4; ShapeN<5> s5;
+    const Shape* shapes[] = {&s0,&s1,&s2,&s3,&s4,&s5};
+    const int    results1[] = {0,1,2,3,4,4};
+    size_t       errors = 0;
+
+    for (size_t i = 0; i < 6; ++i)
+    {
+        if (do_match(shapes[i]) != results1[i])
+            ++errors;
+
+        for (size_t j = 0; j < 6; ++j)
+            if (do_match(shapes[i],shapes[j]) != (i == 0 && j == 0 ? 0 : i == 1 ? 1 : j == 2 ? 2 : 3))
+                ++errors;
+    }
+
+    const mch::dispatch_memory after = mch::dispatch_table_memory();
+
+    if (after.in_use <= before.in_use || after.allocations <= before.allocations)
+        ++errors; // Dispatch tables were not allocated from the arena
+
+    std::cout << after.in_use << " bytes in " << after.allocations << " blocks used by dispatch tables, " << after.reserved << " bytes reserved" << std::endl;
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const size_t errors = test_type_switch() + test_allocator();
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,219 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises the dispatch profile: match statements have to record how often
+/// they saw each dynamic type and which clause it took, while a profile loaded
+/// before or after the first use of a match statement has to seed its counts.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#define XTL_USE_VTBL_FREQUENCY 1
+
+#include <iostream>
+#include <sstream>
+#include <typeinfo>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+int recorded(const Shape* s)
+{
+    Match(s)
+    {
+    Case(Circle)   return 1;
+    Case(Square)   return 2;
+    Otherwise()    return 0;
+    }
+    EndMatch
+
+    return -1; // To prevent all control path warning
+}
+
+/// Line of the match statement in replayed(), whose profile is loaded before its first use
+const size_t replayed_line = __LINE__ + 4;
+
+int replayed(const Shape* s)
+{
+    Match(s)
+    {
+    Case(Circle)   return 1;
+    Case(Square)   return 2;
+    Otherwise()    return 0;
+    }
+    EndMatch
+
+    return -1; // To prevent all control path warning
+}
+
+//------------------------------------------------------------------------------
+
+/// Finds the site of the profile, whose name ends with the given line
+const mch::dispatch_profile::site* find_site(const mch::dispatch_profile& profile, size_t line)
+{
+    std::ostringstream suffix;
+    suffix << ':' << line;
+
+    for (std::map<std::string,mch::dispatch_profile::site>::const_iterator p = profile.sites.begin(); p != profile.sites.end(); ++p)
+        if (p->first.size() > suffix.str().size() && p->first.compare(p->first.size() - suffix.str().size(), std::string::npos, suffix.str()) == 0)
+            return &p->second;
+
+    return nullptr;
+}
+
+/// Saves the profile of the program and reads it back
+mch::dispatch_profile current_profile()
+{
+    std::stringstream ss;
+    mch::save_dispatch_profile(ss);
+
+    mch::dispatch_profile result;
+    result.read(ss);
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+size_t test_record()
+{
+    Circle      c;
+    Square      s;
+    Triangle    t;
+    CircleN<0>  c0;
+    CircleN<1>  c1;
+    CircleN<2>  c2;
+    CircleN<3>  c3;
+    const Shape* shapes[] = { &c, &s, &t, &c0, &c1, &c2, &c3 };
+    const int    expected[] = { 1, 2, 0, 1, 1, 1, 1 };
+    size_t       errors = 0;
+
+    // Circles are seen 100 times, everything else once per round
+    for (size_t round = 0; round < 10; ++round)
+        for (size_t i = 0; i < 7; ++i)
+            for (size_t k = i == 0 ? 100 : 1; k; --k)
+                if (recorded(shapes[i]) != expected[i])
+                    ++errors;
+
+    const mch::dispatch_profile profile = current_profile();
+    const mch::dispatch_profile::site* site = nullptr;
+
+    for (std::map<std::string,mch::dispatch_profile::site>::const_iterator p = profile.sites.begin(); p != profile.sites.end(); ++p)
+        if (p->second.entries.size() == 7)
+            site = &p->second;
+
+    if (!site)
+        return errors + 1;
+
+    if (site->expected_hits(typeid(Circle).name()) != 1000 || site->expected_hits(typeid(Square).name()) != 10)
+        ++errors;
+
+    // Clause histogram: circles took one clause, squares and triangles others
+    const std::map<size_t,size_t> clauses = site->clauses();
+
+    if (clauses.size() != 3)
+        ++errors;
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+size_t test_replay()
+{
+    std::ostringstream os;
+    os << "# Profile of a previous run"                       << std::endl
+       << "site\t"  << __FILE__ << ':' << replayed_line       << std::endl
+       << "tuple\t500\t2\t" << typeid(Square).name()          << std::endl
+       << "tuple\t7\t1\t"   << typeid(Circle).name()          << std::endl
+       << "clause\t1\t7"                                      << std::endl
+       << "clause\t2\t500"                                    << std::endl;
+
+    std::istringstream is(os.str());
+    size_t errors = 0;
+
+    if (!mch::load_dispatch_profile(is))
+        ++errors;
+
+    Circle c;
+    Square s;
+
+    if (replayed(&s) != 2 || replayed(&c) != 1)
+        ++errors;
+
+    mch::dispatch_profile profile = current_profile();
+    const mch::dispatch_profile::site* site = find_site(profile, replayed_line);
+
+    // Counts of the tuples seen for the first time start from the loaded ones
+    if (!site || site->expected_hits(typeid(Square).name()) != 501 || site->expected_hits(typeid(Circle).name()) != 8)
+        ++errors;
+
+    // A profile loaded after the first use is replayed on the already registered maps
+    std::istringstream again(os.str());
+
+    if (!mch::load_dispatch_profile(again) || replayed(&s) != 2)
+        ++errors;
+
+    profile = current_profile();
+    site    = find_site(profile, replayed_line);
+
+    if (!site || site->expected_hits(typeid(Square).name()) != 502)
+        ++errors;
+
+    // Malformed profiles are rejected
+    std::istringstream malformed("tuple\t1\t2\tx\n");
+
+    if (mch::load_dispatch_profile(malformed))
+        ++errors;
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const size_t errors = test_record() + test_replay();
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,205 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises the export of dispatch statistics: every match statement has to
+/// show up in a snapshot under its own location with the counts of requests it
+/// served, and the snapshot has to be exportable as JSON and CSV at any time.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#define XTL_DUMP_PERFORMANCE 1
+
+#include <sstream>
+#include <string>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+/// Line of the match statement in unary()
+const size_t unary_line = __LINE__ + 4;
+
+int unary(const Shape* s)
+{
+    Match(s)
+    {
+    Case(Circle)   return 1;
+    Case(Square)   return 2;
+    Otherwise()    return 0;
+    }
+    EndMatch
+
+    return -1; // To prevent all control path warning
+}
+
+/// Line of the match statement in binary()
+const size_t binary_line = __LINE__ + 4;
+
+int binary(const Shape* a, const Shape* b)
+{
+    Match(a,b)
+    {
+    Case(Circle,Circle) return 1;
+    Case(Square,Shape)  return 2;
+    Otherwise()         return 0;
+    }
+    EndMatch
+
+    return -1; // To prevent all control path warning
+}
+
+//------------------------------------------------------------------------------
+
+/// Finds statistics of the match statement at the given line of this file
+const mch::dispatch_stats* find_stats(const std::vector<mch::dispatch_stats>& stats, size_t line)
+{
+    for (size_t i = 0; i < stats.size(); ++i)
+        if (stats[i].line == line && std::string(stats[i].file) == __FILE__)
+            return &stats[i];
+
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+size_t test_snapshot()
+{
+    Circle   c;
+    Square   s;
+    Triangle t;
+    const Shape* shapes[] = { &c, &s, &t };
+    size_t   errors = 0;
+
+    for (size_t i = 0; i < 100; ++i)
+        if (unary(shapes[i%3]) != int(i%3+1)%3)
+            ++errors;
+
+    const std::vector<mch::dispatch_stats> before = mch::dispatch_statistics();
+    const mch::dispatch_stats* u = find_stats(before, unary_line);
+
+    // Every request is either a hit or a miss and each type got an entry
+    if (!u || u->arity != 1 || u->hits + u->misses != 100 || u->entries != 3 || u->hits < u->misses)
+        ++errors;
+
+    if (!u || u->cache_size < u->entries || u->memory == 0 || u->collisions > u->misses)
+        ++errors;
+
+    // The binary match statement is not registered until its first use
+    if (find_stats(before, binary_line))
+        ++errors;
+
+    for (size_t i = 0; i < 9; ++i)
+        binary(shapes[i%3], shapes[i/3]);
+
+    const std::vector<mch::dispatch_stats> after = mch::dispatch_statistics();
+    const mch::dispatch_stats* b = find_stats(after, binary_line);
+
+    if (!b || b->arity != 2 || b->hits + b->misses != 9 || b->entries != 9)
+        ++errors;
+
+    // Counters keep growing between snapshots
+    const mch::dispatch_stats* v = find_stats(after, unary_line);
+
+    if (!v || v->hits + v->misses != 100 || unary(&c) != 1 || find_stats(mch::dispatch_statistics(), unary_line)->hits != v->hits + 1)
+        ++errors;
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+/// Number of occurrences of the substring in the string
+size_t occurrences(const std::string& str, const std::string& sub)
+{
+    size_t n = 0;
+
+    for (size_t p = str.find(sub); p != std::string::npos; p = str.find(sub, p + 1))
+        ++n;
+
+    return n;
+}
+
+size_t test_export()
+{
+    const size_t maps = mch::dispatch_statistics().size();
+    size_t errors = 0;
+
+    std::ostringstream json;
+    mch::write_dispatch_statistics_json(json);
+
+    if (json.str().empty() || json.str()[0] != '[' || occurrences(json.str(), "{\"file\":") != maps)
+        ++errors;
+
+    std::ostringstream line;
+    line << "\"line\":" << binary_line << ',';
+
+    if (occurrences(json.str(), line.str()) != 1 || occurrences(json.str(), "\"arity\":2,") != 1)
+        ++errors;
+
+    std::ostringstream csv;
+    mch::write_dispatch_statistics_csv(csv);
+
+    // Header followed by a line per map
+    if (occurrences(csv.str(), "\n") != maps + 1 || csv.str().compare(0, 10, "file,line,") != 0)
+        ++errors;
+
+    // Quotes in strings are escaped in both formats
+    std::ostringstream quoted;
+    mch::write_json_string(quoted, "a\"b\\c\n");
+    mch::write_csv_field(quoted, "a\"b");
+
+    if (quoted.str() != "\"a\\\"b\\\\c\\u000a\"\"a\"\"b\"")
+        ++errors;
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const size_t errors = test_snapshot() + test_export();
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
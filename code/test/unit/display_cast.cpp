@@ -0,0 +1,151 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises display_cast: casts within a registered hierarchy have to agree
+/// with dynamic_cast, including adjustments of pointers to classes with other
+/// bases, while the rest fall back to dynamic_cast. Match statements and 
+/// constructor patterns have to use it with XTL_USE_DISPLAY_CAST.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#define XTL_USE_DISPLAY_CAST 1
+
+#include <mach7/match.hpp>                 // Support for Match statement
+#include <mach7/patterns/constructor.hpp>  // Support for constructor patterns
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+/// Unregistered base that makes casts to the classes deriving from it adjust the pointer
+struct Tag { virtual ~Tag() {} int tag; };
+
+struct Shape                    { XTL_DISPLAY_ROOT(Shape)                  virtual ~Shape() {} };
+struct Circle   : Shape         { XTL_DISPLAY_DERIVED(Circle,Shape)        double radius; };
+struct Square   : Shape         { XTL_DISPLAY_DERIVED(Square,Shape)        double side; };
+struct Ring     : Tag, Circle   { XTL_DISPLAY_DERIVED(Ring,Circle)         double inner; };
+struct Disk     : Ring          { XTL_DISPLAY_DERIVED(Disk,Ring)           int    color; };
+
+/// Derived from a registered class, but not registered itself: treated as Circle
+struct Ellipse  : Circle        { double ratio; };
+
+namespace mch ///< Mach7 library namespace
+{
+    template <> struct bindings<Circle> { Members(Circle::radius); };
+    template <> struct bindings<Square> { Members(Square::side);   };
+} // of namespace mch
+
+//------------------------------------------------------------------------------
+
+static_assert( mch::is_display_castable<const Shape, Disk>::value, "Disk is registered below Shape");
+static_assert(!mch::is_display_castable<Shape, Ellipse>::value,     "Ellipse is not registered");
+static_assert(!mch::is_display_castable<Shape, Tag>::value,         "Tag is a cross-cast");
+static_assert(mch::display_of<Disk>::depth == 4,                   "Disk is 4 levels deep");
+
+template <typename T>
+size_t check_cast(const Shape* s)
+{
+    return display_cast<const T*>(s) == dynamic_cast<const T*>(s) ? 0 : 1;
+}
+
+size_t test_casts(const Shape* s)
+{
+    return check_cast<Shape>(s) + check_cast<Circle>(s) + check_cast<Square>(s)
+         + check_cast<Ring>(s)  + check_cast<Disk>(s)   + check_cast<Ellipse>(s)
+         + check_cast<Tag>(s);
+}
+
+//------------------------------------------------------------------------------
+
+int area_kind(const Shape* s)
+{
+    Match(s)
+    {
+    Case(Disk)   return 4;
+    Case(Ring)   return 3;
+    Case(Square) return 2;
+    Case(Circle) return 1;
+    Otherwise()  return 0;
+    }
+    EndMatch
+
+    return -1; // To prevent all control path warning
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    Shape   shape;
+    Circle  circle;  circle.radius = 2;
+    Square  square;  square.side   = 3;
+    Ring    ring;
+    Disk    disk;
+    Ellipse ellipse;
+    const Shape* shapes[]   = { &shape, &circle, &square, &ring, &disk, &ellipse };
+    const int    expected[] = { 0, 1, 2, 3, 4, 1 };
+    size_t errors = 0;
+
+    for (size_t i = 0; i < XTL_ARR_SIZE(shapes); ++i)
+    {
+        errors += test_casts(shapes[i]);
+
+        if (area_kind(shapes[i]) != expected[i] || area_kind(shapes[i]) != expected[i])
+            ++errors;
+    }
+
+    // Casts of null pointers and of references
+    if (display_cast<const Circle*>(static_cast<const Shape*>(nullptr)) || &display_cast<const Ring&>(*shapes[4]) != &disk)
+        ++errors;
+
+    try { display_cast<const Square&>(*shapes[1]); ++errors; } catch (const std::bad_cast&) {}
+
+    // Constructor patterns
+    mch::var<double> v;
+
+    if (!mch::C<Circle>(v)(shapes[1]) || v != 2 || mch::C<Circle>(v)(shapes[2]) || !mch::C<Circle>()(shapes[4]) || mch::C<Square>()(shapes[3]))
+        ++errors;
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,234 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Checks the precomputed subsumption relation between kinds of a closed class
+/// hierarchy against the walk over tag precedence lists it replaces, as well
+/// as the fallback to that walk and to the sparse part of the table of kinds
+/// for kinds that are not kept densely, whose replaced snapshots have to be
+/// reclaimed.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <mach7/match.hpp>                 // Support for Match statement
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+
+#include <iostream>
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+struct Node
+{
+    enum Kind { K_Node = 1, K_Expr, K_Binary, K_Plus, K_Literal };
+    Node(Kind k) : kind(k) {}
+    Kind kind;
+};
+
+struct Expr    : Node    { Expr(Kind k = K_Expr)     : Node(k)   {} };
+struct Binary  : Expr    { Binary(Kind k = K_Binary) : Expr(k)   {} };
+struct Plus    : Binary  { Plus()                    : Binary(K_Plus) {} };
+struct Literal : Expr    { Literal(int v) : Expr(K_Literal), value(v) {} int value; };
+
+SKV(Node,Node::K_Node);
+
+namespace mch ///< Mach7 library namespace
+{
+template <> struct bindings<Node>    { KS(Node::kind); KV(Node,Node::K_Node); };
+template <> struct bindings<Expr>    { KV(Node,Node::K_Expr);    BCS(Expr,    Node); };
+template <> struct bindings<Binary>  { KV(Node,Node::K_Binary);  BCS(Binary,  Expr, Node); };
+template <> struct bindings<Plus>    { KV(Node,Node::K_Plus);    BCS(Plus,    Binary, Expr, Node); };
+template <> struct bindings<Literal> { KV(Node,Node::K_Literal); BCS(Literal, Expr, Node); Members(Literal::value); };
+} // of namespace mch
+
+//------------------------------------------------------------------------------
+
+/// The walk over the tag precedence list the subsumption table replaces
+static bool walk_kinds(mch::lbl_type base_kind, mch::lbl_type derived_kind)
+{
+    const mch::lbl_type* all_kinds = mch::get_kinds<Node>(derived_kind);
+
+    if (!all_kinds)
+        return base_kind == derived_kind;
+
+    while (*all_kinds)
+        if (*all_kinds++ == base_kind)
+            return true;
+
+    return false;
+}
+
+static size_t test_hierarchy()
+{
+    size_t errors = 0;
+
+    // Include a few kinds beyond those of the hierarchy to cover unknown ones
+    for (size_t d = 0; d < 10; ++d)
+        for (size_t b = 0; b < 10; ++b)
+            if (mch::is_base_and_derived_kinds<Node>(mch::lbl_type(b),mch::lbl_type(d)) != walk_kinds(mch::lbl_type(b),mch::lbl_type(d)))
+            {
+                std::cerr << "Mismatch for base " << b << " and derived " << d << std::endl;
+                ++errors;
+            }
+
+    if (!mch::is_base_and_derived_kinds<Node>(mch::remapped<Node>::lbl, mch::remapped<Plus>::lbl)
+      || mch::is_base_and_derived_kinds<Node>(mch::remapped<Binary>::lbl, mch::remapped<Literal>::lbl))
+        ++errors;
+
+    return errors;
+}
+
+static size_t test_matrix()
+{
+    typedef mch::lbl_type L;
+
+    static const L huge    = L(XTL_MAX_DENSE_KINDS + 1);
+    static const L small[] = { L(3), L(2), L(1), L(0) };
+    static const L large[] = { huge, L(2), L(1), L(0) };
+
+    mch::kind_subsumption ks;
+    size_t errors = 0;
+
+    if (ks.test(L(1),L(3)) != -1 || !ks.set(L(3), small) || ks.test(L(1),L(3)) != 1 || ks.test(L(4),L(3)) != 0 || ks.test(L(3),L(2)) != -1)
+        ++errors;
+
+    // Kinds that do not fit into the matrix are left for the walk
+    if (ks.set(huge, large) || ks.test(L(1), huge) != -1)
+        ++errors;
+
+    // Registering more kinds has to preserve the rows recorded so far
+    static const L wide[] = { L(200), L(1), L(0) };
+
+    if (!ks.set(L(200), wide) || ks.test(L(2),L(3)) != 1 || ks.test(L(1),L(200)) != 1 || ks.test(L(3),L(200)) != 0)
+        ++errors;
+
+    // Re-registration of a kind replaces its row
+    static const L other[] = { L(3), L(1), L(0) };
+
+    if (!ks.set(L(3), other) || ks.test(L(2),L(3)) != 0 || ks.test(L(1),L(3)) != 1)
+        ++errors;
+
+    return errors;
+}
+
+static size_t test_table()
+{
+    typedef mch::lbl_type L;
+
+    static const L huge    = L(XTL_MAX_DENSE_KINDS + 7);
+    static const L dense[] = { L(5), L(1), L(0) };
+    static const L large[] = { huge, L(1), L(0) };
+
+    mch::kind_table kt;
+    size_t errors = 0;
+
+    if (kt.get(L(5)) != 0 || kt.get(huge) != 0)
+        ++errors;
+
+    // Both dense and sparse kinds have to be found, but only dense ones in the matrix
+    if (kt.set(L(5), dense) != dense || kt.set(huge, large) != large || kt.get(L(5)) != dense || kt.get(huge) != large)
+        ++errors;
+
+    if (kt.subsumption().test(L(1),L(5)) != 1 || kt.subsumption().test(L(1),huge) != -1)
+        ++errors;
+
+    // Snapshots replaced by registration of more sparse kinds are reclaimed
+    // right away, as no lookup is in progress
+    static L more[16][3];
+
+    for (size_t i = 0; i < 16; ++i)
+    {
+        more[i][0] = L(huge + 1 + i);
+        more[i][1] = L(1);
+        more[i][2] = L(0);
+        kt.set(more[i][0], more[i]);
+    }
+
+    for (size_t i = 0; i < 16; ++i)
+        if (kt.get(more[i][0]) != more[i])
+            ++errors;
+
+    if (kt.get(huge) != large || mch::epoch_domain<>::pending_count() != 0)
+        ++errors;
+
+    // Kinds of the hierarchy are shared by all match statements on it
+    if (mch::get_kinds<Node>(mch::remapped<Plus>::lbl) != mch::bindings<Plus>::get_kinds())
+        ++errors;
+
+    return errors;
+}
+
+static size_t test_match()
+{
+    Plus    p;
+    Literal l(7);
+    const Node* nodes[] = { &p, &l };
+    const int expected[] = { 1, 7 };
+    size_t errors = 0;
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        int r = 0;
+
+        MatchF(nodes[i])
+        {
+        CaseF(Binary)     r = 1; break;
+        CaseF(Literal,v)  r = v; break;
+        CaseF(Node)       r = 0; break;
+        }
+        EndMatchF
+
+        if (r != expected[i])
+            ++errors;
+    }
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const size_t errors = test_hierarchy() + test_matrix() + test_table() + test_match();
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,156 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises kind_switch: subjects have to be dispatched through the jump 
+/// table to the clause on exactly their kind, kinds without a clause and kinds
+/// outside of the range of the table have to go to the default clause, and 
+/// the result has to agree with the equivalent MatchK statement.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <mach7/match.hpp>                 // Support for Match statement
+#include <mach7/kind_switch.hpp>           // Support for kind_switch
+
+#include <string>
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+struct Node
+{
+    enum Kind { K_Node = 100, K_Expr, K_Binary, K_Plus, K_Minus, K_Literal, K_Unused, K_Name };
+    Node(Kind k = K_Node) : kind(k) {}
+    Kind kind;
+};
+
+struct Expr    : Node    { Expr(Kind k = K_Expr)     : Node(k)   {} };
+struct Binary  : Expr    { Binary(Kind k = K_Binary) : Expr(k)   {} };
+struct Plus    : Binary  { Plus()                    : Binary(K_Plus)  {} };
+struct Minus   : Binary  { Minus()                   : Binary(K_Minus) {} };
+struct Literal : Expr    { Literal(int v) : Expr(K_Literal), value(v) {} int value; };
+struct Name    : Expr    { Name() : Expr(K_Name) {} };
+
+SKV(Node,Node::K_Node);
+
+namespace mch ///< Mach7 library namespace
+{
+template <> struct bindings<Node>    { KS(Node::kind); KV(Node,Node::K_Node); };
+template <> struct bindings<Expr>    { KV(Node,Node::K_Expr);    };
+template <> struct bindings<Binary>  { KV(Node,Node::K_Binary);  };
+template <> struct bindings<Plus>    { KV(Node,Node::K_Plus);    };
+template <> struct bindings<Minus>   { KV(Node,Node::K_Minus);   };
+template <> struct bindings<Literal> { KV(Node,Node::K_Literal); Members(Literal::value); };
+template <> struct bindings<Name>    { KV(Node,Node::K_Name);    };
+} // of namespace mch
+
+//------------------------------------------------------------------------------
+
+int with_table(const Node& n)
+{
+    return mch::kind_switch(n,
+        mch::kind_case<Plus>   ([](const Plus&)      { return 1; }),
+        mch::kind_case<Literal>([](const Literal& l) { return 10 + l.value; }),
+        mch::kind_case<Binary> ([](const Binary&)    { return 3; }),
+        mch::kind_otherwise    ([](const Node&)      { return -1; })
+    );
+}
+
+int with_match(const Node& n)
+{
+    MatchK(n)
+    {
+    CaseK(Plus)    return 1;
+    CaseK(Literal) return 10 + matched->value;
+    CaseK(Binary)  return 3;
+    OtherwiseK()   return -1;
+    }
+    EndMatchK
+
+    return -2;
+}
+
+/// No default clause: unhandled kinds yield a value-initialized result
+std::string without_default(const Node* n)
+{
+    return mch::kind_switch(n,
+        mch::kind_case<Minus>([](const Minus&) { return std::string("minus"); }),
+        mch::kind_case<Name> ([](const Name&)  { return std::string("name");  })
+    );
+}
+
+//------------------------------------------------------------------------------
+
+typedef mch::kind_switch_table<Node,int,mch::kind_clause<Plus,int(*)(const Plus&)>,mch::kind_clause<Name,int(*)(const Name&)>> table_type;
+
+static_assert(table_type::smallest == Node::K_Plus && table_type::size == 5, "The table spans the kinds of the clauses only");
+static_assert(mch::clause_for_kind<Node::K_Literal,mch::kind_clause<Plus,int>,mch::kind_default<int>>::value == 1, "Kinds without a clause go to the default one");
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    Node    node;
+    Expr    expr;
+    Binary  binary;
+    Plus    plus;
+    Minus   minus;
+    Literal literal(7);
+    Name    name;
+    Node    alien(Node::Kind(1000)); // Kind above the table
+    Node    early(Node::Kind(1));    // Kind below the table
+    const Node* nodes[] = { &node, &expr, &binary, &plus, &minus, &literal, &name, &alien, &early };
+    size_t  errors = 0;
+
+    for (size_t i = 0; i < XTL_ARR_SIZE(nodes); ++i)
+        if (with_table(*nodes[i]) != with_match(*nodes[i]))
+            ++errors;
+
+    if (with_table(literal) != 17 || with_table(alien) != -1 || with_table(early) != -1)
+        ++errors;
+
+    if (without_default(&minus) != "minus" || without_default(&name) != "name" || !without_default(&plus).empty() || !without_default(&alien).empty())
+        ++errors;
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,132 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises the multi-threaded version of vtblmap<T> used by the unary Match
+/// statement: several threads concurrently match a mix of types large enough
+/// to force the cache to grow repeatedly, after which all the replaced cache
+/// descriptors are expected to have been reclaimed. Another thread matches
+/// once and stays parked meanwhile, which must not hold reclamation back.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#define XTL_MULTI_THREADING 1
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mach7/match.hpp>                 // Support for Match statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+int do_match(const Shape* s)
+{
+    MatchP(s)
+    {
+    CaseP(Circle)   return 1;
+    CaseP(Square)   return 2;
+    CaseP(Triangle) return 3;
+    OtherwiseP()    return 0;
+    }
+    EndMatchP
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const std::vector<Shape*> shapes = make_all_shapes<0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19>();
+    const size_t n = shapes.size();
+    const size_t threads_count = 4;
+    const size_t iterations = 50000;
+
+    std::atomic<size_t> errors(0);
+    std::atomic<int>    parked(0); // 1 once the parked thread has matched, 2 once it may exit
+    std::vector<std::thread> threads;
+
+    std::thread parker([&shapes,&errors,&parked]()
+    {
+        if (do_match(shapes[0]) != classify(shapes[0]))
+            ++errors;
+
+        parked.store(1);
+
+        while (parked.load() != 2)
+            std::this_thread::yield();
+    });
+
+    while (parked.load() != 1)
+        std::this_thread::yield();
+
+    for (size_t t = 0; t < threads_count; ++t)
+        threads.push_back(std::thread([&shapes,&errors,n,t,iterations]()
+        {
+            size_t seed = 7*t+1;
+
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                seed = seed*1103515245 + 12345;
+                const Shape* s = shapes[(seed >> 8) % std::min(n, 4 + i/64)]; // Gradually introduce new types
+
+                if (do_match(s) != classify(s))
+                    ++errors;
+            }
+        }));
+
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    // The worker threads have exited and the parked one is outside of the map
+    mch::epoch_domain<>::reclaim();
+    const size_t pending = mch::epoch_domain<>::pending_count();
+
+    parked.store(2);
+    parker.join();
+
+    for (size_t i = 0; i < n; ++i)
+        delete shapes[i];
+
+    return report(errors, pending != 0, ", ", pending, " descriptors pending reclamation");
+}
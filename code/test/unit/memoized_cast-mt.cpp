@@ -0,0 +1,147 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises memoized_cast in the multi-threaded setting: several threads 
+/// concurrently cast objects of many dynamic types to more target types than
+/// fit inline into an entry of the offset table, while new dynamic types keep
+/// coming in. Some of the targets are declared up front with XTL_CAST_TARGETS
+/// and thus have constant indices. Every cast has to agree with dynamic_cast.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#define XTL_MULTI_THREADING 1
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <mach7/memoized_cast.hpp>         // Support for memoized dynamic_cast
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+/// Unrelated polymorphic base that makes casts to the derived classes adjust the pointer
+struct Tag      { virtual ~Tag() {} intptr_t tag; };
+
+template <int I> struct TaggedCircle : Tag, Circle {};
+template <int I> struct TaggedSquare : Tag, Square {};
+
+/// Casts to these take a constant index, the rest get one on first use
+XTL_CAST_TARGETS(Shape, Square, TaggedCircle<0>, TaggedCircle<1>, TaggedSquare<2>, Tag)
+
+static_assert( mch::is_declared_cast_target<Shape,TaggedSquare<2>>::index == 3, "Declared targets are indexed in order");
+static_assert(!mch::is_declared_cast_target<Shape,Circle>::value, "Circle was not declared");
+
+//------------------------------------------------------------------------------
+
+/// Checks memoized_cast to T against dynamic_cast
+template <typename T>
+bool cast_agrees(const Shape* s)
+{
+    return memoized_cast<const T*>(s) == dynamic_cast<const T*>(s);
+}
+
+typedef bool (*cast_check)(const Shape*);
+
+template <int I>
+void add_types(std::vector<Shape*>& shapes, std::vector<cast_check>& checks)
+{
+    shapes.push_back(new TaggedCircle<I>);
+    shapes.push_back(new TaggedSquare<I>);
+    checks.push_back(&cast_agrees<TaggedCircle<I>>);
+    checks.push_back(&cast_agrees<TaggedSquare<I>>);
+}
+
+template <int... I>
+void add_all_types(std::vector<Shape*>& shapes, std::vector<cast_check>& checks)
+{
+    int dummy[] = {(add_types<I>(shapes,checks),0)...};
+    XTL_UNUSED(dummy);
+    shapes.push_back(new Circle);
+    shapes.push_back(new Square);
+    checks.push_back(&cast_agrees<Circle>);
+    checks.push_back(&cast_agrees<Square>);
+    checks.push_back(&cast_agrees<Tag>);
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    std::vector<Shape*>     shapes;
+    std::vector<cast_check> checks;
+    add_all_types<0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15>(shapes, checks);
+
+    const size_t n = shapes.size();
+    const size_t m = checks.size();
+    const size_t threads_count = 4;
+    const size_t iterations = 50000;
+
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < threads_count; ++t)
+        threads.push_back(std::thread([&shapes,&checks,&errors,n,m,t,iterations]()
+        {
+            size_t seed = 7*t+1;
+
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                seed = seed*1103515245 + 12345;
+                const Shape* s = shapes[(seed >> 8) % std::min(n, 2 + i/64)]; // Gradually introduce new types
+
+                if (!checks[(seed >> 20) % m](s))
+                    ++errors;
+            }
+        }));
+
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    for (size_t i = 0; i < n; ++i)
+        delete shapes[i];
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
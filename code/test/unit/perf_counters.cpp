@@ -0,0 +1,170 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises the instrumentation of match statements with performance 
+/// counters: every statement has to be reported under its own location with
+/// the number of its executions in all threads, whether or not the kernel lets
+/// the hardware events be counted.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#define XTL_USE_PERF_COUNTERS 1
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+const size_t inner_line = __LINE__ + 5;  ///< Line of the Match statement in inner
+const size_t outer_line = __LINE__ + 16; ///< Line of the Match statement in outer
+
+size_t inner(const Shape& s)
+{
+    Match(s)
+    {
+    Case(Circle)   return 1;
+    Case(Square)   return 2;
+    Case(Triangle) return 3;
+    }
+    EndMatch
+    return 0;
+}
+
+size_t outer(const Shape& s1, const Shape& s2)
+{
+    Match(s1,s2)
+    {
+    Case(Circle, Shape) return inner(s2);
+    Otherwise()         return 0;
+    }
+    EndMatch
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns the counts of the statement at the given line, if it was executed
+const mch::perf_site_counts* find(const std::vector<mch::perf_site_counts>& counts, size_t line)
+{
+    for (size_t i = 0; i < counts.size(); ++i)
+        if (counts[i].line == line)
+            return &counts[i];
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    Circle c; Square s; Triangle t;
+    const Shape* shapes[] = {&c, &s, &t};
+    size_t checksum = 0;
+    size_t errors   = 0;
+
+    // The inner statement is executed by itself and from the outer one
+    for (size_t i = 0; i < 300; ++i)
+        checksum += inner(*shapes[i % 3]);
+
+    std::thread other([&shapes]()
+    {
+        for (size_t i = 0; i < 200; ++i)
+            outer(*shapes[i % 2 ? 1 : 0], *shapes[i % 3]);
+    });
+    other.join();
+
+    const std::vector<mch::perf_site_counts> counts = mch::perf_counts();
+    const mch::perf_site_counts* in  = find(counts, inner_line);
+    const mch::perf_site_counts* out = find(counts, outer_line);
+
+    if (!in  || in->executions  != 300 + 100) { std::cerr << "Wrong executions of inner statement" << std::endl; ++errors; }
+    if (!out || out->executions != 200)       { std::cerr << "Wrong executions of outer statement" << std::endl; ++errors; }
+
+    if (in && out)
+        for (size_t k = 0; k < mch::perf_event_kinds; ++k)
+            if (mch::perf_event_counted(k) && k != mch::perf_branch_misses && k != mch::perf_l1d_misses && (in->total[k] == 0 || out->total[k] == 0))
+            {
+                std::cerr << "No " << mch::perf_event_name(k) << " counted" << std::endl;
+                ++errors;
+            }
+
+    // Either some events were counted or the report tells why not
+    std::ostringstream text;
+    mch::write_perf_report(text);
+    const bool explained = text.str().find("unavailable") != std::string::npos;
+
+    if (!mch::perf_event_counted(mch::perf_cycles) && !explained)
+    {
+        std::cerr << "Missing reason of unavailable counters" << std::endl;
+        ++errors;
+    }
+
+    std::ostringstream location;
+    location << "perf_counters.cpp:" << inner_line << ' ';
+
+    if (text.str().find(location.str()) == std::string::npos)
+    {
+        std::cerr << "Inner statement is missing from the report" << std::endl;
+        ++errors;
+    }
+
+    std::ostringstream json;
+    mch::write_perf_counters_json(json);
+
+    if (json.str().find("\"executions\":400") == std::string::npos)
+    {
+        std::cerr << "Inner statement is missing from the JSON report" << std::endl;
+        ++errors;
+    }
+
+    return report(errors, false,
+                  ", ", counts.size(), " statements, hardware counters ",
+                  mch::perf_event_counted(mch::perf_cycles) ? "available" : "unavailable",
+                  checksum ? "" : " ");
+}
+
+//------------------------------------------------------------------------------
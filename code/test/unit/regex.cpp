@@ -49,13 +49,116 @@
 #include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
 #include <mach7/patterns/regex.hpp>        // Regular expression patterns
 
+#include <chrono>
 #include <iostream>
 
+using namespace mch;
 
-int main()
+//------------------------------------------------------------------------------
+
+/// Classifies string #s the same way #main does, but with regular expressions
+/// compiled on every evaluation of the pattern (\see XTL_REGEX).
+int classify_uncached(const std::string& s)
+{
+    var<int> area_code;
+    var<int> y,m,d;
+    auto year  = y |= y > 0;
+    auto month = m |= m > 0 && m < 13;
+    auto day   = d |= d > 0 && d < 31;
+
+    Match(s)
+    {
+        With(rex("([0-9]{4})[/-]([0-9]{2})[/-]([0-9]{2})", year, month, day)) return 1;
+        With(rex("([0-9]{4})[/-]([0-9]{2})[/-]([0-9]{2})", year, day, month)) return 2;
+        With(rex("([0-9]+)-([0-9]+)-([0-9]+)", 979))                        return 3;
+        With(rex("([0-9]+)-([0-9]+)-([0-9]+)", area_code |= area_code >= 970 && area_code <= 980)) return 4;
+        With(rex("([0-9]+)-([0-9]+)-([0-9]+)", area_code))                  return 5;
+        With(rex("[0-9]{4}"))                                               return 6;
+        With(rex("[A-Za-z_][A-Za-z_0-9]*"))                                 return 7;
+    }
+    EndMatch
+
+    return 0;
+}
+
+/// The same classification with regular expressions compiled once per call site
+int classify(const std::string& s)
+{
+    var<int> area_code;
+    var<int> y,m,d;
+    auto year  = y |= y > 0;
+    auto month = m |= m > 0 && m < 13;
+    auto day   = d |= d > 0 && d < 31;
+
+    Match(s)
+    {
+        With(rex(XTL_REGEX("([0-9]{4})[/-]([0-9]{2})[/-]([0-9]{2})"), year, month, day)) return 1;
+        With(rex(XTL_REGEX("([0-9]{4})[/-]([0-9]{2})[/-]([0-9]{2})"), year, day, month)) return 2;
+        With(rex(XTL_REGEX("([0-9]+)-([0-9]+)-([0-9]+)"), 979))                        return 3;
+        With(rex(XTL_REGEX("([0-9]+)-([0-9]+)-([0-9]+)"), area_code |= area_code >= 970 && area_code <= 980)) return 4;
+        With(rex(XTL_REGEX("([0-9]+)-([0-9]+)-([0-9]+)"), area_code))                  return 5;
+        With(rex(XTL_REGEX("[0-9]{4}")))                                               return 6;
+        With(rex(XTL_REGEX("[A-Za-z_][A-Za-z_0-9]*")))                                 return 7;
+    }
+    EndMatch
+
+    return 0;
+}
+
+#if XTL_SUPPORT(std_string_view)
+/// Subjects of type std::string_view are matched without a copy
+int classify(std::string_view s)
+{
+    var<std::string_view> key;
+    var<int> value;
+
+    Match(s)
+    {
+        With(rex(XTL_REGEX("([a-z]+)=([0-9]+)"), key, value)) return key.value().data() == s.data() ? value.value() : -1;
+        With(rex(XTL_REGEX("[0-9]{4}")))                      return 6;
+    }
+    EndMatch
+
+    return 0;
+}
+#endif
+
+/// Checks conversion of captures into various types
+int test_captures()
 {
-    using namespace mch;
+    int errors = 0;
+
+    var<double>        f;
+    var<unsigned int>  u;
+    var<long long>     l;
+    var<std::string>   s;
 
+    errors += !rex(XTL_REGEX("(-?[0-9.]+)"), f)("-3.25") || f.value() != -3.25;
+    errors += !rex(XTL_REGEX("([+-]?[0-9]+)"), u)("+42") || u.value() != 42u;
+    errors +=  rex(XTL_REGEX("([+-]?[0-9]+)"), u)("-42");                   // Negative into unsigned
+    errors += !rex(XTL_REGEX("([0-9]+)"), l)("9000000000") || l.value() != 9000000000LL;
+    errors +=  rex(XTL_REGEX("([0-9]+)"), l)("99999999999999999999");       // Out of range
+    errors += !rex(XTL_REGEX("(.*)=(.*)"), s, l)("two words=2") || s.value() != "two" || l.value() != 2; // Strings are read as with operator>>
+    errors +=  rex(XTL_REGEX("(.*)=(.*)"), s, l)(" =2");                   // Nothing but whitespace
+#if XTL_SUPPORT(std_string_view)
+    var<std::string_view> v;
+    std::string_view subject = "key=value";
+    errors += !rex(XTL_REGEX("([a-z]+)=.*"), v)(subject) || v.value() != "key" || v.value().data() != subject.data();
+    errors += !std::is_same<regex0<>::accepted_type_for<const char*>::type, std::string_view>::value; // C strings are matched in place as well
+    errors += !std::is_same<regex0<>::accepted_type_for<char[8]>::type,     std::string_view>::value;
+#endif
+
+    if (errors)
+        std::cerr << errors << " capture conversion errors" << std::endl;
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+
+int main()
+{
     const char* strings[] = 
     {
         "1977-04-01",
@@ -98,4 +201,52 @@ int main()
 
         std::cout << std::endl;
     }
+
+    // Compare regular expressions compiled once per call site with those 
+    // compiled every time the pattern is tried. Timings go to the log to keep
+    // the output comparable with the expected one.
+
+    int errors = test_captures();
+    const size_t n = sizeof(strings)/sizeof(strings[0]);
+    const int    N = 50;
+
+    typedef std::chrono::steady_clock clock;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::string s = strings[i];
+        int k = classify_uncached(s);
+
+        if (classify(s) != k)
+            std::cerr << "Cached regex classified " << s << " differently" << std::endl, ++errors;
+    }
+
+#if XTL_SUPPORT(std_string_view)
+    errors += classify(std::string_view("1977")) != 6;
+    errors += classify(std::string_view("key=42")) != 42;
+#endif
+
+    int sum1 = 0, sum2 = 0;
+    clock::time_point t0 = clock::now();
+
+    for (int j = 0; j < N; ++j)
+        for (size_t i = 0; i < n; ++i)
+            sum1 += classify_uncached(strings[i]);
+
+    clock::time_point t1 = clock::now();
+
+    for (int j = 0; j < N; ++j)
+        for (size_t i = 0; i < n; ++i)
+            sum2 += classify(std::string(strings[i]));
+
+    clock::time_point t2 = clock::now();
+
+    errors += sum1 != sum2;
+
+    typedef std::chrono::duration<double, std::micro> microseconds;
+    double uncached = microseconds(t1-t0).count() / (N*n);
+    double cached   = microseconds(t2-t1).count() / (N*n);
+    std::clog << "Per match: rex(\"...\") " << uncached << "us, rex(XTL_REGEX(\"...\")) " << cached << "us, " << uncached/cached << " times faster" << std::endl;
+
+    return errors;
 }
@@ -0,0 +1,238 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Checks that regex patterns matched with the DFA engine accept the same 
+/// subjects and bind the same capture groups as those matched with std::regex,
+/// and that expressions outside of the supported subset fall back to it.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <mach7/match.hpp>                 // Support for Match statement
+#include <mach7/patterns/combinators.hpp>  // Support for pattern combinators &&, || and !
+#include <mach7/patterns/guard.hpp>        // Support for guard patterns
+#include <mach7/patterns/n+k.hpp>          // Generalized n+k patterns
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+#include <mach7/patterns/regex_dfa.hpp>    // DFA engine for regular expression patterns
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+using namespace mch;
+
+//------------------------------------------------------------------------------
+
+std::atomic<size_t> allocations(0); ///< Number of calls to global operator new
+
+#if defined(__GNUC__) && __GNUC__ >= 11 && !defined(__clang__)
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wmismatched-new-delete" // Replacements of operator new and delete are inlined into each other's callers
+#endif
+
+void* operator new(size_t size)
+{
+    ++allocations;
+
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); } ///< Sized deallocation has to be replaced as well
+
+#if defined(__GNUC__) && __GNUC__ >= 11 && !defined(__clang__)
+  #pragma GCC diagnostic pop
+#endif
+
+//------------------------------------------------------------------------------
+
+/// Regular expressions of the supported subset
+const char* expressions[] = 
+{
+    "abc",
+    "a|b|",
+    "(a|ab)(c|bcd)(d*)",
+    "([0-9]+)-([0-9]+)-([0-9]+)",
+    "([0-9]{4})[/-]([0-9]{2})[/-]([0-9]{2})",
+    "[A-Za-z_][A-Za-z_0-9]*",
+    "(a+)*b",
+    "(a+)+?(a*)",
+    "(a+?)(a*)",
+    "(x?)(x{2,3})(x*)",
+    "((a)|(b))+",
+    "(?:ab)+(c)?",
+    "[^0-9\\s]+(\\d*)",
+    "\\w+@\\w+\\.(com|org)",
+    "^(.*)=(.*)$",
+    "[\\]\\-a]+",
+    "\\x41\\.\\*",
+    "(GET|POST) (/[^ ]*) HTTP/1\\.([01])",
+};
+
+/// Subjects to match them against
+const char* subjects[] = 
+{
+    "", "a", "b", "abc", "abcd", "abcdd", "ab", "aaab", "aaaa", "xx", "xxxx", "xxxxxx",
+    "abab", "ababc", "abba", "979-739-3587", "1977-04-01", "var1", "_x9", "ab12",
+    "user@host.com", "user@host.net", "key=value", "=", "]-a", "A.*", "a=b=c",
+    "GET /index.html HTTP/1.1", "POST / HTTP/1.0", "PUT / HTTP/1.1",
+};
+
+/// Compares the outcome of both engines on one expression and subject
+int compare(const char* re, const char* subject)
+{
+    const std::regex std_re(re);
+    const dfa_regex  dfa_re(re);
+
+    if (dfa_re.uses_fallback())
+    {
+        std::cerr << re << " unexpectedly fell back to std::regex" << std::endl;
+        return 1;
+    }
+
+    const char* first = subject;
+    const char* last  = subject + std::strlen(subject);
+    const size_t n    = dfa_re.groups();
+
+    std::vector<regex_capture> expected(n), actual(n);
+    const bool e = regex_engine<std::regex>::match(std_re, first, last, expected.data(), n);
+    const bool a = dfa_re.match(first, last, actual.data(), n);
+    const bool d = dfa_re.match(first, last, nullptr, 0);
+
+    if (e != a || e != d || (e && expected != actual))
+    {
+        std::cerr << re << " on \"" << subject << "\": std::regex " << (e ? "matched" : "did not match") 
+                  << ", DFA " << (a ? "matched" : "did not match") << (d != a ? " inconsistently" : "");
+
+        for (size_t i = 0; e && a && i < n; ++i)
+            if (expected[i] != actual[i])
+                std::cerr << ", group " << i+1 << " differs";
+
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/// Classifies the same strings as regex.cpp with the DFA engine
+const char* classify(const std::string& s)
+{
+    var<int> area_code;
+    var<int> y,m,d;
+    auto year  = y |= y > 0;
+    auto month = m |= m > 0 && m < 13;
+    auto day   = d |= d > 0 && d < 31;
+
+    Match(s)
+    {
+        With(rex(XTL_DFA_REGEX("([0-9]{4})[/-]([0-9]{2})[/-]([0-9]{2})"), year, month, day)) return "Date YYYY-MM-DD";
+        With(rex(XTL_DFA_REGEX("([0-9]{4})[/-]([0-9]{2})[/-]([0-9]{2})"), year, day, month)) return "Date YYYY-DD-MM";
+        With(rex(XTL_DFA_REGEX("([0-9]+)-([0-9]+)-([0-9]+)"), 979))                        return "Local Phone";
+        With(rex(XTL_DFA_REGEX("([0-9]+)-([0-9]+)-([0-9]+)"), area_code |= area_code >= 970 && area_code <= 980)) return "Texas Phone";
+        With(rex(XTL_DFA_REGEX("([0-9]+)-([0-9]+)-([0-9]+)"), area_code))                  return "Phone with area code";
+        With(rex(XTL_DFA_REGEX("[0-9]{4}")))                                               return "4 digits";
+        With(rex(XTL_DFA_REGEX("[A-Za-z_][A-Za-z_0-9]*")))                                 return "Identifier";
+    }
+    EndMatch
+
+    return "UNRECOGNIZED";
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    int errors = 0;
+
+    for (size_t i = 0; i < XTL_ARR_SIZE(expressions); ++i)
+        for (size_t j = 0; j < XTL_ARR_SIZE(subjects); ++j)
+            errors += compare(expressions[i], subjects[j]);
+
+    // Expressions outside of the subset are left to std::regex
+    const char* unsupported[] = { "(a)\\1", "a\\b", "(?=a)a", "a^b", "a{2000}", "(a*)*b" };
+
+    for (size_t i = 0; i < XTL_ARR_SIZE(unsupported); ++i)
+        if (!dfa_regex(unsupported[i]).uses_fallback())
+            std::cerr << unsupported[i] << " should have fallen back to std::regex" << std::endl, ++errors;
+
+    var<std::string> a;
+    errors += !rex(dfa_regex("(a)\\1"), a)("aa") || a.value() != "a";
+
+    // Invalid expressions are reported the same way std::regex reports them
+    try
+    {
+        dfa_regex("(a");
+        std::cerr << "Invalid expression was accepted" << std::endl, ++errors;
+    }
+    catch (const std::regex_error&) {}
+
+    // Once the per-thread scratch space has grown, matching does not allocate
+    {
+        const dfa_regex re("(GET|POST) (/[^ ]*) HTTP/1\\.([01])");
+        const char*     request = "GET /index.html HTTP/1.1";
+        regex_capture   groups[3];
+
+        re.match(request, request + std::strlen(request), groups, 3);
+        const size_t before = allocations;
+
+        for (int i = 0; i < 1000; ++i)
+            errors += !re.match(request, request + std::strlen(request), groups, 3)
+                   || !re.match(request, request + std::strlen(request), nullptr, 0);
+
+        if (allocations != before)
+            std::cerr << allocations - before << " allocations while matching" << std::endl, ++errors;
+    }
+
+    // Matches with the DFA engine bind the same values in Match statement
+    const char* strings[] = { "1977-04-01", "1977-20-01", "979-739-3587", "571-739-3587", "XXX-739-3587", "971-739-3587", "1977", "var1" };
+    const char* expected[] = { "Date YYYY-MM-DD", "Date YYYY-DD-MM", "Local Phone", "Phone with area code", "UNRECOGNIZED", "Texas Phone", "4 digits", "Identifier" };
+
+    for (size_t i = 0; i < XTL_ARR_SIZE(strings); ++i)
+        if (std::strcmp(classify(strings[i]), expected[i]) != 0)
+            std::cerr << strings[i] << " classified as " << classify(strings[i]) << std::endl, ++errors;
+
+    return report(errors);
+}
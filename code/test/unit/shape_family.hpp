@@ -0,0 +1,101 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Defines the family of shapes shared by the tests of dispatch tables: a small
+/// hierarchy of shapes together with many distinct classes of each kind, which
+/// make the vtbl maps of match statements grow, and the expected result of 
+/// classifying them computed without any caching.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#pragma once
+
+#include <mach7/config.hpp>                // Various compiler/platform dependent macros
+#include <cstddef>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+/// Shapes carry an identifier, so that tests can tell the objects apart
+struct Shape    { Shape(size_t i = 0) : id(i) {} virtual ~Shape() {} size_t id; };
+struct Circle   : Shape { Circle  (size_t i = 0) : Shape(i), radius(1.0)   {} double radius; };
+struct Square   : Shape { Square  (size_t i = 0) : Shape(i), side(1.0)     {} double side; };
+struct Triangle : Shape { Triangle(size_t i = 0) : Shape(i), a(1.0), b(1.0), c(1.0) {} double a, b, c; };
+
+/// Many distinct classes to make sure the vtbl maps have to grow while in use
+template <int I> struct CircleN   : Circle   { CircleN  (size_t i = 0) : Circle(i)   {} };
+template <int I> struct SquareN   : Square   { SquareN  (size_t i = 0) : Square(i)   {} };
+template <int I> struct TriangleN : Triangle { TriangleN(size_t i = 0) : Triangle(i) {} };
+
+//------------------------------------------------------------------------------
+
+/// Expected result computed without any caching
+inline int classify(const Shape* s)
+{
+    if (dynamic_cast<const Circle*>(s))   return 1;
+    if (dynamic_cast<const Square*>(s))   return 2;
+    if (dynamic_cast<const Triangle*>(s)) return 3;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+/// Adds one shape of each kind with index I
+template <int I>
+void make_shapes(std::vector<Shape*>& shapes)
+{
+    shapes.push_back(new CircleN<I>);
+    shapes.push_back(new SquareN<I>);
+    shapes.push_back(new TriangleN<I>);
+}
+
+/// Shapes of each kind with all the given indices followed by a plain Shape
+template <int... I>
+std::vector<Shape*> make_all_shapes()
+{
+    std::vector<Shape*> shapes;
+    int dummy[] = {(make_shapes<I>(shapes),0)...};
+    XTL_UNUSED(dummy);
+    shapes.push_back(new Shape);
+    return shapes;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,217 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Checks that clauses sharing the type tests of sub-terms made by nested 
+/// constructor patterns pick the same clauses as the clauses testing each
+/// sub-term on their own, including in nested match statements and on 
+/// sub-terms shared by several positions of the subject.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <mach7/type_switchN-patterns.hpp> // Support for N-ary Match statement on patterns
+#include <mach7/patterns/bindings.hpp>     // Mach7 support for bindings on arbitrary UDT
+#include <mach7/patterns/constructor.hpp>  // Support for constructor patterns
+#include <mach7/patterns/primitive.hpp>    // Wildcard, variable and value patterns
+#include <mach7/shared_tests.hpp>          // Type tests of sub-terms shared by the clauses of a match statement
+
+#include <iostream>
+#include <vector>
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+struct Expr          { virtual ~Expr() {} };
+struct Val    : Expr { Val(int v)         : value(v) {} int value; };
+struct Neg    : Expr { Neg(const Expr* e) : e(e)     {} const Expr* e; };
+struct Add    : Expr { Add(const Expr* e1, const Expr* e2) : e1(e1), e2(e2) {} const Expr* e1; const Expr* e2; };
+struct Mul    : Expr { Mul(const Expr* e1, const Expr* e2) : e1(e1), e2(e2) {} const Expr* e1; const Expr* e2; };
+
+namespace mch ///< Mach7 library namespace
+{
+template <> struct bindings<Val> { Members(Val::value); };
+template <> struct bindings<Neg> { Members(Neg::e); };
+template <> struct bindings<Add> { Members(Add::e1, Add::e2); };
+template <> struct bindings<Mul> { Members(Mul::e1, Mul::e2); };
+} // of namespace mch
+
+using mch::C;
+
+//------------------------------------------------------------------------------
+
+/// Whether the calling thread is inside the scope of shared tests of a match statement
+bool inside_shared_tests()
+{
+    return mch::shared_tests_generation::of_this_thread().current != 0;
+}
+
+//------------------------------------------------------------------------------
+
+int rules(const Expr* e)
+{
+    mch::var<const Expr*> x, y;
+    mch::var<int> n, m;
+    mch::wildcard _;
+
+    Match(e)
+    {
+        Case(C<Add>(C<Val>(0), x))            return 1;
+        Case(C<Add>(x, C<Val>(0)))            return 2;
+        Case(C<Add>(C<Val>(n), C<Val>(m)))    return 3;
+        Case(C<Add>(C<Neg>(x), C<Neg>(y)))    return 4;
+        Case(C<Add>(C<Neg>(x), y))            return 5 + 10*rules(x); // Nested statement on a sub-term
+        Case(C<Add>(x, C<Neg>(y)))            return 6;
+        Case(C<Mul>(C<Val>(1), x))            return 7;
+        Case(C<Mul>(C<Val>(n), C<Neg>(x)))    return 8;
+        Case(C<Mul>(C<Neg>(x), C<Val>(n)))    return 9;
+        Case(C<Mul>(_, C<Val>(0)))            return 10;
+        Case(C<Neg>(C<Mul>(x, y)))            return 11;
+        Case(C<Neg>(C<Val>(n)))               return 12 + 10*inside_shared_tests();
+        Otherwise()                           return 0;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T> const T* as(const Expr* e) { return dynamic_cast<const T*>(e); }
+
+int expected_rules(const Expr* e)
+{
+    if (const Add* a = as<Add>(e))
+    {
+        const Val* v1 = as<Val>(a->e1);
+        const Val* v2 = as<Val>(a->e2);
+
+        if (v1 && v1->value == 0)    return 1;
+        if (v2 && v2->value == 0)    return 2;
+        if (v1 && v2)                return 3;
+        if (as<Neg>(a->e1) && as<Neg>(a->e2)) return 4;
+        if (as<Neg>(a->e1))          return 5 + 10*expected_rules(as<Neg>(a->e1)->e);
+        if (as<Neg>(a->e2))          return 6;
+        return 0;
+    }
+
+    if (const Mul* p = as<Mul>(e))
+    {
+        const Val* v1 = as<Val>(p->e1);
+        const Val* v2 = as<Val>(p->e2);
+
+        if (v1 && v1->value == 1)    return 7;
+        if (v1 && as<Neg>(p->e2))    return 8;
+        if (as<Neg>(p->e1) && v2)    return 9;
+        if (v2 && v2->value == 0)    return 10;
+        return 0;
+    }
+
+    if (const Neg* g = as<Neg>(e))
+    {
+        if (as<Mul>(g->e))           return 11;
+        if (as<Val>(g->e))           return 12 + 10*XTL_SHARE_NESTED_TESTS;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+/// Owns all the expressions created by the test
+struct expressions : std::vector<const Expr*>
+{
+   ~expressions()
+    {
+        for (size_t i = 0; i < size(); ++i)
+            delete (*this)[i];
+    }
+
+    const Expr* keep(const Expr* e) { push_back(e); return e; }
+
+    /// Leaves, negations and binary nodes over leaves and negations
+    const Expr* make(size_t kind, const Expr* e1, const Expr* e2)
+    {
+        switch (kind % 5)
+        {
+        case 0:  return keep(new Val(int(kind % 3)));
+        case 1:  return keep(new Neg(e1));
+        case 2:  return keep(new Add(e1, e2));
+        case 3:  return keep(new Mul(e1, e2));
+        default: return keep(new Neg(keep(new Neg(e2))));
+        }
+    }
+};
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    int errors = 0;
+    expressions es;
+    std::vector<const Expr*> subjects;
+    unsigned long long seed = 1;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+        size_t k = size_t(seed >> 33);
+        const Expr* v1 = es.make(0, 0, 0);
+        const Expr* v2 = es.keep(new Val(int(k % 3)));
+        const Expr* e1 = es.make(k / 5 % 5 == 0 ? 0 : k / 5 % 5 + 5*(k / 125 % 3), v1, v2);
+        const Expr* e2 = k / 25 % 2 ? e1 : es.make(k / 375 % 5, v2, v1); // Same sub-term in both positions
+        subjects.push_back(es.make(k, e1, e2));
+    }
+
+    for (size_t i = 0; i < subjects.size(); ++i)
+        if (rules(subjects[i]) != expected_rules(subjects[i]))
+            std::cerr << "rules(" << i << ") == " << rules(subjects[i]) << " instead of " << expected_rules(subjects[i]) << std::endl, ++errors;
+
+    // Patterns applied outside of match statements do not remember anything,
+    // even when a sub-term is replaced by an object of another type.
+    errors += inside_shared_tests();
+    const Expr* v = new Val(1);
+    errors += !C<Val>()(v);
+    delete v;
+    v = new Neg(subjects[0]);
+    errors += C<Val>()(v) != nullptr || mch::shared_cast<const Val*>(v) != nullptr || mch::shared_cast<const Neg*>(v) != v;
+    delete v;
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,163 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises batched type switch #MatchEach over ranges of polymorphic
+/// subjects: every subject has to be visited exactly once, by the same clause
+/// #Match would have picked for it, and subjects of the same dynamic type have
+/// to be visited in the order they appear in the range.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <list>
+#include <vector>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+struct Other    : Shape {};
+
+//------------------------------------------------------------------------------
+
+Shape* make_shape(size_t i)
+{
+    switch (i*7 % 10)
+    {
+    case 0: return new CircleN<0>;
+    case 1: return new CircleN<1>;
+    case 2: return new CircleN<2>;
+    case 3: return new SquareN<0>;
+    case 4: return new SquareN<1>;
+    case 5: return new TriangleN<0>;
+    case 6: return new TriangleN<1>;
+    case 7: return new TriangleN<2>;
+    case 8: return new Other;
+    default:return new Shape;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/// Records the clause each subject was visited by and checks their order
+template <typename Range>
+size_t check(const Range& subjects, size_t n)
+{
+    std::vector<int>          results(n, -1);
+    std::vector<const Shape*> order;
+    size_t                    errors = 0;
+
+    MatchEach(subjects)
+    {
+    Case(Circle)   results[match0.id] = 1; order.push_back(&match0); break;
+    Case(Square)   results[match0.id] = 2; order.push_back(&match0); continue;
+    Case(Triangle) results[match0.id] = 3; order.push_back(&match0); break;
+    Otherwise()    results[match0.id] = 0; order.push_back(&match0); break;
+    }
+    EndMatchEach
+
+    if (order.size() != n)
+        ++errors;     // Some subjects were skipped or visited more than once
+
+    size_t k = 0;
+
+    for (typename Range::const_iterator p = subjects.begin(); p != subjects.end(); ++p, ++k)
+        if (results[k] != classify(mch::addr(*p)))
+            ++errors; // Wrong clause or not visited at all
+
+    // Subjects of the same type come in groups and keep their relative order
+    std::vector<intptr_t> seen;
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const intptr_t v = mch::vtbl_of(order[i]);
+
+        if (i == 0 || v != mch::vtbl_of(order[i-1]))
+        {
+            for (size_t j = 0; j < seen.size(); ++j)
+                if (seen[j] == v)
+                    ++errors; // Type appeared in two groups
+
+            seen.push_back(v);
+        }
+        else
+        if (order[i]->id < order[i-1]->id)
+            ++errors;         // Order within a group was not preserved
+    }
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const size_t n = 1000;
+
+    std::vector<Shape*> shapes;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        shapes.push_back(make_shape(i));
+        shapes.back()->id = i;
+    }
+
+    const std::list<const Shape*> shape_list(shapes.begin(), shapes.end());
+    std::vector<CircleN<3>>       circles(10);
+
+    for (size_t i = 0; i < circles.size(); ++i)
+        circles[i].id = i;
+
+    size_t errors = 0;
+
+    errors += check(shapes, n);       // Random-access range of pointers
+    errors += check(shape_list, n);   // Sequential range of pointers
+    errors += check(circles, circles.size()); // Range of references to objects
+    errors += check(std::vector<Shape*>(), 0);
+
+    for (size_t i = 0; i < n; ++i)
+        delete shapes[i];
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
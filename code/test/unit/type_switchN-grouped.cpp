@@ -0,0 +1,176 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises grouped_vector: a container keeping polymorphic objects in per
+/// type arenas, over which #MatchEach dispatches once per arena. Every object
+/// has to be visited exactly once, by the same clause #Match would have picked
+/// for it, and objects of an arena have to be visited in the insertion order.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <vector>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include <mach7/grouped_vector.hpp>        // Container of objects grouped by their dynamic types
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+/// Class with Shape not at the beginning of the object
+struct Named    { virtual ~Named() {} const char* name; };
+struct Other    : Named, Shape { Other(size_t i = 0) : Shape(i) {} };
+
+//------------------------------------------------------------------------------
+
+void add_shape(mch::grouped_vector<Shape>& shapes, size_t i)
+{
+    switch (i*7 % 9)
+    {
+    case 0: shapes.emplace_back<CircleN<0>>(i);   break;
+    case 1: shapes.emplace_back<CircleN<1>>(i);   break;
+    case 2: shapes.push_back(SquareN<0>(i));      break;
+    case 3: shapes.emplace_back<SquareN<1>>(i);   break;
+    case 4: shapes.emplace_back<TriangleN<0>>(i); break;
+    case 5: shapes.emplace_back<TriangleN<1>>(i); break;
+    case 6: shapes.emplace_back<Other>(i);        break;
+    case 7: shapes.emplace_back<Shape>(i);        break;
+    default:shapes.emplace_back<Circle>(i);       break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/// Records the clause each object was visited by and checks their order
+template <typename Container>
+size_t check(Container& shapes, size_t n)
+{
+    std::vector<int>          results(n, -1);
+    std::vector<const Shape*> order;
+    size_t                    errors = 0;
+
+    MatchEach(shapes)
+    {
+    Case(Circle)   results[match0.id] = 1; order.push_back(&match0); break;
+    Case(Square)   results[match0.id] = 2; order.push_back(&match0); break;
+    Case(Triangle) results[match0.id] = 3; order.push_back(&match0); break;
+    Otherwise()    results[match0.id] = 0; order.push_back(&match0); break;
+    }
+    EndMatchEach
+
+    if (order.size() != n || shapes.size() != n)
+        ++errors;     // Some objects were skipped or visited more than once
+
+    for (size_t i = 0; i < order.size(); ++i)
+        if (results[order[i]->id] != classify(order[i]))
+            ++errors; // Wrong clause
+
+    for (size_t i = 0; i < n; ++i)
+        if (results[i] < 0)
+            ++errors; // Not visited at all
+
+    // Objects of an arena come in a row and keep their insertion order
+    std::vector<intptr_t> seen;
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const intptr_t v = mch::vtbl_of(order[i]);
+
+        if (i == 0 || v != mch::vtbl_of(order[i-1]))
+        {
+            for (size_t j = 0; j < seen.size(); ++j)
+                if (seen[j] == v)
+                    ++errors; // Type appeared in two groups
+
+            seen.push_back(v);
+        }
+        else
+        if (order[i]->id < order[i-1]->id)
+            ++errors;         // Insertion order was not preserved
+    }
+
+    if (seen.size() != shapes.types())
+        ++errors;
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const size_t n = 1000;
+
+    mch::grouped_vector<Shape> shapes;
+
+    for (size_t i = 0; i < n; ++i)
+        add_shape(shapes, i);
+
+    size_t errors = 0;
+
+    errors += check(shapes, n);
+    errors += check(static_cast<const mch::grouped_vector<Shape>&>(shapes), n);
+
+    // Modification of objects through the container
+    MatchEach(shapes)
+    {
+    Case(Circle) match0.radius = 2.0; break;
+    }
+    EndMatchEach
+
+    MatchEach(shapes)
+    {
+    Case(Circle) if (match0.radius != 2.0) ++errors; break;
+    }
+    EndMatchEach
+
+    shapes.clear();
+    errors += check(shapes, 0);
+
+    for (size_t i = 0; i < n/2; ++i)
+        add_shape(shapes, i);
+
+    errors += check(shapes, n/2);
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,163 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises the multi-threaded version of vtbl_map<N,T> used by N-ary type
+/// switch: several threads concurrently match the same match statements over
+/// a mix of types large enough to force rearrangements of the cache, after
+/// which all the replaced cache descriptors are expected to be reclaimed.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#define XTL_MULTI_THREADING 1
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+int do_match(const Shape* s0)
+{
+    Match(s0)
+    {
+    Case(Circle)   return 1;
+    Case(Square)   return 2;
+    Case(Triangle) return 3;
+    Otherwise()    return 0;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int do_match(const Shape* s0, const Shape* s1)
+{
+    Match(s0,s1)
+    {
+    Case(Circle  , Circle  ) return 11;
+    Case(Circle  , Square  ) return 12;
+    Case(Circle  , Triangle) return 13;
+    Case(Square  , Circle  ) return 21;
+    Case(Square  , Square  ) return 22;
+    Case(Square  , Triangle) return 23;
+    Case(Triangle, Circle  ) return 31;
+    Case(Triangle, Square  ) return 32;
+    Case(Triangle, Triangle) return 33;
+    Otherwise()              return 0;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int do_match(const Shape* s0, const Shape* s1, const Shape* s2)
+{
+    Match(s0,s1,s2)
+    {
+    Case(Circle  , Circle  , Circle  ) return 111;
+    Case(Square  , Square  , Square  ) return 222;
+    Case(Triangle, Triangle, Triangle) return 333;
+    Case(Shape   , Shape   , Shape   ) return 0;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const std::vector<Shape*> shapes = make_all_shapes<0,1,2,3,4,5>();
+    const size_t n = shapes.size();
+    const size_t threads_count = 4;
+    const size_t iterations = 20000;
+
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < threads_count; ++t)
+        threads.push_back(std::thread([&shapes,&errors,n,t,iterations]()
+        {
+            size_t seed = 7*t+1;
+
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                seed = seed*1103515245 + 12345;
+                const Shape* a = shapes[(seed >>  8) % n];
+                const Shape* b = shapes[(seed >> 16) % n];
+                const Shape* c = shapes[(seed >> 24) % n];
+
+                int ca = classify(a), cb = classify(b), cc = classify(c);
+
+                if (do_match(a) != ca)
+                    ++errors;
+
+                if (do_match(a,b) != (ca && cb ? ca*10+cb : 0))
+                    ++errors;
+
+                if (do_match(a,b,c) != (ca && ca == cb && cb == cc ? ca*111 : 0))
+                    ++errors;
+            }
+        }));
+
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    for (size_t i = 0; i < n; ++i)
+        delete shapes[i];
+
+    // All the worker threads have exited, so nothing can block reclamation
+    mch::epoch_domain<>::reclaim();
+    const size_t pending = mch::epoch_domain<>::pending_count();
+
+    return report(errors, pending != 0, ", ", pending, " descriptors pending reclamation");
+}
+
+//------------------------------------------------------------------------------
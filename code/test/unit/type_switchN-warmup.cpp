@@ -0,0 +1,140 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Exercises ahead-of-time warm-up of vtbl_map<N,T> used by N-ary type switch:
+/// all the maps are seeded with the vtbl-pointers of known classes before any
+/// match statement is executed and then frozen and sealed, after which the
+/// statements are expected to produce the same results as without warm-up,
+/// including for classes that were not known at the time of warm-up.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <vector>
+#include <mach7/type_switchN.hpp>          // Support for N-ary type switch statement
+#include "shape_family.hpp"                // Shapes shared by the tests of dispatch tables
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+int do_match(const Shape* s0)
+{
+    Match(s0)
+    {
+    Case(Circle)   return 1;
+    Case(Square)   return 2;
+    Case(Triangle) return 3;
+    Otherwise()    return 0;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int do_match(const Shape* s0, const Shape* s1)
+{
+    Match(s0,s1)
+    {
+    Case(Circle  , Circle  ) return 11;
+    Case(Circle  , Square  ) return 12;
+    Case(Circle  , Triangle) return 13;
+    Case(Square  , Circle  ) return 21;
+    Case(Square  , Square  ) return 22;
+    Case(Square  , Triangle) return 23;
+    Case(Triangle, Circle  ) return 31;
+    Case(Triangle, Square  ) return 32;
+    Case(Triangle, Triangle) return 33;
+    Otherwise()              return 0;
+    }
+    EndMatch
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    std::vector<Shape*> shapes = make_all_shapes<0,1,2,3,4,5>();
+    std::vector<std::intptr_t> vtbls;
+
+    for (size_t i = 0; i < shapes.size(); ++i)
+        vtbls.push_back(mch::vtbl_of(shapes[i]));
+
+    // Both match statements above have their maps preallocated before main,
+    // but only the unary one is seeded with all the classes by default
+    const size_t unary  = mch::warm_up_all(vtbls.data(), vtbls.size());
+    const size_t warmed = mch::warm_up_all(vtbls.data(), vtbls.size(), 2);
+    const size_t sealed = mch::freeze_all();
+
+    // Classes unknown at the time of sealing have to be found the regular way
+    make_shapes<6>(shapes);
+    const size_t n = shapes.size();
+
+    size_t errors = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int ci = classify(shapes[i]);
+
+        if (do_match(shapes[i]) != ci)
+            ++errors;
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            const int cj = classify(shapes[j]);
+
+            if (do_match(shapes[i],shapes[j]) != (ci && cj ? ci*10+cj : 0))
+                ++errors;
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        delete shapes[i];
+
+    const bool failed = unary != 1 || warmed != 2 || sealed != warmed;
+
+    return report(errors, failed, ", ", unary, '/', warmed, " maps warmed up, ", sealed, " maps sealed");
+}
+
+//------------------------------------------------------------------------------
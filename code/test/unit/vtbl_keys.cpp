@@ -0,0 +1,132 @@
+//
+//  Mach7: Pattern Matching Library for C++
+//
+//  Copyright 2011-2013, Texas A&M University.
+//  Copyright 2014 Yuriy Solodkyy.
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//      * Redistributions of source code must retain the above copyright
+//        notice, this list of conditions and the following disclaimer.
+//
+//      * Redistributions in binary form must reproduce the above copyright
+//        notice, this list of conditions and the following disclaimer in the
+//        documentation and/or other materials provided with the distribution.
+//
+//      * Neither the names of Mach7 project nor the names of its contributors
+//        may be used to endorse or promote products derived from this software
+//        without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file
+///
+/// This file is a part of Mach7 library test suite.
+///
+/// Checks that the keys of N-ary vtbl maps are computed and compared the same
+/// way by the SIMD and BMI2 code paths (see XTL_USE_SIMD) as by the portable
+/// scalar functions of the library: interleaving of vtbl-pointers must produce
+/// bit-identical results and tuples must compare equal exactly when the early
+/// exit loop of the generic array_equal says so.
+///
+/// \author Yuriy Solodkyy <yuriy.solodkyy@gmail.com>
+///
+/// \see https://parasol.tamu.edu/mach7/
+/// \see https://github.com/solodon4/Mach7
+/// \see https://github.com/solodon4/SELL
+///
+
+#include <random>
+#include <mach7/vtblmap4.hpp>              // Keys of vtbl maps
+#include "testutils.hpp"                   // Reporting of the outcome of a test
+
+//------------------------------------------------------------------------------
+
+/// Number of scalar interleaving functions of the library that disagree with
+/// the one used by vtbl maps on the low 32/N bits of each element.
+inline size_t interleave_errors(const intptr_t (&v)[2])
+{
+    const intptr_t r = mch::interleave(v);
+    const uint32_t x = uint32_t(v[0]), y = uint32_t(v[1]);
+
+    return (r != intptr_t(mch::interleave(x,y)))
+         + (r != intptr_t(mch::interleave8x2(x,y)))
+         + (r != intptr_t(mch::interleave4x2(x,y)));
+}
+
+inline size_t interleave_errors(const intptr_t (&v)[3])
+{
+    return mch::interleave(v) != intptr_t(mch::interleave(uint32_t(v[0]),uint32_t(v[1]),uint32_t(v[2])));
+}
+
+inline size_t interleave_errors(const intptr_t (&v)[4])
+{
+    const intptr_t r = mch::interleave(v);
+    const uint32_t x = uint32_t(v[0]), y = uint32_t(v[1]), z = uint32_t(v[2]), w = uint32_t(v[3]);
+
+    return (r != intptr_t(mch::interleave(x,y,z,w)))
+         + (r != intptr_t(mch::interleave8x4(x,y,z,w)))
+         + (r != intptr_t(mch::interleave4x4(x,y,z,w)));
+}
+
+//------------------------------------------------------------------------------
+
+template <size_t N>
+size_t test(std::mt19937_64& rng, size_t iterations)
+{
+    const intptr_t mask   = (intptr_t(1) << 32/N) - 1;
+    size_t         errors = 0;
+
+    for (size_t k = 0; k < iterations; ++k)
+    {
+        intptr_t a[N];
+        intptr_t b[N];
+
+        for (size_t i = 0; i < N; ++i)
+            a[i] = b[i] = intptr_t(rng() & ~uint64_t(7)); // vtbl-pointers are aligned
+
+        // Interleaving only looks at the low bits of each vtbl-pointer
+        intptr_t v[N];
+
+        for (size_t i = 0; i < N; ++i)
+            v[i] = a[i] & mask;
+
+        errors += interleave_errors(v);
+
+        if (!mch::array_equal(a,b))
+            ++errors;
+
+        // Tuples that differ in a single position, including in the high bits
+        b[k % N] ^= intptr_t(1) << (3 + rng() % 60);
+
+        if (mch::array_equal(a,b) != mch::array_equal<intptr_t,N>(a,b))
+            ++errors;
+    }
+
+    return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    std::mt19937_64 rng(42);
+    const size_t    iterations = 100000;
+    const size_t    errors     = test<2>(rng,iterations) + test<3>(rng,iterations) + test<4>(rng,iterations);
+
+    return report(errors);
+}
+
+//------------------------------------------------------------------------------